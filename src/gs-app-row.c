@@ -364,6 +364,9 @@ gs_app_row_set_app (GsAppRow *app_row, GsApp *app)
 	g_signal_connect_object (app_row->priv->app, "notify::progress",
 				 G_CALLBACK (gs_app_row_notify_props_changed_cb),
 				 app_row, 0);
+	g_signal_connect_object (app_row->priv->app, "notify::pixbuf",
+				 G_CALLBACK (gs_app_row_notify_props_changed_cb),
+				 app_row, 0);
 	gs_app_row_refresh (app_row);
 }
 
@@ -121,6 +121,13 @@ app_state_changed (GsApp *app, GParamSpec *pspec, GsAppTile *tile)
 	g_idle_add (app_state_changed_idle, g_object_ref (tile));
 }
 
+static void
+app_pixbuf_changed (GsApp *app, GParamSpec *pspec, GsAppTile *tile)
+{
+	GsAppTilePrivate *priv = gs_app_tile_get_instance_private (tile);
+	gs_image_set_from_pixbuf (GTK_IMAGE (priv->image), gs_app_get_pixbuf (app));
+}
+
 void
 gs_app_tile_set_app (GsAppTile *tile, GsApp *app)
 {
@@ -135,8 +142,10 @@ gs_app_tile_set_app (GsAppTile *tile, GsApp *app)
 	gtk_image_clear (GTK_IMAGE (priv->image));
 	gtk_image_set_pixel_size (GTK_IMAGE (priv->image), 64);
 
-	if (priv->app)
+	if (priv->app) {
 		g_signal_handlers_disconnect_by_func (priv->app, app_state_changed, tile);
+		g_signal_handlers_disconnect_by_func (priv->app, app_pixbuf_changed, tile);
+	}
 
 	g_clear_object (&priv->app);
 	if (!app)
@@ -157,6 +166,8 @@ gs_app_tile_set_app (GsAppTile *tile, GsApp *app)
 	g_signal_connect (priv->app, "notify::state",
 			  G_CALLBACK (app_state_changed), tile);
 	app_state_changed (priv->app, NULL, tile);
+	g_signal_connect (priv->app, "notify::pixbuf",
+			  G_CALLBACK (app_pixbuf_changed), tile);
 
 	gs_image_set_from_pixbuf (GTK_IMAGE (priv->image), gs_app_get_pixbuf (app));
 	gtk_label_set_label (GTK_LABEL (priv->name), gs_app_get_name (app));
@@ -173,8 +184,10 @@ gs_app_tile_destroy (GtkWidget *widget)
 
 	priv = gs_app_tile_get_instance_private (tile);
 
-	if (priv->app)
+	if (priv->app) {
 		g_signal_handlers_disconnect_by_func (priv->app, app_state_changed, tile);
+		g_signal_handlers_disconnect_by_func (priv->app, app_pixbuf_changed, tile);
+	}
 	g_clear_object (&priv->app);
 
 	GTK_WIDGET_CLASS (gs_app_tile_parent_class)->destroy (widget);
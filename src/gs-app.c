@@ -49,6 +49,7 @@
 
 #include "gs-app.h"
 #include "gs-cleanup.h"
+#include "gs-icon-cache.h"
 #include "gs-utils.h"
 
 struct GsAppPrivate
@@ -88,6 +89,7 @@ struct GsAppPrivate
 	guint			 progress;
 	GHashTable		*metadata;
 	GdkPixbuf		*pixbuf;
+	gint			 icon_load;
 	GdkPixbuf		*featured_pixbuf;
 	GPtrArray		*addons; /* of GsApp */
 	GHashTable		*addons_hash; /* of "id" */
@@ -98,6 +100,7 @@ struct GsAppPrivate
 	guint64			 kudos;
 	gboolean		 to_be_installed;
 	AsBundle		*bundle;
+	volatile guint		 notify_pending; /* bitmask of PROP_ */
 };
 
 enum {
@@ -112,9 +115,12 @@ enum {
 	PROP_STATE,
 	PROP_PROGRESS,
 	PROP_INSTALL_DATE,
+	PROP_PIXBUF,
 	PROP_LAST
 };
 
+static GParamSpec *obj_props[PROP_LAST] = { NULL, };
+
 #define APP_PRIV(app) ((GsAppPrivate *) gs_app_get_instance_private ((GsApp *) (app)))
 
 G_DEFINE_TYPE_WITH_PRIVATE (GsApp, gs_app, G_TYPE_OBJECT)
@@ -318,36 +324,45 @@ gs_app_to_string (GsApp *app)
 	return g_string_free (str, FALSE);
 }
 
-typedef struct {
-	GsApp *app;
-	gchar *property_name;
-} AppNotifyData;
-
+/**
+ * gs_app_notify_idle_cb:
+ *
+ * Emits every property that changed since the idle was queued, so a
+ * refine that sets many properties only wakes up the UI once.
+ **/
 static gboolean
-notify_idle_cb (gpointer data)
+gs_app_notify_idle_cb (gpointer data)
 {
-	AppNotifyData *notify_data = data;
-
-	g_object_notify (G_OBJECT (notify_data->app),
-			 notify_data->property_name);
-
-	g_object_unref (notify_data->app);
-	g_free (notify_data->property_name);
-	g_free (notify_data);
+	GsApp *app = GS_APP (data);
+	GsAppPrivate *priv = APP_PRIV (app);
+	guint pending;
+	guint i;
 
+	pending = g_atomic_int_and (&priv->notify_pending, 0);
+	g_object_freeze_notify (G_OBJECT (app));
+	for (i = PROP_0 + 1; i < PROP_LAST; i++) {
+		if (pending & (1u << i))
+			g_object_notify_by_pspec (G_OBJECT (app), obj_props[i]);
+	}
+	g_object_thaw_notify (G_OBJECT (app));
+	g_object_unref (app);
 	return G_SOURCE_REMOVE;
 }
 
+/**
+ * gs_app_queue_notify:
+ *
+ * Marks @prop_id as changed; this can be called from any thread and the
+ * notification is emitted from the main loop.
+ **/
 static void
-gs_app_queue_notify (GsApp *app, const gchar *property_name)
+gs_app_queue_notify (GsApp *app, guint prop_id)
 {
-	AppNotifyData *notify_data;
-
-	notify_data = g_new (AppNotifyData, 1);
-	notify_data->app = g_object_ref (app);
-	notify_data->property_name = g_strdup (property_name);
+	GsAppPrivate *priv = APP_PRIV (app);
 
-	g_idle_add (notify_idle_cb, notify_data);
+	/* the first change since the last idle schedules a new one */
+	if (g_atomic_int_or (&priv->notify_pending, 1u << prop_id) == 0)
+		g_idle_add (gs_app_notify_idle_cb, g_object_ref (app));
 }
 
 /**
@@ -504,7 +519,7 @@ gs_app_set_progress (GsApp *app, guint percentage)
 	if (priv->progress == percentage)
 		return;
 	priv->progress = percentage;
-	gs_app_queue_notify (app, "progress");
+	gs_app_queue_notify (app, PROP_PROGRESS);
 }
 
 /**
@@ -530,7 +545,7 @@ gs_app_set_state (GsApp *app, AsAppState state)
 	g_return_if_fail (GS_IS_APP (app));
 
 	if (gs_app_set_state_internal (app, state))
-		gs_app_queue_notify (app, "state");
+		gs_app_queue_notify (app, PROP_STATE);
 }
 
 /**
@@ -607,7 +622,7 @@ gs_app_set_kind (GsApp *app, GsAppKind kind)
 	}
 
 	priv->kind = kind;
-	gs_app_queue_notify (app, "kind");
+	gs_app_queue_notify (app, PROP_KIND);
 }
 
 /**
@@ -827,6 +842,18 @@ gs_app_is_addon_id_kind (GsApp *app)
 	return TRUE;
 }
 
+#define GS_APP_ICON_MAX_THREADS		4
+
+typedef enum {
+	GS_APP_ICON_LOAD_NONE,
+	GS_APP_ICON_LOAD_PENDING,
+	GS_APP_ICON_LOAD_FAILED
+} GsAppIconLoad;
+
+static GThreadPool	*icon_pool;
+static gint		 icon_pool_pending;
+static GMutex		 icon_lock;	/* protects swapping the AsIcon */
+
 static GtkIconTheme	*icon_theme_singleton;
 static GMutex		 icon_theme_lock;
 static GHashTable	*icon_theme_paths;
@@ -918,6 +945,58 @@ gs_app_get_pixbuf (GsApp *app)
 	return APP_PRIV (app)->pixbuf;
 }
 
+/**
+ * gs_app_has_icon:
+ *
+ * Checks if gs_app_get_pixbuf() returns a pixbuf now or once the icon has
+ * been downloaded and loaded, using the same fallback icons. This only
+ * uses the icon metadata and never loads anything.
+ */
+gboolean
+gs_app_has_icon (GsApp *app)
+{
+	AsIcon *icon;
+
+	g_return_val_if_fail (GS_IS_APP (app), FALSE);
+
+	if (APP_PRIV (app)->pixbuf != NULL)
+		return TRUE;
+	icon = APP_PRIV (app)->icon;
+	if (icon != NULL) {
+		switch (as_icon_get_kind (icon)) {
+		case AS_ICON_KIND_STOCK:
+		case AS_ICON_KIND_CACHED:
+			if (as_icon_get_name (icon) != NULL)
+				return TRUE;
+			break;
+		case AS_ICON_KIND_LOCAL:
+			if (as_icon_get_filename (icon) != NULL)
+				return TRUE;
+			break;
+		case AS_ICON_KIND_REMOTE:
+			/* the icons plugin downloads it to the filename */
+			if (as_icon_get_url (icon) != NULL &&
+			    as_icon_get_filename (icon) != NULL)
+				return TRUE;
+			break;
+		default:
+			break;
+		}
+	}
+
+	/* these use a generic icon from the theme */
+	if (gs_app_get_state (app) == AS_APP_STATE_AVAILABLE_LOCAL)
+		return TRUE;
+	switch (gs_app_get_kind (app)) {
+	case GS_APP_KIND_PACKAGE:
+	case GS_APP_KIND_OS_UPDATE:
+	case GS_APP_KIND_MISSING:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
 /**
  * gs_app_get_icon:
  */
@@ -937,25 +1016,122 @@ gs_app_set_icon (GsApp *app, AsIcon *icon)
 	g_return_if_fail (GS_IS_APP (app));
 
 	/* save icon */
+	g_mutex_lock (&icon_lock);
 	g_clear_object (&APP_PRIV (app)->icon);
 	if (icon != NULL)
 		APP_PRIV (app)->icon = g_object_ref (icon);
+	g_mutex_unlock (&icon_lock);
+
+	/* allow a new icon to be loaded */
+	g_atomic_int_compare_and_exchange (&APP_PRIV (app)->icon_load,
+					   GS_APP_ICON_LOAD_FAILED,
+					   GS_APP_ICON_LOAD_NONE);
 }
 
 /**
- * gs_app_load_icon:
+ * gs_app_dup_icon:
+ *
+ * Returns: a private copy of the icon, which a worker thread can load
+ * into without racing gs_app_set_icon() or anyone else using the icon
  */
-gboolean
-gs_app_load_icon (GsApp *app, gint scale, GError **error)
+static AsIcon *
+gs_app_dup_icon (GsApp *app)
 {
 	AsIcon *icon;
+	AsIcon *src;
+
+	g_mutex_lock (&icon_lock);
+	src = APP_PRIV (app)->icon;
+	if (src == NULL) {
+		g_mutex_unlock (&icon_lock);
+		return NULL;
+	}
+	icon = as_icon_new ();
+	as_icon_set_kind (icon, as_icon_get_kind (src));
+#if AS_CHECK_VERSION(0,5,0)
+	as_icon_set_name (icon, as_icon_get_name (src));
+	as_icon_set_url (icon, as_icon_get_url (src));
+#else
+	as_icon_set_name (icon, as_icon_get_name (src), -1);
+	as_icon_set_url (icon, as_icon_get_url (src), -1);
+#endif
+	as_icon_set_filename (icon, as_icon_get_filename (src));
+	as_icon_set_prefix (icon, as_icon_get_prefix (src));
+	as_icon_set_width (icon, as_icon_get_width (src));
+	as_icon_set_height (icon, as_icon_get_height (src));
+	g_mutex_unlock (&icon_lock);
+	return icon;
+}
+
+/**
+ * gs_app_get_icon_source:
+ *
+ * Returns: the file that @icon will be decoded from, or %NULL if unknown
+ */
+static gchar *
+gs_app_get_icon_source (AsIcon *icon, gint scale)
+{
+	GtkIconInfo *icon_info;
+	gchar *filename = NULL;
+	guint i;
+	gint sizes[] = { 64 * scale, 64, 0 };
+
+	switch (as_icon_get_kind (icon)) {
+	case AS_ICON_KIND_LOCAL:
+		return g_strdup (as_icon_get_filename (icon));
+	case AS_ICON_KIND_CACHED:
+		if (as_icon_get_prefix (icon) == NULL)
+			return NULL;
+		for (i = 0; sizes[i] != 0; i++) {
+			_cleanup_free_ gchar *size_str = NULL;
+			size_str = g_strdup_printf ("%ix%i", sizes[i], sizes[i]);
+			filename = g_build_filename (as_icon_get_prefix (icon),
+						     size_str,
+						     as_icon_get_name (icon),
+						     NULL);
+			if (g_file_test (filename, G_FILE_TEST_EXISTS))
+				return filename;
+			g_clear_pointer (&filename, g_free);
+		}
+		return NULL;
+	case AS_ICON_KIND_STOCK:
+		g_mutex_lock (&icon_theme_lock);
+		icon_theme_add_path (as_icon_get_prefix (icon));
+		icon_info = gtk_icon_theme_lookup_icon (icon_theme_get (),
+							as_icon_get_name (icon),
+							64 * scale,
+							GTK_ICON_LOOKUP_USE_BUILTIN |
+							GTK_ICON_LOOKUP_FORCE_SIZE);
+		if (icon_info != NULL) {
+			filename = g_strdup (gtk_icon_info_get_filename (icon_info));
+			g_object_unref (icon_info);
+		}
+		g_mutex_unlock (&icon_theme_lock);
+		return filename;
+	default:
+		return NULL;
+	}
+}
+
+/**
+ * gs_app_load_icon_internal:
+ *
+ * Loads @icon, which must not be shared with any other thread.
+ */
+static gboolean
+gs_app_load_icon_internal (GsApp *app, AsIcon *icon, gint scale, GError **error)
+{
+	_cleanup_free_ gchar *source = NULL;
 	_cleanup_object_unref_ GdkPixbuf *pixbuf = NULL;
 
-	g_return_val_if_fail (GS_IS_APP (app), FALSE);
-	g_return_val_if_fail (APP_PRIV (app)->icon != NULL, FALSE);
+	/* already decoded in a previous session from the same file */
+	pixbuf = gs_icon_cache_lookup (gs_app_get_id (app), icon, scale);
+	if (pixbuf != NULL) {
+		gs_app_set_pixbuf (app, pixbuf);
+		return TRUE;
+	}
 
 	/* either load from the theme or from a file */
-	icon = gs_app_get_icon (app);
 	switch (as_icon_get_kind (icon)) {
 	case AS_ICON_KIND_LOCAL:
 		if (as_icon_get_filename (icon) == NULL) {
@@ -971,6 +1147,11 @@ gs_app_load_icon (GsApp *app, gint scale, GError **error)
 							   64 * scale,
 							   error);
 		break;
+	case AS_ICON_KIND_CACHED:
+		if (!as_icon_load (icon, AS_ICON_LOAD_FLAG_SEARCH_SIZE, error))
+			return FALSE;
+		pixbuf = g_object_ref (as_icon_get_pixbuf (icon));
+		break;
 	case AS_ICON_KIND_STOCK:
 		g_mutex_lock (&icon_theme_lock);
 		icon_theme_add_path (as_icon_get_prefix (icon));
@@ -992,21 +1173,169 @@ gs_app_load_icon (GsApp *app, gint scale, GError **error)
 	}
 	if (pixbuf == NULL)
 		return FALSE;
+	source = gs_app_get_icon_source (icon, scale);
+	gs_icon_cache_save (gs_app_get_id (app), icon, source, scale, pixbuf);
 	gs_app_set_pixbuf (app, pixbuf);
 	return TRUE;
 }
 
+/**
+ * gs_app_load_icon:
+ */
+gboolean
+gs_app_load_icon (GsApp *app, gint scale, GError **error)
+{
+	_cleanup_object_unref_ AsIcon *icon = NULL;
+
+	g_return_val_if_fail (GS_IS_APP (app), FALSE);
+
+	icon = gs_app_dup_icon (app);
+	g_return_val_if_fail (icon != NULL, FALSE);
+	return gs_app_load_icon_internal (app, icon, scale, error);
+}
+
+typedef struct {
+	GsApp		*app;
+	GdkPixbuf	*pixbuf;
+} GsAppPixbufHelper;
+
+/**
+ * gs_app_set_pixbuf_internal:
+ */
+static void
+gs_app_set_pixbuf_internal (GsApp *app, GdkPixbuf *pixbuf)
+{
+	if (APP_PRIV (app)->pixbuf != NULL)
+		g_object_unref (APP_PRIV (app)->pixbuf);
+	APP_PRIV (app)->pixbuf = g_object_ref (pixbuf);
+	gs_app_queue_notify (app, PROP_PIXBUF);
+}
+
+/**
+ * gs_app_set_pixbuf_idle_cb:
+ */
+static gboolean
+gs_app_set_pixbuf_idle_cb (gpointer user_data)
+{
+	GsAppPixbufHelper *helper = (GsAppPixbufHelper *) user_data;
+	gs_app_set_pixbuf_internal (helper->app, helper->pixbuf);
+	g_object_unref (helper->app);
+	g_object_unref (helper->pixbuf);
+	g_slice_free (GsAppPixbufHelper, helper);
+	return G_SOURCE_REMOVE;
+}
+
 /**
  * gs_app_set_pixbuf:
+ *
+ * The widgets showing the old pixbuf only ever look at it in the main
+ * thread, so unless called while dispatching the default main context the
+ * pixbuf is swapped in from an idle handler instead. This is what
+ * g_main_context_invoke() does, except that a worker thread never takes
+ * the context for itself when the main loop happens to be idle.
  */
 void
 gs_app_set_pixbuf (GsApp *app, GdkPixbuf *pixbuf)
 {
+	GsAppPixbufHelper *helper;
+
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (GDK_IS_PIXBUF (pixbuf));
-	if (APP_PRIV (app)->pixbuf != NULL)
-		g_object_unref (APP_PRIV (app)->pixbuf);
-	APP_PRIV (app)->pixbuf = g_object_ref (pixbuf);
+
+	if (g_main_context_is_owner (g_main_context_default ())) {
+		gs_app_set_pixbuf_internal (app, pixbuf);
+		return;
+	}
+	helper = g_slice_new (GsAppPixbufHelper);
+	helper->app = g_object_ref (app);
+	helper->pixbuf = g_object_ref (pixbuf);
+	g_idle_add (gs_app_set_pixbuf_idle_cb, helper);
+}
+
+typedef struct {
+	GsApp		*app;
+	AsIcon		*icon;		/* private copy */
+	gint		 scale;
+} GsAppIconJob;
+
+/**
+ * gs_app_icon_pool_cb:
+ */
+static void
+gs_app_icon_pool_cb (gpointer data, gpointer user_data)
+{
+	GsAppIconJob *job = (GsAppIconJob *) data;
+	_cleanup_error_free_ GError *error = NULL;
+
+	if (!gs_app_load_icon_internal (job->app, job->icon, job->scale, &error)) {
+		g_warning ("failed to load icon for %s: %s",
+			   gs_app_get_id (job->app), error->message);
+		g_atomic_int_set (&APP_PRIV (job->app)->icon_load,
+				  GS_APP_ICON_LOAD_FAILED);
+	} else {
+		g_atomic_int_set (&APP_PRIV (job->app)->icon_load,
+				  GS_APP_ICON_LOAD_NONE);
+	}
+	g_object_unref (job->app);
+	g_object_unref (job->icon);
+	g_slice_free (GsAppIconJob, job);
+	g_atomic_int_add (&icon_pool_pending, -1);
+}
+
+/**
+ * gs_app_load_icon_async:
+ *
+ * Loads the icon using a small pool of worker threads, so that decoding
+ * the image does not block whoever is refining or showing the app.
+ * The pixbuf is set later, and "notify::pixbuf" is emitted in the main
+ * thread. Nothing is done if a load is already pending or has failed.
+ */
+void
+gs_app_load_icon_async (GsApp *app, gint scale)
+{
+	static gsize icon_pool_init = 0;
+	AsIcon *icon;
+	GsAppIconJob *job;
+
+	g_return_if_fail (GS_IS_APP (app));
+
+	if (!g_atomic_int_compare_and_exchange (&APP_PRIV (app)->icon_load,
+						GS_APP_ICON_LOAD_NONE,
+						GS_APP_ICON_LOAD_PENDING))
+		return;
+	icon = gs_app_dup_icon (app);
+	if (icon == NULL) {
+		g_atomic_int_set (&APP_PRIV (app)->icon_load,
+				  GS_APP_ICON_LOAD_NONE);
+		return;
+	}
+
+	if (g_once_init_enter (&icon_pool_init)) {
+		icon_pool = g_thread_pool_new (gs_app_icon_pool_cb, NULL,
+					       GS_APP_ICON_MAX_THREADS,
+					       FALSE, NULL);
+		g_once_init_leave (&icon_pool_init, 1);
+	}
+
+	job = g_slice_new (GsAppIconJob);
+	job->app = g_object_ref (app);
+	job->icon = icon;
+	job->scale = scale;
+	g_atomic_int_inc (&icon_pool_pending);
+	g_thread_pool_push (icon_pool, job, NULL);
+}
+
+/**
+ * gs_app_load_icon_wait:
+ *
+ * Blocks until every icon queued by gs_app_load_icon_async() has been
+ * loaded. The pixbufs may still be waiting to be set in the main thread.
+ */
+void
+gs_app_load_icon_wait (void)
+{
+	while (g_atomic_int_get (&icon_pool_pending) > 0)
+		g_usleep (G_USEC_PER_SEC / 100);
 }
 
 /**
@@ -1128,7 +1457,7 @@ gs_app_ui_versions_populate (GsApp *app)
 		priv->version_ui = gs_app_get_ui_version (priv->version, flags[i]);
 		priv->update_version_ui = gs_app_get_ui_version (priv->update_version, flags[i]);
 		if (g_strcmp0 (priv->version_ui, priv->update_version_ui) != 0) {
-			gs_app_queue_notify (app, "version");
+			gs_app_queue_notify (app, PROP_VERSION);
 			return;
 		}
 		gs_app_ui_versions_invalidate (app);
@@ -1181,7 +1510,7 @@ gs_app_set_version (GsApp *app, const gchar *version)
 	g_free (APP_PRIV (app)->version);
 	APP_PRIV (app)->version = g_strdup (version);
 	gs_app_ui_versions_invalidate (app);
-	gs_app_queue_notify (app, "version");
+	gs_app_queue_notify (app, PROP_VERSION);
 }
 
 /**
@@ -1473,7 +1802,7 @@ gs_app_set_update_version (GsApp *app, const gchar *update_version)
 {
 	g_return_if_fail (GS_IS_APP (app));
 	gs_app_set_update_version_internal (app, update_version);
-	gs_app_queue_notify (app, "version");
+	gs_app_queue_notify (app, PROP_VERSION);
 }
 
 /**
@@ -1539,7 +1868,7 @@ gs_app_set_rating (GsApp *app, gint rating)
 {
 	g_return_if_fail (GS_IS_APP (app));
 	APP_PRIV (app)->rating = rating;
-	gs_app_queue_notify (app, "rating");
+	gs_app_queue_notify (app, PROP_RATING);
 }
 
 /**
@@ -1591,7 +1920,7 @@ gs_app_set_rating_kind (GsApp *app, GsAppRatingKind rating_kind)
 {
 	g_return_if_fail (GS_IS_APP (app));
 	APP_PRIV (app)->rating_kind = rating_kind;
-	gs_app_queue_notify (app, "rating");
+	gs_app_queue_notify (app, PROP_RATING);
 }
 
 /**
@@ -2102,6 +2431,9 @@ gs_app_get_property (GObject *object, guint prop_id, GValue *value, GParamSpec *
 	case PROP_INSTALL_DATE:
 		g_value_set_uint64 (value, priv->install_date);
 		break;
+	case PROP_PIXBUF:
+		g_value_set_object (value, priv->pixbuf);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -2241,6 +2573,7 @@ gs_app_class_init (GsAppClass *klass)
 	pspec = g_param_spec_string ("id", NULL, NULL,
 				     NULL,
 				     G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+	obj_props[PROP_ID] = pspec;
 	g_object_class_install_property (object_class, PROP_ID, pspec);
 
 	/**
@@ -2249,6 +2582,7 @@ gs_app_class_init (GsAppClass *klass)
 	pspec = g_param_spec_string ("name", NULL, NULL,
 				     NULL,
 				     G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+	obj_props[PROP_NAME] = pspec;
 	g_object_class_install_property (object_class, PROP_NAME, pspec);
 
 	/**
@@ -2257,6 +2591,7 @@ gs_app_class_init (GsAppClass *klass)
 	pspec = g_param_spec_string ("version", NULL, NULL,
 				     NULL,
 				     G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+	obj_props[PROP_VERSION] = pspec;
 	g_object_class_install_property (object_class, PROP_VERSION, pspec);
 
 	/**
@@ -2265,11 +2600,13 @@ gs_app_class_init (GsAppClass *klass)
 	pspec = g_param_spec_string ("summary", NULL, NULL,
 				     NULL,
 				     G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+	obj_props[PROP_SUMMARY] = pspec;
 	g_object_class_install_property (object_class, PROP_SUMMARY, pspec);
 
 	pspec = g_param_spec_string ("description", NULL, NULL,
 				     NULL,
 				     G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+	obj_props[PROP_DESCRIPTION] = pspec;
 	g_object_class_install_property (object_class, PROP_DESCRIPTION, pspec);
 
 	/**
@@ -2278,6 +2615,7 @@ gs_app_class_init (GsAppClass *klass)
 	pspec = g_param_spec_int ("rating", NULL, NULL,
 				  -1, 100, -1,
 				  G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+	obj_props[PROP_RATING] = pspec;
 	g_object_class_install_property (object_class, PROP_RATING, pspec);
 
 	/**
@@ -2288,6 +2626,7 @@ gs_app_class_init (GsAppClass *klass)
 				   GS_APP_KIND_LAST,
 				   GS_APP_KIND_UNKNOWN,
 				   G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+	obj_props[PROP_KIND] = pspec;
 	g_object_class_install_property (object_class, PROP_KIND, pspec);
 
 	/**
@@ -2298,6 +2637,7 @@ gs_app_class_init (GsAppClass *klass)
 				   AS_APP_STATE_LAST,
 				   AS_APP_STATE_UNKNOWN,
 				   G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+	obj_props[PROP_STATE] = pspec;
 	g_object_class_install_property (object_class, PROP_STATE, pspec);
 
 	/**
@@ -2305,12 +2645,23 @@ gs_app_class_init (GsAppClass *klass)
 	 */
 	pspec = g_param_spec_uint ("progress", NULL, NULL, 0, 100, 0,
 				   G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+	obj_props[PROP_PROGRESS] = pspec;
 	g_object_class_install_property (object_class, PROP_PROGRESS, pspec);
 
 	pspec = g_param_spec_uint64 ("install-date", NULL, NULL,
 				     0, G_MAXUINT64, 0,
 				     G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+	obj_props[PROP_INSTALL_DATE] = pspec;
 	g_object_class_install_property (object_class, PROP_INSTALL_DATE, pspec);
+
+	/**
+	 * GsApp:pixbuf:
+	 */
+	pspec = g_param_spec_object ("pixbuf", NULL, NULL,
+				     GDK_TYPE_PIXBUF,
+				     G_PARAM_READABLE);
+	obj_props[PROP_PIXBUF] = pspec;
+	g_object_class_install_property (object_class, PROP_PIXBUF, pspec);
 }
 
 /**
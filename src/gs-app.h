@@ -197,12 +197,16 @@ void		 gs_app_set_management_plugin	(GsApp		*app,
 GdkPixbuf	*gs_app_get_pixbuf		(GsApp		*app);
 void		 gs_app_set_pixbuf		(GsApp		*app,
 						 GdkPixbuf	*pixbuf);
+gboolean	 gs_app_has_icon		(GsApp		*app);
 AsIcon		*gs_app_get_icon		(GsApp		*app);
 void		 gs_app_set_icon		(GsApp		*app,
 						 AsIcon		*icon);
 gboolean	 gs_app_load_icon		(GsApp		*app,
 						 gint		 scale,
 						 GError		**error);
+void		 gs_app_load_icon_async		(GsApp		*app,
+						 gint		 scale);
+void		 gs_app_load_icon_wait		(void);
 GdkPixbuf	*gs_app_get_featured_pixbuf	(GsApp		*app);
 void		 gs_app_set_featured_pixbuf	(GsApp		*app,
 						 GdkPixbuf	*pixbuf);
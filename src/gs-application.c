@@ -37,6 +37,7 @@
 
 #include "gs-dbus-helper.h"
 #include "gs-box.h"
+#include "gs-cache.h"
 #include "gs-cleanup.h"
 #include "gs-first-run-dialog.h"
 #include "gs-shell.h"
@@ -330,7 +331,15 @@ profile_activated (GSimpleAction *action,
 		   gpointer       data)
 {
 	GsApplication *app = GS_APPLICATION (data);
+	const gchar *trace;
+	_cleanup_error_free_ GError *error = NULL;
+
 	gs_profile_dump (app->profile);
+
+	/* also save a timeline that can be loaded into a trace viewer */
+	trace = g_getenv ("GNOME_SOFTWARE_TRACE");
+	if (trace != NULL && !gs_profile_export_trace (app->profile, trace, &error))
+		g_warning ("failed to save trace: %s", error->message);
 }
 
 static void
@@ -569,6 +578,7 @@ gs_application_startup (GApplication *application)
 	gs_application_provide_search (GS_APPLICATION (application));
 	gs_application_monitor_network (GS_APPLICATION (application));
 	gs_folders_convert ();
+	gs_cache_load_async ();
 }
 
 static void
@@ -580,6 +590,21 @@ gs_application_activate (GApplication *application)
 	gs_application_show_first_run_dialog (GS_APPLICATION (application));
 }
 
+static void
+gs_application_shutdown (GApplication *application)
+{
+	GsApplication *app = GS_APPLICATION (application);
+	_cleanup_error_free_ GError *error = NULL;
+
+	/* the next start can show these straight away */
+	if (app->plugin_loader != NULL &&
+	    !gs_plugin_loader_save_snapshot (app->plugin_loader, &error))
+		g_warning ("failed to save snapshot: %s", error->message);
+	gs_cache_flush ();
+
+	G_APPLICATION_CLASS (gs_application_parent_class)->shutdown (application);
+}
+
 static void
 gs_application_dispose (GObject *object)
 {
@@ -719,6 +744,7 @@ gs_application_class_init (GsApplicationClass *class)
 	G_OBJECT_CLASS (class)->dispose = gs_application_dispose;
 	G_APPLICATION_CLASS (class)->startup = gs_application_startup;
 	G_APPLICATION_CLASS (class)->activate = gs_application_activate;
+	G_APPLICATION_CLASS (class)->shutdown = gs_application_shutdown;
 	G_APPLICATION_CLASS (class)->local_command_line = gs_application_local_command_line;
 }
 
@@ -0,0 +1,733 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2015 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib/gstdio.h>
+
+#include "gs-cache.h"
+#include "gs-cleanup.h"
+
+/*
+ * All the files downloaded by gnome-software are recorded in a single index
+ * in the user cache dir. The index is loaded once, and checked against the
+ * disk in a worker thread, after which looking up a file does not need to
+ * touch the disk. Changes are batched and written a few seconds later, also
+ * in a worker thread. The least recently used files are deleted when the
+ * total size goes over the budget, which can be set in MiB using
+ * GNOME_SOFTWARE_CACHE_SIZE. Icons used in this session are never deleted,
+ * as an application may still point to the file. The files that can be
+ * deleted are kept in access order, so eviction never has to sort them.
+ */
+
+#define GS_CACHE_SIZE_DEFAULT		256	/* MiB */
+#define GS_CACHE_MAX_AGE		(24 * 60 * 60)	/* seconds */
+#define GS_CACHE_SAVE_DELAY		5	/* seconds */
+
+typedef struct {
+	gchar		*filename;
+	GsCacheKind	 kind;
+	guint64		 size;
+	gint64		 atime;
+	gint64		 validated;
+	gchar		*etag;
+	gchar		*last_modified;
+	GList		*link;		/* in gs_cache_lru, or NULL if kept */
+} GsCacheEntry;
+
+static GMutex		 gs_cache_mutex;
+static GMutex		 gs_cache_save_mutex;		/* held while writing */
+static GHashTable	*gs_cache_entries = NULL;	/* filename:GsCacheEntry */
+static GQueue		 gs_cache_lru = G_QUEUE_INIT;	/* oldest first */
+static guint64		 gs_cache_total = 0;		/* excluding firmware */
+static gboolean		 gs_cache_dirty = FALSE;
+static guint		 gs_cache_save_id = 0;
+static gint64		 gs_cache_session_start = 0;
+
+typedef struct {
+	gchar		*filename;
+	guint64		 size;
+} GsCacheVerify;
+
+/**
+ * gs_cache_entry_free:
+ **/
+static void
+gs_cache_entry_free (GsCacheEntry *entry)
+{
+	g_free (entry->filename);
+	g_free (entry->etag);
+	g_free (entry->last_modified);
+	g_slice_free (GsCacheEntry, entry);
+}
+
+/**
+ * gs_cache_kind_to_string:
+ **/
+static const gchar *
+gs_cache_kind_to_string (GsCacheKind kind)
+{
+	if (kind == GS_CACHE_KIND_SCREENSHOT)
+		return "screenshot";
+	if (kind == GS_CACHE_KIND_ICON)
+		return "icon";
+	if (kind == GS_CACHE_KIND_FIRMWARE)
+		return "firmware";
+	return NULL;
+}
+
+/**
+ * gs_cache_kind_from_string:
+ **/
+static GsCacheKind
+gs_cache_kind_from_string (const gchar *kind)
+{
+	if (g_strcmp0 (kind, "screenshot") == 0)
+		return GS_CACHE_KIND_SCREENSHOT;
+	if (g_strcmp0 (kind, "icon") == 0)
+		return GS_CACHE_KIND_ICON;
+	if (g_strcmp0 (kind, "firmware") == 0)
+		return GS_CACHE_KIND_FIRMWARE;
+	return GS_CACHE_KIND_LAST;
+}
+
+/**
+ * gs_cache_entry_can_evict:
+ **/
+static gboolean
+gs_cache_entry_can_evict (GsCacheEntry *entry)
+{
+	if (entry->kind == GS_CACHE_KIND_FIRMWARE)
+		return FALSE;
+	if (entry->kind == GS_CACHE_KIND_ICON &&
+	    entry->atime >= gs_cache_session_start)
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * gs_cache_entry_remove_locked:
+ *
+ * Forgets about a file, without deleting it.
+ *
+ * Returns: %TRUE if the file was in the index
+ **/
+static gboolean
+gs_cache_entry_remove_locked (const gchar *filename)
+{
+	GsCacheEntry *entry;
+
+	entry = g_hash_table_lookup (gs_cache_entries, filename);
+	if (entry == NULL)
+		return FALSE;
+	if (entry->link != NULL)
+		g_queue_delete_link (&gs_cache_lru, entry->link);
+	if (entry->kind != GS_CACHE_KIND_FIRMWARE)
+		gs_cache_total -= entry->size;
+	g_hash_table_remove (gs_cache_entries, filename);
+	return TRUE;
+}
+
+/**
+ * gs_cache_entry_insert_locked:
+ *
+ * Adds the entry as the most recently used one, replacing any entry for
+ * the same file.
+ **/
+static void
+gs_cache_entry_insert_locked (GsCacheEntry *entry)
+{
+	gs_cache_entry_remove_locked (entry->filename);
+	g_hash_table_insert (gs_cache_entries, entry->filename, entry);
+	if (entry->kind != GS_CACHE_KIND_FIRMWARE)
+		gs_cache_total += entry->size;
+	if (gs_cache_entry_can_evict (entry)) {
+		g_queue_push_tail (&gs_cache_lru, entry);
+		entry->link = gs_cache_lru.tail;
+	}
+}
+
+/**
+ * gs_cache_entry_used_locked:
+ *
+ * Makes the entry the most recently used one. An icon used in this session
+ * may be the local icon of an application or the decoded copy in the icon
+ * cache, so it is kept until the next session.
+ **/
+static void
+gs_cache_entry_used_locked (GsCacheEntry *entry)
+{
+	entry->atime = g_get_real_time () / G_USEC_PER_SEC;
+	if (entry->link == NULL)
+		return;
+	g_queue_unlink (&gs_cache_lru, entry->link);
+	if (!gs_cache_entry_can_evict (entry)) {
+		g_list_free (entry->link);
+		entry->link = NULL;
+		return;
+	}
+	g_queue_push_tail_link (&gs_cache_lru, entry->link);
+}
+
+/**
+ * gs_cache_unlink_all:
+ *
+ * Deletes files that have been removed from the index, without the lock
+ * held so that lookups are not blocked on the disk.
+ **/
+static void
+gs_cache_unlink_all (GPtrArray *filenames)
+{
+	guint i;
+
+	for (i = 0; i < filenames->len; i++)
+		g_unlink (g_ptr_array_index (filenames, i));
+}
+
+/**
+ * gs_cache_get_index_filename:
+ **/
+static gchar *
+gs_cache_get_index_filename (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "gnome-software",
+				 "cache-index.ini",
+				 NULL);
+}
+
+/**
+ * gs_cache_get_budget:
+ **/
+static guint64
+gs_cache_get_budget (void)
+{
+	const gchar *tmp;
+	guint64 size = 0;
+
+	tmp = g_getenv ("GNOME_SOFTWARE_CACHE_SIZE");
+	if (tmp != NULL)
+		size = g_ascii_strtoull (tmp, NULL, 10);
+	if (size == 0)
+		size = GS_CACHE_SIZE_DEFAULT;
+	return size * 1024 * 1024;
+}
+
+/**
+ * gs_cache_save_data:
+ *
+ * Writes the index if anything has changed, which is safe to call from
+ * any thread. The whole index is written, so it is only done once for a
+ * batch of changes.
+ **/
+static void
+gs_cache_save_data (void)
+{
+	GHashTableIter iter;
+	GsCacheEntry *entry;
+	gboolean ret = FALSE;
+	gsize len;
+	_cleanup_error_free_ GError *error = NULL;
+	_cleanup_free_ gchar *data = NULL;
+	_cleanup_free_ gchar *dirname = NULL;
+	_cleanup_free_ gchar *fn = NULL;
+	_cleanup_keyfile_unref_ GKeyFile *kf = NULL;
+
+	/* the data is created while holding the save lock, so an older
+	 * index can never be written after a newer one */
+	g_mutex_lock (&gs_cache_save_mutex);
+	g_mutex_lock (&gs_cache_mutex);
+	if (!gs_cache_dirty || gs_cache_entries == NULL) {
+		g_mutex_unlock (&gs_cache_mutex);
+		g_mutex_unlock (&gs_cache_save_mutex);
+		return;
+	}
+
+	/* the group name is a hash as filenames can contain anything */
+	kf = g_key_file_new ();
+	g_hash_table_iter_init (&iter, gs_cache_entries);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry)) {
+		_cleanup_free_ gchar *group = NULL;
+		group = g_compute_checksum_for_string (G_CHECKSUM_SHA1, entry->filename, -1);
+		g_key_file_set_string (kf, group, "Filename", entry->filename);
+		g_key_file_set_string (kf, group, "Kind", gs_cache_kind_to_string (entry->kind));
+		g_key_file_set_uint64 (kf, group, "Size", entry->size);
+		g_key_file_set_int64 (kf, group, "AccessTime", entry->atime);
+		g_key_file_set_int64 (kf, group, "Validated", entry->validated);
+		if (entry->etag != NULL)
+			g_key_file_set_string (kf, group, "ETag", entry->etag);
+		if (entry->last_modified != NULL)
+			g_key_file_set_string (kf, group, "LastModified", entry->last_modified);
+	}
+	data = g_key_file_to_data (kf, &len, NULL);
+	gs_cache_dirty = FALSE;
+	g_mutex_unlock (&gs_cache_mutex);
+
+	/* write atomically */
+	fn = gs_cache_get_index_filename ();
+	dirname = g_path_get_dirname (fn);
+	if (g_mkdir_with_parents (dirname, 0700) != 0) {
+		g_warning ("failed to create %s", dirname);
+		goto out;
+	}
+	if (!g_file_set_contents (fn, data, len, &error)) {
+		g_warning ("failed to save cache index: %s", error->message);
+		goto out;
+	}
+	ret = TRUE;
+out:
+	/* try again with the next change */
+	if (!ret) {
+		g_mutex_lock (&gs_cache_mutex);
+		gs_cache_dirty = TRUE;
+		g_mutex_unlock (&gs_cache_mutex);
+	}
+	g_mutex_unlock (&gs_cache_save_mutex);
+}
+
+/**
+ * gs_cache_save_thread_cb:
+ **/
+static void
+gs_cache_save_thread_cb (GTask *task,
+			 gpointer source_object,
+			 gpointer task_data,
+			 GCancellable *cancellable)
+{
+	gs_cache_save_data ();
+}
+
+/**
+ * gs_cache_save_timeout_cb:
+ **/
+static gboolean
+gs_cache_save_timeout_cb (gpointer user_data)
+{
+	_cleanup_object_unref_ GTask *task = NULL;
+
+	g_mutex_lock (&gs_cache_mutex);
+	gs_cache_save_id = 0;
+	g_mutex_unlock (&gs_cache_mutex);
+
+	task = g_task_new (NULL, NULL, NULL, NULL);
+	g_task_run_in_thread (task, gs_cache_save_thread_cb);
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * gs_cache_queue_save_locked:
+ *
+ * Marks the index as changed, and writes it after a short delay so that
+ * all the changes made in the meantime only cost one write.
+ **/
+static void
+gs_cache_queue_save_locked (void)
+{
+	gs_cache_dirty = TRUE;
+	if (gs_cache_save_id != 0)
+		return;
+	gs_cache_save_id = g_timeout_add_seconds (GS_CACHE_SAVE_DELAY,
+						  gs_cache_save_timeout_cb,
+						  NULL);
+}
+
+/**
+ * gs_cache_verify_free:
+ **/
+static void
+gs_cache_verify_free (GsCacheVerify *verify)
+{
+	g_free (verify->filename);
+	g_slice_free (GsCacheVerify, verify);
+}
+
+/**
+ * gs_cache_verify_thread_cb:
+ *
+ * Drops any entries where the file has gone away or has been truncated.
+ * The disk is checked without the lock held, so lookups are not blocked.
+ **/
+static void
+gs_cache_verify_thread_cb (GTask *task,
+			   gpointer source_object,
+			   gpointer task_data,
+			   GCancellable *cancellable)
+{
+	GHashTableIter iter;
+	GStatBuf buf;
+	GsCacheEntry *entry;
+	GsCacheVerify *verify;
+	guint i;
+	_cleanup_ptrarray_unref_ GPtrArray *array = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *invalid = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *removed = NULL;
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_cache_verify_free);
+	g_mutex_lock (&gs_cache_mutex);
+	g_hash_table_iter_init (&iter, gs_cache_entries);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry)) {
+		verify = g_slice_new0 (GsCacheVerify);
+		verify->filename = g_strdup (entry->filename);
+		verify->size = entry->size;
+		g_ptr_array_add (array, verify);
+	}
+	g_mutex_unlock (&gs_cache_mutex);
+
+	/* integrity check */
+	invalid = g_ptr_array_new ();
+	for (i = 0; i < array->len; i++) {
+		verify = g_ptr_array_index (array, i);
+		if (g_stat (verify->filename, &buf) != 0) {
+			g_debug ("%s has been removed from the cache", verify->filename);
+			g_ptr_array_add (invalid, verify);
+			continue;
+		}
+		if ((guint64) buf.st_size != verify->size) {
+			g_warning ("%s is not the expected size, removing", verify->filename);
+			g_ptr_array_add (invalid, verify);
+			continue;
+		}
+	}
+	if (invalid->len == 0)
+		return;
+
+	/* only if the file has not been replaced in the meantime */
+	removed = g_ptr_array_new ();
+	g_mutex_lock (&gs_cache_mutex);
+	for (i = 0; i < invalid->len; i++) {
+		verify = g_ptr_array_index (invalid, i);
+		entry = g_hash_table_lookup (gs_cache_entries, verify->filename);
+		if (entry == NULL || entry->size != verify->size)
+			continue;
+		gs_cache_entry_remove_locked (verify->filename);
+		g_ptr_array_add (removed, verify->filename);
+	}
+	gs_cache_queue_save_locked ();
+	g_mutex_unlock (&gs_cache_mutex);
+	gs_cache_unlink_all (removed);
+}
+
+/**
+ * gs_cache_sort_atime_cb:
+ **/
+static gint
+gs_cache_sort_atime_cb (gconstpointer a, gconstpointer b)
+{
+	GsCacheEntry *entry1 = *((GsCacheEntry **) a);
+	GsCacheEntry *entry2 = *((GsCacheEntry **) b);
+	if (entry1->atime < entry2->atime)
+		return -1;
+	if (entry1->atime > entry2->atime)
+		return 1;
+	return 0;
+}
+
+/**
+ * gs_cache_load_locked:
+ *
+ * Loads the index, which is checked against the disk in a worker thread.
+ **/
+static void
+gs_cache_load_locked (void)
+{
+	GsCacheEntry *entry;
+	guint i;
+	_cleanup_free_ gchar *fn = NULL;
+	_cleanup_keyfile_unref_ GKeyFile *kf = NULL;
+	_cleanup_object_unref_ GTask *task = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *array = NULL;
+	_cleanup_strv_free_ gchar **groups = NULL;
+
+	if (gs_cache_entries != NULL)
+		return;
+	gs_cache_entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+						  (GDestroyNotify) gs_cache_entry_free);
+	gs_cache_session_start = g_get_real_time () / G_USEC_PER_SEC;
+
+	kf = g_key_file_new ();
+	fn = gs_cache_get_index_filename ();
+	if (!g_key_file_load_from_file (kf, fn, G_KEY_FILE_NONE, NULL))
+		return;
+	groups = g_key_file_get_groups (kf, NULL);
+	array = g_ptr_array_new ();
+	for (i = 0; groups[i] != NULL; i++) {
+		_cleanup_free_ gchar *filename = NULL;
+		_cleanup_free_ gchar *kind = NULL;
+
+		filename = g_key_file_get_string (kf, groups[i], "Filename", NULL);
+		kind = g_key_file_get_string (kf, groups[i], "Kind", NULL);
+		if (filename == NULL || gs_cache_kind_from_string (kind) == GS_CACHE_KIND_LAST) {
+			gs_cache_dirty = TRUE;
+			continue;
+		}
+
+		entry = g_slice_new0 (GsCacheEntry);
+		entry->filename = g_strdup (filename);
+		entry->kind = gs_cache_kind_from_string (kind);
+		entry->size = g_key_file_get_uint64 (kf, groups[i], "Size", NULL);
+		entry->atime = g_key_file_get_int64 (kf, groups[i], "AccessTime", NULL);
+		entry->validated = g_key_file_get_int64 (kf, groups[i], "Validated", NULL);
+		entry->etag = g_key_file_get_string (kf, groups[i], "ETag", NULL);
+		entry->last_modified = g_key_file_get_string (kf, groups[i], "LastModified", NULL);
+		g_ptr_array_add (array, entry);
+	}
+
+	/* sorted once, then kept in order as the files are used */
+	g_ptr_array_sort (array, gs_cache_sort_atime_cb);
+	for (i = 0; i < array->len; i++)
+		gs_cache_entry_insert_locked (g_ptr_array_index (array, i));
+	if (gs_cache_dirty)
+		gs_cache_queue_save_locked ();
+
+	/* checking every file can take some time */
+	task = g_task_new (NULL, NULL, NULL, NULL);
+	g_task_run_in_thread (task, gs_cache_verify_thread_cb);
+}
+
+/**
+ * gs_cache_evict_locked:
+ * @removed: the filenames to delete once the lock is released
+ *
+ * Removes the least recently used files until the cache fits in the
+ * budget, or until only files that are kept are left.
+ **/
+static void
+gs_cache_evict_locked (GPtrArray *removed)
+{
+	GsCacheEntry *entry;
+	guint64 budget;
+
+	budget = gs_cache_get_budget ();
+	while (gs_cache_total > budget && gs_cache_lru.head != NULL) {
+		entry = gs_cache_lru.head->data;
+		g_debug ("evicting %s from the cache", entry->filename);
+		g_ptr_array_add (removed, g_strdup (entry->filename));
+		gs_cache_entry_remove_locked (entry->filename);
+		gs_cache_queue_save_locked ();
+	}
+}
+
+/**
+ * gs_cache_lookup:
+ * @kind: a #GsCacheKind
+ * @filename: the full path of the cached file
+ *
+ * Finds out if a download has to be made. Files that were downloaded before
+ * the index existed are adopted, and files that have been deleted since
+ * are dropped. The index is not marked as changed for a file that is
+ * found, so the access time and any adopted file are only written to disk
+ * with the next change to the index.
+ *
+ * Returns: a #GsCacheState
+ **/
+GsCacheState
+gs_cache_lookup (GsCacheKind kind, const gchar *filename)
+{
+	GsCacheEntry *entry;
+	GsCacheState state;
+	GStatBuf buf;
+	gboolean exists;
+
+	exists = g_stat (filename, &buf) == 0;
+	g_mutex_lock (&gs_cache_mutex);
+	gs_cache_load_locked ();
+	entry = g_hash_table_lookup (gs_cache_entries, filename);
+	if (!exists) {
+		if (entry != NULL) {
+			g_debug ("%s has been removed from the cache", filename);
+			gs_cache_entry_remove_locked (filename);
+			gs_cache_queue_save_locked ();
+		}
+		state = GS_CACHE_STATE_MISSING;
+		goto out;
+	}
+	if (entry == NULL) {
+		/* no validators, so this will be downloaded again when stale */
+		entry = g_slice_new0 (GsCacheEntry);
+		entry->filename = g_strdup (filename);
+		entry->kind = kind;
+		entry->size = buf.st_size;
+		entry->validated = buf.st_mtime;
+		gs_cache_entry_insert_locked (entry);
+	}
+	gs_cache_entry_used_locked (entry);
+	if (entry->atime - entry->validated > GS_CACHE_MAX_AGE)
+		state = GS_CACHE_STATE_STALE;
+	else
+		state = GS_CACHE_STATE_VALID;
+out:
+	g_mutex_unlock (&gs_cache_mutex);
+	return state;
+}
+
+/**
+ * gs_cache_prepare_message:
+ * @filename: the full path of the cached file
+ * @msg: a #SoupMessage
+ *
+ * Adds the validators of any cached copy to the request so the server can
+ * reply with 304 Not Modified.
+ **/
+void
+gs_cache_prepare_message (const gchar *filename, SoupMessage *msg)
+{
+	GsCacheEntry *entry;
+
+	g_mutex_lock (&gs_cache_mutex);
+	gs_cache_load_locked ();
+	entry = g_hash_table_lookup (gs_cache_entries, filename);
+	if (entry != NULL) {
+		if (entry->etag != NULL) {
+			soup_message_headers_replace (msg->request_headers,
+						      "If-None-Match",
+						      entry->etag);
+		}
+		if (entry->last_modified != NULL) {
+			soup_message_headers_replace (msg->request_headers,
+						      "If-Modified-Since",
+						      entry->last_modified);
+		}
+	}
+	g_mutex_unlock (&gs_cache_mutex);
+}
+
+/**
+ * gs_cache_add:
+ * @kind: a #GsCacheKind
+ * @filename: the full path of the file that has just been written
+ * @msg: the #SoupMessage used for the download, or %NULL
+ *
+ * Records a new or replaced file, evicting older files if required.
+ **/
+void
+gs_cache_add (GsCacheKind kind, const gchar *filename, SoupMessage *msg)
+{
+	GsCacheEntry *entry;
+	GStatBuf buf;
+	_cleanup_ptrarray_unref_ GPtrArray *removed = NULL;
+
+	if (g_stat (filename, &buf) != 0) {
+		g_warning ("failed to add %s to the cache", filename);
+		return;
+	}
+
+	g_mutex_lock (&gs_cache_mutex);
+	gs_cache_load_locked ();
+	entry = g_slice_new0 (GsCacheEntry);
+	entry->filename = g_strdup (filename);
+	entry->kind = kind;
+	entry->size = buf.st_size;
+	entry->atime = g_get_real_time () / G_USEC_PER_SEC;
+	entry->validated = entry->atime;
+	if (msg != NULL) {
+		entry->etag = g_strdup (soup_message_headers_get_one (msg->response_headers,
+								      "ETag"));
+		entry->last_modified = g_strdup (soup_message_headers_get_one (msg->response_headers,
+									       "Last-Modified"));
+	}
+	gs_cache_entry_insert_locked (entry);
+	gs_cache_queue_save_locked ();
+	removed = g_ptr_array_new_with_free_func (g_free);
+	gs_cache_evict_locked (removed);
+	g_mutex_unlock (&gs_cache_mutex);
+	gs_cache_unlink_all (removed);
+}
+
+/**
+ * gs_cache_touch:
+ * @filename: the full path of the cached file
+ *
+ * Marks a cached file as valid again, typically after a 304 response.
+ **/
+void
+gs_cache_touch (const gchar *filename)
+{
+	GsCacheEntry *entry;
+
+	g_mutex_lock (&gs_cache_mutex);
+	gs_cache_load_locked ();
+	entry = g_hash_table_lookup (gs_cache_entries, filename);
+	if (entry != NULL) {
+		gs_cache_entry_used_locked (entry);
+		entry->validated = entry->atime;
+		gs_cache_queue_save_locked ();
+	}
+	g_mutex_unlock (&gs_cache_mutex);
+}
+
+/**
+ * gs_cache_remove:
+ * @filename: the full path of the cached file
+ *
+ * Deletes a cached file, for instance if it could not be loaded.
+ **/
+void
+gs_cache_remove (const gchar *filename)
+{
+	g_mutex_lock (&gs_cache_mutex);
+	gs_cache_load_locked ();
+	if (gs_cache_entry_remove_locked (filename))
+		gs_cache_queue_save_locked ();
+	g_mutex_unlock (&gs_cache_mutex);
+	g_unlink (filename);
+}
+
+/**
+ * gs_cache_load_thread_cb:
+ **/
+static void
+gs_cache_load_thread_cb (GTask *task,
+			 gpointer source_object,
+			 gpointer task_data,
+			 GCancellable *cancellable)
+{
+	g_mutex_lock (&gs_cache_mutex);
+	gs_cache_load_locked ();
+	g_mutex_unlock (&gs_cache_mutex);
+}
+
+/**
+ * gs_cache_load_async:
+ *
+ * Loads the index in a worker thread, so that the first lookup from the
+ * main thread does not have to read it.
+ **/
+void
+gs_cache_load_async (void)
+{
+	_cleanup_object_unref_ GTask *task = NULL;
+	task = g_task_new (NULL, NULL, NULL, NULL);
+	g_task_run_in_thread (task, gs_cache_load_thread_cb);
+}
+
+/**
+ * gs_cache_flush:
+ *
+ * Writes any pending changes to the index straight away, for instance
+ * when the application is quitting.
+ **/
+void
+gs_cache_flush (void)
+{
+	gs_cache_save_data ();
+}
+
+/* vim: set noexpandtab: */
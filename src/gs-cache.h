@@ -0,0 +1,60 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2015 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GS_CACHE_H
+#define __GS_CACHE_H
+
+#include <glib.h>
+#include <libsoup/soup.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+	GS_CACHE_KIND_SCREENSHOT,
+	GS_CACHE_KIND_ICON,
+	GS_CACHE_KIND_FIRMWARE,			/* never evicted */
+	GS_CACHE_KIND_LAST
+} GsCacheKind;
+
+typedef enum {
+	GS_CACHE_STATE_MISSING,
+	GS_CACHE_STATE_VALID,
+	GS_CACHE_STATE_STALE,			/* usable, but revalidate */
+	GS_CACHE_STATE_LAST
+} GsCacheState;
+
+GsCacheState	 gs_cache_lookup		(GsCacheKind	 kind,
+						 const gchar	*filename);
+void		 gs_cache_prepare_message	(const gchar	*filename,
+						 SoupMessage	*msg);
+void		 gs_cache_add			(GsCacheKind	 kind,
+						 const gchar	*filename,
+						 SoupMessage	*msg);
+void		 gs_cache_touch			(const gchar	*filename);
+void		 gs_cache_remove		(const gchar	*filename);
+void		 gs_cache_load_async		(void);
+void		 gs_cache_flush			(void);
+
+G_END_DECLS
+
+#endif /* __GS_CACHE_H */
+
+/* vim: set noexpandtab: */
@@ -25,6 +25,7 @@
 #include <gtk/gtk.h>
 #include <locale.h>
 
+#include "gs-cache.h"
 #include "gs-cleanup.h"
 #include "gs-profile.h"
 #include "gs-plugin-loader.h"
@@ -398,8 +399,17 @@ main (int argc, char **argv)
 		gs_cmd_show_results_categories (categories);
 	}
 out:
+	/* there is no main loop to write the index later */
+	gs_cache_flush ();
 	gs_profile_stop (profile, "GsCmd");
 	gs_profile_dump (profile);
+	if (g_getenv ("GNOME_SOFTWARE_TRACE") != NULL) {
+		_cleanup_error_free_ GError *error_trace = NULL;
+		if (!gs_profile_export_trace (profile,
+					      g_getenv ("GNOME_SOFTWARE_TRACE"),
+					      &error_trace))
+			g_warning ("failed to save trace: %s", error_trace->message);
+	}
 	g_option_context_free (context);
 	gs_plugin_list_free (list);
 	gs_plugin_list_free (categories);
@@ -0,0 +1,363 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2015 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "gs-cache.h"
+#include "gs-cleanup.h"
+#include "gs-icon-cache.h"
+
+/*
+ * Each decoded icon is saved in its own file as a small header, the name
+ * of the file it was decoded from, and then the RGBA pixels, so that it
+ * can be mapped and used as the pixbuf data without decoding the PNG or
+ * looking in the icon theme again.
+ */
+
+#define GS_ICON_CACHE_MAGIC		"GSIC"
+#define GS_ICON_CACHE_VERSION		2
+
+typedef struct {
+	gchar		 magic[4];
+	guint32		 version;
+	guint32		 width;
+	guint32		 height;
+	guint32		 rowstride;
+	guint32		 source_len;	/* bytes of source filename that follow */
+	gint64		 source_mtime;
+	gint64		 source_size;
+} GsIconCacheHeader;
+
+/**
+ * gs_icon_cache_get_dir:
+ **/
+static gchar *
+gs_icon_cache_get_dir (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "gnome-software",
+				 "icons",
+				 NULL);
+}
+
+/**
+ * gs_icon_cache_get_app_dir:
+ *
+ * Every application has its own directory so that its icons can be
+ * removed without touching the ones of any other application.
+ **/
+static gchar *
+gs_icon_cache_get_app_dir (const gchar *app_id)
+{
+	_cleanup_free_ gchar *app_csum = NULL;
+	_cleanup_free_ gchar *path = NULL;
+
+	app_csum = g_compute_checksum_for_string (G_CHECKSUM_SHA1,
+						  app_id != NULL ? app_id : "", -1);
+	path = gs_icon_cache_get_dir ();
+	return g_build_filename (path, app_csum, NULL);
+}
+
+/**
+ * gs_icon_cache_get_filename:
+ **/
+static gchar *
+gs_icon_cache_get_filename (const gchar *app_id, AsIcon *icon, gint scale)
+{
+	const gchar *keys[6];
+	guint i;
+	_cleanup_checksum_free_ GChecksum *csum = NULL;
+	_cleanup_free_ gchar *basename = NULL;
+	_cleanup_free_ gchar *path = NULL;
+	_cleanup_free_ gchar *scale_str = NULL;
+
+	/* only the metadata, so a hit does not need the source file; that
+	 * is checked against the file header instead */
+	scale_str = g_strdup_printf ("%i", scale);
+	keys[0] = app_id;
+	keys[1] = as_icon_kind_to_string (as_icon_get_kind (icon));
+	keys[2] = as_icon_get_prefix (icon);
+	keys[3] = as_icon_get_name (icon);
+	keys[4] = as_icon_get_filename (icon);
+	keys[5] = scale_str;
+	csum = g_checksum_new (G_CHECKSUM_SHA1);
+	for (i = 0; i < G_N_ELEMENTS (keys); i++) {
+		if (keys[i] != NULL)
+			g_checksum_update (csum, (const guchar *) keys[i], -1);
+		g_checksum_update (csum, (const guchar *) "\n", 1);
+	}
+
+	path = gs_icon_cache_get_app_dir (app_id);
+	basename = g_strdup_printf ("%s@%i.rgba", g_checksum_get_string (csum), scale);
+	return g_build_filename (path, basename, NULL);
+}
+
+/**
+ * gs_icon_cache_pixbuf_destroy_cb:
+ **/
+static void
+gs_icon_cache_pixbuf_destroy_cb (guchar *pixels, gpointer user_data)
+{
+	g_mapped_file_unref ((GMappedFile *) user_data);
+}
+
+/**
+ * gs_icon_cache_lookup:
+ *
+ * Returns a pixbuf that uses the mapped cache file for the pixel data,
+ * or %NULL if the icon has not been saved for this scale or the file it
+ * was decoded from has changed since.
+ **/
+GdkPixbuf *
+gs_icon_cache_lookup (const gchar *app_id, AsIcon *icon, gint scale)
+{
+	GMappedFile *mapped;
+	GStatBuf stat_buf;
+	GsIconCacheHeader *hdr;
+	gchar *data;
+	gsize len;
+	_cleanup_free_ gchar *filename = NULL;
+	_cleanup_free_ gchar *source = NULL;
+
+	g_return_val_if_fail (AS_IS_ICON (icon), NULL);
+
+	/* writable is copy-on-write, in case the pixels are changed */
+	filename = gs_icon_cache_get_filename (app_id, icon, scale);
+	mapped = g_mapped_file_new (filename, TRUE, NULL);
+	if (mapped == NULL)
+		return NULL;
+
+	/* check this is valid */
+	data = g_mapped_file_get_contents (mapped);
+	len = g_mapped_file_get_length (mapped);
+	hdr = (GsIconCacheHeader *) data;
+	if (len < sizeof (GsIconCacheHeader) ||
+	    memcmp (hdr->magic, GS_ICON_CACHE_MAGIC, 4) != 0 ||
+	    hdr->version != GS_ICON_CACHE_VERSION ||
+	    hdr->width != (guint32) (64 * scale) ||
+	    hdr->height != (guint32) (64 * scale) ||
+	    hdr->rowstride != hdr->width * 4 ||
+	    len != sizeof (GsIconCacheHeader) + hdr->source_len +
+		   hdr->rowstride * hdr->height) {
+		g_debug ("ignoring invalid icon cache %s", filename);
+		g_mapped_file_unref (mapped);
+		return NULL;
+	}
+
+	/* the source file is replaced when the icon is updated */
+	if (hdr->source_len > 0) {
+		source = g_strndup (data + sizeof (GsIconCacheHeader), hdr->source_len);
+		if (g_stat (source, &stat_buf) != 0 ||
+		    (gint64) stat_buf.st_mtime != hdr->source_mtime ||
+		    (gint64) stat_buf.st_size != hdr->source_size) {
+			g_debug ("ignoring icon cache %s as %s changed",
+				 filename, source);
+			g_mapped_file_unref (mapped);
+			return NULL;
+		}
+	}
+
+	/* mark as used, so it is not evicted */
+	gs_cache_lookup (GS_CACHE_KIND_ICON, filename);
+
+	/* the pixbuf keeps the mapping alive */
+	return gdk_pixbuf_new_from_data ((const guchar *) data +
+					 sizeof (GsIconCacheHeader) + hdr->source_len,
+					 GDK_COLORSPACE_RGB, TRUE, 8,
+					 hdr->width, hdr->height, hdr->rowstride,
+					 gs_icon_cache_pixbuf_destroy_cb,
+					 mapped);
+}
+
+/**
+ * gs_icon_cache_remove_old:
+ *
+ * Removes the icons saved for the same application and scale before
+ * @filename, as the icon they were decoded from is no longer used.
+ **/
+static void
+gs_icon_cache_remove_old (const gchar *filename, gint scale)
+{
+	const gchar *fn;
+	_cleanup_dir_close_ GDir *dir = NULL;
+	_cleanup_free_ gchar *basename = NULL;
+	_cleanup_free_ gchar *path = NULL;
+	_cleanup_free_ gchar *suffix = NULL;
+
+	path = g_path_get_dirname (filename);
+	basename = g_path_get_basename (filename);
+	dir = g_dir_open (path, 0, NULL);
+	if (dir == NULL)
+		return;
+	suffix = g_strdup_printf ("@%i.rgba", scale);
+	while ((fn = g_dir_read_name (dir)) != NULL) {
+		_cleanup_free_ gchar *tmp = NULL;
+		if (!g_str_has_suffix (fn, suffix))
+			continue;
+		if (g_strcmp0 (fn, basename) == 0)
+			continue;
+		tmp = g_build_filename (path, fn, NULL);
+		g_debug ("removing old icon cache %s", tmp);
+		gs_cache_remove (tmp);
+	}
+}
+
+/**
+ * gs_icon_cache_save:
+ *
+ * Saves a decoded icon so it can be used by gs_icon_cache_lookup().
+ * Only the 64px and 128px icons used for the two UI scales are saved.
+ * If @source is set then the icon is only used while that file is not
+ * modified.
+ **/
+void
+gs_icon_cache_save (const gchar *app_id,
+		    AsIcon *icon,
+		    const gchar *source,
+		    gint scale,
+		    GdkPixbuf *pixbuf)
+{
+	GStatBuf stat_buf;
+	GsIconCacheHeader hdr;
+	const guchar *pixels;
+	guint i;
+	gint size = 64 * scale;
+	_cleanup_error_free_ GError *error = NULL;
+	_cleanup_free_ gchar *filename = NULL;
+	_cleanup_free_ gchar *path = NULL;
+	_cleanup_object_unref_ GdkPixbuf *pixbuf_rgba = NULL;
+	_cleanup_string_free_ GString *str = NULL;
+
+	g_return_if_fail (AS_IS_ICON (icon));
+	g_return_if_fail (GDK_IS_PIXBUF (pixbuf));
+
+	if (scale != 1 && scale != 2)
+		return;
+	if (gdk_pixbuf_get_width (pixbuf) != size ||
+	    gdk_pixbuf_get_height (pixbuf) != size ||
+	    gdk_pixbuf_get_bits_per_sample (pixbuf) != 8 ||
+	    gdk_pixbuf_get_colorspace (pixbuf) != GDK_COLORSPACE_RGB)
+		return;
+
+	/* always save with an alpha channel */
+	if (gdk_pixbuf_get_has_alpha (pixbuf))
+		pixbuf_rgba = g_object_ref (pixbuf);
+	else
+		pixbuf_rgba = gdk_pixbuf_add_alpha (pixbuf, FALSE, 0, 0, 0);
+
+	/* header then tightly packed rows */
+	memset (&hdr, 0, sizeof (hdr));
+	memcpy (hdr.magic, GS_ICON_CACHE_MAGIC, 4);
+	hdr.version = GS_ICON_CACHE_VERSION;
+	hdr.width = size;
+	hdr.height = size;
+	hdr.rowstride = size * 4;
+	if (source != NULL && g_stat (source, &stat_buf) == 0) {
+		hdr.source_len = strlen (source);
+		hdr.source_mtime = stat_buf.st_mtime;
+		hdr.source_size = stat_buf.st_size;
+	}
+	str = g_string_sized_new (sizeof (hdr) + hdr.source_len +
+				  hdr.rowstride * hdr.height);
+	g_string_append_len (str, (const gchar *) &hdr, sizeof (hdr));
+	if (hdr.source_len > 0)
+		g_string_append_len (str, source, hdr.source_len);
+	pixels = gdk_pixbuf_get_pixels (pixbuf_rgba);
+	for (i = 0; i < hdr.height; i++) {
+		g_string_append_len (str,
+				     (const gchar *) pixels + i * gdk_pixbuf_get_rowstride (pixbuf_rgba),
+				     hdr.rowstride);
+	}
+
+	/* this is atomic, so readers never see a partial file */
+	path = gs_icon_cache_get_app_dir (app_id);
+	filename = gs_icon_cache_get_filename (app_id, icon, scale);
+	if (g_mkdir_with_parents (path, 0700) != 0 ||
+	    !g_file_set_contents (filename, str->str, str->len, &error)) {
+		g_debug ("failed to save icon cache %s: %s", filename,
+			 error != NULL ? error->message : "cannot create directory");
+		return;
+	}
+
+	/* counted in the download cache budget */
+	gs_cache_add (GS_CACHE_KIND_ICON, filename, NULL);
+	gs_icon_cache_remove_old (filename, scale);
+}
+
+/**
+ * gs_icon_cache_remove_dir:
+ **/
+static void
+gs_icon_cache_remove_dir (const gchar *path)
+{
+	const gchar *fn;
+	_cleanup_dir_close_ GDir *dir = NULL;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir == NULL)
+		return;
+	while ((fn = g_dir_read_name (dir)) != NULL) {
+		_cleanup_free_ gchar *tmp = NULL;
+		tmp = g_build_filename (path, fn, NULL);
+		if (g_file_test (tmp, G_FILE_TEST_IS_DIR)) {
+			gs_icon_cache_remove_dir (tmp);
+			g_rmdir (tmp);
+			continue;
+		}
+		if (g_str_has_suffix (fn, ".rgba"))
+			gs_cache_remove (tmp);
+	}
+}
+
+/**
+ * gs_icon_cache_invalidate_app:
+ *
+ * Removes the saved icons of one application, for instance when its
+ * AppStream metadata has changed.
+ **/
+void
+gs_icon_cache_invalidate_app (const gchar *app_id)
+{
+	_cleanup_free_ gchar *path = NULL;
+
+	path = gs_icon_cache_get_app_dir (app_id);
+	gs_icon_cache_remove_dir (path);
+	g_rmdir (path);
+}
+
+/**
+ * gs_icon_cache_invalidate:
+ *
+ * Removes all the saved icons.
+ **/
+void
+gs_icon_cache_invalidate (void)
+{
+	_cleanup_free_ gchar *path = NULL;
+
+	path = gs_icon_cache_get_dir ();
+	gs_icon_cache_remove_dir (path);
+}
+
+/* vim: set noexpandtab: */
@@ -0,0 +1,45 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2015 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GS_ICON_CACHE_H
+#define __GS_ICON_CACHE_H
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <appstream-glib.h>
+
+G_BEGIN_DECLS
+
+GdkPixbuf	*gs_icon_cache_lookup		(const gchar	*app_id,
+						 AsIcon		*icon,
+						 gint		 scale);
+void		 gs_icon_cache_save		(const gchar	*app_id,
+						 AsIcon		*icon,
+						 const gchar	*source,
+						 gint		 scale,
+						 GdkPixbuf	*pixbuf);
+void		 gs_icon_cache_invalidate_app	(const gchar	*app_id);
+void		 gs_icon_cache_invalidate	(void);
+
+G_END_DECLS
+
+#endif /* __GS_ICON_CACHE_H */
+
+/* vim: set noexpandtab: */
@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <appstream-glib.h>
 
 #include "gs-cleanup.h"
@@ -30,6 +31,9 @@
 #include "gs-profile.h"
 
 #define GS_PLUGIN_LOADER_UPDATES_CHANGED_DELAY	3	/* s */
+#define GS_PLUGIN_LOADER_MAX_THREADS		8
+#define GS_PLUGIN_LOADER_SEARCH_BATCH_SIZE	25
+#define GS_PLUGIN_LOADER_STATUS_INTERVAL	16	/* ms, about one frame */
 
 struct GsPluginLoaderPrivate
 {
@@ -38,18 +42,39 @@ struct GsPluginLoaderPrivate
 	GsPluginStatus		 status_last;
 	GsProfile		*profile;
 
+	GMutex			 status_mutex;
+	GQueue			 status_pending;	/* of GsPluginLoaderStatus */
+	GHashTable		*progress_pending;	/* GsApp : percentage */
+	guint			 status_flush_id;
+	gboolean		 status_disposed;
+
 	GMutex			 pending_apps_mutex;
 	GPtrArray		*pending_apps;
 
 	GMutex			 app_cache_mutex;
 	GHashTable		*app_cache;
+	GHashTable		*snapshot;		/* id : GsApp, first paint only */
+	GHashTable		*snapshot_data;		/* id : GVariant */
 	GSettings		*settings;
 
+	GMutex			 search_mutex;
+	gchar			*search_value;
+	GsPluginRefineFlags	 search_flags;
+	GList			*search_ranked;		/* after the first page */
+	guint			 search_n_matches;
+	guint			 search_generation;	/* bumped when cleared */
+	gchar			*search_truncated;	/* more than one page */
+
 	gchar			**compatible_projects;
 	gint			 scale;
 
 	guint			 updates_changed_id;
+	gboolean		 updates_changed_all;
+	GHashTable		*apps_changed;		/* app ID or package name */
+	guint			 snapshot_id;
 	gboolean		 online; 
+
+	GThreadPool		*pool;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (GsPluginLoader, gs_plugin_loader, G_TYPE_OBJECT)
@@ -69,12 +94,19 @@ typedef struct {
 	GList				*list;
 	GsPluginRefineFlags		 flags;
 	gchar				*value;
+	gchar				**ids;
 	gchar				*filename;
 	guint				 cache_age;
 	GsCategory			*category;
 	GsApp				*app;
 	AsAppState			 state_success;
 	AsAppState			 state_failure;
+	GsPluginLoaderSearchBatchFunc	 batch_func;
+	gpointer			 batch_data;
+	guint				 offset;
+	gboolean			 paged;
+	guint				 n_matches;
+	gboolean			 reload;
 } GsPluginLoaderAsyncState;
 
 static void
@@ -87,10 +119,92 @@ gs_plugin_loader_free_async_state (GsPluginLoaderAsyncState *state)
 
 	g_free (state->filename);
 	g_free (state->value);
+	g_strfreev (state->ids);
 	gs_plugin_list_free (state->list);
 	g_slice_free (GsPluginLoaderAsyncState, state);
 }
 
+/* every function a plugin can export, in the same order as the table */
+typedef enum {
+	GS_PLUGIN_LOADER_VFUNC_INITIALIZE,
+	GS_PLUGIN_LOADER_VFUNC_DESTROY,
+	GS_PLUGIN_LOADER_VFUNC_REFINE,
+	GS_PLUGIN_LOADER_VFUNC_REFRESH,
+	GS_PLUGIN_LOADER_VFUNC_ADD_SEARCH,
+	GS_PLUGIN_LOADER_VFUNC_ADD_SEARCH_FILES,
+	GS_PLUGIN_LOADER_VFUNC_ADD_SEARCH_WHAT_PROVIDES,
+	GS_PLUGIN_LOADER_VFUNC_ADD_INSTALLED,
+	GS_PLUGIN_LOADER_VFUNC_ADD_UPDATES,
+	GS_PLUGIN_LOADER_VFUNC_ADD_UPDATES_HISTORICAL,
+	GS_PLUGIN_LOADER_VFUNC_ADD_SOURCES,
+	GS_PLUGIN_LOADER_VFUNC_ADD_POPULAR,
+	GS_PLUGIN_LOADER_VFUNC_ADD_FEATURED,
+	GS_PLUGIN_LOADER_VFUNC_ADD_CATEGORIES,
+	GS_PLUGIN_LOADER_VFUNC_ADD_CATEGORY_APPS,
+	GS_PLUGIN_LOADER_VFUNC_APP_INSTALL,
+	GS_PLUGIN_LOADER_VFUNC_APP_REMOVE,
+	GS_PLUGIN_LOADER_VFUNC_APP_SET_RATING,
+	GS_PLUGIN_LOADER_VFUNC_FILENAME_TO_APP,
+	GS_PLUGIN_LOADER_VFUNC_OFFLINE_UPDATE,
+	GS_PLUGIN_LOADER_VFUNC_LAST
+} GsPluginLoaderVfunc;
+
+typedef struct {
+	const gchar	*name;
+	glong		 offset;
+} GsPluginLoaderVfuncInfo;
+
+static const GsPluginLoaderVfuncInfo vfuncs[] = {
+	{ "gs_plugin_initialize",		G_STRUCT_OFFSET (GsPluginVtable, initialize) },
+	{ "gs_plugin_destroy",			G_STRUCT_OFFSET (GsPluginVtable, destroy) },
+	{ "gs_plugin_refine",			G_STRUCT_OFFSET (GsPluginVtable, refine) },
+	{ "gs_plugin_refresh",			G_STRUCT_OFFSET (GsPluginVtable, refresh) },
+	{ "gs_plugin_add_search",		G_STRUCT_OFFSET (GsPluginVtable, add_search) },
+	{ "gs_plugin_add_search_files",		G_STRUCT_OFFSET (GsPluginVtable, add_search_files) },
+	{ "gs_plugin_add_search_what_provides",	G_STRUCT_OFFSET (GsPluginVtable, add_search_what_provides) },
+	{ "gs_plugin_add_installed",		G_STRUCT_OFFSET (GsPluginVtable, add_installed) },
+	{ "gs_plugin_add_updates",		G_STRUCT_OFFSET (GsPluginVtable, add_updates) },
+	{ "gs_plugin_add_updates_historical",	G_STRUCT_OFFSET (GsPluginVtable, add_updates_historical) },
+	{ "gs_plugin_add_sources",		G_STRUCT_OFFSET (GsPluginVtable, add_sources) },
+	{ "gs_plugin_add_popular",		G_STRUCT_OFFSET (GsPluginVtable, add_popular) },
+	{ "gs_plugin_add_featured",		G_STRUCT_OFFSET (GsPluginVtable, add_featured) },
+	{ "gs_plugin_add_categories",		G_STRUCT_OFFSET (GsPluginVtable, add_categories) },
+	{ "gs_plugin_add_category_apps",	G_STRUCT_OFFSET (GsPluginVtable, add_category_apps) },
+	{ "gs_plugin_app_install",		G_STRUCT_OFFSET (GsPluginVtable, app_install) },
+	{ "gs_plugin_app_remove",		G_STRUCT_OFFSET (GsPluginVtable, app_remove) },
+	{ "gs_plugin_app_set_rating",		G_STRUCT_OFFSET (GsPluginVtable, app_set_rating) },
+	{ "gs_plugin_filename_to_app",		G_STRUCT_OFFSET (GsPluginVtable, filename_to_app) },
+	{ "gs_plugin_offline_update",		G_STRUCT_OFFSET (GsPluginVtable, offline_update) },
+	{ NULL, 0 }
+};
+
+/**
+ * gs_plugin_loader_vfunc_lookup:
+ **/
+static GsPluginLoaderVfunc
+gs_plugin_loader_vfunc_lookup (const gchar *function_name)
+{
+	guint i;
+	for (i = 0; i < GS_PLUGIN_LOADER_VFUNC_LAST; i++) {
+		if (g_strcmp0 (vfuncs[i].name, function_name) == 0)
+			return i;
+	}
+	return GS_PLUGIN_LOADER_VFUNC_LAST;
+}
+
+/**
+ * gs_plugin_loader_plugin_get_vfunc:
+ *
+ * Return value: the function, or %NULL if the plugin does not export it
+ **/
+static gpointer
+gs_plugin_loader_plugin_get_vfunc (GsPlugin *plugin, GsPluginLoaderVfunc vfunc)
+{
+	if (vfunc >= GS_PLUGIN_LOADER_VFUNC_LAST)
+		return NULL;
+	return G_STRUCT_MEMBER (gpointer, plugin->vtable, vfuncs[vfunc].offset);
+}
+
 /**
  * gs_plugin_loader_error_quark:
  * Return value: Our personal error quark.
@@ -114,6 +228,523 @@ gs_plugin_loader_app_sort_cb (gconstpointer a, gconstpointer b)
 			  gs_app_get_name (GS_APP (b)));
 }
 
+/*
+ * The applications returned by the installed and updatable lists are saved
+ * as a GVariant, and mapped again at startup so the first page can be shown
+ * before the plugins have finished. The snapshot is only used if the
+ * AppStream and PackageKit data have not changed since.
+ *
+ * Each application is serialized by the job thread that has just refined it
+ * and the copy is kept under the app cache lock, so saving never reads a
+ * GsApp that a refine thread may be writing. The restored applications are
+ * kept apart from the app cache, as they have not been refined in this
+ * session, and are dropped once the installed list has been fetched.
+ */
+
+#define GS_PLUGIN_LOADER_SNAPSHOT_VERSION	1
+#define GS_PLUGIN_LOADER_SNAPSHOT_TYPE		"(ua{st}aa{sv})"
+#define GS_PLUGIN_LOADER_SNAPSHOT_DELAY		5	/* s */
+
+/**
+ * gs_plugin_loader_snapshot_get_filename:
+ **/
+static gchar *
+gs_plugin_loader_snapshot_get_filename (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "gnome-software",
+				 "apps.gvariant",
+				 NULL);
+}
+
+/**
+ * gs_plugin_loader_snapshot_get_stamps:
+ *
+ * Returns the modification times of everything the refined data depends on.
+ **/
+static GVariant *
+gs_plugin_loader_snapshot_get_stamps (void)
+{
+	GVariantBuilder builder;
+	guint i;
+	_cleanup_free_ gchar *user_xmls = NULL;
+	const gchar *paths[] = { "/usr/share/app-info/xmls",
+				 "/var/cache/app-info/xmls",
+				 "/var/lib/PackageKit/transactions.db",
+				 NULL,
+				 NULL };
+
+	user_xmls = g_build_filename (g_get_user_data_dir (),
+				      "app-info", "xmls", NULL);
+	paths[3] = user_xmls;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{st}"));
+	for (i = 0; paths[i] != NULL; i++) {
+		GStatBuf buf;
+		guint64 mtime = 0;
+		if (g_stat (paths[i], &buf) == 0)
+			mtime = (guint64) buf.st_mtime;
+		g_variant_builder_add (&builder, "{st}", paths[i], mtime);
+	}
+	return g_variant_builder_end (&builder);
+}
+
+/**
+ * gs_plugin_loader_snapshot_add_string:
+ **/
+static void
+gs_plugin_loader_snapshot_add_string (GVariantBuilder *builder,
+				      const gchar *key,
+				      const gchar *value)
+{
+	if (value == NULL)
+		return;
+	g_variant_builder_add (builder, "{sv}", key, g_variant_new_string (value));
+}
+
+/**
+ * gs_plugin_loader_snapshot_add_strv:
+ **/
+static void
+gs_plugin_loader_snapshot_add_strv (GVariantBuilder *builder,
+				    const gchar *key,
+				    GPtrArray *array)
+{
+	if (array == NULL || array->len == 0)
+		return;
+	g_variant_builder_add (builder, "{sv}", key,
+			       g_variant_new_strv ((const gchar * const *) array->pdata,
+						   array->len));
+}
+
+/**
+ * gs_plugin_loader_snapshot_app_is_valid:
+ **/
+static gboolean
+gs_plugin_loader_snapshot_app_is_valid (GsApp *app)
+{
+	switch (gs_app_get_state (app)) {
+	case AS_APP_STATE_AVAILABLE:
+	case AS_APP_STATE_INSTALLED:
+	case AS_APP_STATE_UPDATABLE:
+	case AS_APP_STATE_UNAVAILABLE:
+		break;
+	default:
+		return FALSE;
+	}
+	if (gs_app_get_kind (app) == GS_APP_KIND_UNKNOWN ||
+	    gs_app_get_kind (app) == GS_APP_KIND_SOURCE)
+		return FALSE;
+	if (gs_app_get_id (app) == NULL || gs_app_get_name (app) == NULL)
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * gs_plugin_loader_snapshot_app_to_variant:
+ **/
+static GVariant *
+gs_plugin_loader_snapshot_app_to_variant (GsApp *app)
+{
+	AsIcon *icon;
+	GVariantBuilder builder;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+	gs_plugin_loader_snapshot_add_string (&builder, "id", gs_app_get_id (app));
+	g_variant_builder_add (&builder, "{sv}", "kind",
+			       g_variant_new_uint32 (gs_app_get_kind (app)));
+	g_variant_builder_add (&builder, "{sv}", "id-kind",
+			       g_variant_new_uint32 (gs_app_get_id_kind (app)));
+	g_variant_builder_add (&builder, "{sv}", "state",
+			       g_variant_new_uint32 (gs_app_get_state (app)));
+	gs_plugin_loader_snapshot_add_string (&builder, "name", gs_app_get_name (app));
+	gs_plugin_loader_snapshot_add_string (&builder, "summary", gs_app_get_summary (app));
+	gs_plugin_loader_snapshot_add_string (&builder, "description", gs_app_get_description (app));
+	gs_plugin_loader_snapshot_add_string (&builder, "version", gs_app_get_version (app));
+	gs_plugin_loader_snapshot_add_string (&builder, "update-version", gs_app_get_update_version (app));
+	gs_plugin_loader_snapshot_add_string (&builder, "update-details", gs_app_get_update_details (app));
+	gs_plugin_loader_snapshot_add_string (&builder, "licence", gs_app_get_licence (app));
+	gs_plugin_loader_snapshot_add_string (&builder, "origin", gs_app_get_origin (app));
+	gs_plugin_loader_snapshot_add_string (&builder, "management-plugin", gs_app_get_management_plugin (app));
+	gs_plugin_loader_snapshot_add_string (&builder, "project-group", gs_app_get_project_group (app));
+	gs_plugin_loader_snapshot_add_string (&builder, "menu-path", gs_app_get_menu_path (app));
+	gs_plugin_loader_snapshot_add_string (&builder, "url",
+					      gs_app_get_url (app, AS_URL_KIND_HOMEPAGE));
+	gs_plugin_loader_snapshot_add_strv (&builder, "sources", gs_app_get_sources (app));
+	gs_plugin_loader_snapshot_add_strv (&builder, "source-ids", gs_app_get_source_ids (app));
+	gs_plugin_loader_snapshot_add_strv (&builder, "categories", gs_app_get_categories (app));
+	gs_plugin_loader_snapshot_add_strv (&builder, "keywords", gs_app_get_keywords (app));
+	g_variant_builder_add (&builder, "{sv}", "size",
+			       g_variant_new_uint64 (gs_app_get_size (app)));
+	g_variant_builder_add (&builder, "{sv}", "install-date",
+			       g_variant_new_uint64 (gs_app_get_install_date (app)));
+	g_variant_builder_add (&builder, "{sv}", "kudos",
+			       g_variant_new_uint64 (gs_app_get_kudos (app)));
+	g_variant_builder_add (&builder, "{sv}", "rating",
+			       g_variant_new_int32 (gs_app_get_rating (app)));
+	g_variant_builder_add (&builder, "{sv}", "rating-confidence",
+			       g_variant_new_int32 (gs_app_get_rating_confidence (app)));
+	g_variant_builder_add (&builder, "{sv}", "rating-kind",
+			       g_variant_new_uint32 (gs_app_get_rating_kind (app)));
+
+	/* only icons that can be loaded again without a network */
+	icon = gs_app_get_icon (app);
+	if (icon != NULL &&
+	    (as_icon_get_kind (icon) == AS_ICON_KIND_STOCK ||
+	     as_icon_get_kind (icon) == AS_ICON_KIND_LOCAL ||
+	     as_icon_get_kind (icon) == AS_ICON_KIND_CACHED)) {
+		g_variant_builder_add (&builder, "{sv}", "icon-kind",
+				       g_variant_new_uint32 (as_icon_get_kind (icon)));
+		gs_plugin_loader_snapshot_add_string (&builder, "icon-name", as_icon_get_name (icon));
+		gs_plugin_loader_snapshot_add_string (&builder, "icon-filename", as_icon_get_filename (icon));
+		gs_plugin_loader_snapshot_add_string (&builder, "icon-prefix", as_icon_get_prefix (icon));
+		g_variant_builder_add (&builder, "{sv}", "icon-width",
+				       g_variant_new_uint32 (as_icon_get_width (icon)));
+		g_variant_builder_add (&builder, "{sv}", "icon-height",
+				       g_variant_new_uint32 (as_icon_get_height (icon)));
+	}
+	return g_variant_builder_end (&builder);
+}
+
+/**
+ * gs_plugin_loader_snapshot_app_from_variant:
+ *
+ * All the text is restored with the lowest quality, so that anything the
+ * plugins find when refining replaces it.
+ **/
+static GsApp *
+gs_plugin_loader_snapshot_app_from_variant (GVariant *dict)
+{
+	GsApp *app;
+	const gchar *tmp;
+	gint32 val_i32;
+	guint32 val_u32;
+	guint64 val_u64;
+	guint i;
+	const gchar **strv;
+
+	if (!g_variant_lookup (dict, "id", "&s", &tmp))
+		return NULL;
+	app = gs_app_new (tmp);
+	if (g_variant_lookup (dict, "kind", "u", &val_u32))
+		gs_app_set_kind (app, val_u32);
+	if (g_variant_lookup (dict, "id-kind", "u", &val_u32))
+		gs_app_set_id_kind (app, val_u32);
+	if (g_variant_lookup (dict, "state", "u", &val_u32))
+		gs_app_set_state (app, val_u32);
+	if (g_variant_lookup (dict, "name", "&s", &tmp))
+		gs_app_set_name (app, GS_APP_QUALITY_LOWEST, tmp);
+	if (g_variant_lookup (dict, "summary", "&s", &tmp))
+		gs_app_set_summary (app, GS_APP_QUALITY_LOWEST, tmp);
+	if (g_variant_lookup (dict, "description", "&s", &tmp))
+		gs_app_set_description (app, GS_APP_QUALITY_LOWEST, tmp);
+	if (g_variant_lookup (dict, "version", "&s", &tmp))
+		gs_app_set_version (app, tmp);
+	if (g_variant_lookup (dict, "update-version", "&s", &tmp))
+		gs_app_set_update_version (app, tmp);
+	if (g_variant_lookup (dict, "update-details", "&s", &tmp))
+		gs_app_set_update_details (app, tmp);
+	if (g_variant_lookup (dict, "licence", "&s", &tmp))
+		gs_app_set_licence (app, tmp);
+	if (g_variant_lookup (dict, "origin", "&s", &tmp))
+		gs_app_set_origin (app, tmp);
+	if (g_variant_lookup (dict, "management-plugin", "&s", &tmp))
+		gs_app_set_management_plugin (app, tmp);
+	if (g_variant_lookup (dict, "project-group", "&s", &tmp))
+		gs_app_set_project_group (app, tmp);
+	if (g_variant_lookup (dict, "menu-path", "&s", &tmp))
+		gs_app_set_menu_path (app, tmp);
+	if (g_variant_lookup (dict, "url", "&s", &tmp))
+		gs_app_set_url (app, AS_URL_KIND_HOMEPAGE, tmp);
+	if (g_variant_lookup (dict, "sources", "^a&s", &strv)) {
+		for (i = 0; strv[i] != NULL; i++)
+			gs_app_add_source (app, strv[i]);
+		g_free (strv);
+	}
+	if (g_variant_lookup (dict, "source-ids", "^a&s", &strv)) {
+		for (i = 0; strv[i] != NULL; i++)
+			gs_app_add_source_id (app, strv[i]);
+		g_free (strv);
+	}
+	if (g_variant_lookup (dict, "categories", "^a&s", &strv)) {
+		for (i = 0; strv[i] != NULL; i++)
+			gs_app_add_category (app, strv[i]);
+		g_free (strv);
+	}
+	if (g_variant_lookup (dict, "keywords", "^a&s", &strv)) {
+		_cleanup_ptrarray_unref_ GPtrArray *keywords = NULL;
+		keywords = g_ptr_array_new_with_free_func (g_free);
+		for (i = 0; strv[i] != NULL; i++)
+			g_ptr_array_add (keywords, g_strdup (strv[i]));
+		gs_app_set_keywords (app, keywords);
+		g_free (strv);
+	}
+	if (g_variant_lookup (dict, "size", "t", &val_u64))
+		gs_app_set_size (app, val_u64);
+	if (g_variant_lookup (dict, "install-date", "t", &val_u64))
+		gs_app_set_install_date (app, val_u64);
+	if (g_variant_lookup (dict, "kudos", "t", &val_u64)) {
+		for (i = 0; (1u << i) < GS_APP_KUDO_LAST; i++) {
+			if (val_u64 & (1u << i))
+				gs_app_add_kudo (app, 1u << i);
+		}
+	}
+	if (g_variant_lookup (dict, "rating", "i", &val_i32))
+		gs_app_set_rating (app, val_i32);
+	if (g_variant_lookup (dict, "rating-confidence", "i", &val_i32))
+		gs_app_set_rating_confidence (app, val_i32);
+	if (g_variant_lookup (dict, "rating-kind", "u", &val_u32))
+		gs_app_set_rating_kind (app, val_u32);
+
+	/* the pixbuf is loaded on demand */
+	if (g_variant_lookup (dict, "icon-kind", "u", &val_u32)) {
+		_cleanup_object_unref_ AsIcon *icon = NULL;
+		icon = as_icon_new ();
+		as_icon_set_kind (icon, val_u32);
+		if (g_variant_lookup (dict, "icon-name", "&s", &tmp)) {
+#if AS_CHECK_VERSION(0,5,0)
+			as_icon_set_name (icon, tmp);
+#else
+			as_icon_set_name (icon, tmp, -1);
+#endif
+		}
+		if (g_variant_lookup (dict, "icon-filename", "&s", &tmp))
+			as_icon_set_filename (icon, tmp);
+		if (g_variant_lookup (dict, "icon-prefix", "&s", &tmp))
+			as_icon_set_prefix (icon, tmp);
+		if (g_variant_lookup (dict, "icon-width", "u", &val_u32))
+			as_icon_set_width (icon, val_u32);
+		if (g_variant_lookup (dict, "icon-height", "u", &val_u32))
+			as_icon_set_height (icon, val_u32);
+		gs_app_set_icon (app, icon);
+	}
+	return app;
+}
+
+/**
+ * gs_plugin_loader_save_snapshot:
+ *
+ * Saves the refined applications so that the next session can show them
+ * before the plugins have been run.
+ **/
+gboolean
+gs_plugin_loader_save_snapshot (GsPluginLoader *plugin_loader, GError **error)
+{
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+	GList *apps;
+	GList *l;
+	GVariantBuilder builder;
+	_cleanup_free_ gchar *dirname = NULL;
+	_cleanup_free_ gchar *filename = NULL;
+	_cleanup_variant_unref_ GVariant *snapshot = NULL;
+
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), FALSE);
+
+	if (priv->snapshot_id != 0) {
+		g_source_remove (priv->snapshot_id);
+		priv->snapshot_id = 0;
+	}
+
+	/* keep the old file if nothing has been fetched in this session */
+	g_mutex_lock (&priv->app_cache_mutex);
+	if (g_hash_table_size (priv->snapshot_data) == 0) {
+		g_mutex_unlock (&priv->app_cache_mutex);
+		return TRUE;
+	}
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+	apps = g_hash_table_get_values (priv->snapshot_data);
+	for (l = apps; l != NULL; l = l->next)
+		g_variant_builder_add_value (&builder, l->data);
+	g_list_free (apps);
+	g_mutex_unlock (&priv->app_cache_mutex);
+	snapshot = g_variant_new ("(u@a{st}aa{sv})",
+				  GS_PLUGIN_LOADER_SNAPSHOT_VERSION,
+				  gs_plugin_loader_snapshot_get_stamps (),
+				  &builder);
+	g_variant_ref_sink (snapshot);
+
+	/* write the serialized data so it can be mapped directly */
+	filename = gs_plugin_loader_snapshot_get_filename ();
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0700) != 0) {
+		g_set_error (error,
+			     GS_PLUGIN_LOADER_ERROR,
+			     GS_PLUGIN_LOADER_ERROR_FAILED,
+			     "failed to create %s", dirname);
+		return FALSE;
+	}
+	return g_file_set_contents (filename,
+				    g_variant_get_data (snapshot),
+				    g_variant_get_size (snapshot),
+				    error);
+}
+
+/**
+ * gs_plugin_loader_snapshot_capture:
+ *
+ * Serializes the applications of a job that has finished refining them.
+ * This is called from the job thread, only apps in a state that will
+ * still be true next time are kept.
+ **/
+static void
+gs_plugin_loader_snapshot_capture (GsPluginLoader *plugin_loader, GList *list)
+{
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+	GList *l;
+	GsApp *app;
+	GVariant *dict;
+	guint i;
+	_cleanup_ptrarray_unref_ GPtrArray *dicts = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *ids = NULL;
+
+	dicts = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+	ids = g_ptr_array_new_with_free_func (g_free);
+	for (l = list; l != NULL; l = l->next) {
+		app = GS_APP (l->data);
+		if (!gs_plugin_loader_snapshot_app_is_valid (app))
+			continue;
+		dict = gs_plugin_loader_snapshot_app_to_variant (app);
+		g_ptr_array_add (dicts, g_variant_ref_sink (dict));
+		g_ptr_array_add (ids, g_strdup (gs_app_get_id (app)));
+	}
+
+	g_mutex_lock (&priv->app_cache_mutex);
+	for (i = 0; i < dicts->len; i++) {
+		g_hash_table_insert (priv->snapshot_data,
+				     g_strdup (g_ptr_array_index (ids, i)),
+				     g_variant_ref (g_ptr_array_index (dicts, i)));
+	}
+	g_mutex_unlock (&priv->app_cache_mutex);
+}
+
+/**
+ * gs_plugin_loader_snapshot_save_cb:
+ **/
+static gboolean
+gs_plugin_loader_snapshot_save_cb (gpointer user_data)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (user_data);
+	_cleanup_error_free_ GError *error = NULL;
+
+	plugin_loader->priv->snapshot_id = 0;
+	if (!gs_plugin_loader_save_snapshot (plugin_loader, &error))
+		g_warning ("failed to save snapshot: %s", error->message);
+	return FALSE;
+}
+
+/**
+ * gs_plugin_loader_snapshot_queue_save:
+ **/
+static void
+gs_plugin_loader_snapshot_queue_save (GsPluginLoader *plugin_loader)
+{
+	if (plugin_loader->priv->snapshot_id != 0)
+		g_source_remove (plugin_loader->priv->snapshot_id);
+	plugin_loader->priv->snapshot_id =
+		g_timeout_add_seconds (GS_PLUGIN_LOADER_SNAPSHOT_DELAY,
+				       gs_plugin_loader_snapshot_save_cb,
+				       plugin_loader);
+}
+
+/**
+ * gs_plugin_loader_snapshot_load:
+ **/
+static gboolean
+gs_plugin_loader_snapshot_load (GsPluginLoader *plugin_loader, GError **error)
+{
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+	GVariantIter iter;
+	GVariant *dict;
+	guint32 version;
+	_cleanup_free_ gchar *filename = NULL;
+	_cleanup_variant_unref_ GVariant *apps = NULL;
+	_cleanup_variant_unref_ GVariant *snapshot = NULL;
+	_cleanup_variant_unref_ GVariant *stamps = NULL;
+	_cleanup_variant_unref_ GVariant *stamps_now = NULL;
+	_cleanup_bytes_unref_ GBytes *bytes = NULL;
+	GMappedFile *mapped;
+
+	/* nothing saved yet */
+	filename = gs_plugin_loader_snapshot_get_filename ();
+	if (!g_file_test (filename, G_FILE_TEST_EXISTS))
+		return TRUE;
+	mapped = g_mapped_file_new (filename, FALSE, error);
+	if (mapped == NULL)
+		return FALSE;
+	bytes = g_mapped_file_get_bytes (mapped);
+	g_mapped_file_unref (mapped);
+	snapshot = g_variant_new_from_bytes (G_VARIANT_TYPE (GS_PLUGIN_LOADER_SNAPSHOT_TYPE),
+					     bytes, FALSE);
+	g_variant_ref_sink (snapshot);
+
+	/* written by a different version, or the metadata has changed */
+	g_variant_get (snapshot, "(u@a{st}@aa{sv})", &version, &stamps, &apps);
+	if (version != GS_PLUGIN_LOADER_SNAPSHOT_VERSION) {
+		g_debug ("ignoring snapshot version %u", version);
+		return TRUE;
+	}
+	stamps_now = gs_plugin_loader_snapshot_get_stamps ();
+	g_variant_ref_sink (stamps_now);
+	if (!g_variant_equal (stamps, stamps_now)) {
+		g_debug ("ignoring out of date snapshot");
+		return TRUE;
+	}
+
+	/* only used for the first paint, never by the plugins */
+	g_mutex_lock (&priv->app_cache_mutex);
+	g_variant_iter_init (&iter, apps);
+	while ((dict = g_variant_iter_next_value (&iter)) != NULL) {
+		GsApp *app = gs_plugin_loader_snapshot_app_from_variant (dict);
+		g_variant_unref (dict);
+		if (app == NULL)
+			continue;
+		g_hash_table_insert (priv->snapshot,
+				     g_strdup (gs_app_get_id (app)),
+				     app);
+	}
+	g_debug ("loaded %u apps from snapshot",
+		 g_hash_table_size (priv->snapshot));
+	g_mutex_unlock (&priv->app_cache_mutex);
+	return TRUE;
+}
+
+/**
+ * gs_plugin_loader_get_snapshot:
+ *
+ * Returns the applications saved in the last session in @state that would
+ * be shown in the application views, without running any plugins. This is
+ * only meant for showing something before the real results are available,
+ * and returns nothing once the installed list has been fetched.
+ *
+ * Return value: (element-type GsApp) (transfer full): A list of applications
+ **/
+GList *
+gs_plugin_loader_get_snapshot (GsPluginLoader *plugin_loader, AsAppState state)
+{
+	GList *apps;
+	GList *l;
+	GList *list = NULL;
+
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
+
+	g_mutex_lock (&plugin_loader->priv->app_cache_mutex);
+	apps = g_hash_table_get_values (plugin_loader->priv->snapshot);
+	for (l = apps; l != NULL; l = l->next) {
+		GsApp *app = GS_APP (l->data);
+		if (gs_app_get_state (app) != state)
+			continue;
+		if (gs_app_get_kind (app) != GS_APP_KIND_NORMAL &&
+		    gs_app_get_kind (app) != GS_APP_KIND_SYSTEM)
+			continue;
+		if (gs_app_get_summary (app) == NULL || !gs_app_has_icon (app))
+			continue;
+		gs_plugin_add_app (&list, app);
+	}
+	g_list_free (apps);
+	g_mutex_unlock (&plugin_loader->priv->app_cache_mutex);
+	return g_list_sort (list, gs_plugin_loader_app_sort_cb);
+}
+
 /**
  * gs_plugin_loader_dedupe:
  */
@@ -176,93 +807,613 @@ gs_plugin_loader_list_dedupe (GsPluginLoader *plugin_loader, GList *list)
 }
 
 /**
- * gs_plugin_loader_run_refine_plugin:
- **/
-static gboolean
-gs_plugin_loader_run_refine_plugin (GsPluginLoader *plugin_loader,
-				    GsPlugin *plugin,
-				    const gchar *function_name_parent,
-				    GList **list,
-				    GsPluginRefineFlags flags,
-				    GCancellable *cancellable,
-				    GError **error)
+ * gs_plugin_loader_find_plugin:
+ */
+static GsPlugin *
+gs_plugin_loader_find_plugin (GsPluginLoader *plugin_loader,
+			      const gchar *plugin_name)
 {
-	GsPluginRefineFunc plugin_func = NULL;
-	const gchar *function_name = "gs_plugin_refine";
-	gboolean exists;
-	gboolean ret = TRUE;
-	_cleanup_free_ gchar *profile_id = NULL;
-
-	/* load the symbol */
-	exists = g_module_symbol (plugin->module,
-				  function_name,
-				  (gpointer *) &plugin_func);
-	if (!exists)
-		goto out;
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+	GsPlugin *plugin;
+	guint i;
 
-	/* profile the plugin runtime */
-	if (function_name_parent == NULL) {
-		profile_id = g_strdup_printf ("GsPlugin::%s(%s)",
-					      plugin->name,
-					      function_name);
-	} else {
-		profile_id = g_strdup_printf ("GsPlugin::%s(%s;%s)",
-					      plugin->name,
-					      function_name_parent,
-					      function_name);
-	}
-	gs_profile_start (plugin_loader->priv->profile, profile_id);
-	ret = plugin_func (plugin, list, flags, cancellable, error);
-	if (!ret) {
-		/* check the plugin is well behaved and sets error
-		 * if returning FALSE */
-		if (error != NULL && *error == NULL) {
-			g_set_error (error,
-				     GS_PLUGIN_ERROR,
-				     GS_PLUGIN_ERROR_FAILED,
-				     "%s[%s] returned FALSE and set no error",
-				     plugin->name, function_name);
-		}
-		goto out;
+	for (i = 0; i < priv->plugins->len; i++) {
+		plugin = g_ptr_array_index (priv->plugins, i);
+		if (g_strcmp0 (plugin->name, plugin_name) == 0)
+			return plugin;
 	}
+	return NULL;
+}
 
-	/* check the plugin is well behaved and returns FALSE
-	 * if returning an error */
-	if (error != NULL && *error != NULL) {
-		ret = FALSE;
-		g_warning ("%s set %s but did not return FALSE!",
-			   plugin->name, (*error)->message);
-		goto out;
-	}
-out:
-	if (profile_id != NULL) {
-		gs_profile_stop (plugin_loader->priv->profile, profile_id);
-		gs_plugin_status_update (plugin, NULL, GS_PLUGIN_STATUS_FINISHED);
-	}
-	return ret;
+typedef enum {
+	GS_PLUGIN_LOADER_JOB_KIND_RESULTS,
+	GS_PLUGIN_LOADER_JOB_KIND_SEARCH,
+	GS_PLUGIN_LOADER_JOB_KIND_CATEGORY,
+	GS_PLUGIN_LOADER_JOB_KIND_REFINE,
+	GS_PLUGIN_LOADER_JOB_KIND_LAST
+} GsPluginLoaderJobKind;
+
+typedef struct GsPluginLoaderDispatch GsPluginLoaderDispatch;
+
+/* one plugin vfunc call scheduled on the worker pool */
+typedef struct {
+	GsPluginLoaderDispatch	*dispatch;
+	GsPlugin		*plugin;
+	gpointer		 plugin_func;
+	GPtrArray		*deps;		/* of GsPluginLoaderJob, transitively */
+	GPtrArray		*dependents;	/* of GsPluginLoaderJob */
+	guint			 deps_pending;
+	GList			*list;		/* private results */
+	GList			*list_new;	/* not seen by the plugin on input */
+	GError			*error;
+} GsPluginLoaderJob;
+
+/* a set of jobs for one function, ordered by the plugin dependency graph */
+struct GsPluginLoaderDispatch {
+	GsPluginLoader		*plugin_loader;
+	GsPluginLoaderJobKind	 kind;
+	const gchar		*function_name;
+	GsPluginLoaderVfunc	 vfunc;
+	gchar			**values;
+	GsCategory		*category;
+	GList			**refine_list;	/* shared by all refine jobs */
+	GsPluginRefineFlags	 refine_flags;
+	GCancellable		*cancellable;
+	GPtrArray		*jobs;		/* of GsPluginLoaderJob, in plugin order */
+	GAsyncQueue		*finished;	/* of GsPluginLoaderJob, or %NULL */
+	GMutex			 mutex;
+	GCond			 cond;
+	guint			 jobs_pending;
+	gboolean		 failed;
+};
+
+/**
+ * gs_plugin_loader_job_free:
+ **/
+static void
+gs_plugin_loader_job_free (GsPluginLoaderJob *job)
+{
+	g_ptr_array_unref (job->deps);
+	g_ptr_array_unref (job->dependents);
+	g_list_free (job->list_new);
+	gs_plugin_list_free (job->list);
+	if (job->error != NULL)
+		g_error_free (job->error);
+	g_slice_free (GsPluginLoaderJob, job);
 }
 
 /**
- * gs_plugin_loader_run_refine:
+ * gs_plugin_loader_job_call:
  **/
 static gboolean
-gs_plugin_loader_run_refine (GsPluginLoader *plugin_loader,
-			     const gchar *function_name_parent,
-			     GList **list,
-			     GsPluginRefineFlags flags,
-			     GCancellable *cancellable,
-			     GError **error)
+gs_plugin_loader_job_call (GsPluginLoaderJob *job, GError **error)
 {
-	GList *l;
-	GList *addons_list = NULL;
-	GList *related_list = NULL;
+	GsPluginLoaderDispatch *dispatch = job->dispatch;
+	GsPluginCategoryFunc category_func;
+	GsPluginRefineFunc refine_func;
+	GsPluginResultsFunc results_func;
+	GsPluginSearchFunc search_func;
+
+	switch (dispatch->kind) {
+	case GS_PLUGIN_LOADER_JOB_KIND_RESULTS:
+		results_func = (GsPluginResultsFunc) job->plugin_func;
+		return results_func (job->plugin,
+				     &job->list,
+				     dispatch->cancellable,
+				     error);
+	case GS_PLUGIN_LOADER_JOB_KIND_SEARCH:
+		search_func = (GsPluginSearchFunc) job->plugin_func;
+		return search_func (job->plugin,
+				    dispatch->values,
+				    &job->list,
+				    dispatch->cancellable,
+				    error);
+	case GS_PLUGIN_LOADER_JOB_KIND_CATEGORY:
+		category_func = (GsPluginCategoryFunc) job->plugin_func;
+		return category_func (job->plugin,
+				      dispatch->category,
+				      &job->list,
+				      dispatch->cancellable,
+				      error);
+	case GS_PLUGIN_LOADER_JOB_KIND_REFINE:
+		refine_func = (GsPluginRefineFunc) job->plugin_func;
+		return refine_func (job->plugin,
+				    dispatch->refine_list,
+				    dispatch->refine_flags,
+				    dispatch->cancellable,
+				    error);
+	default:
+		g_assert_not_reached ();
+	}
+	return FALSE;
+}
+
+/**
+ * gs_plugin_loader_job_has_dep:
+ **/
+static gboolean
+gs_plugin_loader_job_has_dep (GsPluginLoaderJob *job, GsPluginLoaderJob *dep)
+{
+	guint i;
+
+	for (i = 0; i < job->deps->len; i++) {
+		if (g_ptr_array_index (job->deps, i) == dep)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * gs_plugin_loader_job_add_dep:
+ **/
+static void
+gs_plugin_loader_job_add_dep (GsPluginLoaderJob *job, GsPluginLoaderJob *dep)
+{
+	if (gs_plugin_loader_job_has_dep (job, dep))
+		return;
+	g_ptr_array_add (job->deps, dep);
+	g_ptr_array_add (dep->dependents, job);
+	job->deps_pending++;
+}
+
+/**
+ * gs_plugin_loader_job_run:
+ *
+ * Runs in a worker thread once every plugin this job depends on has finished.
+ **/
+static void
+gs_plugin_loader_job_run (GsPluginLoaderJob *job)
+{
+	GList *l;
+	GsPluginLoaderDispatch *dispatch = job->dispatch;
+	GsPluginLoaderPrivate *priv = dispatch->plugin_loader->priv;
+	const gchar *profile_id;
+	gboolean ret;
+	guint i;
+	_cleanup_hashtable_unref_ GHashTable *input = NULL;
+
+	/* start with everything the plugins we depend on have returned, in
+	 * the order they would have added it when run serially; refiners all
+	 * work on the caller's list instead */
+	g_mutex_lock (&dispatch->mutex);
+	ret = !dispatch->failed;
+	input = g_hash_table_new (g_direct_hash, g_direct_equal);
+	if (dispatch->kind != GS_PLUGIN_LOADER_JOB_KIND_REFINE) {
+		for (i = 0; i < dispatch->jobs->len; i++) {
+			GList *list_new = NULL;
+			GsPluginLoaderJob *dep = g_ptr_array_index (dispatch->jobs, i);
+			if (!gs_plugin_loader_job_has_dep (job, dep))
+				continue;
+			for (l = dep->list_new; l != NULL; l = l->next) {
+				if (g_hash_table_contains (input, l->data))
+					continue;
+				g_hash_table_add (input, l->data);
+				list_new = g_list_prepend (list_new, g_object_ref (l->data));
+			}
+			job->list = g_list_concat (g_list_reverse (list_new), job->list);
+		}
+	}
+	g_mutex_unlock (&dispatch->mutex);
+
+	/* another plugin already failed, so don't bother */
+	if (!ret)
+		goto out;
+	if (g_cancellable_set_error_if_cancelled (dispatch->cancellable, &job->error))
+		goto out;
+
+	/* run function */
+	profile_id = job->plugin->profile_ids[dispatch->vfunc];
+	gs_profile_start (priv->profile, profile_id);
+	ret = gs_plugin_loader_job_call (job, &job->error);
+	if (!ret && job->error == NULL) {
+		g_set_error (&job->error,
+			     GS_PLUGIN_ERROR,
+			     GS_PLUGIN_ERROR_FAILED,
+			     "%s[%s] returned FALSE and set no error",
+			     job->plugin->name, dispatch->function_name);
+	}
+	gs_plugin_status_update (job->plugin, NULL, GS_PLUGIN_STATUS_FINISHED);
+	gs_profile_stop (priv->profile, profile_id);
+
+	/* only keep what this plugin added */
+	for (l = job->list; l != NULL; l = l->next) {
+		if (g_hash_table_contains (input, l->data))
+			continue;
+		job->list_new = g_list_prepend (job->list_new, l->data);
+	}
+	job->list_new = g_list_reverse (job->list_new);
+out:
+	g_mutex_lock (&dispatch->mutex);
+
+	/* stop any plugins that have not started yet */
+	if (job->error != NULL)
+		dispatch->failed = TRUE;
+
+	/* schedule anything that was waiting for us */
+	for (i = 0; i < job->dependents->len; i++) {
+		GsPluginLoaderJob *dep = g_ptr_array_index (job->dependents, i);
+		if (--dep->deps_pending == 0)
+			g_thread_pool_push (priv->pool, dep, NULL);
+	}
+	if (dispatch->finished != NULL)
+		g_async_queue_push (dispatch->finished, job);
+	if (--dispatch->jobs_pending == 0)
+		g_cond_signal (&dispatch->cond);
+	g_mutex_unlock (&dispatch->mutex);
+}
+
+/**
+ * gs_plugin_loader_pool_cb:
+ **/
+static void
+gs_plugin_loader_pool_cb (gpointer data, gpointer user_data)
+{
+	gs_plugin_loader_job_run ((GsPluginLoaderJob *) data);
+}
+
+/**
+ * gs_plugin_loader_dispatch_find_job:
+ **/
+static GsPluginLoaderJob *
+gs_plugin_loader_dispatch_find_job (GsPluginLoaderDispatch *dispatch,
+				    const gchar *plugin_name)
+{
+	GsPluginLoaderJob *job;
+	guint i;
+
+	for (i = 0; i < dispatch->jobs->len; i++) {
+		job = g_ptr_array_index (dispatch->jobs, i);
+		if (g_strcmp0 (job->plugin->name, plugin_name) == 0)
+			return job;
+	}
+	return NULL;
+}
+
+/**
+ * gs_plugin_loader_dispatch_add_deps:
+ *
+ * Adds an edge from every job that @plugin transitively depends on to @job.
+ * Plugins that do not implement the function still order the ones that do.
+ **/
+static void
+gs_plugin_loader_dispatch_add_deps (GsPluginLoaderDispatch *dispatch,
+				    GsPluginLoaderJob *job,
+				    GsPlugin *plugin,
+				    GHashTable *visited)
+{
+	GsPlugin *dep;
+	GsPluginLoaderJob *dep_job;
+	guint i;
+
+	if (plugin->deps == NULL)
+		return;
+	for (i = 0; plugin->deps[i] != NULL; i++) {
+		if (g_hash_table_contains (visited, plugin->deps[i]))
+			continue;
+		g_hash_table_add (visited, (gpointer) plugin->deps[i]);
+		dep = gs_plugin_loader_find_plugin (dispatch->plugin_loader,
+						    plugin->deps[i]);
+		if (dep == NULL || !dep->enabled)
+			continue;
+		dep_job = gs_plugin_loader_dispatch_find_job (dispatch, dep->name);
+		if (dep_job != NULL)
+			gs_plugin_loader_job_add_dep (job, dep_job);
+		gs_plugin_loader_dispatch_add_deps (dispatch, job, dep, visited);
+	}
+}
+
+/**
+ * gs_plugin_loader_plugin_can_refine:
+ *
+ * Refiners that declare which fields they set are only run when one of
+ * those fields is wanted.
+ **/
+static gboolean
+gs_plugin_loader_plugin_can_refine (GsPlugin *plugin, GsPluginRefineFlags flags)
+{
+	if (plugin->vtable->refine == NULL)
+		return FALSE;
+	if (plugin->refine_provides == GS_PLUGIN_REFINE_FLAGS_ANY)
+		return TRUE;
+	return (plugin->refine_provides & flags) != 0;
+}
+
+/**
+ * gs_plugin_loader_dispatch_new:
+ *
+ * Creates a job for every enabled plugin that implements @function_name,
+ * ordered by the plugin dependencies. For refine jobs only the plugins
+ * that can set one of @refine_flags are included.
+ **/
+static GsPluginLoaderDispatch *
+gs_plugin_loader_dispatch_new (GsPluginLoader *plugin_loader,
+			       const gchar *function_name,
+			       GsPluginLoaderJobKind kind,
+			       GsPluginRefineFlags refine_flags,
+			       GCancellable *cancellable)
+{
+	GsPluginLoaderDispatch *dispatch;
+	GsPluginLoaderJob *job;
+	GsPlugin *plugin;
+	gpointer plugin_func;
+	guint i;
+
+	/* get the jobs in priority order */
+	dispatch = g_slice_new0 (GsPluginLoaderDispatch);
+	dispatch->plugin_loader = plugin_loader;
+	dispatch->kind = kind;
+	dispatch->function_name = function_name;
+	dispatch->vfunc = gs_plugin_loader_vfunc_lookup (function_name);
+	dispatch->refine_flags = refine_flags;
+	dispatch->cancellable = cancellable;
+	dispatch->jobs = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_plugin_loader_job_free);
+	g_mutex_init (&dispatch->mutex);
+	g_cond_init (&dispatch->cond);
+	for (i = 0; i < plugin_loader->priv->plugins->len; i++) {
+		plugin = g_ptr_array_index (plugin_loader->priv->plugins, i);
+		if (!plugin->enabled)
+			continue;
+		if (kind == GS_PLUGIN_LOADER_JOB_KIND_REFINE &&
+		    !gs_plugin_loader_plugin_can_refine (plugin, refine_flags))
+			continue;
+		plugin_func = gs_plugin_loader_plugin_get_vfunc (plugin, dispatch->vfunc);
+		if (plugin_func == NULL)
+			continue;
+		job = g_slice_new0 (GsPluginLoaderJob);
+		job->dispatch = dispatch;
+		job->plugin = plugin;
+		job->plugin_func = plugin_func;
+		job->deps = g_ptr_array_new ();
+		job->dependents = g_ptr_array_new ();
+		g_ptr_array_add (dispatch->jobs, job);
+	}
+	for (i = 0; i < dispatch->jobs->len; i++) {
+		_cleanup_hashtable_unref_ GHashTable *visited = NULL;
+		job = g_ptr_array_index (dispatch->jobs, i);
+		visited = g_hash_table_new (g_str_hash, g_str_equal);
+		gs_plugin_loader_dispatch_add_deps (dispatch, job, job->plugin, visited);
+	}
+	return dispatch;
+}
+
+/**
+ * gs_plugin_loader_dispatch_free:
+ **/
+static void
+gs_plugin_loader_dispatch_free (GsPluginLoaderDispatch *dispatch)
+{
+	g_ptr_array_unref (dispatch->jobs);
+	if (dispatch->finished != NULL)
+		g_async_queue_unref (dispatch->finished);
+	g_mutex_clear (&dispatch->mutex);
+	g_cond_clear (&dispatch->cond);
+	g_slice_free (GsPluginLoaderDispatch, dispatch);
+}
+
+/**
+ * gs_plugin_loader_dispatch_start:
+ *
+ * Starts every job that depends on nothing on the worker pool. If
+ * @dispatch->finished is set each job is pushed to it once it is done.
+ **/
+static void
+gs_plugin_loader_dispatch_start (GsPluginLoaderDispatch *dispatch)
+{
+	GsPluginLoaderJob *job;
+	guint i;
+
+	g_mutex_lock (&dispatch->mutex);
+	dispatch->jobs_pending = dispatch->jobs->len;
+	for (i = 0; i < dispatch->jobs->len; i++) {
+		job = g_ptr_array_index (dispatch->jobs, i);
+		if (job->deps_pending == 0)
+			g_thread_pool_push (dispatch->plugin_loader->priv->pool, job, NULL);
+	}
+	g_mutex_unlock (&dispatch->mutex);
+}
+
+/**
+ * gs_plugin_loader_dispatch_wait:
+ *
+ * Waits for all the jobs to finish.
+ **/
+static gboolean
+gs_plugin_loader_dispatch_wait (GsPluginLoaderDispatch *dispatch, GError **error)
+{
+	GsPluginLoaderJob *job;
+	guint i;
+
+	g_mutex_lock (&dispatch->mutex);
+	while (dispatch->jobs_pending > 0)
+		g_cond_wait (&dispatch->cond, &dispatch->mutex);
+	g_mutex_unlock (&dispatch->mutex);
+
+	/* use the error from the highest priority plugin that failed */
+	for (i = 0; i < dispatch->jobs->len; i++) {
+		job = g_ptr_array_index (dispatch->jobs, i);
+		if (job->error != NULL) {
+			g_propagate_error (error, job->error);
+			job->error = NULL;
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * gs_plugin_loader_dispatch_run:
+ *
+ * Runs the jobs on the worker pool and waits for them all to finish.
+ **/
+static gboolean
+gs_plugin_loader_dispatch_run (GsPluginLoaderDispatch *dispatch, GError **error)
+{
+	gs_plugin_loader_dispatch_start (dispatch);
+	return gs_plugin_loader_dispatch_wait (dispatch, error);
+}
+
+/**
+ * gs_plugin_loader_run_parallel:
+ *
+ * Calls @function_name on every enabled plugin, running plugins that do not
+ * depend on each other concurrently on the loader worker pool. Each plugin
+ * sees the results of the plugins it depends on, as it would when run
+ * serially in priority order, and the merged list keeps that order.
+ *
+ * Plugins that modify objects returned by another plugin must list that
+ * plugin in gs_plugin_get_deps().
+ **/
+static gboolean
+gs_plugin_loader_run_parallel (GsPluginLoader *plugin_loader,
+			       const gchar *function_name,
+			       GsPluginLoaderJobKind kind,
+			       gchar **values,
+			       GsCategory *category,
+			       GList **list,
+			       GCancellable *cancellable,
+			       GError **error)
+{
+	GsPluginLoaderDispatch *dispatch;
+	GsPluginLoaderJob *job;
+	GList *l;
+	gboolean ret;
+	guint i;
+	_cleanup_hashtable_unref_ GHashTable *seen = NULL;
+
+	dispatch = gs_plugin_loader_dispatch_new (plugin_loader,
+						  function_name,
+						  kind,
+						  GS_PLUGIN_REFINE_FLAGS_DEFAULT,
+						  cancellable);
+	dispatch->values = values;
+	dispatch->category = category;
+	ret = gs_plugin_loader_dispatch_run (dispatch, error);
+	if (!ret)
+		goto out;
+
+	/* merge as if each plugin had prepended to the same list in turn */
+	seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+	for (l = *list; l != NULL; l = l->next)
+		g_hash_table_add (seen, l->data);
+	for (i = 0; i < dispatch->jobs->len; i++) {
+		GList *list_new = NULL;
+		job = g_ptr_array_index (dispatch->jobs, i);
+		for (l = job->list_new; l != NULL; l = l->next) {
+			if (g_hash_table_contains (seen, l->data))
+				continue;
+			g_hash_table_add (seen, l->data);
+			list_new = g_list_prepend (list_new, g_object_ref (l->data));
+		}
+		*list = g_list_concat (g_list_reverse (list_new), *list);
+	}
+out:
+	gs_plugin_loader_dispatch_free (dispatch);
+	return ret;
+}
+
+/**
+ * gs_plugin_loader_refine_declared:
+ **/
+static gboolean
+gs_plugin_loader_refine_declared (GsPlugin *plugin)
+{
+	return plugin->refine_reads != GS_PLUGIN_REFINE_FIELDS_ANY &&
+	       plugin->refine_writes != GS_PLUGIN_REFINE_FIELDS_ANY;
+}
+
+/**
+ * gs_plugin_loader_refine_conflicts:
+ *
+ * Two refiners have to run one after the other if either writes the
+ * #GsApp fields that the other reads or writes. #GsApp has no locking, so
+ * a refiner that does not declare its fields runs on its own, even next
+ * to one that declares it uses none.
+ **/
+static gboolean
+gs_plugin_loader_refine_conflicts (GsPlugin *plugin1, GsPlugin *plugin2)
+{
+	if (!gs_plugin_loader_refine_declared (plugin1) ||
+	    !gs_plugin_loader_refine_declared (plugin2))
+		return TRUE;
+	if ((plugin1->refine_writes &
+	     (plugin2->refine_writes | plugin2->refine_reads)) != 0)
+		return TRUE;
+	if ((plugin1->refine_reads & plugin2->refine_writes) != 0)
+		return TRUE;
+	return FALSE;
+}
+
+/**
+ * gs_plugin_loader_run_refine_parallel:
+ *
+ * Runs every gs_plugin_refine() concurrently on the same list, except
+ * where the plugins depend on each other or on the same #GsApp fields, in
+ * which case the plugin with the higher priority runs first.
+ **/
+static gboolean
+gs_plugin_loader_run_refine_parallel (GsPluginLoader *plugin_loader,
+				      GList **list,
+				      GsPluginRefineFlags flags,
+				      GCancellable *cancellable,
+				      GError **error)
+{
+	GsPluginLoaderDispatch *dispatch;
+	GsPluginLoaderJob *job1;
+	GsPluginLoaderJob *job2;
+	gboolean ret;
+	guint i;
+	guint j;
+
+	dispatch = gs_plugin_loader_dispatch_new (plugin_loader,
+						  "gs_plugin_refine",
+						  GS_PLUGIN_LOADER_JOB_KIND_REFINE,
+						  flags,
+						  cancellable);
+	dispatch->refine_list = list;
+
+	/* nothing can add what was asked for */
+	if (dispatch->jobs->len == 0) {
+		gs_plugin_loader_dispatch_free (dispatch);
+		return TRUE;
+	}
+
+	/* order the refiners that share fields */
+	for (i = 0; i < dispatch->jobs->len; i++) {
+		job1 = g_ptr_array_index (dispatch->jobs, i);
+		for (j = i + 1; j < dispatch->jobs->len; j++) {
+			job2 = g_ptr_array_index (dispatch->jobs, j);
+			if (!gs_plugin_loader_refine_conflicts (job1->plugin,
+								job2->plugin))
+				continue;
+			gs_plugin_loader_job_add_dep (job2, job1);
+		}
+	}
+	ret = gs_plugin_loader_dispatch_run (dispatch, error);
+	gs_plugin_loader_dispatch_free (dispatch);
+	return ret;
+}
+
+/**
+ * gs_plugin_loader_run_refine:
+ **/
+static gboolean
+gs_plugin_loader_run_refine (GsPluginLoader *plugin_loader,
+			     const gchar *function_name_parent,
+			     GList **list,
+			     GsPluginRefineFlags flags,
+			     GCancellable *cancellable,
+			     GError **error)
+{
+	GList *l;
+	GList *addons_list = NULL;
+	GList *related_list = NULL;
 	GPtrArray *addons;
 	GPtrArray *related;
 	GsApp *app;
-	GsPlugin *plugin;
 	gboolean ret = TRUE;
 	guint i;
 	GList *freeze_list;
+	_cleanup_free_ gchar *profile_id = NULL;
 
 	/* freeze all apps */
 	freeze_list = gs_plugin_list_copy (*list);
@@ -270,20 +1421,21 @@ gs_plugin_loader_run_refine (GsPluginLoader *plugin_loader,
 		g_object_freeze_notify (G_OBJECT (l->data));
 
 	/* run each plugin */
-	for (i = 0; i < plugin_loader->priv->plugins->len; i++) {
-		plugin = g_ptr_array_index (plugin_loader->priv->plugins, i);
-		if (!plugin->enabled)
-			continue;
-		ret = gs_plugin_loader_run_refine_plugin (plugin_loader,
-							  plugin,
-							  function_name_parent,
-							  list,
-							  flags,
-							  cancellable,
-							  error);
-		if (!ret)
-			goto out;
+	if (function_name_parent == NULL) {
+		profile_id = g_strdup ("GsPlugin::*(gs_plugin_refine)");
+	} else {
+		profile_id = g_strdup_printf ("GsPlugin::*(%s;gs_plugin_refine)",
+					      function_name_parent);
 	}
+	gs_profile_start (plugin_loader->priv->profile, profile_id);
+	ret = gs_plugin_loader_run_refine_parallel (plugin_loader,
+						    list,
+						    flags,
+						    cancellable,
+						    error);
+	gs_profile_stop (plugin_loader->priv->profile, profile_id);
+	if (!ret)
+		goto out;
 
 	/* refine addons one layer deep */
 	if ((flags & GS_PLUGIN_REFINE_FLAGS_REQUIRE_ADDONS) > 0) {
@@ -351,64 +1503,23 @@ out:
 }
 
 /**
- * gs_plugin_loader_run_results_plugin:
+ * gs_plugin_loader_run_results:
  **/
-static gboolean
-gs_plugin_loader_run_results_plugin (GsPluginLoader *plugin_loader,
-				     GsPlugin *plugin,
-				     const gchar *function_name,
-				     GList **list,
-				     GCancellable *cancellable,
-				     GError **error)
+static GList *
+gs_plugin_loader_run_results (GsPluginLoader *plugin_loader,
+			      const gchar *function_name,
+			      GsPluginRefineFlags flags,
+			      GCancellable *cancellable,
+			      GError **error)
 {
-	GsPluginResultsFunc plugin_func = NULL;
-	gboolean exists;
 	gboolean ret = TRUE;
-	_cleanup_free_ gchar *profile_id = NULL;
+	GList *list = NULL;
+	_cleanup_free_ gchar *profile_id_parent = NULL;
 
-	/* get symbol */
-	exists = g_module_symbol (plugin->module,
-				  function_name,
-				  (gpointer *) &plugin_func);
-	if (!exists)
-		goto out;
-
-	/* run function */
-	profile_id = g_strdup_printf ("GsPlugin::%s(%s)",
-				      plugin->name, function_name);
-	gs_profile_start (plugin_loader->priv->profile, profile_id);
-	g_assert (error == NULL || *error == NULL);
-	ret = plugin_func (plugin, list, cancellable, error);
-	if (!ret)
-		goto out;
-out:
-	if (profile_id != NULL) {
-		gs_plugin_status_update (plugin, NULL, GS_PLUGIN_STATUS_FINISHED);
-		gs_profile_stop (plugin_loader->priv->profile, profile_id);
-	}
-	return ret;
-}
-
-/**
- * gs_plugin_loader_run_results:
- **/
-static GList *
-gs_plugin_loader_run_results (GsPluginLoader *plugin_loader,
-			      const gchar *function_name,
-			      GsPluginRefineFlags flags,
-			      GCancellable *cancellable,
-			      GError **error)
-{
-	gboolean ret = TRUE;
-	GList *list = NULL;
-	GsPlugin *plugin;
-	guint i;
-	_cleanup_free_ gchar *profile_id_parent = NULL;
-
-	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
-	g_return_val_if_fail (function_name != NULL, NULL);
-	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
-	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
+	g_return_val_if_fail (function_name != NULL, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
 
 	/* profile */
 	profile_id_parent = g_strdup_printf ("GsPlugin::*(%s)",
@@ -416,24 +1527,16 @@ gs_plugin_loader_run_results (GsPluginLoader *plugin_loader,
 	gs_profile_start (plugin_loader->priv->profile, profile_id_parent);
 
 	/* run each plugin */
-	for (i = 0; i < plugin_loader->priv->plugins->len; i++) {
-		plugin = g_ptr_array_index (plugin_loader->priv->plugins, i);
-		if (!plugin->enabled)
-			continue;
-		ret = g_cancellable_set_error_if_cancelled (cancellable, error);
-		if (ret) {
-			ret = FALSE;
-			goto out;
-		}
-		ret = gs_plugin_loader_run_results_plugin (plugin_loader,
-							   plugin,
-							   function_name,
-							   &list,
-							   cancellable,
-							   error);
-		if (!ret)
-			goto out;
-	}
+	ret = gs_plugin_loader_run_parallel (plugin_loader,
+					     function_name,
+					     GS_PLUGIN_LOADER_JOB_KIND_RESULTS,
+					     NULL,
+					     NULL,
+					     &list,
+					     cancellable,
+					     error);
+	if (!ret)
+		goto out;
 
 	/* dedupe applications we already know about */
 	gs_plugin_loader_list_dedupe (plugin_loader, list);
@@ -554,7 +1657,7 @@ gs_plugin_loader_app_is_valid (GsApp *app, gpointer user_data)
 		return FALSE;
 	}
 	if (gs_app_get_kind (app) == GS_APP_KIND_NORMAL &&
-	    gs_app_get_pixbuf (app) == NULL) {
+	    !gs_app_has_icon (app)) {
 		g_debug ("app invalid as no pixbuf %s",
 			 gs_plugin_loader_get_app_str (app));
 		return FALSE;
@@ -664,23 +1767,19 @@ static gboolean
 gs_plugin_loader_run_action_plugin (GsPluginLoader *plugin_loader,
 				    GsPlugin *plugin,
 				    GsApp *app,
-				    const gchar *function_name,
+				    GsPluginLoaderVfunc vfunc,
 				    GCancellable *cancellable,
 				    GError **error)
 {
 	GError *error_local = NULL;
-	GsPluginActionFunc plugin_func = NULL;
-	gboolean exists;
+	GsPluginActionFunc plugin_func;
+	const gchar *profile_id = NULL;
 	gboolean ret = TRUE;
-	_cleanup_free_ gchar *profile_id = NULL;
 
-	exists = g_module_symbol (plugin->module,
-				  function_name,
-				  (gpointer *) &plugin_func);
-	if (!exists)
+	plugin_func = gs_plugin_loader_plugin_get_vfunc (plugin, vfunc);
+	if (plugin_func == NULL)
 		goto out;
-	profile_id = g_strdup_printf ("GsPlugin::%s(%s)",
-				      plugin->name, function_name);
+	profile_id = plugin->profile_ids[vfunc];
 	gs_profile_start (plugin_loader->priv->profile, profile_id);
 	ret = plugin_func (plugin, app, cancellable, &error_local);
 	if (!ret) {
@@ -718,9 +1817,11 @@ gs_plugin_loader_run_action (GsPluginLoader *plugin_loader,
 	gboolean ret;
 	gboolean anything_ran = FALSE;
 	GsPlugin *plugin;
+	GsPluginLoaderVfunc vfunc;
 	guint i;
 
 	/* run each plugin */
+	vfunc = gs_plugin_loader_vfunc_lookup (function_name);
 	for (i = 0; i < plugin_loader->priv->plugins->len; i++) {
 		plugin = g_ptr_array_index (plugin_loader->priv->plugins, i);
 		if (!plugin->enabled)
@@ -730,7 +1831,7 @@ gs_plugin_loader_run_action (GsPluginLoader *plugin_loader,
 		ret = gs_plugin_loader_run_action_plugin (plugin_loader,
 							  plugin,
 							  app,
-							  function_name,
+							  vfunc,
 							  cancellable,
 							  error);
 		if (!ret)
@@ -866,6 +1967,9 @@ gs_plugin_loader_get_updates_thread_cb (GTask *task,
 		return;
 	}
 
+	/* the refined apps are worth keeping for next time */
+	gs_plugin_loader_snapshot_capture (plugin_loader, state->list);
+
 	/* success */
 	g_task_return_pointer (task, gs_plugin_list_copy (state->list), (GDestroyNotify) gs_plugin_list_free);
 }
@@ -926,12 +2030,18 @@ gs_plugin_loader_get_updates_finish (GsPluginLoader *plugin_loader,
 				       GAsyncResult *res,
 				       GError **error)
 {
+	GList *list;
+
 	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
 	g_return_val_if_fail (G_IS_TASK (res), NULL);
 	g_return_val_if_fail (g_task_is_valid (res, plugin_loader), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	return g_task_propagate_pointer (G_TASK (res), error);
+	/* the refined apps are saved a bit later */
+	list = g_task_propagate_pointer (G_TASK (res), error);
+	if (list != NULL)
+		gs_plugin_loader_snapshot_queue_save (plugin_loader);
+	return list;
 }
 
 /******************************************************************************/
@@ -1065,14 +2175,967 @@ gs_plugin_loader_get_installed_thread_cb (GTask *task,
 		return;
 	}
 
+	/* the refined apps are worth keeping for next time */
+	gs_plugin_loader_snapshot_capture (plugin_loader, state->list);
+
+	/* success */
+	g_task_return_pointer (task, gs_plugin_list_copy (state->list), (GDestroyNotify) gs_plugin_list_free);
+}
+
+/**
+ * gs_plugin_loader_get_installed_async:
+ *
+ * This method calls all plugins that implement the gs_plugin_add_installed()
+ * function. The plugins can either return #GsApp objects of kind
+ * %GS_APP_KIND_NORMAL for bonafide applications, or #GsApp's of kind
+ * %GS_APP_KIND_PACKAGE for packages that may or may not be applications.
+ *
+ * Once the list of updates is refined, some of the #GsApp's of kind
+ * %GS_APP_KIND_PACKAGE will have been promoted to a kind of %GS_APP_KIND_NORMAL,
+ * or if they are core applications, promoted again to a kind of %GS_APP_KIND_SYSTEM.
+ *
+ * Any #GsApp's of kind %GS_APP_KIND_PACKAGE or %GS_APP_KIND_SYSTEM that remain
+ * after refining are automatically removed.
+ *
+ * This means all of the #GsApp's returning from this function are of kind
+ * %GS_APP_KIND_NORMAL.
+ *
+ * The #GsApps will all initially be in state %AS_APP_STATE_INSTALLED.
+ **/
+void
+gs_plugin_loader_get_installed_async (GsPluginLoader *plugin_loader,
+				      GsPluginRefineFlags flags,
+				      GCancellable *cancellable,
+				      GAsyncReadyCallback callback,
+				      gpointer user_data)
+{
+	GsPluginLoaderAsyncState *state;
+	_cleanup_object_unref_ GTask *task = NULL;
+
+	g_return_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	/* save state */
+	state = g_slice_new0 (GsPluginLoaderAsyncState);
+	state->flags = flags;
+
+	/* run in a thread */
+	task = g_task_new (plugin_loader, cancellable, callback, user_data);
+	g_task_set_task_data (task, state, (GDestroyNotify) gs_plugin_loader_free_async_state);
+	g_task_set_return_on_cancel (task, TRUE);
+	g_task_run_in_thread (task, gs_plugin_loader_get_installed_thread_cb);
+}
+
+/**
+ * gs_plugin_loader_get_installed_finish:
+ *
+ * Return value: (element-type GsApp) (transfer full): A list of applications
+ **/
+GList *
+gs_plugin_loader_get_installed_finish (GsPluginLoader *plugin_loader,
+				       GAsyncResult *res,
+				       GError **error)
+{
+	GList *list;
+
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
+	g_return_val_if_fail (G_IS_TASK (res), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, plugin_loader), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* the real results replace the ones from the last session */
+	list = g_task_propagate_pointer (G_TASK (res), error);
+	if (list != NULL) {
+		g_mutex_lock (&plugin_loader->priv->app_cache_mutex);
+		g_hash_table_remove_all (plugin_loader->priv->snapshot);
+		g_mutex_unlock (&plugin_loader->priv->app_cache_mutex);
+		gs_plugin_loader_snapshot_queue_save (plugin_loader);
+	}
+	return list;
+}
+
+/******************************************************************************/
+
+/**
+ * gs_plugin_loader_get_popular_thread_cb:
+ **/
+static void
+gs_plugin_loader_get_popular_thread_cb (GTask *task,
+					gpointer object,
+					gpointer task_data,
+					GCancellable *cancellable)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
+	GsPluginLoaderAsyncState *state = (GsPluginLoaderAsyncState *) task_data;
+	GError *error = NULL;
+
+	/* do things that would block */
+	state->list = gs_plugin_loader_run_results (plugin_loader,
+						    "gs_plugin_add_popular",
+						    state->flags,
+						    cancellable,
+						    &error);
+	if (error != NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+
+	/* filter package list */
+	gs_plugin_list_filter (&state->list, gs_plugin_loader_app_is_valid, state);
+	gs_plugin_list_filter (&state->list, gs_plugin_loader_filter_qt_for_gtk, NULL);
+	gs_plugin_list_filter (&state->list, gs_plugin_loader_get_app_is_compatible, plugin_loader);
+	if (state->list == NULL) {
+		g_task_return_new_error (task,
+					 GS_PLUGIN_LOADER_ERROR,
+					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
+					 "no popular apps to show");
+		return;
+	}
+
+	/* success */
+	g_task_return_pointer (task, gs_plugin_list_copy (state->list), (GDestroyNotify) gs_plugin_list_free);
+}
+
+/**
+ * gs_plugin_loader_get_popular_async:
+ **/
+void
+gs_plugin_loader_get_popular_async (GsPluginLoader *plugin_loader,
+				    GsPluginRefineFlags flags,
+				    GCancellable *cancellable,
+				    GAsyncReadyCallback callback,
+				    gpointer user_data)
+{
+	GsPluginLoaderAsyncState *state;
+	_cleanup_object_unref_ GTask *task = NULL;
+
+	g_return_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	/* save state */
+	state = g_slice_new0 (GsPluginLoaderAsyncState);
+	state->flags = flags;
+
+	/* run in a thread */
+	task = g_task_new (plugin_loader, cancellable, callback, user_data);
+	g_task_set_task_data (task, state, (GDestroyNotify) gs_plugin_loader_free_async_state);
+	g_task_set_return_on_cancel (task, TRUE);
+	g_task_run_in_thread (task, gs_plugin_loader_get_popular_thread_cb);
+}
+
+/**
+ * gs_plugin_loader_get_popular_finish:
+ *
+ * Return value: (element-type GsApp) (transfer full): A list of applications
+ **/
+GList *
+gs_plugin_loader_get_popular_finish (GsPluginLoader *plugin_loader,
+				     GAsyncResult *res,
+				     GError **error)
+{
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
+	g_return_val_if_fail (G_IS_TASK (res), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, plugin_loader), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+/******************************************************************************/
+
+/**
+ * gs_plugin_loader_featured_debug:
+ **/
+static gboolean
+gs_plugin_loader_featured_debug (GsApp *app, gpointer user_data)
+{
+	if (g_strcmp0 (gs_app_get_id (app),
+	    g_getenv ("GNOME_SOFTWARE_FEATURED")) == 0)
+		return TRUE;
+	return FALSE;
+}
+
+/**
+ * gs_plugin_loader_get_featured_thread_cb:
+ **/
+static void
+gs_plugin_loader_get_featured_thread_cb (GTask *task,
+					 gpointer object,
+					 gpointer task_data,
+					 GCancellable *cancellable)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
+	GsPluginLoaderAsyncState *state = (GsPluginLoaderAsyncState *) task_data;
+	GError *error = NULL;
+
+	/* do things that would block */
+	state->list = gs_plugin_loader_run_results (plugin_loader,
+						    "gs_plugin_add_featured",
+						    state->flags,
+						    cancellable,
+						    &error);
+	if (error != NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+
+	/* filter package list */
+	if (g_getenv ("GNOME_SOFTWARE_FEATURED") != NULL) {
+		gs_plugin_list_filter (&state->list, gs_plugin_loader_featured_debug, NULL);
+	} else {
+		gs_plugin_list_filter (&state->list, gs_plugin_loader_app_is_valid, state);
+		gs_plugin_list_filter (&state->list, gs_plugin_loader_get_app_is_compatible, plugin_loader);
+	}
+	if (state->list == NULL) {
+		g_task_return_new_error (task,
+					 GS_PLUGIN_LOADER_ERROR,
+					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
+					 "no featured apps to show");
+		return;
+	}
+
+	/* success */
+	g_task_return_pointer (task, gs_plugin_list_copy (state->list), (GDestroyNotify) gs_plugin_list_free);
+}
+
+/**
+ * gs_plugin_loader_get_featured_async:
+ *
+ * This method calls all plugins that implement the gs_plugin_add_featured()
+ * function. The plugins can either return #GsApp objects of kind
+ * %GS_APP_KIND_NORMAL for bonafide applications, or #GsApp's of kind
+ * %GS_APP_KIND_PACKAGE for packages that may or may not be applications.
+ *
+ * Once the list of updates is refined, some of the #GsApp's of kind
+ * %GS_APP_KIND_PACKAGE will have been promoted to a kind of %GS_APP_KIND_NORMAL,
+ * or if they are core applications, promoted again to a kind of %GS_APP_KIND_SYSTEM.
+ *
+ * Any #GsApp's of kind %GS_APP_KIND_PACKAGE that remain after refining are
+ * automatically removed.
+ *
+ * This means all of the #GsApp's returning from this function are of kind
+ * %GS_APP_KIND_NORMAL or %GS_APP_KIND_SYSTEM.
+ *
+ * The #GsApps may be in state %AS_APP_STATE_INSTALLED or %AS_APP_STATE_AVAILABLE
+ * and the UI may want to filter the two classes of applications differently.
+ **/
+void
+gs_plugin_loader_get_featured_async (GsPluginLoader *plugin_loader,
+				     GsPluginRefineFlags flags,
+				     GCancellable *cancellable,
+				     GAsyncReadyCallback callback,
+				     gpointer user_data)
+{
+	GsPluginLoaderAsyncState *state;
+	_cleanup_object_unref_ GTask *task = NULL;
+
+	g_return_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	/* save state */
+	state = g_slice_new0 (GsPluginLoaderAsyncState);
+	state->flags = flags;
+
+	/* run in a thread */
+	task = g_task_new (plugin_loader, cancellable, callback, user_data);
+	g_task_set_task_data (task, state, (GDestroyNotify) gs_plugin_loader_free_async_state);
+	g_task_set_return_on_cancel (task, TRUE);
+	g_task_run_in_thread (task, gs_plugin_loader_get_featured_thread_cb);
+}
+
+/**
+ * gs_plugin_loader_get_featured_finish:
+ *
+ * Return value: (element-type GsApp) (transfer full): A list of applications
+ **/
+GList *
+gs_plugin_loader_get_featured_finish (GsPluginLoader *plugin_loader,
+				      GAsyncResult *res,
+				      GError **error)
+{
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
+	g_return_val_if_fail (G_IS_TASK (res), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, plugin_loader), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+/******************************************************************************/
+
+/**
+ * gs_plugin_loader_convert_unavailable_app:
+ **/
+static gboolean
+gs_plugin_loader_convert_unavailable_app (GsApp *app, const gchar *search)
+{
+	GPtrArray *keywords;
+	const gchar *keyword;
+	guint i;
+	_cleanup_string_free_ GString *tmp = NULL;
+
+	/* is the search string one of the codec keywords */
+	keywords = gs_app_get_keywords (app);
+	for (i = 0; i < keywords->len; i++) {
+		keyword = g_ptr_array_index (keywords, i);
+		if (g_ascii_strcasecmp (search, keyword) == 0) {
+			search = keyword;
+			break;
+		}
+	}
+
+	tmp = g_string_new ("");
+	/* TRANSLATORS: this is when we know about an application or
+	 * addon, but it can't be listed for some reason */
+	g_string_append_printf (tmp, _("No addon codecs are available "
+				"for the %s format."), search);
+	g_string_append (tmp, "\n");
+	g_string_append_printf (tmp, _("Information about %s, as well as options "
+				"for how to get a codec that can play this format "
+				"can be found on the website."), search);
+	gs_app_set_summary_missing (app, tmp->str);
+	gs_app_set_kind (app, GS_APP_KIND_MISSING);
+	gs_app_set_size (app, GS_APP_SIZE_MISSING);
+	return TRUE;
+}
+
+/**
+ * gs_plugin_loader_convert_unavailable:
+ **/
+static void
+gs_plugin_loader_convert_unavailable (GList *list, const gchar *search)
+{
+	GList *l;
+	GsApp *app;
+
+	for (l = list; l != NULL; l = l->next) {
+		app = GS_APP (l->data);
+		if (gs_app_get_kind (app) != GS_APP_KIND_UNKNOWN &&
+		    gs_app_get_kind (app) != GS_APP_KIND_MISSING)
+			continue;
+		if (gs_app_get_state (app) != AS_APP_STATE_UNAVAILABLE)
+			continue;
+		if (gs_app_get_id_kind (app) != AS_ID_KIND_CODEC)
+			continue;
+		if (gs_app_get_url (app, AS_URL_KIND_MISSING) == NULL)
+			continue;
+
+		/* only convert the first unavailable codec */
+		if (gs_plugin_loader_convert_unavailable_app (app, search))
+			break;
+	}
+}
+
+/**
+ * gs_plugin_loader_search_refine:
+ *
+ * Refines and filters the results returned by gs_plugin_add_search().
+ **/
+static gboolean
+gs_plugin_loader_search_refine (GsPluginLoader *plugin_loader,
+				GsPluginLoaderAsyncState *state,
+				GList **list,
+				GCancellable *cancellable,
+				GError **error)
+{
+	/* dedupe applications we already know about */
+	gs_plugin_loader_list_dedupe (plugin_loader, *list);
+
+	/* run refine() on each one */
+	if (!gs_plugin_loader_run_refine (plugin_loader,
+					  "gs_plugin_add_search",
+					  list,
+					  state->flags,
+					  cancellable,
+					  error))
+		return FALSE;
+
+	/* convert any unavailables */
+	gs_plugin_loader_convert_unavailable (*list, state->value);
+
+	/* filter package list */
+	gs_plugin_list_filter_duplicates (list);
+	gs_plugin_list_filter (list, gs_plugin_loader_app_is_valid, state);
+	gs_plugin_list_filter (list, gs_plugin_loader_filter_qt_for_gtk, NULL);
+	gs_plugin_list_filter (list, gs_plugin_loader_get_app_is_compatible, plugin_loader);
+	if (((state->flags & GS_PLUGIN_REFINE_FLAGS_ALLOW_NO_APPDATA) == 0) &&
+	    g_settings_get_boolean (plugin_loader->priv->settings, "require-appdata")) {
+		gs_plugin_list_filter (list,
+				       gs_plugin_loader_get_app_has_appdata,
+				       plugin_loader);
+	}
+	return TRUE;
+}
+
+/* a set of search results on the way to the main context */
+typedef struct {
+	GsPluginLoader			*plugin_loader;
+	GsPluginLoaderSearchBatchFunc	 batch_func;
+	gpointer			 batch_data;
+	GCancellable			*cancellable;
+	GList				*list;
+} GsPluginLoaderSearchBatch;
+
+/**
+ * gs_plugin_loader_search_batch_free:
+ **/
+static void
+gs_plugin_loader_search_batch_free (GsPluginLoaderSearchBatch *batch)
+{
+	g_object_unref (batch->plugin_loader);
+	if (batch->cancellable != NULL)
+		g_object_unref (batch->cancellable);
+	gs_plugin_list_free (batch->list);
+	g_slice_free (GsPluginLoaderSearchBatch, batch);
+}
+
+/**
+ * gs_plugin_loader_search_batch_cb:
+ **/
+static gboolean
+gs_plugin_loader_search_batch_cb (gpointer user_data)
+{
+	GsPluginLoaderSearchBatch *batch = (GsPluginLoaderSearchBatch *) user_data;
+
+	/* the caller has moved on to another search */
+	if (batch->cancellable != NULL &&
+	    g_cancellable_is_cancelled (batch->cancellable))
+		return G_SOURCE_REMOVE;
+	batch->batch_func (batch->plugin_loader, batch->list, batch->batch_data);
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * gs_plugin_loader_search_sort_cb:
+ **/
+static gint
+gs_plugin_loader_search_sort_cb (gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0 (gs_app_get_search_sort_key (GS_APP (b)),
+			  gs_app_get_search_sort_key (GS_APP (a)));
+}
+
+/**
+ * gs_plugin_loader_search_heap_swap:
+ **/
+static void
+gs_plugin_loader_search_heap_swap (GPtrArray *heap, guint idx1, guint idx2)
+{
+	gpointer tmp = heap->pdata[idx1];
+	heap->pdata[idx1] = heap->pdata[idx2];
+	heap->pdata[idx2] = tmp;
+}
+
+/**
+ * gs_plugin_loader_search_heap_sift_up:
+ **/
+static void
+gs_plugin_loader_search_heap_sift_up (GPtrArray *heap, guint idx)
+{
+	guint parent;
+
+	while (idx > 0) {
+		parent = (idx - 1) / 2;
+		if (gs_plugin_loader_search_sort_cb (heap->pdata[idx],
+						     heap->pdata[parent]) <= 0)
+			break;
+		gs_plugin_loader_search_heap_swap (heap, idx, parent);
+		idx = parent;
+	}
+}
+
+/**
+ * gs_plugin_loader_search_heap_sift_down:
+ **/
+static void
+gs_plugin_loader_search_heap_sift_down (GPtrArray *heap, guint idx)
+{
+	guint child;
+
+	while ((child = idx * 2 + 1) < heap->len) {
+		if (child + 1 < heap->len &&
+		    gs_plugin_loader_search_sort_cb (heap->pdata[child + 1],
+						     heap->pdata[child]) > 0)
+			child++;
+		if (gs_plugin_loader_search_sort_cb (heap->pdata[child],
+						     heap->pdata[idx]) <= 0)
+			break;
+		gs_plugin_loader_search_heap_swap (heap, idx, child);
+		idx = child;
+	}
+}
+
+/**
+ * gs_plugin_loader_search_rank:
+ *
+ * Picks matches @offset to @offset + @max from @list, ordered by the match
+ * score set by the plugin. Only the best @offset + @max candidates are ever
+ * kept, in a heap with the worst of them at the root.
+ *
+ * Returns: (transfer full): the matches, best first
+ **/
+static GList *
+gs_plugin_loader_search_rank (GList *list, guint offset, guint max)
+{
+	GList *l;
+	GList *ranked = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *heap = NULL;
+
+	heap = g_ptr_array_sized_new (offset + max);
+	for (l = list; l != NULL; l = l->next) {
+		if (heap->len < offset + max) {
+			g_ptr_array_add (heap, l->data);
+			gs_plugin_loader_search_heap_sift_up (heap, heap->len - 1);
+			continue;
+		}
+
+		/* only replace the worst match we have */
+		if (gs_plugin_loader_search_sort_cb (l->data, heap->pdata[0]) >= 0)
+			continue;
+		heap->pdata[0] = l->data;
+		gs_plugin_loader_search_heap_sift_down (heap, 0);
+	}
+
+	/* the root comes out worst first, and the best @offset stay behind */
+	while (heap->len > offset) {
+		gs_plugin_add_app (&ranked, GS_APP (heap->pdata[0]));
+		g_ptr_array_remove_index_fast (heap, 0);
+		gs_plugin_loader_search_heap_sift_down (heap, 0);
+	}
+	return ranked;
+}
+
+/**
+ * gs_plugin_loader_search_stream:
+ *
+ * Refines @list a few applications at a time and sends each set to the
+ * main context as soon as it is ready, so the best matches are shown first.
+ * The IDs of the applications that were sent are added to @sent.
+ **/
+static gboolean
+gs_plugin_loader_search_stream (GsPluginLoader *plugin_loader,
+				GTask *task,
+				GsPluginLoaderAsyncState *state,
+				GList *list,
+				GHashTable *sent,
+				GCancellable *cancellable,
+				GError **error)
+{
+	GsApp *app;
+	GsPluginLoaderSearchBatch *batch;
+	GList *c;
+	GList *l;
+	guint i;
+
+	for (l = list; l != NULL;) {
+		_cleanup_plugin_list_free_ GList *chunk = NULL;
+		GList *list_new = NULL;
+
+		for (i = 0; l != NULL && i < GS_PLUGIN_LOADER_SEARCH_BATCH_SIZE; l = l->next, i++)
+			gs_plugin_add_app (&chunk, GS_APP (l->data));
+		chunk = g_list_reverse (chunk);
+		if (!gs_plugin_loader_search_refine (plugin_loader, state,
+						     &chunk, cancellable, error))
+			return FALSE;
+
+		/* refining can give two candidates the same ID */
+		for (c = chunk; c != NULL; c = c->next) {
+			app = GS_APP (c->data);
+			if (gs_app_get_id (app) != NULL) {
+				if (g_hash_table_contains (sent, gs_app_get_id (app)))
+					continue;
+				g_hash_table_add (sent, g_strdup (gs_app_get_id (app)));
+			}
+			gs_plugin_add_app (&list_new, app);
+		}
+		if (list_new == NULL)
+			continue;
+		list_new = g_list_reverse (list_new);
+		state->list = g_list_concat (state->list, gs_plugin_list_copy (list_new));
+
+		batch = g_slice_new0 (GsPluginLoaderSearchBatch);
+		batch->plugin_loader = g_object_ref (plugin_loader);
+		batch->batch_func = state->batch_func;
+		batch->batch_data = state->batch_data;
+		if (cancellable != NULL)
+			batch->cancellable = g_object_ref (cancellable);
+		batch->list = list_new;
+		g_main_context_invoke_full (g_task_get_context (task),
+					    G_PRIORITY_DEFAULT,
+					    gs_plugin_loader_search_batch_cb,
+					    batch,
+					    (GDestroyNotify) gs_plugin_loader_search_batch_free);
+	}
+	return TRUE;
+}
+
+/**
+ * gs_plugin_loader_search_slice:
+ *
+ * Returns: (transfer full): up to @max applications from @list, starting
+ * at @offset
+ **/
+static GList *
+gs_plugin_loader_search_slice (GList *list, guint offset, guint max)
+{
+	GList *l;
+	GList *slice = NULL;
+	guint i;
+
+	l = g_list_nth (list, offset);
+	for (i = 0; l != NULL && i < max; l = l->next, i++)
+		gs_plugin_add_app (&slice, GS_APP (l->data));
+	return g_list_reverse (slice);
+}
+
+/**
+ * gs_plugin_loader_search_cache_get_generation:
+ *
+ * Gets the generation a search starts with, so that matches found with
+ * data that has since changed are not saved.
+ **/
+static guint
+gs_plugin_loader_search_cache_get_generation (GsPluginLoader *plugin_loader)
+{
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+	guint generation;
+
+	g_mutex_lock (&priv->search_mutex);
+	generation = priv->search_generation;
+	g_mutex_unlock (&priv->search_mutex);
+	return generation;
+}
+
+/**
+ * gs_plugin_loader_search_cache_save:
+ *
+ * Keeps the ranked matches after the first page of the last search, so
+ * the later pages do not run every plugin again. Nothing is kept if the
+ * cache was cleared after the search started.
+ **/
+static void
+gs_plugin_loader_search_cache_save (GsPluginLoader *plugin_loader,
+				    GsPluginLoaderAsyncState *state,
+				    guint generation,
+				    GList *ranked)
+{
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+
+	g_mutex_lock (&priv->search_mutex);
+	if (generation == priv->search_generation) {
+		g_free (priv->search_value);
+		priv->search_value = g_strdup (state->value);
+		priv->search_flags = state->flags;
+		gs_plugin_list_free (priv->search_ranked);
+		priv->search_ranked = gs_plugin_list_copy (ranked);
+		priv->search_n_matches = state->n_matches;
+	}
+	g_mutex_unlock (&priv->search_mutex);
+}
+
+/**
+ * gs_plugin_loader_search_cache_lookup:
+ *
+ * Returns: %TRUE if @value with @flags was the last search and @ranked
+ * was set
+ **/
+static gboolean
+gs_plugin_loader_search_cache_lookup (GsPluginLoader *plugin_loader,
+				      const gchar *value,
+				      GsPluginRefineFlags flags,
+				      GList **ranked,
+				      guint *n_matches)
+{
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+	gboolean ret = FALSE;
+
+	g_mutex_lock (&priv->search_mutex);
+	if (g_strcmp0 (priv->search_value, value) == 0 &&
+	    priv->search_flags == flags) {
+		*ranked = gs_plugin_list_copy (priv->search_ranked);
+		*n_matches = priv->search_n_matches;
+		ret = TRUE;
+	}
+	g_mutex_unlock (&priv->search_mutex);
+	return ret;
+}
+
+/**
+ * gs_plugin_loader_search_cache_clear:
+ **/
+static void
+gs_plugin_loader_search_cache_clear (GsPluginLoader *plugin_loader)
+{
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+
+	g_mutex_lock (&priv->search_mutex);
+	g_clear_pointer (&priv->search_value, g_free);
+	g_clear_pointer (&priv->search_ranked, gs_plugin_list_free);
+	priv->search_n_matches = 0;
+	priv->search_generation++;
+	g_mutex_unlock (&priv->search_mutex);
+}
+
+/**
+ * gs_plugin_loader_search_set_truncated:
+ *
+ * Remembers if the last paged search found more than one page, as its
+ * results cannot then be narrowed by a subsearch.
+ **/
+static void
+gs_plugin_loader_search_set_truncated (GsPluginLoader *plugin_loader,
+				       GsPluginLoaderAsyncState *state)
+{
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+
+	g_mutex_lock (&priv->search_mutex);
+	g_free (priv->search_truncated);
+	priv->search_truncated = NULL;
+	if (state->n_matches > GS_PLUGIN_LOADER_SEARCH_PAGE_SIZE)
+		priv->search_truncated = g_strdup (state->value);
+	g_mutex_unlock (&priv->search_mutex);
+}
+
+/**
+ * gs_plugin_loader_search_was_truncated:
+ *
+ * Returns: %TRUE if @value extends the last paged search and that search
+ * found more than one page
+ **/
+static gboolean
+gs_plugin_loader_search_was_truncated (GsPluginLoader *plugin_loader,
+				       const gchar *value)
+{
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+	gboolean ret;
+
+	g_mutex_lock (&priv->search_mutex);
+	ret = priv->search_truncated != NULL &&
+	      g_str_has_prefix (value, priv->search_truncated);
+	g_mutex_unlock (&priv->search_mutex);
+	return ret;
+}
+
+/**
+ * gs_plugin_loader_search_collect:
+ *
+ * Runs gs_plugin_add_search() on every plugin and adds the matches of
+ * each one to the ranked set as soon as it finishes. When the first page
+ * is streamed, any new match that gets into the best
+ * %GS_PLUGIN_LOADER_SEARCH_PAGE_SIZE is refined and sent straight away,
+ * so a slow plugin does not hold back the results of a fast one.
+ *
+ * @ranked is set to all the matches, best first, less any that were sent.
+ **/
+static gboolean
+gs_plugin_loader_search_collect (GsPluginLoader *plugin_loader,
+				 GTask *task,
+				 GsPluginLoaderAsyncState *state,
+				 gchar **values,
+				 GHashTable *sent,
+				 GList **ranked,
+				 GCancellable *cancellable,
+				 GError **error)
+{
+	GsApp *app;
+	GsPluginLoaderDispatch *dispatch;
+	GsPluginLoaderJob *job;
+	GList *l;
+	gboolean ret = TRUE;
+	gboolean stream;
+	guint i;
+	_cleanup_hashtable_unref_ GHashTable *apps = NULL;
+	_cleanup_hashtable_unref_ GHashTable *ids = NULL;
+	_cleanup_hashtable_unref_ GHashTable *shown = NULL;
+	_cleanup_plugin_list_free_ GList *candidates = NULL;
+
+	dispatch = gs_plugin_loader_dispatch_new (plugin_loader,
+						  "gs_plugin_add_search",
+						  GS_PLUGIN_LOADER_JOB_KIND_SEARCH,
+						  GS_PLUGIN_REFINE_FLAGS_DEFAULT,
+						  cancellable);
+	dispatch->values = values;
+	dispatch->finished = g_async_queue_new ();
+	gs_plugin_loader_dispatch_start (dispatch);
+
+	stream = state->paged && state->offset == 0 && state->batch_func != NULL;
+	apps = g_hash_table_new (g_direct_hash, g_direct_equal);
+	ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	shown = g_hash_table_new (g_direct_hash, g_direct_equal);
+	for (i = 0; i < dispatch->jobs->len; i++) {
+		_cleanup_plugin_list_free_ GList *page = NULL;
+		_cleanup_plugin_list_free_ GList *top = NULL;
+
+		/* the search fails if any plugin does */
+		job = g_async_queue_pop (dispatch->finished);
+		if (!ret || job->error != NULL)
+			continue;
+		for (l = job->list_new; l != NULL; l = l->next) {
+			app = GS_APP (l->data);
+			if (gs_app_get_id (app) != NULL) {
+				if (g_hash_table_contains (ids, gs_app_get_id (app)))
+					continue;
+				g_hash_table_add (ids, g_strdup (gs_app_get_id (app)));
+			} else {
+				/* several plugins may return the same object */
+				if (g_hash_table_contains (apps, app))
+					continue;
+				g_hash_table_add (apps, app);
+			}
+			gs_plugin_add_app (&candidates, app);
+		}
+		if (!stream)
+			continue;
+
+		/* send what this plugin added to the best matches so far */
+		top = gs_plugin_loader_search_rank (candidates, 0,
+						    GS_PLUGIN_LOADER_SEARCH_PAGE_SIZE);
+		for (l = top; l != NULL; l = l->next) {
+			if (g_hash_table_contains (shown, l->data))
+				continue;
+			g_hash_table_add (shown, l->data);
+			gs_plugin_add_app (&page, GS_APP (l->data));
+		}
+		page = g_list_reverse (page);
+		ret = gs_plugin_loader_search_stream (plugin_loader, task, state,
+						      page, sent,
+						      cancellable, error);
+	}
+
+	/* the jobs have all been popped, but may not have returned yet */
+	if (!gs_plugin_loader_dispatch_wait (dispatch, ret ? error : NULL))
+		ret = FALSE;
+	gs_plugin_loader_dispatch_free (dispatch);
+	if (!ret)
+		return FALSE;
+
+	/* rank everything that was not sent; refining only happens for the
+	 * page that is shown, so this is an upper bound on what can be shown */
+	state->n_matches = g_list_length (candidates);
+	candidates = g_list_sort (candidates, gs_plugin_loader_search_sort_cb);
+	for (l = candidates; l != NULL; l = l->next) {
+		if (g_hash_table_contains (shown, l->data))
+			continue;
+		gs_plugin_add_app (ranked, GS_APP (l->data));
+	}
+	*ranked = g_list_reverse (*ranked);
+	return TRUE;
+}
+
+/**
+ * gs_plugin_loader_search_thread_cb:
+ **/
+static void
+gs_plugin_loader_search_thread_cb (GTask *task,
+				   gpointer object,
+				   gpointer task_data,
+				   GCancellable *cancellable)
+{
+	gboolean ret = TRUE;
+	GError *error = NULL;
+	GsPluginLoaderAsyncState *state = (GsPluginLoaderAsyncState *) task_data;
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
+	guint generation;
+	_cleanup_hashtable_unref_ GHashTable *sent = NULL;
+	_cleanup_plugin_list_free_ GList *page = NULL;
+	_cleanup_plugin_list_free_ GList *ranked = NULL;
+	_cleanup_strv_free_ gchar **values = NULL;
+
+	values = as_utils_search_tokenize (state->value);
+	if (values == NULL) {
+		g_task_return_new_error (task,
+					 GS_PLUGIN_LOADER_ERROR,
+					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
+					 "no valid search terms");
+		return;
+	}
+
+	/* later pages come from the matches the first page found */
+	sent = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	generation = gs_plugin_loader_search_cache_get_generation (plugin_loader);
+	if (state->paged &&
+	    state->offset >= GS_PLUGIN_LOADER_SEARCH_PAGE_SIZE &&
+	    gs_plugin_loader_search_cache_lookup (plugin_loader,
+						  state->value,
+						  state->flags,
+						  &ranked,
+						  &state->n_matches)) {
+		page = gs_plugin_loader_search_slice (ranked,
+						      state->offset - GS_PLUGIN_LOADER_SEARCH_PAGE_SIZE,
+						      GS_PLUGIN_LOADER_SEARCH_PAGE_SIZE);
+	} else {
+		ret = gs_plugin_loader_search_collect (plugin_loader,
+						       task,
+						       state,
+						       values,
+						       sent,
+						       &ranked,
+						       cancellable,
+						       &error);
+		if (!ret) {
+			g_task_return_error (task, error);
+			return;
+		}
+		if (state->paged)
+			gs_plugin_loader_search_set_truncated (plugin_loader, state);
+		if (!state->paged) {
+			/* refine all of the matches */
+			page = ranked;
+			ranked = NULL;
+		} else if (state->offset == 0 && state->batch_func != NULL) {
+			gs_plugin_loader_search_cache_save (plugin_loader,
+							    state,
+							    generation,
+							    ranked);
+		} else {
+			page = gs_plugin_loader_search_slice (ranked,
+							      state->offset,
+							      GS_PLUGIN_LOADER_SEARCH_PAGE_SIZE);
+			gs_plugin_loader_search_cache_save (plugin_loader,
+							    state,
+							    generation,
+							    g_list_nth (ranked, GS_PLUGIN_LOADER_SEARCH_PAGE_SIZE));
+		}
+	}
+
+	/* only refine the requested page of the best matches */
+	if (state->batch_func != NULL) {
+		ret = gs_plugin_loader_search_stream (plugin_loader,
+						      task,
+						      state,
+						      page,
+						      sent,
+						      cancellable,
+						      &error);
+	} else {
+		state->list = page;
+		page = NULL;
+		ret = gs_plugin_loader_search_refine (plugin_loader,
+						      state,
+						      &state->list,
+						      cancellable,
+						      &error);
+	}
+	if (!ret) {
+		g_task_return_error (task, error);
+		return;
+	}
+	if (state->list == NULL) {
+		g_task_return_new_error (task,
+					 GS_PLUGIN_LOADER_ERROR,
+					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
+					 "no search results to show");
+		return;
+	}
+
 	/* success */
 	g_task_return_pointer (task, gs_plugin_list_copy (state->list), (GDestroyNotify) gs_plugin_list_free);
 }
 
 /**
- * gs_plugin_loader_get_installed_async:
+ * gs_plugin_loader_search_async:
  *
- * This method calls all plugins that implement the gs_plugin_add_installed()
+ * This method calls all plugins that implement the gs_plugin_add_search()
  * function. The plugins can either return #GsApp objects of kind
  * %GS_APP_KIND_NORMAL for bonafide applications, or #GsApp's of kind
  * %GS_APP_KIND_PACKAGE for packages that may or may not be applications.
@@ -1087,14 +3150,19 @@ gs_plugin_loader_get_installed_thread_cb (GTask *task,
  * This means all of the #GsApp's returning from this function are of kind
  * %GS_APP_KIND_NORMAL.
  *
- * The #GsApps will all initially be in state %AS_APP_STATE_INSTALLED.
+ * The #GsApps may be in state %AS_APP_STATE_INSTALLED or %AS_APP_STATE_AVAILABLE
+ * and the UI may want to filter the two classes of applications differently.
+ *
+ * All of the matches are returned; use gs_plugin_loader_search_stream_async()
+ * to get them a page at a time.
  **/
 void
-gs_plugin_loader_get_installed_async (GsPluginLoader *plugin_loader,
-				      GsPluginRefineFlags flags,
-				      GCancellable *cancellable,
-				      GAsyncReadyCallback callback,
-				      gpointer user_data)
+gs_plugin_loader_search_async (GsPluginLoader *plugin_loader,
+			       const gchar *value,
+			       GsPluginRefineFlags flags,
+			       GCancellable *cancellable,
+			       GAsyncReadyCallback callback,
+			       gpointer user_data)
 {
 	GsPluginLoaderAsyncState *state;
 	_cleanup_object_unref_ GTask *task = NULL;
@@ -1105,83 +3173,48 @@ gs_plugin_loader_get_installed_async (GsPluginLoader *plugin_loader,
 	/* save state */
 	state = g_slice_new0 (GsPluginLoaderAsyncState);
 	state->flags = flags;
+	state->value = g_strdup (value);
 
 	/* run in a thread */
 	task = g_task_new (plugin_loader, cancellable, callback, user_data);
 	g_task_set_task_data (task, state, (GDestroyNotify) gs_plugin_loader_free_async_state);
 	g_task_set_return_on_cancel (task, TRUE);
-	g_task_run_in_thread (task, gs_plugin_loader_get_installed_thread_cb);
+	g_task_run_in_thread (task, gs_plugin_loader_search_thread_cb);
 }
 
 /**
- * gs_plugin_loader_get_installed_finish:
+ * gs_plugin_loader_search_stream_async:
  *
- * Return value: (element-type GsApp) (transfer full): A list of applications
- **/
-GList *
-gs_plugin_loader_get_installed_finish (GsPluginLoader *plugin_loader,
-				       GAsyncResult *res,
-				       GError **error)
-{
-	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
-	g_return_val_if_fail (G_IS_TASK (res), NULL);
-	g_return_val_if_fail (g_task_is_valid (res, plugin_loader), NULL);
-	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
-
-	return g_task_propagate_pointer (G_TASK (res), error);
-}
-
-/******************************************************************************/
-
-/**
- * gs_plugin_loader_get_popular_thread_cb:
- **/
-static void
-gs_plugin_loader_get_popular_thread_cb (GTask *task,
-					gpointer object,
-					gpointer task_data,
-					GCancellable *cancellable)
-{
-	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
-	GsPluginLoaderAsyncState *state = (GsPluginLoaderAsyncState *) task_data;
-	GError *error = NULL;
-
-	/* do things that would block */
-	state->list = gs_plugin_loader_run_results (plugin_loader,
-						    "gs_plugin_add_popular",
-						    state->flags,
-						    cancellable,
-						    &error);
-	if (error != NULL) {
-		g_task_return_error (task, error);
-		return;
-	}
-
-	/* filter package list */
-	gs_plugin_list_filter (&state->list, gs_plugin_loader_app_is_valid, state);
-	gs_plugin_list_filter (&state->list, gs_plugin_loader_filter_qt_for_gtk, NULL);
-	gs_plugin_list_filter (&state->list, gs_plugin_loader_get_app_is_compatible, plugin_loader);
-	if (state->list == NULL) {
-		g_task_return_new_error (task,
-					 GS_PLUGIN_LOADER_ERROR,
-					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
-					 "no popular apps to show");
-		return;
-	}
-
-	/* success */
-	g_task_return_pointer (task, gs_plugin_list_copy (state->list), (GDestroyNotify) gs_plugin_list_free);
-}
-
-/**
- * gs_plugin_loader_get_popular_async:
+ * Like gs_plugin_loader_search_async(), but returns the page of results
+ * starting at @offset, and @batch_func is also called in the main context
+ * with each few results as soon as they are refined, best match first.
+ * Each application is only passed to @batch_func once.
+ *
+ * The matches are ranked on the score set by the plugin before anything
+ * is refined, and only the page that was asked for is refined. For the
+ * first page the matches of each plugin are ranked and sent as soon as
+ * that plugin finishes, so it may hold a few more than
+ * %GS_PLUGIN_LOADER_SEARCH_PAGE_SIZE if a slower plugin returns better
+ * ones. Later pages hold up to %GS_PLUGIN_LOADER_SEARCH_PAGE_SIZE of the
+ * remaining matches, fewer if some turn out to be packages without an
+ * application, and reuse the matches of the last search rather than
+ * running the plugins again.
+ *
+ * Once the page is complete @callback is called, and
+ * gs_plugin_loader_search_finish() returns all the results that were sent
+ * in batches. Use gs_plugin_loader_search_get_n_matches() to find out if
+ * there are more pages.
  **/
 void
-gs_plugin_loader_get_popular_async (GsPluginLoader *plugin_loader,
-				    GsPluginRefineFlags flags,
-				    GCancellable *cancellable,
-				    GAsyncReadyCallback callback,
-				    gpointer user_data)
+gs_plugin_loader_search_stream_async (GsPluginLoader *plugin_loader,
+				      const gchar *value,
+				      GsPluginRefineFlags flags,
+				      guint offset,
+				      GsPluginLoaderSearchBatchFunc batch_func,
+				      gpointer batch_data,
+				      GCancellable *cancellable,
+				      GAsyncReadyCallback callback,
+				      gpointer user_data)
 {
 	GsPluginLoaderAsyncState *state;
 	_cleanup_object_unref_ GTask *task = NULL;
@@ -1192,23 +3225,28 @@ gs_plugin_loader_get_popular_async (GsPluginLoader *plugin_loader,
 	/* save state */
 	state = g_slice_new0 (GsPluginLoaderAsyncState);
 	state->flags = flags;
+	state->value = g_strdup (value);
+	state->offset = offset;
+	state->paged = TRUE;
+	state->batch_func = batch_func;
+	state->batch_data = batch_data;
 
 	/* run in a thread */
 	task = g_task_new (plugin_loader, cancellable, callback, user_data);
 	g_task_set_task_data (task, state, (GDestroyNotify) gs_plugin_loader_free_async_state);
 	g_task_set_return_on_cancel (task, TRUE);
-	g_task_run_in_thread (task, gs_plugin_loader_get_popular_thread_cb);
+	g_task_run_in_thread (task, gs_plugin_loader_search_thread_cb);
 }
 
 /**
- * gs_plugin_loader_get_popular_finish:
+ * gs_plugin_loader_search_finish:
  *
  * Return value: (element-type GsApp) (transfer full): A list of applications
  **/
 GList *
-gs_plugin_loader_get_popular_finish (GsPluginLoader *plugin_loader,
-				     GAsyncResult *res,
-				     GError **error)
+gs_plugin_loader_search_finish (GsPluginLoader *plugin_loader,
+				GAsyncResult *res,
+				GError **error)
 {
 	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
 	g_return_val_if_fail (G_IS_TASK (res), NULL);
@@ -1218,352 +3256,315 @@ gs_plugin_loader_get_popular_finish (GsPluginLoader *plugin_loader,
 	return g_task_propagate_pointer (G_TASK (res), error);
 }
 
-/******************************************************************************/
-
 /**
- * gs_plugin_loader_featured_debug:
+ * gs_plugin_loader_search_get_n_matches:
+ *
+ * Gets the number of matches the search found, which may be more than fit
+ * on one page.
+ *
+ * The matches are counted and ranked before they are refined, as refining
+ * all of them would cost as much as not paging at all. Refining can still
+ * merge two matches into one application or filter some out, for instance
+ * packages without an application, so this is an upper bound on the
+ * number of results and the last page may turn out to be empty. The
+ * results keep the ranked order, less any that were merged or filtered.
  **/
-static gboolean
-gs_plugin_loader_featured_debug (GsApp *app, gpointer user_data)
+guint
+gs_plugin_loader_search_get_n_matches (GsPluginLoader *plugin_loader,
+				       GAsyncResult *res)
 {
-	if (g_strcmp0 (gs_app_get_id (app),
-	    g_getenv ("GNOME_SOFTWARE_FEATURED")) == 0)
-		return TRUE;
-	return FALSE;
+	GsPluginLoaderAsyncState *state;
+
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), 0);
+	g_return_val_if_fail (G_IS_TASK (res), 0);
+
+	state = g_task_get_task_data (G_TASK (res));
+	return state->n_matches;
 }
 
+/******************************************************************************/
+
+/* the same weights as the AppStream token types, so a narrowed search
+ * scores an application as the appstream plugin would */
+typedef enum {
+	GS_PLUGIN_LOADER_SEARCH_MATCH_NONE		= 0,
+	GS_PLUGIN_LOADER_SEARCH_MATCH_PKGNAME		= 1 << 1,
+	GS_PLUGIN_LOADER_SEARCH_MATCH_COMMENT		= 1 << 3,
+	GS_PLUGIN_LOADER_SEARCH_MATCH_NAME		= 1 << 4,
+	GS_PLUGIN_LOADER_SEARCH_MATCH_KEYWORD		= 1 << 5,
+	GS_PLUGIN_LOADER_SEARCH_MATCH_ID		= 1 << 6,
+	GS_PLUGIN_LOADER_SEARCH_MATCH_LAST
+} GsPluginLoaderSearchMatch;
+
 /**
- * gs_plugin_loader_get_featured_thread_cb:
+ * gs_plugin_loader_subsearch_add_tokens:
+ *
+ * Splits @str with the AppStream tokenizer and adds each token to @tokens
+ * with the match type of the field it came from.
  **/
 static void
-gs_plugin_loader_get_featured_thread_cb (GTask *task,
-					 gpointer object,
-					 gpointer task_data,
-					 GCancellable *cancellable)
+gs_plugin_loader_subsearch_add_tokens (GHashTable *tokens,
+				       const gchar *str,
+				       GsPluginLoaderSearchMatch match)
 {
-	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
-	GsPluginLoaderAsyncState *state = (GsPluginLoaderAsyncState *) task_data;
-	GError *error = NULL;
+	guint i;
+	guint match_old;
+	_cleanup_strv_free_ gchar **values = NULL;
 
-	/* do things that would block */
-	state->list = gs_plugin_loader_run_results (plugin_loader,
-						    "gs_plugin_add_featured",
-						    state->flags,
-						    cancellable,
-						    &error);
-	if (error != NULL) {
-		g_task_return_error (task, error);
+	if (str == NULL)
 		return;
-	}
-
-	/* filter package list */
-	if (g_getenv ("GNOME_SOFTWARE_FEATURED") != NULL) {
-		gs_plugin_list_filter (&state->list, gs_plugin_loader_featured_debug, NULL);
-	} else {
-		gs_plugin_list_filter (&state->list, gs_plugin_loader_app_is_valid, state);
-		gs_plugin_list_filter (&state->list, gs_plugin_loader_get_app_is_compatible, plugin_loader);
-	}
-	if (state->list == NULL) {
-		g_task_return_new_error (task,
-					 GS_PLUGIN_LOADER_ERROR,
-					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
-					 "no featured apps to show");
+	values = as_utils_search_tokenize (str);
+	if (values == NULL)
 		return;
+	for (i = 0; values[i] != NULL; i++) {
+		match_old = GPOINTER_TO_UINT (g_hash_table_lookup (tokens, values[i]));
+		g_hash_table_insert (tokens,
+				     g_strdup (values[i]),
+				     GUINT_TO_POINTER (match_old | match));
 	}
-
-	/* success */
-	g_task_return_pointer (task, gs_plugin_list_copy (state->list), (GDestroyNotify) gs_plugin_list_free);
 }
 
 /**
- * gs_plugin_loader_get_featured_async:
- *
- * This method calls all plugins that implement the gs_plugin_add_featured()
- * function. The plugins can either return #GsApp objects of kind
- * %GS_APP_KIND_NORMAL for bonafide applications, or #GsApp's of kind
- * %GS_APP_KIND_PACKAGE for packages that may or may not be applications.
- *
- * Once the list of updates is refined, some of the #GsApp's of kind
- * %GS_APP_KIND_PACKAGE will have been promoted to a kind of %GS_APP_KIND_NORMAL,
- * or if they are core applications, promoted again to a kind of %GS_APP_KIND_SYSTEM.
- *
- * Any #GsApp's of kind %GS_APP_KIND_PACKAGE that remain after refining are
- * automatically removed.
- *
- * This means all of the #GsApp's returning from this function are of kind
- * %GS_APP_KIND_NORMAL or %GS_APP_KIND_SYSTEM.
+ * gs_plugin_loader_subsearch_app_score:
  *
- * The #GsApps may be in state %AS_APP_STATE_INSTALLED or %AS_APP_STATE_AVAILABLE
- * and the UI may want to filter the two classes of applications differently.
- **/
-void
-gs_plugin_loader_get_featured_async (GsPluginLoader *plugin_loader,
-				     GsPluginRefineFlags flags,
-				     GCancellable *cancellable,
-				     GAsyncReadyCallback callback,
-				     gpointer user_data)
-{
-	GsPluginLoaderAsyncState *state;
-	_cleanup_object_unref_ GTask *task = NULL;
-
-	g_return_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader));
-	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
-
-	/* save state */
-	state = g_slice_new0 (GsPluginLoaderAsyncState);
-	state->flags = flags;
-
-	/* run in a thread */
-	task = g_task_new (plugin_loader, cancellable, callback, user_data);
-	g_task_set_task_data (task, state, (GDestroyNotify) gs_plugin_loader_free_async_state);
-	g_task_set_return_on_cancel (task, TRUE);
-	g_task_run_in_thread (task, gs_plugin_loader_get_featured_thread_cb);
-}
-
-/**
- * gs_plugin_loader_get_featured_finish:
+ * Scores @app against every search term the same way as the appstream
+ * plugin index does: an exact token match counts four times a prefix
+ * match, and an exact match replaces any prefix matches of that term.
  *
- * Return value: (element-type GsApp) (transfer full): A list of applications
+ * Returns: the match value, or 0 if any term does not match
  **/
-GList *
-gs_plugin_loader_get_featured_finish (GsPluginLoader *plugin_loader,
-				      GAsyncResult *res,
-				      GError **error)
+static guint
+gs_plugin_loader_subsearch_app_score (GsApp *app, gchar **values)
 {
-	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
-	g_return_val_if_fail (G_IS_TASK (res), NULL);
-	g_return_val_if_fail (g_task_is_valid (res, plugin_loader), NULL);
-	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	GHashTableIter iter;
+	GPtrArray *keywords;
+	GPtrArray *sources;
+	const gchar *token;
+	gpointer value;
+	guint i;
+	guint match_all = 0;
+	guint match_exact;
+	guint match_prefix;
+	_cleanup_hashtable_unref_ GHashTable *tokens = NULL;
+
+	tokens = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	gs_plugin_loader_subsearch_add_tokens (tokens, gs_app_get_id (app),
+					       GS_PLUGIN_LOADER_SEARCH_MATCH_ID);
+	gs_plugin_loader_subsearch_add_tokens (tokens, gs_app_get_name (app),
+					       GS_PLUGIN_LOADER_SEARCH_MATCH_NAME);
+	gs_plugin_loader_subsearch_add_tokens (tokens, gs_app_get_summary (app),
+					       GS_PLUGIN_LOADER_SEARCH_MATCH_COMMENT);
+	keywords = gs_app_get_keywords (app);
+	for (i = 0; keywords != NULL && i < keywords->len; i++) {
+		gs_plugin_loader_subsearch_add_tokens (tokens,
+						       g_ptr_array_index (keywords, i),
+						       GS_PLUGIN_LOADER_SEARCH_MATCH_KEYWORD);
+	}
+	sources = gs_app_get_sources (app);
+	for (i = 0; i < sources->len; i++) {
+		gs_plugin_loader_subsearch_add_tokens (tokens,
+						       g_ptr_array_index (sources, i),
+						       GS_PLUGIN_LOADER_SEARCH_MATCH_PKGNAME);
+	}
 
-	return g_task_propagate_pointer (G_TASK (res), error);
+	for (i = 0; values[i] != NULL; i++) {
+		match_exact = GPOINTER_TO_UINT (g_hash_table_lookup (tokens, values[i]));
+		match_prefix = 0;
+		g_hash_table_iter_init (&iter, tokens);
+		while (g_hash_table_iter_next (&iter, (gpointer *) &token, &value)) {
+			if (g_str_has_prefix (token, values[i]))
+				match_prefix |= GPOINTER_TO_UINT (value);
+		}
+		if (match_prefix == 0)
+			return 0;
+		if (match_exact != 0)
+			match_all |= match_exact << 2;
+		else
+			match_all |= match_prefix;
+	}
+	return match_all;
 }
 
-/******************************************************************************/
+typedef struct {
+	GsApp		*app;
+	guint		 score;
+	guint		 idx;
+} GsPluginLoaderSubsearchItem;
 
 /**
- * gs_plugin_loader_convert_unavailable_app:
+ * gs_plugin_loader_subsearch_item_sort_cb:
+ *
+ * Best match first, keeping the previous order for equal matches.
  **/
-static gboolean
-gs_plugin_loader_convert_unavailable_app (GsApp *app, const gchar *search)
+static gint
+gs_plugin_loader_subsearch_item_sort_cb (gconstpointer a, gconstpointer b)
 {
-	GPtrArray *keywords;
-	const gchar *keyword;
-	guint i;
-	_cleanup_string_free_ GString *tmp = NULL;
-
-	/* is the search string one of the codec keywords */
-	keywords = gs_app_get_keywords (app);
-	for (i = 0; i < keywords->len; i++) {
-		keyword = g_ptr_array_index (keywords, i);
-		if (g_ascii_strcasecmp (search, keyword) == 0) {
-			search = keyword;
-			break;
-		}
-	}
+	const GsPluginLoaderSubsearchItem *item1 = a;
+	const GsPluginLoaderSubsearchItem *item2 = b;
 
-	tmp = g_string_new ("");
-	/* TRANSLATORS: this is when we know about an application or
-	 * addon, but it can't be listed for some reason */
-	g_string_append_printf (tmp, _("No addon codecs are available "
-				"for the %s format."), search);
-	g_string_append (tmp, "\n");
-	g_string_append_printf (tmp, _("Information about %s, as well as options "
-				"for how to get a codec that can play this format "
-				"can be found on the website."), search);
-	gs_app_set_summary_missing (app, tmp->str);
-	gs_app_set_kind (app, GS_APP_KIND_MISSING);
-	gs_app_set_size (app, GS_APP_SIZE_MISSING);
-	return TRUE;
+	if (item1->score != item2->score)
+		return item1->score < item2->score ? 1 : -1;
+	if (item1->idx != item2->idx)
+		return item1->idx < item2->idx ? -1 : 1;
+	return 0;
 }
 
 /**
- * gs_plugin_loader_convert_unavailable:
+ * gs_plugin_loader_subsearch_rank:
+ *
+ * Drops the applications in @list that no longer match every term and
+ * orders the rest by how well they match, as a fresh search would.
  **/
-static void
-gs_plugin_loader_convert_unavailable (GList *list, const gchar *search)
+static GList *
+gs_plugin_loader_subsearch_rank (GList *list, gchar **values)
 {
 	GList *l;
-	GsApp *app;
+	GList *ranked = NULL;
+	GsPluginLoaderSubsearchItem item;
+	guint i;
+	_cleanup_array_unref_ GArray *items = NULL;
 
-	for (l = list; l != NULL; l = l->next) {
-		app = GS_APP (l->data);
-		if (gs_app_get_kind (app) != GS_APP_KIND_UNKNOWN &&
-		    gs_app_get_kind (app) != GS_APP_KIND_MISSING)
-			continue;
-		if (gs_app_get_state (app) != AS_APP_STATE_UNAVAILABLE)
-			continue;
-		if (gs_app_get_id_kind (app) != AS_ID_KIND_CODEC)
-			continue;
-		if (gs_app_get_url (app, AS_URL_KIND_MISSING) == NULL)
+	items = g_array_new (FALSE, FALSE, sizeof (GsPluginLoaderSubsearchItem));
+	for (l = list, i = 0; l != NULL; l = l->next, i++) {
+		item.app = GS_APP (l->data);
+		item.score = gs_plugin_loader_subsearch_app_score (item.app, values);
+		if (item.score == 0)
 			continue;
-
-		/* only convert the first unavailable codec */
-		if (gs_plugin_loader_convert_unavailable_app (app, search))
-			break;
+		item.idx = i;
+		g_array_append_val (items, item);
+	}
+	g_array_sort (items, gs_plugin_loader_subsearch_item_sort_cb);
+	for (i = items->len; i > 0; i--) {
+		item = g_array_index (items, GsPluginLoaderSubsearchItem, i - 1);
+		gs_plugin_add_app (&ranked, item.app);
 	}
+	return ranked;
 }
 
 /**
- * gs_plugin_loader_search_thread_cb:
+ * gs_plugin_loader_subsearch_thread_cb:
  **/
 static void
-gs_plugin_loader_search_thread_cb (GTask *task,
-				   gpointer object,
-				   gpointer task_data,
-				   GCancellable *cancellable)
+gs_plugin_loader_subsearch_thread_cb (GTask *task,
+				      gpointer object,
+				      gpointer task_data,
+				      GCancellable *cancellable)
 {
-	const gchar *function_name = "gs_plugin_add_search";
-	gboolean ret = TRUE;
-	GError *error = NULL;
+	GsApp *app;
 	GsPluginLoaderAsyncState *state = (GsPluginLoaderAsyncState *) task_data;
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
-	GsPlugin *plugin;
-	GsPluginSearchFunc plugin_func = NULL;
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+	GList *ranked;
 	guint i;
-	_cleanup_free_ gchar *profile_id = NULL;
 	_cleanup_strv_free_ gchar **values = NULL;
 
-	/* run each plugin */
 	values = as_utils_search_tokenize (state->value);
 	if (values == NULL) {
 		g_task_return_new_error (task,
 					 GS_PLUGIN_LOADER_ERROR,
 					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
 					 "no valid search terms");
-		goto out;
-	}
-	for (i = 0; i < plugin_loader->priv->plugins->len; i++) {
-		plugin = g_ptr_array_index (plugin_loader->priv->plugins, i);
-		if (!plugin->enabled)
-			continue;
-		ret = g_task_return_error_if_cancelled (task);
-		if (ret)
-			goto out;
-		ret = g_module_symbol (plugin->module,
-				       function_name,
-				       (gpointer *) &plugin_func);
-		if (!ret)
-			continue;
-		profile_id = g_strdup_printf ("GsPlugin::%s(%s)",
-					      plugin->name, function_name);
-		gs_profile_start (plugin_loader->priv->profile, profile_id);
-		ret = plugin_func (plugin, values, &state->list, cancellable, &error);
-		if (!ret) {
-			g_task_return_error (task, error);
-			goto out;
-		}
-		gs_plugin_status_update (plugin, NULL, GS_PLUGIN_STATUS_FINISHED);
-		gs_profile_stop (plugin_loader->priv->profile, profile_id);
-		g_clear_pointer (&profile_id, g_free);
+		return;
 	}
 
-	/* dedupe applications we already know about */
-	gs_plugin_loader_list_dedupe (plugin_loader, state->list);
-
-	/* run refine() on each one */
-	ret = gs_plugin_loader_run_refine (plugin_loader,
-					   function_name,
-					   &state->list,
-					   state->flags,
-					   cancellable,
-					   &error);
-	if (!ret) {
-		g_task_return_error (task, error);
-		goto out;
+	/* the previous results may only have been the first page */
+	if (g_strv_length (state->ids) >= GS_PLUGIN_LOADER_SEARCH_PAGE_SIZE ||
+	    gs_plugin_loader_search_was_truncated (plugin_loader, state->value)) {
+		g_debug ("previous search was truncated, doing full search");
+		gs_plugin_loader_search_thread_cb (task, object, task_data, cancellable);
+		return;
 	}
 
-	/* convert any unavailables */
-	gs_plugin_loader_convert_unavailable (state->list, state->value);
-
-	/* filter package list */
-	gs_plugin_list_filter_duplicates (&state->list);
-	gs_plugin_list_filter (&state->list, gs_plugin_loader_app_is_valid, state);
-	gs_plugin_list_filter (&state->list, gs_plugin_loader_filter_qt_for_gtk, NULL);
-	gs_plugin_list_filter (&state->list, gs_plugin_loader_get_app_is_compatible, plugin_loader);
-	if (((state->flags & GS_PLUGIN_REFINE_FLAGS_ALLOW_NO_APPDATA) == 0) &&
-	    g_settings_get_boolean (plugin_loader->priv->settings, "require-appdata")) {
-		gs_plugin_list_filter (&state->list,
-				       gs_plugin_loader_get_app_has_appdata,
-				       plugin_loader);
+	/* get the previous results from the app cache */
+	g_mutex_lock (&priv->app_cache_mutex);
+	for (i = 0; state->ids[i] != NULL; i++) {
+		app = g_hash_table_lookup (priv->app_cache, state->ids[i]);
+		if (app == NULL)
+			break;
+		gs_plugin_add_app (&state->list, app);
 	}
+	g_mutex_unlock (&priv->app_cache_mutex);
+	state->list = g_list_reverse (state->list);
+
+	/* something has evicted a previous result, so start afresh */
+	if (state->ids[i] != NULL) {
+		g_debug ("%s not in cache, doing full search", state->ids[i]);
+		gs_plugin_list_free (state->list);
+		state->list = NULL;
+		gs_plugin_loader_search_thread_cb (task, object, task_data, cancellable);
+		return;
+	}
+
+	/* the new terms can only narrow the previous results, but they may
+	 * well change which of them are the best matches */
+	ranked = gs_plugin_loader_subsearch_rank (state->list, values);
+	gs_plugin_list_free (state->list);
+	state->list = ranked;
 	if (state->list == NULL) {
 		g_task_return_new_error (task,
 					 GS_PLUGIN_LOADER_ERROR,
 					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
 					 "no search results to show");
-		goto out;
-	}
-	if (g_list_length (state->list) > 500) {
-		g_task_return_new_error (task,
-					 GS_PLUGIN_LOADER_ERROR,
-					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
-					 "Too many search results returned");
-		goto out;
+		return;
 	}
 
 	/* success */
 	g_task_return_pointer (task, gs_plugin_list_copy (state->list), (GDestroyNotify) gs_plugin_list_free);
-out:
-	if (profile_id != NULL)
-		gs_profile_stop (plugin_loader->priv->profile, profile_id);
 }
 
 /**
- * gs_plugin_loader_search_async:
- *
- * This method calls all plugins that implement the gs_plugin_add_search()
- * function. The plugins can either return #GsApp objects of kind
- * %GS_APP_KIND_NORMAL for bonafide applications, or #GsApp's of kind
- * %GS_APP_KIND_PACKAGE for packages that may or may not be applications.
- *
- * Once the list of updates is refined, some of the #GsApp's of kind
- * %GS_APP_KIND_PACKAGE will have been promoted to a kind of %GS_APP_KIND_NORMAL,
- * or if they are core applications, promoted again to a kind of %GS_APP_KIND_SYSTEM.
+ * gs_plugin_loader_subsearch_async:
  *
- * Any #GsApp's of kind %GS_APP_KIND_PACKAGE or %GS_APP_KIND_SYSTEM that remain
- * after refining are automatically removed.
+ * This method refines the results of an earlier search for a longer
+ * search string, e.g. when the user types another character.
  *
- * This means all of the #GsApp's returning from this function are of kind
- * %GS_APP_KIND_NORMAL.
+ * The application IDs in @previous_ids are looked up in the loader cache
+ * and only the applications that also match @value are returned, best
+ * match first, without calling into any plugin. If any of the previous results are no longer
+ * known, or the previous search returned only the first page of its matches,
+ * then a full search is done as with gs_plugin_loader_search_async().
  *
- * The #GsApps may be in state %AS_APP_STATE_INSTALLED or %AS_APP_STATE_AVAILABLE
- * and the UI may want to filter the two classes of applications differently.
+ * The caller is responsible for only using this when @value extends the
+ * search string that returned @previous_ids.
  **/
 void
-gs_plugin_loader_search_async (GsPluginLoader *plugin_loader,
-			       const gchar *value,
-			       GsPluginRefineFlags flags,
-			       GCancellable *cancellable,
-			       GAsyncReadyCallback callback,
-			       gpointer user_data)
+gs_plugin_loader_subsearch_async (GsPluginLoader *plugin_loader,
+				  gchar **previous_ids,
+				  const gchar *value,
+				  GsPluginRefineFlags flags,
+				  GCancellable *cancellable,
+				  GAsyncReadyCallback callback,
+				  gpointer user_data)
 {
 	GsPluginLoaderAsyncState *state;
 	_cleanup_object_unref_ GTask *task = NULL;
 
 	g_return_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader));
+	g_return_if_fail (previous_ids != NULL);
 	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
 	/* save state */
 	state = g_slice_new0 (GsPluginLoaderAsyncState);
 	state->flags = flags;
 	state->value = g_strdup (value);
+	state->ids = g_strdupv (previous_ids);
 
 	/* run in a thread */
 	task = g_task_new (plugin_loader, cancellable, callback, user_data);
 	g_task_set_task_data (task, state, (GDestroyNotify) gs_plugin_loader_free_async_state);
 	g_task_set_return_on_cancel (task, TRUE);
-	g_task_run_in_thread (task, gs_plugin_loader_search_thread_cb);
+	g_task_run_in_thread (task, gs_plugin_loader_subsearch_thread_cb);
 }
 
 /**
- * gs_plugin_loader_search_finish:
+ * gs_plugin_loader_subsearch_finish:
  *
  * Return value: (element-type GsApp) (transfer full): A list of applications
  **/
 GList *
-gs_plugin_loader_search_finish (GsPluginLoader *plugin_loader,
-				GAsyncResult *res,
-				GError **error)
+gs_plugin_loader_subsearch_finish (GsPluginLoader *plugin_loader,
+				   GAsyncResult *res,
+				   GError **error)
 {
 	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
 	g_return_val_if_fail (G_IS_TASK (res), NULL);
@@ -1573,8 +3574,6 @@ gs_plugin_loader_search_finish (GsPluginLoader *plugin_loader,
 	return g_task_propagate_pointer (G_TASK (res), error);
 }
 
-/******************************************************************************/
-
 /**
  * gs_plugin_loader_search_files_thread_cb:
  **/
@@ -1589,39 +3588,23 @@ gs_plugin_loader_search_files_thread_cb (GTask *task,
 	GError *error = NULL;
 	GsPluginLoaderAsyncState *state = (GsPluginLoaderAsyncState *) task_data;
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
-	GsPlugin *plugin;
-	GsPluginSearchFunc plugin_func = NULL;
-	guint i;
-	_cleanup_free_ gchar *profile_id = NULL;
 	_cleanup_strv_free_ gchar **values = NULL;
 
 	values = g_new0 (gchar *, 2);
 	values[0] = g_strdup (state->value);
 
 	/* run each plugin */
-	for (i = 0; i < plugin_loader->priv->plugins->len; i++) {
-		plugin = g_ptr_array_index (plugin_loader->priv->plugins, i);
-		if (!plugin->enabled)
-			continue;
-		ret = g_task_return_error_if_cancelled (task);
-		if (ret)
-			goto out;
-		ret = g_module_symbol (plugin->module,
-				       function_name,
-				       (gpointer *) &plugin_func);
-		if (!ret)
-			continue;
-		profile_id = g_strdup_printf ("GsPlugin::%s(%s)",
-					      plugin->name, function_name);
-		gs_profile_start (plugin_loader->priv->profile, profile_id);
-		ret = plugin_func (plugin, values, &state->list, cancellable, &error);
-		if (!ret) {
-			g_task_return_error (task, error);
-			goto out;
-		}
-		gs_plugin_status_update (plugin, NULL, GS_PLUGIN_STATUS_FINISHED);
-		gs_profile_stop (plugin_loader->priv->profile, profile_id);
-		g_clear_pointer (&profile_id, g_free);
+	ret = gs_plugin_loader_run_parallel (plugin_loader,
+					     function_name,
+					     GS_PLUGIN_LOADER_JOB_KIND_SEARCH,
+					     values,
+					     NULL,
+					     &state->list,
+					     cancellable,
+					     &error);
+	if (!ret) {
+		g_task_return_error (task, error);
+		return;
 	}
 
 	/* dedupe applications we already know about */
@@ -1636,7 +3619,7 @@ gs_plugin_loader_search_files_thread_cb (GTask *task,
 					   &error);
 	if (!ret) {
 		g_task_return_error (task, error);
-		goto out;
+		return;
 	}
 
 	/* convert any unavailables */
@@ -1659,21 +3642,11 @@ gs_plugin_loader_search_files_thread_cb (GTask *task,
 					 GS_PLUGIN_LOADER_ERROR,
 					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
 					 "no search results to show");
-		goto out;
-	}
-	if (g_list_length (state->list) > 500) {
-		g_task_return_new_error (task,
-					 GS_PLUGIN_LOADER_ERROR,
-					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
-					 "Too many search results returned");
-		goto out;
+		return;
 	}
 
 	/* success */
 	g_task_return_pointer (task, gs_plugin_list_copy (state->list), (GDestroyNotify) gs_plugin_list_free);
-out:
-	if (profile_id != NULL)
-		gs_profile_stop (plugin_loader->priv->profile, profile_id);
 }
 
 /**
@@ -1757,39 +3730,23 @@ gs_plugin_loader_search_what_provides_thread_cb (GTask *task,
 	GError *error = NULL;
 	GsPluginLoaderAsyncState *state = (GsPluginLoaderAsyncState *) task_data;
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
-	GsPlugin *plugin;
-	GsPluginSearchFunc plugin_func = NULL;
-	guint i;
-	_cleanup_free_ gchar *profile_id = NULL;
 	_cleanup_strv_free_ gchar **values = NULL;
 
 	values = g_new0 (gchar *, 2);
 	values[0] = g_strdup (state->value);
 
 	/* run each plugin */
-	for (i = 0; i < plugin_loader->priv->plugins->len; i++) {
-		plugin = g_ptr_array_index (plugin_loader->priv->plugins, i);
-		if (!plugin->enabled)
-			continue;
-		ret = g_task_return_error_if_cancelled (task);
-		if (ret)
-			goto out;
-		ret = g_module_symbol (plugin->module,
-				       function_name,
-				       (gpointer *) &plugin_func);
-		if (!ret)
-			continue;
-		profile_id = g_strdup_printf ("GsPlugin::%s(%s)",
-					      plugin->name, function_name);
-		gs_profile_start (plugin_loader->priv->profile, profile_id);
-		ret = plugin_func (plugin, values, &state->list, cancellable, &error);
-		if (!ret) {
-			g_task_return_error (task, error);
-			goto out;
-		}
-		gs_plugin_status_update (plugin, NULL, GS_PLUGIN_STATUS_FINISHED);
-		gs_profile_stop (plugin_loader->priv->profile, profile_id);
-		g_clear_pointer (&profile_id, g_free);
+	ret = gs_plugin_loader_run_parallel (plugin_loader,
+					     function_name,
+					     GS_PLUGIN_LOADER_JOB_KIND_SEARCH,
+					     values,
+					     NULL,
+					     &state->list,
+					     cancellable,
+					     &error);
+	if (!ret) {
+		g_task_return_error (task, error);
+		return;
 	}
 
 	/* dedupe applications we already know about */
@@ -1804,7 +3761,7 @@ gs_plugin_loader_search_what_provides_thread_cb (GTask *task,
 					   &error);
 	if (!ret) {
 		g_task_return_error (task, error);
-		goto out;
+		return;
 	}
 
 	/* convert any unavailables */
@@ -1827,21 +3784,11 @@ gs_plugin_loader_search_what_provides_thread_cb (GTask *task,
 					 GS_PLUGIN_LOADER_ERROR,
 					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
 					 "no search results to show");
-		goto out;
-	}
-	if (g_list_length (state->list) > 500) {
-		g_task_return_new_error (task,
-					 GS_PLUGIN_LOADER_ERROR,
-					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
-					 "Too many search results returned");
-		goto out;
+		return;
 	}
 
 	/* success */
 	g_task_return_pointer (task, gs_plugin_list_copy (state->list), (GDestroyNotify) gs_plugin_list_free);
-out:
-	if (profile_id != NULL)
-		gs_profile_stop (plugin_loader->priv->profile, profile_id);
 }
 
 /**
@@ -1935,36 +3882,20 @@ gs_plugin_loader_get_categories_thread_cb (GTask *task,
 	GError *error = NULL;
 	GsPluginLoaderAsyncState *state = (GsPluginLoaderAsyncState *) task_data;
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
-	GsPlugin *plugin;
-	GsPluginResultsFunc plugin_func = NULL;
 	GList *l;
-	guint i;
-	_cleanup_free_ gchar *profile_id = NULL;
 
 	/* run each plugin */
-	for (i = 0; i < plugin_loader->priv->plugins->len; i++) {
-		plugin = g_ptr_array_index (plugin_loader->priv->plugins, i);
-		if (!plugin->enabled)
-			continue;
-		ret = g_task_return_error_if_cancelled (task);
-		if (ret)
-			goto out;
-		ret = g_module_symbol (plugin->module,
-				       function_name,
-				       (gpointer *) &plugin_func);
-		if (!ret)
-			continue;
-		profile_id = g_strdup_printf ("GsPlugin::%s(%s)",
-					      plugin->name, function_name);
-		gs_profile_start (plugin_loader->priv->profile, profile_id);
-		ret = plugin_func (plugin, &state->list, cancellable, &error);
-		if (!ret) {
-			g_task_return_error (task, error);
-			goto out;
-		}
-		gs_plugin_status_update (plugin, NULL, GS_PLUGIN_STATUS_FINISHED);
-		gs_profile_stop (plugin_loader->priv->profile, profile_id);
-		g_clear_pointer (&profile_id, g_free);
+	ret = gs_plugin_loader_run_parallel (plugin_loader,
+					     function_name,
+					     GS_PLUGIN_LOADER_JOB_KIND_RESULTS,
+					     NULL,
+					     NULL,
+					     &state->list,
+					     cancellable,
+					     &error);
+	if (!ret) {
+		g_task_return_error (task, error);
+		return;
 	}
 
 	/* sort by name */
@@ -1978,14 +3909,11 @@ gs_plugin_loader_get_categories_thread_cb (GTask *task,
 					 GS_PLUGIN_LOADER_ERROR,
 					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
 					 "no categories to show");
-		goto out;
+		return;
 	}
 
 	/* success */
 	g_task_return_pointer (task, gs_plugin_list_copy (state->list), (GDestroyNotify) gs_plugin_list_free);
-out:
-	if (profile_id != NULL)
-		gs_profile_stop (plugin_loader->priv->profile, profile_id);
 }
 
 /**
@@ -2040,47 +3968,31 @@ gs_plugin_loader_get_categories_finish (GsPluginLoader *plugin_loader,
 
 /**
  * gs_plugin_loader_get_category_apps_thread_cb:
- **/
-static void
-gs_plugin_loader_get_category_apps_thread_cb (GTask *task,
-					      gpointer object,
-					      gpointer task_data,
-					      GCancellable *cancellable)
-{
-	const gchar *function_name = "gs_plugin_add_category_apps";
-	gboolean ret = TRUE;
-	GError *error = NULL;
-	GsPluginLoaderAsyncState *state = (GsPluginLoaderAsyncState *) task_data;
-	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
-	GsPlugin *plugin;
-	GsPluginCategoryFunc plugin_func = NULL;
-	guint i;
-	_cleanup_free_ gchar *profile_id = NULL;
-
-	/* run each plugin */
-	for (i = 0; i < plugin_loader->priv->plugins->len; i++) {
-		plugin = g_ptr_array_index (plugin_loader->priv->plugins, i);
-		if (!plugin->enabled)
-			continue;
-		ret = g_task_return_error_if_cancelled (task);
-		if (ret)
-			goto out;
-		ret = g_module_symbol (plugin->module,
-				       function_name,
-				       (gpointer *) &plugin_func);
-		if (!ret)
-			continue;
-		profile_id = g_strdup_printf ("GsPlugin::%s(%s)",
-					      plugin->name, function_name);
-		gs_profile_start (plugin_loader->priv->profile, profile_id);
-		ret = plugin_func (plugin, state->category, &state->list, cancellable, &error);
-		if (!ret) {
-			g_task_return_error (task, error);
-			goto out;
-		}
-		gs_plugin_status_update (plugin, NULL, GS_PLUGIN_STATUS_FINISHED);
-		gs_profile_stop (plugin_loader->priv->profile, profile_id);
-		g_clear_pointer (&profile_id, g_free);
+ **/
+static void
+gs_plugin_loader_get_category_apps_thread_cb (GTask *task,
+					      gpointer object,
+					      gpointer task_data,
+					      GCancellable *cancellable)
+{
+	const gchar *function_name = "gs_plugin_add_category_apps";
+	gboolean ret = TRUE;
+	GError *error = NULL;
+	GsPluginLoaderAsyncState *state = (GsPluginLoaderAsyncState *) task_data;
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
+
+	/* run each plugin */
+	ret = gs_plugin_loader_run_parallel (plugin_loader,
+					     function_name,
+					     GS_PLUGIN_LOADER_JOB_KIND_CATEGORY,
+					     NULL,
+					     state->category,
+					     &state->list,
+					     cancellable,
+					     &error);
+	if (!ret) {
+		g_task_return_error (task, error);
+		return;
 	}
 
 	/* dedupe applications we already know about */
@@ -2095,7 +4007,7 @@ gs_plugin_loader_get_category_apps_thread_cb (GTask *task,
 					   &error);
 	if (!ret) {
 		g_task_return_error (task, error);
-		goto out;
+		return;
 	}
 
 	/* filter package list */
@@ -2114,7 +4026,7 @@ gs_plugin_loader_get_category_apps_thread_cb (GTask *task,
 					 GS_PLUGIN_LOADER_ERROR,
 					 GS_PLUGIN_LOADER_ERROR_NO_RESULTS,
 					 "no get_category_apps results to show");
-		goto out;
+		return;
 	}
 
 	/* sort, just in case the UI doesn't do this */
@@ -2122,9 +4034,6 @@ gs_plugin_loader_get_category_apps_thread_cb (GTask *task,
 
 	/* success */
 	g_task_return_pointer (task, gs_plugin_list_copy (state->list), (GDestroyNotify) gs_plugin_list_free);
-out:
-	if (profile_id != NULL)
-		gs_profile_stop (plugin_loader->priv->profile, profile_id);
 }
 
 /**
@@ -2656,24 +4565,20 @@ gs_plugin_loader_get_pending (GsPluginLoader *plugin_loader)
  * gs_plugin_loader_run:
  **/
 static void
-gs_plugin_loader_run (GsPluginLoader *plugin_loader, const gchar *function_name)
+gs_plugin_loader_run (GsPluginLoader *plugin_loader, GsPluginLoaderVfunc vfunc)
 {
-	gboolean ret;
-	GsPluginFunc plugin_func = NULL;
+	const gchar *profile_id;
+	GsPluginFunc plugin_func;
 	GsPlugin *plugin;
 	guint i;
 
 	/* run each plugin */
 	for (i = 0; i < plugin_loader->priv->plugins->len; i++) {
-		_cleanup_free_ gchar *profile_id = NULL;
 		plugin = g_ptr_array_index (plugin_loader->priv->plugins, i);
-		ret = g_module_symbol (plugin->module,
-				       function_name,
-				       (gpointer *) &plugin_func);
-		if (!ret)
+		plugin_func = gs_plugin_loader_plugin_get_vfunc (plugin, vfunc);
+		if (plugin_func == NULL)
 			continue;
-		profile_id = g_strdup_printf ("GsPlugin::%s(%s)",
-					      plugin->name, function_name);
+		profile_id = plugin->profile_ids[vfunc];
 		gs_profile_start (plugin_loader->priv->profile, profile_id);
 		plugin_func (plugin);
 		gs_plugin_status_update (plugin, NULL, GS_PLUGIN_STATUS_FINISHED);
@@ -2705,16 +4610,13 @@ gs_plugin_loader_set_enabled (GsPluginLoader *plugin_loader,
 }
 
 /**
- * gs_plugin_loader_status_update_cb:
+ * gs_plugin_loader_status_emit:
  */
 static void
-gs_plugin_loader_status_update_cb (GsPlugin *plugin,
-				   GsApp *app,
-				   GsPluginStatus status,
-				   gpointer user_data)
+gs_plugin_loader_status_emit (GsPluginLoader *plugin_loader,
+			      GsApp *app,
+			      GsPluginStatus status)
 {
-	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (user_data);
-
 	/* same as last time */
 	if (app == NULL && status == plugin_loader->priv->status_last)
 		return;
@@ -2729,6 +4631,305 @@ gs_plugin_loader_status_update_cb (GsPlugin *plugin,
 		       0, app, status);
 }
 
+/**
+ * gs_plugin_loader_status_new_pending:
+ */
+static GHashTable *
+gs_plugin_loader_status_new_pending (void)
+{
+	return g_hash_table_new_full (g_direct_hash, g_direct_equal,
+				      (GDestroyNotify) g_object_unref, NULL);
+}
+
+/* a status reported by a plugin, waiting for the next flush */
+typedef struct {
+	GsApp			*app;		/* or NULL */
+	GsPluginStatus		 status;
+} GsPluginLoaderStatus;
+
+/**
+ * gs_plugin_loader_status_free:
+ */
+static void
+gs_plugin_loader_status_free (GsPluginLoaderStatus *item)
+{
+	if (item->app != NULL)
+		g_object_unref (item->app);
+	g_slice_free (GsPluginLoaderStatus, item);
+}
+
+/**
+ * gs_plugin_loader_status_flush_cb:
+ *
+ * Emits the statuses reported since the last flush, in the order they
+ * were reported, and the latest progress of each application.
+ */
+static gboolean
+gs_plugin_loader_status_flush_cb (gpointer user_data)
+{
+	GHashTableIter iter;
+	GsApp *app;
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (user_data);
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+	GsPluginLoaderStatus *item;
+	GQueue status_pending = G_QUEUE_INIT;
+	gpointer value;
+	_cleanup_hashtable_unref_ GHashTable *progress_pending = NULL;
+
+	g_mutex_lock (&priv->status_mutex);
+	status_pending = priv->status_pending;
+	g_queue_init (&priv->status_pending);
+	progress_pending = priv->progress_pending;
+	priv->progress_pending = gs_plugin_loader_status_new_pending ();
+	priv->status_flush_id = 0;
+	g_mutex_unlock (&priv->status_mutex);
+
+	g_hash_table_iter_init (&iter, progress_pending);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &app, &value))
+		gs_app_set_progress (app, GPOINTER_TO_UINT (value));
+	while ((item = g_queue_pop_head (&status_pending)) != NULL) {
+		gs_plugin_loader_status_emit (plugin_loader, item->app, item->status);
+		gs_plugin_loader_status_free (item);
+	}
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * gs_plugin_loader_status_queue_flush_locked:
+ */
+static void
+gs_plugin_loader_status_queue_flush_locked (GsPluginLoader *plugin_loader)
+{
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+
+	if (priv->status_flush_id != 0)
+		return;
+	priv->status_flush_id = g_timeout_add (GS_PLUGIN_LOADER_STATUS_INTERVAL,
+					       gs_plugin_loader_status_flush_cb,
+					       plugin_loader);
+}
+
+/**
+ * gs_plugin_loader_status_update_cb:
+ *
+ * Called by the plugins in any thread; the statuses are queued in order
+ * until the next flush, only dropping one that repeats the one before.
+ */
+static void
+gs_plugin_loader_status_update_cb (GsPlugin *plugin,
+				   GsApp *app,
+				   GsPluginStatus status,
+				   gpointer user_data)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (user_data);
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+	GsPluginLoaderStatus *item;
+
+	g_mutex_lock (&priv->status_mutex);
+	if (priv->status_disposed)
+		goto out;
+	item = g_queue_peek_tail (&priv->status_pending);
+	if (item != NULL && item->app == app && item->status == status)
+		goto out;
+	item = g_slice_new0 (GsPluginLoaderStatus);
+	if (app != NULL)
+		item->app = g_object_ref (app);
+	item->status = status;
+	g_queue_push_tail (&priv->status_pending, item);
+	gs_plugin_loader_status_queue_flush_locked (plugin_loader);
+out:
+	g_mutex_unlock (&priv->status_mutex);
+}
+
+/**
+ * gs_plugin_loader_progress_update_cb:
+ *
+ * Called by the plugins in any thread; only the latest percentage for each
+ * application is kept until the next flush.
+ */
+static void
+gs_plugin_loader_progress_update_cb (GsPlugin *plugin,
+				     GsApp *app,
+				     guint percentage,
+				     gpointer user_data)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (user_data);
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+
+	g_mutex_lock (&priv->status_mutex);
+	if (!priv->status_disposed) {
+		g_hash_table_insert (priv->progress_pending,
+				     g_object_ref (app),
+				     GUINT_TO_POINTER (percentage));
+		gs_plugin_loader_status_queue_flush_locked (plugin_loader);
+	}
+	g_mutex_unlock (&priv->status_mutex);
+}
+
+/**
+ * gs_plugin_loader_apps_changed_thread_cb:
+ *
+ * Refines the changed applications in place, so rows that are already
+ * shown update, and puts them back in the cache. Anything that no plugin
+ * knows about any more is left out of the cache.
+ **/
+static void
+gs_plugin_loader_apps_changed_thread_cb (GTask *task,
+					 gpointer object,
+					 gpointer task_data,
+					 GCancellable *cancellable)
+{
+	GList *l;
+	GsApp *app;
+	GsPluginLoaderAsyncState *state = (GsPluginLoaderAsyncState *) task_data;
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
+	GsPluginLoaderPrivate *priv = plugin_loader->priv;
+	_cleanup_error_free_ GError *error = NULL;
+
+	if (!gs_plugin_loader_run_refine (plugin_loader,
+					  NULL,
+					  &state->list,
+					  state->flags,
+					  cancellable,
+					  &error)) {
+		g_warning ("failed to refine changed apps: %s", error->message);
+		state->reload = TRUE;
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	g_mutex_lock (&priv->app_cache_mutex);
+	for (l = state->list; l != NULL; l = l->next) {
+		app = GS_APP (l->data);
+		if (gs_app_get_state (app) == AS_APP_STATE_UNKNOWN) {
+			g_debug ("apps-changed: %s was removed", gs_app_get_id (app));
+			state->reload = TRUE;
+			continue;
+		}
+
+		/* something else may have been looked up in the meantime */
+		if (gs_app_get_id (app) == NULL ||
+		    g_hash_table_contains (priv->app_cache, gs_app_get_id (app)))
+			continue;
+		g_hash_table_insert (priv->app_cache,
+				     g_strdup (gs_app_get_id (app)),
+				     g_object_ref (app));
+	}
+	g_mutex_unlock (&priv->app_cache_mutex);
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * gs_plugin_loader_apps_changed_finished_cb:
+ *
+ * Reloads the views if an application appeared or went away, as the
+ * rows that are shown can only update in place.
+ **/
+static void
+gs_plugin_loader_apps_changed_finished_cb (GObject *source_object,
+					   GAsyncResult *res,
+					   gpointer user_data)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
+	GsPluginLoaderAsyncState *state;
+
+	state = g_task_get_task_data (G_TASK (res));
+	if (!state->reload)
+		return;
+	g_debug ("updates-changed");
+	g_signal_emit (plugin_loader, signals[SIGNAL_UPDATES_CHANGED], 0);
+}
+
+/**
+ * gs_plugin_loader_app_is_changed:
+ */
+static gboolean
+gs_plugin_loader_app_is_changed (GsPluginLoader *plugin_loader, GsApp *app)
+{
+	GPtrArray *sources;
+	guint i;
+
+	if (g_hash_table_contains (plugin_loader->priv->apps_changed,
+				   gs_app_get_id (app)))
+		return TRUE;
+	sources = gs_app_get_sources (app);
+	for (i = 0; i < sources->len; i++) {
+		if (g_hash_table_contains (plugin_loader->priv->apps_changed,
+					   g_ptr_array_index (sources, i)))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * gs_plugin_loader_invalidate_changed:
+ *
+ * Refines only the cached applications that a plugin reported as changed,
+ * rather than throwing away the whole cache. The views are only reloaded
+ * if an application was added or removed.
+ *
+ * This has to be called in the main context, as the state of the shared
+ * applications is reset here, where the UI reads it, and not in the
+ * worker thread that refines them.
+ */
+static void
+gs_plugin_loader_invalidate_changed (GsPluginLoader *plugin_loader)
+{
+	GHashTableIter iter;
+	GList *l;
+	GPtrArray *sources;
+	GsApp *app;
+	GsPluginLoaderAsyncState *state;
+	const gchar *id;
+	guint i;
+	_cleanup_hashtable_unref_ GHashTable *unmatched = NULL;
+	_cleanup_object_unref_ GTask *task = NULL;
+
+	state = g_slice_new0 (GsPluginLoaderAsyncState);
+	state->flags = GS_PLUGIN_REFINE_FLAGS_DEFAULT |
+		       GS_PLUGIN_REFINE_FLAGS_REQUIRE_VERSION |
+		       GS_PLUGIN_REFINE_FLAGS_REQUIRE_DESCRIPTION |
+		       GS_PLUGIN_REFINE_FLAGS_REQUIRE_SETUP_ACTION;
+
+	/* no longer know the state of these, and they are only put back in
+	 * the cache once they have been refined */
+	unmatched = g_hash_table_new (g_str_hash, g_str_equal);
+	g_hash_table_iter_init (&iter, plugin_loader->priv->apps_changed);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &id, NULL))
+		g_hash_table_add (unmatched, (gpointer) id);
+	g_mutex_lock (&plugin_loader->priv->app_cache_mutex);
+	g_hash_table_iter_init (&iter, plugin_loader->priv->app_cache);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &app)) {
+		if (!gs_plugin_loader_app_is_changed (plugin_loader, app))
+			continue;
+		g_hash_table_remove (unmatched, gs_app_get_id (app));
+		sources = gs_app_get_sources (app);
+		for (i = 0; i < sources->len; i++)
+			g_hash_table_remove (unmatched, g_ptr_array_index (sources, i));
+		gs_plugin_add_app (&state->list, app);
+		g_hash_table_iter_remove (&iter);
+	}
+	g_mutex_unlock (&plugin_loader->priv->app_cache_mutex);
+	for (l = state->list; l != NULL; l = l->next)
+		gs_app_set_state (GS_APP (l->data), AS_APP_STATE_UNKNOWN);
+
+	/* anything that was not cached is probably new */
+	state->reload = g_hash_table_size (unmatched) > 0;
+	g_debug ("apps-changed: %u ids matched %u cached apps",
+		 g_hash_table_size (plugin_loader->priv->apps_changed),
+		 g_list_length (state->list));
+
+	/* run in a thread */
+	task = g_task_new (plugin_loader, NULL,
+			   gs_plugin_loader_apps_changed_finished_cb, NULL);
+	g_task_set_task_data (task, state, (GDestroyNotify) gs_plugin_loader_free_async_state);
+	if (state->list == NULL) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+	g_task_run_in_thread (task, gs_plugin_loader_apps_changed_thread_cb);
+}
+
 /**
  * gs_plugin_loader_updates_changed_delay_cb:
  */
@@ -2740,6 +4941,22 @@ gs_plugin_loader_updates_changed_delay_cb (gpointer user_data)
 	GsApp *app;
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (user_data);
 
+	plugin_loader->priv->updates_changed_id = 0;
+
+	/* the matches of the last search may have changed */
+	gs_plugin_loader_search_cache_clear (plugin_loader);
+
+	/* only some applications changed; this timeout is always
+	 * dispatched in the main context */
+	if (!plugin_loader->priv->updates_changed_all) {
+		g_return_val_if_fail (g_main_context_is_owner (g_main_context_default ()), FALSE);
+		gs_plugin_loader_invalidate_changed (plugin_loader);
+		g_hash_table_remove_all (plugin_loader->priv->apps_changed);
+		return FALSE;
+	}
+	plugin_loader->priv->updates_changed_all = FALSE;
+	g_hash_table_remove_all (plugin_loader->priv->apps_changed);
+
 	/* no longer know the state of these */
 	g_mutex_lock (&plugin_loader->priv->app_cache_mutex);
 	apps = g_hash_table_get_values (plugin_loader->priv->app_cache);
@@ -2756,17 +4973,15 @@ gs_plugin_loader_updates_changed_delay_cb (gpointer user_data)
 	/* notify shells */
 	g_debug ("updates-changed");
 	g_signal_emit (plugin_loader, signals[SIGNAL_UPDATES_CHANGED], 0);
-	plugin_loader->priv->updates_changed_id = 0;
 	return FALSE;
 }
 
 /**
- * gs_plugin_loader_updates_changed_cb:
+ * gs_plugin_loader_updates_changed_schedule:
  */
 static void
-gs_plugin_loader_updates_changed_cb (GsPlugin *plugin, gpointer user_data)
+gs_plugin_loader_updates_changed_schedule (GsPluginLoader *plugin_loader)
 {
-	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (user_data);
 	if (plugin_loader->priv->updates_changed_id != 0)
 		return;
 	plugin_loader->priv->updates_changed_id =
@@ -2775,6 +4990,38 @@ gs_plugin_loader_updates_changed_cb (GsPlugin *plugin, gpointer user_data)
 				       plugin_loader);
 }
 
+/**
+ * gs_plugin_loader_updates_changed_cb:
+ */
+static void
+gs_plugin_loader_updates_changed_cb (GsPlugin *plugin, gpointer user_data)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (user_data);
+	plugin_loader->priv->updates_changed_all = TRUE;
+	gs_plugin_loader_search_cache_clear (plugin_loader);
+	gs_plugin_loader_updates_changed_schedule (plugin_loader);
+}
+
+/**
+ * gs_plugin_loader_apps_changed_cb:
+ */
+static void
+gs_plugin_loader_apps_changed_cb (GsPlugin *plugin, gchar **ids, gpointer user_data)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (user_data);
+	guint i;
+
+	/* merged with anything else that changes before the delay fires */
+	for (i = 0; ids[i] != NULL; i++) {
+		g_hash_table_add (plugin_loader->priv->apps_changed,
+				  g_strdup (ids[i]));
+	}
+
+	/* the next page must not come from the old matches */
+	gs_plugin_loader_search_cache_clear (plugin_loader);
+	gs_plugin_loader_updates_changed_schedule (plugin_loader);
+}
+
 /**
  * gs_plugin_loader_open_plugin:
  */
@@ -2786,7 +5033,11 @@ gs_plugin_loader_open_plugin (GsPluginLoader *plugin_loader,
 	GModule *module;
 	GsPluginGetNameFunc plugin_name = NULL;
 	GsPluginGetDepsFunc plugin_deps = NULL;
+	GsPluginGetRefineFlagsFunc plugin_provides = NULL;
+	GsPluginGetRefineFieldsFunc plugin_reads = NULL;
+	GsPluginGetRefineFieldsFunc plugin_writes = NULL;
 	GsPlugin *plugin = NULL;
+	guint i;
 
 	module = g_module_open (filename, 0);
 	if (module == NULL) {
@@ -2810,6 +5061,17 @@ gs_plugin_loader_open_plugin (GsPluginLoader *plugin_loader,
 			 "gs_plugin_get_deps",
 			 (gpointer *) &plugin_deps);
 
+	/* get what the refine() function adds and uses, if declared */
+	g_module_symbol (module,
+			 "gs_plugin_get_refine_provides",
+			 (gpointer *) &plugin_provides);
+	g_module_symbol (module,
+			 "gs_plugin_get_refine_reads",
+			 (gpointer *) &plugin_reads);
+	g_module_symbol (module,
+			 "gs_plugin_get_refine_writes",
+			 (gpointer *) &plugin_writes);
+
 	/* print what we know */
 	plugin = g_slice_new0 (GsPlugin);
 	plugin->enabled = TRUE;
@@ -2817,15 +5079,40 @@ gs_plugin_loader_open_plugin (GsPluginLoader *plugin_loader,
 	plugin->pixbuf_size = 64;
 	plugin->priority = 0.f;
 	plugin->deps = plugin_deps != NULL ? plugin_deps (plugin) : NULL;
+	plugin->refine_provides = plugin_provides != NULL ?
+		plugin_provides (plugin) : GS_PLUGIN_REFINE_FLAGS_ANY;
+	plugin->refine_reads = plugin_reads != NULL ?
+		plugin_reads (plugin) : GS_PLUGIN_REFINE_FIELDS_ANY;
+	plugin->refine_writes = plugin_writes != NULL ?
+		plugin_writes (plugin) : GS_PLUGIN_REFINE_FIELDS_ANY;
 	plugin->name = g_strdup (plugin_name ());
 	plugin->status_update_fn = gs_plugin_loader_status_update_cb;
 	plugin->status_update_user_data = plugin_loader;
+	plugin->progress_update_fn = gs_plugin_loader_progress_update_cb;
+	plugin->progress_update_user_data = plugin_loader;
 	plugin->updates_changed_fn = gs_plugin_loader_updates_changed_cb;
 	plugin->updates_changed_user_data = plugin_loader;
+	plugin->apps_changed_fn = gs_plugin_loader_apps_changed_cb;
+	plugin->apps_changed_user_data = plugin_loader;
 	plugin->profile = g_object_ref (plugin_loader->priv->profile);
 	plugin->scale = gs_plugin_loader_get_scale (plugin_loader);
 	g_debug ("opened plugin %s: %s", filename, plugin->name);
 
+	/* resolve everything now rather than on each call */
+	plugin->vtable = g_new0 (GsPluginVtable, 1);
+	plugin->profile_ids = g_new0 (const gchar *, GS_PLUGIN_LOADER_VFUNC_LAST);
+	for (i = 0; i < GS_PLUGIN_LOADER_VFUNC_LAST; i++) {
+		_cleanup_free_ gchar *profile_id = NULL;
+		if (!g_module_symbol (module,
+				      vfuncs[i].name,
+				      &G_STRUCT_MEMBER (gpointer, plugin->vtable,
+							vfuncs[i].offset)))
+			continue;
+		profile_id = g_strdup_printf ("GsPlugin::%s(%s)",
+					      plugin->name, vfuncs[i].name);
+		plugin->profile_ids[i] = g_intern_string (profile_id);
+	}
+
 	/* add to array */
 	g_ptr_array_add (plugin_loader->priv->plugins, plugin);
 	return plugin;
@@ -2893,25 +5180,6 @@ gs_plugin_loader_plugin_sort_fn (gconstpointer a, gconstpointer b)
 	return 0;
 }
 
-/**
- * gs_plugin_loader_find_plugin:
- */
-static GsPlugin *
-gs_plugin_loader_find_plugin (GsPluginLoader *plugin_loader,
-			      const gchar *plugin_name)
-{
-	GsPluginLoaderPrivate *priv = plugin_loader->priv;
-	GsPlugin *plugin;
-	guint i;
-
-	for (i = 0; i < priv->plugins->len; i++) {
-		plugin = g_ptr_array_index (priv->plugins, i);
-		if (g_strcmp0 (plugin->name, plugin_name) == 0)
-			return plugin;
-	}
-	return NULL;
-}
-
 /**
  * gs_plugin_loader_setup:
  */
@@ -2928,6 +5196,7 @@ gs_plugin_loader_setup (GsPluginLoader *plugin_loader, GError **error)
 	guint i;
 	guint j;
 	_cleanup_dir_close_ GDir *dir = NULL;
+	_cleanup_error_free_ GError *error_local = NULL;
 
 	g_return_val_if_fail (plugin_loader->priv->location != NULL, FALSE);
 
@@ -2999,7 +5268,11 @@ gs_plugin_loader_setup (GsPluginLoader *plugin_loader, GError **error)
 			  gs_plugin_loader_plugin_sort_fn);
 
 	/* run the plugins */
-	gs_plugin_loader_run (plugin_loader, "gs_plugin_initialize");
+	gs_plugin_loader_run (plugin_loader, GS_PLUGIN_LOADER_VFUNC_INITIALIZE);
+
+	/* show the last refined results until the plugins have run again */
+	if (!gs_plugin_loader_snapshot_load (plugin_loader, &error_local))
+		g_warning ("failed to load snapshot: %s", error_local->message);
 
 	/* now we can load the install-queue */
 	ret = load_install_queue (plugin_loader, error);
@@ -3037,6 +5310,8 @@ gs_plugin_loader_plugin_free (GsPlugin *plugin)
 {
 	g_free (plugin->priv);
 	g_free (plugin->name);
+	g_free (plugin->vtable);
+	g_free (plugin->profile_ids);
 	g_object_unref (plugin->profile);
 	g_module_close (plugin->module);
 	g_slice_free (GsPlugin, plugin);
@@ -3051,14 +5326,37 @@ gs_plugin_loader_dispose (GObject *object)
 {
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
 
+	if (plugin_loader->priv->pool != NULL) {
+		g_thread_pool_free (plugin_loader->priv->pool, FALSE, TRUE);
+		plugin_loader->priv->pool = NULL;
+	}
 	if (plugin_loader->priv->plugins != NULL) {
-		gs_plugin_loader_run (plugin_loader, "gs_plugin_destroy");
+		gs_plugin_loader_run (plugin_loader, GS_PLUGIN_LOADER_VFUNC_DESTROY);
 		g_clear_pointer (&plugin_loader->priv->plugins, g_ptr_array_unref);
 	}
 	if (plugin_loader->priv->updates_changed_id != 0) {
 		g_source_remove (plugin_loader->priv->updates_changed_id);
 		plugin_loader->priv->updates_changed_id = 0;
 	}
+	if (plugin_loader->priv->snapshot_id != 0) {
+		g_source_remove (plugin_loader->priv->snapshot_id);
+		plugin_loader->priv->snapshot_id = 0;
+	}
+
+	/* plugins may still report from other threads, so drop anything
+	 * that arrives from now on */
+	g_mutex_lock (&plugin_loader->priv->status_mutex);
+	plugin_loader->priv->status_disposed = TRUE;
+	if (plugin_loader->priv->status_flush_id != 0) {
+		g_source_remove (plugin_loader->priv->status_flush_id);
+		plugin_loader->priv->status_flush_id = 0;
+	}
+	g_queue_foreach (&plugin_loader->priv->status_pending,
+			 (GFunc) gs_plugin_loader_status_free, NULL);
+	g_queue_clear (&plugin_loader->priv->status_pending);
+	g_clear_pointer (&plugin_loader->priv->progress_pending, g_hash_table_unref);
+	g_mutex_unlock (&plugin_loader->priv->status_mutex);
+
 	if (plugin_loader->priv->profile != NULL) {
 		gs_profile_stop (plugin_loader->priv->profile, "GsPluginLoader");
 		g_clear_object (&plugin_loader->priv->profile);
@@ -3066,7 +5364,11 @@ gs_plugin_loader_dispose (GObject *object)
 
 	g_clear_object (&plugin_loader->priv->settings);
 	g_clear_pointer (&plugin_loader->priv->app_cache, g_hash_table_unref);
+	g_clear_pointer (&plugin_loader->priv->snapshot, g_hash_table_unref);
+	g_clear_pointer (&plugin_loader->priv->snapshot_data, g_hash_table_unref);
+	g_clear_pointer (&plugin_loader->priv->apps_changed, g_hash_table_unref);
 	g_clear_pointer (&plugin_loader->priv->pending_apps, g_ptr_array_unref);
+	g_clear_pointer (&plugin_loader->priv->search_ranked, gs_plugin_list_free);
 
 	G_OBJECT_CLASS (gs_plugin_loader_parent_class)->dispose (object);
 }
@@ -3089,9 +5391,13 @@ gs_plugin_loader_finalize (GObject *object)
 
 	g_strfreev (plugin_loader->priv->compatible_projects);
 	g_free (plugin_loader->priv->location);
+	g_free (plugin_loader->priv->search_value);
+	g_free (plugin_loader->priv->search_truncated);
 
 	g_mutex_clear (&plugin_loader->priv->pending_apps_mutex);
 	g_mutex_clear (&plugin_loader->priv->app_cache_mutex);
+	g_mutex_clear (&plugin_loader->priv->status_mutex);
+	g_mutex_clear (&plugin_loader->priv->search_mutex);
 
 	G_OBJECT_CLASS (gs_plugin_loader_parent_class)->finalize (object);
 }
@@ -3142,6 +5448,7 @@ gs_plugin_loader_init (GsPluginLoader *plugin_loader)
 	plugin_loader->priv->scale = 1;
 	plugin_loader->priv->plugins = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_plugin_loader_plugin_free);
 	plugin_loader->priv->status_last = GS_PLUGIN_STATUS_LAST;
+	plugin_loader->priv->progress_pending = gs_plugin_loader_status_new_pending ();
 	plugin_loader->priv->pending_apps = g_ptr_array_new_with_free_func ((GFreeFunc) g_object_unref);
 	plugin_loader->priv->profile = gs_profile_new ();
 	plugin_loader->priv->settings = g_settings_new ("org.gnome.software");
@@ -3149,9 +5456,28 @@ gs_plugin_loader_init (GsPluginLoader *plugin_loader)
 								g_str_equal,
 								g_free,
 								(GFreeFunc) g_object_unref);
+	plugin_loader->priv->snapshot = g_hash_table_new_full (g_str_hash,
+							       g_str_equal,
+							       g_free,
+							       (GFreeFunc) g_object_unref);
+	plugin_loader->priv->snapshot_data = g_hash_table_new_full (g_str_hash,
+								    g_str_equal,
+								    g_free,
+								    (GFreeFunc) g_variant_unref);
+	plugin_loader->priv->apps_changed = g_hash_table_new_full (g_str_hash,
+								   g_str_equal,
+								   g_free,
+								   NULL);
+	plugin_loader->priv->pool = g_thread_pool_new (gs_plugin_loader_pool_cb,
+						       plugin_loader,
+						       GS_PLUGIN_LOADER_MAX_THREADS,
+						       FALSE,
+						       NULL);
 
 	g_mutex_init (&plugin_loader->priv->pending_apps_mutex);
 	g_mutex_init (&plugin_loader->priv->app_cache_mutex);
+	g_mutex_init (&plugin_loader->priv->status_mutex);
+	g_mutex_init (&plugin_loader->priv->search_mutex);
 
 	/* application start */
 	gs_profile_start (plugin_loader->priv->profile, "GsPluginLoader");
@@ -3259,20 +5585,15 @@ gs_plugin_loader_run_refresh_plugin (GsPluginLoader *plugin_loader,
 				     GCancellable *cancellable,
 				     GError **error)
 {
-	const gchar *function_name = "gs_plugin_refresh";
-	gboolean exists;
+	const gchar *profile_id = NULL;
 	gboolean ret = TRUE;
 	GError *error_local = NULL;
-	GsPluginRefreshFunc plugin_func = NULL;
-	_cleanup_free_ gchar *profile_id = NULL;
+	GsPluginRefreshFunc plugin_func;
 
-	exists = g_module_symbol (plugin->module,
-				  function_name,
-				  (gpointer *) &plugin_func);
-	if (!exists)
+	plugin_func = plugin->vtable->refresh;
+	if (plugin_func == NULL)
 		goto out;
-	profile_id = g_strdup_printf ("GsPlugin::%s(%s)",
-				      plugin->name, function_name);
+	profile_id = plugin->profile_ids[GS_PLUGIN_LOADER_VFUNC_REFRESH];
 	gs_profile_start (plugin_loader->priv->profile, profile_id);
 	ret = plugin_func (plugin, cache_age, flags, cancellable, &error_local);
 	if (!ret) {
@@ -3436,9 +5757,9 @@ gs_plugin_loader_filename_to_app_thread_cb (GTask *task,
 	GsPluginLoaderAsyncState *state = (GsPluginLoaderAsyncState *) task_data;
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
 	GsPlugin *plugin;
-	GsPluginFilenameToAppFunc plugin_func = NULL;
+	GsPluginFilenameToAppFunc plugin_func;
+	const gchar *profile_id = NULL;
 	guint i;
-	_cleanup_free_ gchar *profile_id = NULL;
 
 	/* run each plugin */
 	for (i = 0; i < plugin_loader->priv->plugins->len; i++) {
@@ -3448,13 +5769,10 @@ gs_plugin_loader_filename_to_app_thread_cb (GTask *task,
 		ret = g_task_return_error_if_cancelled (task);
 		if (ret)
 			goto out;
-		ret = g_module_symbol (plugin->module,
-				       function_name,
-				       (gpointer *) &plugin_func);
-		if (!ret)
+		plugin_func = plugin->vtable->filename_to_app;
+		if (plugin_func == NULL)
 			continue;
-		profile_id = g_strdup_printf ("GsPlugin::%s(%s)",
-					      plugin->name, function_name);
+		profile_id = plugin->profile_ids[GS_PLUGIN_LOADER_VFUNC_FILENAME_TO_APP];
 		gs_profile_start (plugin_loader->priv->profile, profile_id);
 		ret = plugin_func (plugin, &state->list, state->filename, cancellable, &error);
 		if (!ret) {
@@ -3463,7 +5781,7 @@ gs_plugin_loader_filename_to_app_thread_cb (GTask *task,
 		}
 		gs_plugin_status_update (plugin, NULL, GS_PLUGIN_STATUS_FINISHED);
 		gs_profile_stop (plugin_loader->priv->profile, profile_id);
-		g_clear_pointer (&profile_id, g_free);
+		profile_id = NULL;
 	}
 
 	/* dedupe applications we already know about */
@@ -3573,15 +5891,14 @@ gs_plugin_loader_offline_update_thread_cb (GTask *task,
                                            gpointer task_data,
                                            GCancellable *cancellable)
 {
-	const gchar *function_name = "gs_plugin_offline_update";
 	gboolean ret = TRUE;
 	GError *error = NULL;
 	GsPluginLoaderAsyncState *state = (GsPluginLoaderAsyncState *) task_data;
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
 	GsPlugin *plugin;
-	GsPluginOfflineUpdateFunc plugin_func = NULL;
+	GsPluginOfflineUpdateFunc plugin_func;
+	const gchar *profile_id = NULL;
 	guint i;
-	_cleanup_free_ gchar *profile_id = NULL;
 
 	/* run each plugin */
 	for (i = 0; i < plugin_loader->priv->plugins->len; i++) {
@@ -3591,13 +5908,10 @@ gs_plugin_loader_offline_update_thread_cb (GTask *task,
 		ret = g_task_return_error_if_cancelled (task);
 		if (ret)
 			goto out;
-		ret = g_module_symbol (plugin->module,
-		                       function_name,
-		                       (gpointer *) &plugin_func);
-		if (!ret)
+		plugin_func = plugin->vtable->offline_update;
+		if (plugin_func == NULL)
 			continue;
-		profile_id = g_strdup_printf ("GsPlugin::%s(%s)",
-		                              plugin->name, function_name);
+		profile_id = plugin->profile_ids[GS_PLUGIN_LOADER_VFUNC_OFFLINE_UPDATE];
 		gs_profile_start (plugin_loader->priv->profile, profile_id);
 		ret = plugin_func (plugin, state->list, cancellable, &error);
 		if (!ret) {
@@ -3606,7 +5920,7 @@ gs_plugin_loader_offline_update_thread_cb (GTask *task,
 		}
 		gs_plugin_status_update (plugin, NULL, GS_PLUGIN_STATUS_FINISHED);
 		gs_profile_stop (plugin_loader->priv->profile, profile_id);
-		g_clear_pointer (&profile_id, g_free);
+		profile_id = NULL;
 	}
 
 	g_task_return_boolean (task, TRUE);
@@ -38,6 +38,8 @@ G_BEGIN_DECLS
 #define GS_PLUGIN_LOADER_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), GS_TYPE_PLUGIN_LOADER, GsPluginLoaderClass))
 #define GS_PLUGIN_LOADER_ERROR		(gs_plugin_loader_error_quark ())
 
+#define GS_PLUGIN_LOADER_SEARCH_PAGE_SIZE	500
+
 typedef struct GsPluginLoaderPrivate GsPluginLoaderPrivate;
 
 typedef struct
@@ -73,6 +75,9 @@ typedef enum {
 typedef void	 (*GsPluginLoaderFinishedFunc)		(GsPluginLoader	*plugin_loader,
 							 GsApp		*app,
 							 gpointer	 user_data);
+typedef void	 (*GsPluginLoaderSearchBatchFunc)	(GsPluginLoader	*plugin_loader,
+							 GList		*list,
+							 gpointer	 user_data);
 
 GQuark		 gs_plugin_loader_error_quark		(void);
 GType		 gs_plugin_loader_get_type		(void);
@@ -141,9 +146,30 @@ void		 gs_plugin_loader_search_async		(GsPluginLoader	*plugin_loader,
 							 GCancellable	*cancellable,
 							 GAsyncReadyCallback callback,
 							 gpointer	 user_data);
+void		 gs_plugin_loader_search_stream_async	(GsPluginLoader	*plugin_loader,
+							 const gchar	*value,
+							 GsPluginRefineFlags flags,
+							 guint		 offset,
+							 GsPluginLoaderSearchBatchFunc batch_func,
+							 gpointer	 batch_data,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
 GList		*gs_plugin_loader_search_finish		(GsPluginLoader	*plugin_loader,
 							 GAsyncResult	*res,
 							 GError		**error);
+guint		 gs_plugin_loader_search_get_n_matches	(GsPluginLoader	*plugin_loader,
+							 GAsyncResult	*res);
+void		 gs_plugin_loader_subsearch_async	(GsPluginLoader	*plugin_loader,
+							 gchar		**previous_ids,
+							 const gchar	*value,
+							 GsPluginRefineFlags flags,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+GList		*gs_plugin_loader_subsearch_finish	(GsPluginLoader	*plugin_loader,
+							 GAsyncResult	*res,
+							 GError		**error);
 void		 gs_plugin_loader_search_files_async	(GsPluginLoader	*plugin_loader,
 							 const gchar	*value,
 							 GsPluginRefineFlags flags,
@@ -181,6 +207,10 @@ gboolean	 gs_plugin_loader_offline_update_finish	(GsPluginLoader	*plugin_loader,
 							 GError		**error);
 gboolean	 gs_plugin_loader_setup			(GsPluginLoader	*plugin_loader,
 							 GError		**error);
+gboolean	 gs_plugin_loader_save_snapshot		(GsPluginLoader	*plugin_loader,
+							 GError		**error);
+GList		*gs_plugin_loader_get_snapshot		(GsPluginLoader	*plugin_loader,
+							 AsAppState	 state);
 void		 gs_plugin_loader_dump_state		(GsPluginLoader	*plugin_loader);
 gboolean	 gs_plugin_loader_set_enabled		(GsPluginLoader	*plugin_loader,
 							 const gchar	*plugin_name,
@@ -230,78 +230,33 @@ gs_plugin_list_copy (GList *list)
 	return g_list_copy_deep (list, (GCopyFunc) g_object_ref, NULL);
 }
 
-typedef struct {
-	GsPlugin	*plugin;
-	GsApp		*app;
-	GsPluginStatus	 status;
-	guint		 percentage;
-} GsPluginStatusHelper;
-
-/**
- * gs_plugin_status_update_cb:
- **/
-static gboolean
-gs_plugin_status_update_cb (gpointer user_data)
-{
-	GsPluginStatusHelper *helper = (GsPluginStatusHelper *) user_data;
-
-	/* call back into the loader */
-	helper->plugin->status_update_fn (helper->plugin,
-					  helper->app,
-					  helper->status,
-					  helper->plugin->status_update_user_data);
-	if (helper->app != NULL)
-		g_object_unref (helper->app);
-	g_slice_free (GsPluginStatusHelper, helper);
-	return FALSE;
-}
-
 /**
  * gs_plugin_status_update:
+ *
+ * Reports what the plugin is doing. This can be called from any thread;
+ * the loader only keeps the latest status and emits it from the main loop.
  **/
 void
 gs_plugin_status_update (GsPlugin *plugin, GsApp *app, GsPluginStatus status)
 {
-	GsPluginStatusHelper *helper;
-
-	helper = g_slice_new0 (GsPluginStatusHelper);
-	helper->plugin = plugin;
-	helper->status = status;
-	if (app != NULL)
-		helper->app = g_object_ref (app);
-	g_idle_add (gs_plugin_status_update_cb, helper);
-}
-
-/**
- * gs_plugin_progress_update_cb:
- **/
-static gboolean
-gs_plugin_progress_update_cb (gpointer user_data)
-{
-	GsPluginStatusHelper *helper = (GsPluginStatusHelper *) user_data;
-
-	gs_app_set_progress (helper->app, helper->percentage);
-	g_object_unref (helper->app);
-	g_slice_free (GsPluginStatusHelper, helper);
-	return FALSE;
+	plugin->status_update_fn (plugin, app, status,
+				  plugin->status_update_user_data);
 }
 
 /**
  * gs_plugin_progress_update:
+ *
+ * Reports the progress of an action on @app. This can be called from any
+ * thread; the loader only keeps the latest value and sets it on @app from
+ * the main loop.
  **/
 void
 gs_plugin_progress_update (GsPlugin *plugin, GsApp *app, guint percentage)
 {
-	GsPluginStatusHelper *helper;
-
 	if (app == NULL)
 		return;
-
-	helper = g_slice_new0 (GsPluginStatusHelper);
-	helper->plugin = plugin;
-	helper->percentage = percentage;
-	helper->app = g_object_ref (app);
-	g_idle_add (gs_plugin_progress_update_cb, helper);
+	plugin->progress_update_fn (plugin, app, percentage,
+				    plugin->progress_update_user_data);
 }
 
 /**
@@ -324,4 +279,51 @@ gs_plugin_updates_changed (GsPlugin *plugin)
 	g_idle_add (gs_plugin_updates_changed_cb, plugin);
 }
 
+typedef struct {
+	GsPlugin	*plugin;
+	gchar		**ids;
+} GsPluginAppsChangedHelper;
+
+/**
+ * gs_plugin_apps_changed_cb:
+ **/
+static gboolean
+gs_plugin_apps_changed_cb (gpointer user_data)
+{
+	GsPluginAppsChangedHelper *helper = (GsPluginAppsChangedHelper *) user_data;
+	GsPlugin *plugin = helper->plugin;
+	plugin->apps_changed_fn (plugin, helper->ids, plugin->apps_changed_user_data);
+	g_strfreev (helper->ids);
+	g_slice_free (GsPluginAppsChangedHelper, helper);
+	return FALSE;
+}
+
+/**
+ * gs_plugin_apps_changed:
+ * @plugin: a #GsPlugin
+ * @ids: application IDs or package names that changed
+ *
+ * Tells the loader that only the applications matching @ids are stale,
+ * so that it can refresh just those rather than reloading everything as
+ * gs_plugin_updates_changed() does.
+ **/
+void
+gs_plugin_apps_changed (GsPlugin *plugin, gchar **ids)
+{
+	GsPluginAppsChangedHelper *helper;
+
+	/* nothing specific known, so fall back to a full reload */
+	if (ids == NULL) {
+		gs_plugin_updates_changed (plugin);
+		return;
+	}
+	if (ids[0] == NULL)
+		return;
+
+	helper = g_slice_new0 (GsPluginAppsChangedHelper);
+	helper->plugin = plugin;
+	helper->ids = g_strdupv (ids);
+	g_idle_add (gs_plugin_apps_changed_cb, helper);
+}
+
 /* vim: set noexpandtab: */
@@ -35,6 +35,7 @@ G_BEGIN_DECLS
 
 typedef struct	GsPluginPrivate	GsPluginPrivate;
 typedef struct	GsPlugin	GsPlugin;
+typedef struct	GsPluginVtable	GsPluginVtable;
 
 typedef enum {
 	GS_PLUGIN_STATUS_UNKNOWN,
@@ -52,26 +53,92 @@ typedef void (*GsPluginStatusUpdate)	(GsPlugin	*plugin,
 					 GsApp		*app,
 					 GsPluginStatus	 status,
 					 gpointer	 user_data);
+typedef void (*GsPluginProgressUpdate)	(GsPlugin	*plugin,
+					 GsApp		*app,
+					 guint		 percentage,
+					 gpointer	 user_data);
 typedef void (*GsPluginUpdatesChanged)	(GsPlugin	*plugin,
 					 gpointer	 user_data);
+typedef void (*GsPluginAppsChanged)	(GsPlugin	*plugin,
+					 gchar		**ids,
+					 gpointer	 user_data);
 
 typedef gboolean (*GsPluginListFilter)	(GsApp		*app,
 					 gpointer	 user_data);
 
+typedef enum {
+	GS_PLUGIN_REFINE_FLAGS_DEFAULT			= 0,
+	GS_PLUGIN_REFINE_FLAGS_USE_HISTORY		= 1 << 0,
+	GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENCE		= 1 << 1,
+	GS_PLUGIN_REFINE_FLAGS_REQUIRE_URL		= 1 << 2,
+	GS_PLUGIN_REFINE_FLAGS_REQUIRE_DESCRIPTION	= 1 << 3,
+	GS_PLUGIN_REFINE_FLAGS_REQUIRE_SIZE		= 1 << 4,
+	GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING		= 1 << 5,
+	GS_PLUGIN_REFINE_FLAGS_REQUIRE_VERSION		= 1 << 6,
+	GS_PLUGIN_REFINE_FLAGS_REQUIRE_HISTORY		= 1 << 7,
+	GS_PLUGIN_REFINE_FLAGS_REQUIRE_SETUP_ACTION	= 1 << 8,
+	GS_PLUGIN_REFINE_FLAGS_REQUIRE_UPDATE_DETAILS	= 1 << 9,
+	GS_PLUGIN_REFINE_FLAGS_REQUIRE_ORIGIN		= 1 << 10,
+	GS_PLUGIN_REFINE_FLAGS_REQUIRE_RELATED		= 1 << 11,
+	GS_PLUGIN_REFINE_FLAGS_REQUIRE_MENU_PATH	= 1 << 12,
+	GS_PLUGIN_REFINE_FLAGS_REQUIRE_ADDONS		= 1 << 13,
+	GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES		= 1 << 14,
+	GS_PLUGIN_REFINE_FLAGS_ALLOW_NO_APPDATA		= 1 << 15,
+	GS_PLUGIN_REFINE_FLAGS_LAST
+} GsPluginRefineFlags;
+
+/* refiners that do not say what they can add are always run */
+#define	GS_PLUGIN_REFINE_FLAGS_ANY			((GsPluginRefineFlags) ~0u)
+
+/* the #GsApp properties a refine() reads or writes, which is not the same
+ * as the flags, e.g. both ratings plugins also add kudos */
+typedef enum {
+	GS_PLUGIN_REFINE_FIELD_NONE			= 0,
+	GS_PLUGIN_REFINE_FIELD_ID			= 1 << 0,
+	GS_PLUGIN_REFINE_FIELD_NAME			= 1 << 1,
+	GS_PLUGIN_REFINE_FIELD_STATE			= 1 << 2,
+	GS_PLUGIN_REFINE_FIELD_SOURCES			= 1 << 3,
+	GS_PLUGIN_REFINE_FIELD_VERSION			= 1 << 4,
+	GS_PLUGIN_REFINE_FIELD_INSTALL_DATE		= 1 << 5,
+	GS_PLUGIN_REFINE_FIELD_HISTORY			= 1 << 6,
+	GS_PLUGIN_REFINE_FIELD_RATING			= 1 << 7,
+	GS_PLUGIN_REFINE_FIELD_KUDOS			= 1 << 8,
+	GS_PLUGIN_REFINE_FIELD_CATEGORIES		= 1 << 9,
+	GS_PLUGIN_REFINE_FIELD_MENU_PATH		= 1 << 10,
+	GS_PLUGIN_REFINE_FIELD_LAST
+} GsPluginRefineFields;
+
+/* refine() runs in parallel with the other refiners on the same #GsApp
+ * objects, which have no locking, so only refiners that declare both the
+ * fields they read and write and share no written field with each other
+ * run at the same time. The declaration has to cover every setter that is
+ * called; a refiner using anything not listed must leave it undeclared,
+ * and refiners that do not say which fields they use run on their own */
+#define	GS_PLUGIN_REFINE_FIELDS_ANY			((GsPluginRefineFields) ~0u)
+
 struct GsPlugin {
 	GModule			*module;
 	gdouble			 priority;	/* largest number gets run first */
 	const gchar		**deps;		/* allow-none */
+	GsPluginRefineFlags	 refine_provides; /* flags refine() can add */
+	GsPluginRefineFields	 refine_reads;	/* fields read by refine() */
+	GsPluginRefineFields	 refine_writes;	/* fields set by refine() */
+	GsPluginVtable		*vtable;	/* resolved when opened */
+	const gchar		**profile_ids;	/* interned, by vfunc */
 	gboolean		 enabled;
 	gboolean		 use_pkg_descriptions;
 	gchar			*name;
 	GsPluginPrivate		*priv;
 	guint			 pixbuf_size;
 	gint			 scale;
-	GsPluginStatusUpdate	 status_update_fn;
+	GsPluginStatusUpdate	 status_update_fn;	/* called in any thread */
 	gpointer		 status_update_user_data;
+	GsPluginProgressUpdate	 progress_update_fn;	/* called in any thread */
+	gpointer		 progress_update_user_data;
 	GsPluginUpdatesChanged	 updates_changed_fn;
 	gpointer		 updates_changed_user_data;
+	GsPluginAppsChanged	 apps_changed_fn;
+	gpointer		 apps_changed_user_data;
 	GsProfile		*profile;
 };
 
@@ -81,27 +148,6 @@ typedef enum {
 	GS_PLUGIN_ERROR_LAST
 } GsPluginError;
 
-typedef enum {
-	GS_PLUGIN_REFINE_FLAGS_DEFAULT			= 0,
-	GS_PLUGIN_REFINE_FLAGS_USE_HISTORY		= 1 << 0,
-	GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENCE		= 1 << 1,
-	GS_PLUGIN_REFINE_FLAGS_REQUIRE_URL		= 1 << 2,
-	GS_PLUGIN_REFINE_FLAGS_REQUIRE_DESCRIPTION	= 1 << 3,
-	GS_PLUGIN_REFINE_FLAGS_REQUIRE_SIZE		= 1 << 4,
-	GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING		= 1 << 5,
-	GS_PLUGIN_REFINE_FLAGS_REQUIRE_VERSION		= 1 << 6,
-	GS_PLUGIN_REFINE_FLAGS_REQUIRE_HISTORY		= 1 << 7,
-	GS_PLUGIN_REFINE_FLAGS_REQUIRE_SETUP_ACTION	= 1 << 8,
-	GS_PLUGIN_REFINE_FLAGS_REQUIRE_UPDATE_DETAILS	= 1 << 9,
-	GS_PLUGIN_REFINE_FLAGS_REQUIRE_ORIGIN		= 1 << 10,
-	GS_PLUGIN_REFINE_FLAGS_REQUIRE_RELATED		= 1 << 11,
-	GS_PLUGIN_REFINE_FLAGS_REQUIRE_MENU_PATH	= 1 << 12,
-	GS_PLUGIN_REFINE_FLAGS_REQUIRE_ADDONS		= 1 << 13,
-	GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES		= 1 << 14,
-	GS_PLUGIN_REFINE_FLAGS_ALLOW_NO_APPDATA		= 1 << 15,
-	GS_PLUGIN_REFINE_FLAGS_LAST
-} GsPluginRefineFlags;
-
 typedef enum {
 	GS_PLUGIN_REFRESH_FLAGS_UPDATES			= 1 << 0,
 	GS_PLUGIN_REFRESH_FLAGS_LAST
@@ -114,6 +160,8 @@ typedef enum {
 
 typedef const gchar	*(*GsPluginGetNameFunc)		(void);
 typedef const gchar	**(*GsPluginGetDepsFunc)	(GsPlugin	*plugin);
+typedef GsPluginRefineFlags (*GsPluginGetRefineFlagsFunc) (GsPlugin	*plugin);
+typedef GsPluginRefineFields (*GsPluginGetRefineFieldsFunc) (GsPlugin	*plugin);
 typedef void		 (*GsPluginFunc)		(GsPlugin	*plugin);
 typedef gboolean	 (*GsPluginSearchFunc)		(GsPlugin	*plugin,
 							 gchar		**value,
@@ -153,6 +201,30 @@ typedef gboolean	 (*GsPluginOfflineUpdateFunc)	(GsPlugin	*plugin,
 							 GCancellable	*cancellable,
 							 GError		**error);
 
+/* every function a plugin may export, set to NULL if not implemented */
+struct GsPluginVtable {
+	GsPluginFunc		 initialize;
+	GsPluginFunc		 destroy;
+	GsPluginRefineFunc	 refine;
+	GsPluginRefreshFunc	 refresh;
+	GsPluginSearchFunc	 add_search;
+	GsPluginSearchFunc	 add_search_files;
+	GsPluginSearchFunc	 add_search_what_provides;
+	GsPluginResultsFunc	 add_installed;
+	GsPluginResultsFunc	 add_updates;
+	GsPluginResultsFunc	 add_updates_historical;
+	GsPluginResultsFunc	 add_sources;
+	GsPluginResultsFunc	 add_popular;
+	GsPluginResultsFunc	 add_featured;
+	GsPluginResultsFunc	 add_categories;
+	GsPluginCategoryFunc	 add_category_apps;
+	GsPluginActionFunc	 app_install;
+	GsPluginActionFunc	 app_remove;
+	GsPluginActionFunc	 app_set_rating;
+	GsPluginFilenameToAppFunc filename_to_app;
+	GsPluginOfflineUpdateFunc offline_update;
+};
+
 const gchar	*gs_plugin_get_name			(void);
 void		 gs_plugin_initialize			(GsPlugin	*plugin);
 void		 gs_plugin_destroy			(GsPlugin	*plugin);
@@ -177,6 +249,8 @@ void		 gs_plugin_progress_update		(GsPlugin	*plugin,
 							 GsApp		*app,
 							 guint		 percentage);
 void		 gs_plugin_updates_changed		(GsPlugin	*plugin);
+void		 gs_plugin_apps_changed			(GsPlugin	*plugin,
+							 gchar		**ids);
 const gchar	*gs_plugin_status_to_string		(GsPluginStatus	 status);
 gboolean	 gs_plugin_add_search			(GsPlugin	*plugin,
 							 gchar		**values,
@@ -194,6 +268,9 @@ gboolean	 gs_plugin_add_search_what_provides	(GsPlugin	*plugin,
 							 GCancellable	*cancellable,
 							 GError		**error);
 const gchar	**gs_plugin_get_deps			(GsPlugin	*plugin);
+GsPluginRefineFlags gs_plugin_get_refine_provides	(GsPlugin	*plugin);
+GsPluginRefineFields gs_plugin_get_refine_reads	(GsPlugin	*plugin);
+GsPluginRefineFields gs_plugin_get_refine_writes	(GsPlugin	*plugin);
 gboolean	 gs_plugin_add_installed		(GsPlugin	*plugin,
 							 GList		**list,
 							 GCancellable	*cancellable,
@@ -103,6 +103,13 @@ app_state_changed (GsApp *app, GParamSpec *pspec, GsPopularTile *tile)
 	g_idle_add (app_state_changed_idle, g_object_ref (tile));
 }
 
+static void
+app_pixbuf_changed (GsApp *app, GParamSpec *pspec, GsPopularTile *tile)
+{
+	GsPopularTilePrivate *priv = gs_popular_tile_get_instance_private (tile);
+	gs_image_set_from_pixbuf (GTK_IMAGE (priv->image), gs_app_get_pixbuf (app));
+}
+
 void
 gs_popular_tile_set_app (GsPopularTile *tile, GsApp *app)
 {
@@ -113,8 +120,10 @@ gs_popular_tile_set_app (GsPopularTile *tile, GsApp *app)
 
 	priv = gs_popular_tile_get_instance_private (tile);
 
-	if (priv->app)
+	if (priv->app) {
 		g_signal_handlers_disconnect_by_func (priv->app, app_state_changed, tile);
+		g_signal_handlers_disconnect_by_func (priv->app, app_pixbuf_changed, tile);
+	}
 
 	g_clear_object (&priv->app);
 	if (!app)
@@ -135,6 +144,8 @@ gs_popular_tile_set_app (GsPopularTile *tile, GsApp *app)
 	g_signal_connect (priv->app, "notify::state",
 		 	  G_CALLBACK (app_state_changed), tile);
 	app_state_changed (priv->app, NULL, tile);
+	g_signal_connect (priv->app, "notify::pixbuf",
+			  G_CALLBACK (app_pixbuf_changed), tile);
 
 	gs_image_set_from_pixbuf (GTK_IMAGE (priv->image), gs_app_get_pixbuf (priv->app));
 
@@ -149,8 +160,10 @@ gs_popular_tile_destroy (GtkWidget *widget)
 
 	priv = gs_popular_tile_get_instance_private (tile);
 
-	if (priv->app)
+	if (priv->app) {
 		g_signal_handlers_disconnect_by_func (priv->app, app_state_changed, tile);
+		g_signal_handlers_disconnect_by_func (priv->app, app_pixbuf_changed, tile);
+	}
 
 	g_clear_object (&priv->app);
 
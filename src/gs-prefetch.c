@@ -0,0 +1,492 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2015 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib/gstdio.h>
+#include <libsoup/soup.h>
+#define I_KNOW_THE_PACKAGEKIT_GLIB2_API_IS_SUBJECT_TO_CHANGE
+#include <packagekit-glib2/packagekit.h>
+
+#include "gs-cache.h"
+#include "gs-cleanup.h"
+#include "gs-prefetch.h"
+#include "gs-screenshot-image.h"
+
+/*
+ * Downloads the screenshots the details page is going to want for the apps
+ * that are visible on the current page, so that they are already in the
+ * cache when a tile or search result is clicked. This uses its own session
+ * with fewer connections so it does not slow down what the user is looking
+ * at, and it only runs on connections that are not metered.
+ */
+
+#define GS_PREFETCH_MAX_CONNS		2
+
+#define GS_PREFETCH_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), GS_TYPE_PREFETCH, GsPrefetchPrivate))
+
+struct GsPrefetchPrivate
+{
+	SoupSession		*session;
+	PkControl		*control;
+	GCancellable		*cancellable;	/* for the save tasks */
+	GMutex			 save_mutex;	/* held while putting a file in place */
+	GQueue			*queue;		/* of GsPrefetchItem */
+	guint			 in_flight;
+};
+
+typedef struct {
+	GsPrefetch		*prefetch;	/* weak */
+	gchar			*url;
+	gchar			*filename;
+	guint			 width;		/* in device pixels */
+	guint			 height;
+} GsPrefetchItem;
+
+G_DEFINE_TYPE (GsPrefetch, gs_prefetch, G_TYPE_OBJECT)
+
+static void gs_prefetch_kick (GsPrefetch *prefetch);
+
+/**
+ * gs_prefetch_item_free:
+ **/
+static void
+gs_prefetch_item_free (GsPrefetchItem *item)
+{
+	if (item->prefetch != NULL)
+		g_object_remove_weak_pointer (G_OBJECT (item->prefetch),
+					      (gpointer *) &item->prefetch);
+	g_free (item->url);
+	g_free (item->filename);
+	g_slice_free (GsPrefetchItem, item);
+}
+
+/**
+ * gs_prefetch_is_free_connection:
+ *
+ * Uses the same rules as the updates page for a connection that can be
+ * used without asking the user.
+ **/
+static gboolean
+gs_prefetch_is_free_connection (GsPrefetch *prefetch)
+{
+	PkNetworkEnum network_state;
+
+	g_object_get (prefetch->priv->control, "network-state", &network_state, NULL);
+	switch (network_state) {
+	case PK_NETWORK_ENUM_ONLINE:
+	case PK_NETWORK_ENUM_WIFI:
+	case PK_NETWORK_ENUM_WIRED:
+		return TRUE;
+	default:
+		break;
+	}
+	return FALSE;
+}
+
+/**
+ * gs_prefetch_save_thread_cb:
+ **/
+static void
+gs_prefetch_save_thread_cb (GTask *task,
+			    gpointer object,
+			    gpointer task_data,
+			    GCancellable *cancellable)
+{
+	GError *error = NULL;
+	GsPrefetch *prefetch = GS_PREFETCH (object);
+	GsPrefetchItem *item = g_object_get_data (G_OBJECT (task), "item");
+	SoupBuffer *buffer = task_data;
+	_cleanup_free_ gchar *filename_tmp = NULL;
+	_cleanup_object_unref_ GdkPixbuf *pixbuf = NULL;
+
+	if (g_task_return_error_if_cancelled (task))
+		return;
+
+	/* only put the file in place if the prefetch was not cancelled
+	 * while decoding, as nothing would add it to the cache index */
+	filename_tmp = g_strdup_printf ("%s.prefetch", item->filename);
+	pixbuf = gs_screenshot_image_save_data (buffer,
+						filename_tmp,
+						item->width,
+						item->height,
+						&error);
+	if (pixbuf == NULL) {
+		g_unlink (filename_tmp);
+		g_task_return_error (task, error);
+		return;
+	}
+	g_mutex_lock (&prefetch->priv->save_mutex);
+	if (g_task_return_error_if_cancelled (task)) {
+		g_mutex_unlock (&prefetch->priv->save_mutex);
+		g_unlink (filename_tmp);
+		return;
+	}
+	if (g_rename (filename_tmp, item->filename) != 0) {
+		g_mutex_unlock (&prefetch->priv->save_mutex);
+		g_unlink (filename_tmp);
+		g_task_return_new_error (task,
+					 G_IO_ERROR,
+					 G_IO_ERROR_FAILED,
+					 "failed to rename %s",
+					 filename_tmp);
+		return;
+	}
+	g_mutex_unlock (&prefetch->priv->save_mutex);
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * gs_prefetch_save_cb:
+ **/
+static void
+gs_prefetch_save_cb (GObject *source_object,
+		     GAsyncResult *res,
+		     gpointer user_data)
+{
+	GsPrefetch *prefetch = GS_PREFETCH (source_object);
+	GsPrefetchItem *item = g_object_get_data (G_OBJECT (res), "item");
+	SoupMessage *msg = SOUP_MESSAGE (user_data);
+	_cleanup_error_free_ GError *error = NULL;
+
+	if (!g_task_propagate_boolean (G_TASK (res), &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("failed to prefetch %s: %s", item->url, error->message);
+	} else {
+		gs_cache_add (GS_CACHE_KIND_SCREENSHOT, item->filename, msg);
+	}
+	g_object_unref (msg);
+
+	prefetch->priv->in_flight--;
+	gs_prefetch_kick (prefetch);
+}
+
+/**
+ * gs_prefetch_complete_cb:
+ **/
+static void
+gs_prefetch_complete_cb (SoupSession *session,
+			 SoupMessage *msg,
+			 gpointer user_data)
+{
+	GsPrefetchItem *item = (GsPrefetchItem *) user_data;
+	GsPrefetch *prefetch = item->prefetch;
+	_cleanup_object_unref_ GTask *task = NULL;
+
+	/* the prefetcher has been finalized */
+	if (prefetch == NULL) {
+		gs_prefetch_item_free (item);
+		return;
+	}
+
+	if (msg->status_code != SOUP_STATUS_OK) {
+		if (msg->status_code != SOUP_STATUS_CANCELLED) {
+			g_debug ("failed to prefetch %s: %s", item->url,
+				 soup_status_get_phrase (msg->status_code));
+		}
+		gs_prefetch_item_free (item);
+		prefetch->priv->in_flight--;
+		gs_prefetch_kick (prefetch);
+		return;
+	}
+
+	/* pad and save in a thread, as the details page would have done */
+	task = g_task_new (prefetch, prefetch->priv->cancellable,
+			   gs_prefetch_save_cb, g_object_ref (msg));
+	g_object_set_data_full (G_OBJECT (task), "item", item,
+				(GDestroyNotify) gs_prefetch_item_free);
+	g_task_set_task_data (task,
+			      soup_message_body_flatten (msg->response_body),
+			      (GDestroyNotify) soup_buffer_free);
+	g_task_run_in_thread (task, gs_prefetch_save_thread_cb);
+}
+
+/**
+ * gs_prefetch_kick:
+ **/
+static void
+gs_prefetch_kick (GsPrefetch *prefetch)
+{
+	GsPrefetchItem *item;
+	GsPrefetchPrivate *priv = prefetch->priv;
+	SoupMessage *msg;
+
+	/* in destruction */
+	if (priv->session == NULL)
+		return;
+	if (!gs_prefetch_is_free_connection (prefetch))
+		return;
+	while (priv->in_flight < GS_PREFETCH_MAX_CONNS) {
+		item = g_queue_pop_head (priv->queue);
+		if (item == NULL)
+			return;
+
+		/* the details page may have got there first */
+		if (gs_cache_lookup (GS_CACHE_KIND_SCREENSHOT,
+				     item->filename) != GS_CACHE_STATE_MISSING) {
+			gs_prefetch_item_free (item);
+			continue;
+		}
+		msg = soup_message_new (SOUP_METHOD_GET, item->url);
+		if (msg == NULL) {
+			gs_prefetch_item_free (item);
+			continue;
+		}
+		g_debug ("prefetching %s to %s", item->url, item->filename);
+		priv->in_flight++;
+		soup_session_queue_message (priv->session, msg,
+					    gs_prefetch_complete_cb, item);
+	}
+}
+
+/**
+ * gs_prefetch_add_screenshot:
+ **/
+static void
+gs_prefetch_add_screenshot (GsPrefetch *prefetch,
+			    AsScreenshot *ss,
+			    guint width,
+			    guint height,
+			    gint scale)
+{
+	AsImage *im;
+	GList *l;
+	GsPrefetchItem *item;
+	_cleanup_free_ gchar *dirname = NULL;
+	_cleanup_free_ gchar *filename = NULL;
+
+	im = gs_screenshot_image_find_image (ss, width, height, &scale);
+	if (im == NULL)
+		return;
+	filename = gs_screenshot_image_get_cache_filename (g_get_user_cache_dir (),
+							  as_image_get_url (im),
+							  width, height, scale);
+	if (gs_cache_lookup (GS_CACHE_KIND_SCREENSHOT, filename) != GS_CACHE_STATE_MISSING)
+		return;
+
+	/* already queued */
+	for (l = prefetch->priv->queue->head; l != NULL; l = l->next) {
+		item = l->data;
+		if (g_strcmp0 (item->filename, filename) == 0)
+			return;
+	}
+
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0700) != 0)
+		return;
+
+	item = g_slice_new0 (GsPrefetchItem);
+	item->prefetch = prefetch;
+	g_object_add_weak_pointer (G_OBJECT (prefetch), (gpointer *) &item->prefetch);
+	item->url = g_strdup (as_image_get_url (im));
+	item->filename = g_strdup (filename);
+	item->width = width * scale;
+	item->height = height * scale;
+	g_queue_push_tail (prefetch->priv->queue, item);
+}
+
+/**
+ * gs_prefetch_add_app:
+ * @prefetch: a #GsPrefetch
+ * @app: a #GsApp that is visible on the current page
+ * @scale: the scale factor of the window
+ *
+ * Queues the first screenshot and its thumbnail at the sizes used by the
+ * details page.
+ **/
+void
+gs_prefetch_add_app (GsPrefetch *prefetch, GsApp *app, gint scale)
+{
+	AsScreenshot *ss;
+	GPtrArray *screenshots;
+
+	g_return_if_fail (GS_IS_PREFETCH (prefetch));
+	g_return_if_fail (GS_IS_APP (app));
+
+	screenshots = gs_app_get_screenshots (app);
+	if (screenshots->len == 0)
+		return;
+	ss = g_ptr_array_index (screenshots, 0);
+
+	/* use a slightly larger screenshot if it's the only screenshot */
+	if (screenshots->len == 1) {
+		gs_prefetch_add_screenshot (prefetch, ss,
+					    AS_IMAGE_LARGE_WIDTH,
+					    AS_IMAGE_LARGE_HEIGHT,
+					    scale);
+	} else {
+		gs_prefetch_add_screenshot (prefetch, ss,
+					    AS_IMAGE_NORMAL_WIDTH,
+					    AS_IMAGE_NORMAL_HEIGHT,
+					    scale);
+		gs_prefetch_add_screenshot (prefetch, ss,
+					    AS_IMAGE_THUMBNAIL_WIDTH,
+					    AS_IMAGE_THUMBNAIL_HEIGHT,
+					    scale);
+	}
+	gs_prefetch_kick (prefetch);
+}
+
+/**
+ * gs_prefetch_cancel:
+ * @prefetch: a #GsPrefetch
+ *
+ * Drops everything that is queued or in progress, typically when the user
+ * navigates to a different page. Screenshots that are being saved in a
+ * thread are not written to the cache.
+ **/
+void
+gs_prefetch_cancel (GsPrefetch *prefetch)
+{
+	GsPrefetchPrivate *priv;
+
+	g_return_if_fail (GS_IS_PREFETCH (prefetch));
+
+	priv = prefetch->priv;
+	g_queue_foreach (priv->queue, (GFunc) gs_prefetch_item_free, NULL);
+	g_queue_clear (priv->queue);
+	soup_session_abort (priv->session);
+
+	/* wait for any file being put in place, so nothing is written
+	 * once this returns; the save tasks hold their own ref, so use a
+	 * new one for the next prefetch */
+	g_cancellable_cancel (priv->cancellable);
+	g_mutex_lock (&priv->save_mutex);
+	g_mutex_unlock (&priv->save_mutex);
+	g_object_unref (priv->cancellable);
+	priv->cancellable = g_cancellable_new ();
+}
+
+/**
+ * gs_prefetch_network_state_cb:
+ **/
+static void
+gs_prefetch_network_state_cb (PkControl *control,
+			      GParamSpec *pspec,
+			      GsPrefetch *prefetch)
+{
+	gs_prefetch_kick (prefetch);
+}
+
+/**
+ * gs_prefetch_get_properties_cb:
+ **/
+static void
+gs_prefetch_get_properties_cb (GObject *source,
+			       GAsyncResult *res,
+			       gpointer user_data)
+{
+	_cleanup_error_free_ GError *error = NULL;
+
+	if (!pk_control_get_properties_finish (PK_CONTROL (source), res, &error)) {
+		g_warning ("failed to get the network state: %s", error->message);
+		return;
+	}
+}
+
+/**
+ * gs_prefetch_dispose:
+ **/
+static void
+gs_prefetch_dispose (GObject *object)
+{
+	GsPrefetch *prefetch = GS_PREFETCH (object);
+	GsPrefetchPrivate *priv = prefetch->priv;
+
+	/* abort while everything the callbacks use is still valid */
+	g_cancellable_cancel (priv->cancellable);
+	if (priv->session != NULL) {
+		gs_prefetch_cancel (prefetch);
+		g_clear_object (&priv->session);
+	}
+	if (priv->control != NULL) {
+		g_signal_handlers_disconnect_by_data (priv->control, prefetch);
+		g_clear_object (&priv->control);
+	}
+
+	G_OBJECT_CLASS (gs_prefetch_parent_class)->dispose (object);
+}
+
+/**
+ * gs_prefetch_finalize:
+ **/
+static void
+gs_prefetch_finalize (GObject *object)
+{
+	GsPrefetch *prefetch = GS_PREFETCH (object);
+
+	g_queue_free (prefetch->priv->queue);
+	g_object_unref (prefetch->priv->cancellable);
+	g_mutex_clear (&prefetch->priv->save_mutex);
+
+	G_OBJECT_CLASS (gs_prefetch_parent_class)->finalize (object);
+}
+
+/**
+ * gs_prefetch_class_init:
+ **/
+static void
+gs_prefetch_class_init (GsPrefetchClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->dispose = gs_prefetch_dispose;
+	object_class->finalize = gs_prefetch_finalize;
+	g_type_class_add_private (klass, sizeof (GsPrefetchPrivate));
+}
+
+/**
+ * gs_prefetch_init:
+ **/
+static void
+gs_prefetch_init (GsPrefetch *prefetch)
+{
+	GsPrefetchPrivate *priv;
+
+	prefetch->priv = GS_PREFETCH_GET_PRIVATE (prefetch);
+	priv = prefetch->priv;
+	priv->queue = g_queue_new ();
+	priv->cancellable = g_cancellable_new ();
+	g_mutex_init (&priv->save_mutex);
+	priv->session = soup_session_new_with_options (SOUP_SESSION_USER_AGENT, "gnome-software",
+						       SOUP_SESSION_MAX_CONNS, GS_PREFETCH_MAX_CONNS,
+						       SOUP_SESSION_MAX_CONNS_PER_HOST, GS_PREFETCH_MAX_CONNS,
+						       NULL);
+
+	/* nothing is downloaded until we know the connection is not metered */
+	priv->control = pk_control_new ();
+	g_signal_connect (priv->control, "notify::network-state",
+			  G_CALLBACK (gs_prefetch_network_state_cb), prefetch);
+	pk_control_get_properties_async (priv->control, NULL,
+					 gs_prefetch_get_properties_cb, prefetch);
+}
+
+/**
+ * gs_prefetch_new:
+ **/
+GsPrefetch *
+gs_prefetch_new (void)
+{
+	GsPrefetch *prefetch;
+	prefetch = g_object_new (GS_TYPE_PREFETCH, NULL);
+	return GS_PREFETCH (prefetch);
+}
+
+/* vim: set noexpandtab: */
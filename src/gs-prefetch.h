@@ -0,0 +1,60 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2015 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GS_PREFETCH_H
+#define __GS_PREFETCH_H
+
+#include <glib-object.h>
+
+#include "gs-app.h"
+
+G_BEGIN_DECLS
+
+#define GS_TYPE_PREFETCH		(gs_prefetch_get_type ())
+#define GS_PREFETCH(o)			(G_TYPE_CHECK_INSTANCE_CAST ((o), GS_TYPE_PREFETCH, GsPrefetch))
+#define GS_PREFETCH_CLASS(k)		(G_TYPE_CHECK_CLASS_CAST((k), GS_TYPE_PREFETCH, GsPrefetchClass))
+#define GS_IS_PREFETCH(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), GS_TYPE_PREFETCH))
+#define GS_IS_PREFETCH_CLASS(k)		(G_TYPE_CHECK_CLASS_TYPE ((k), GS_TYPE_PREFETCH))
+#define GS_PREFETCH_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), GS_TYPE_PREFETCH, GsPrefetchClass))
+
+typedef struct GsPrefetchPrivate GsPrefetchPrivate;
+
+typedef struct
+{
+	 GObject		 parent;
+	 GsPrefetchPrivate	*priv;
+} GsPrefetch;
+
+typedef struct
+{
+	GObjectClass	parent_class;
+} GsPrefetchClass;
+
+GType		 gs_prefetch_get_type			(void);
+GsPrefetch	*gs_prefetch_new			(void);
+void		 gs_prefetch_add_app			(GsPrefetch		*prefetch,
+							 GsApp			*app,
+							 gint			 scale);
+void		 gs_prefetch_cancel			(GsPrefetch		*prefetch);
+
+G_END_DECLS
+
+#endif /* __GS_PREFETCH_H */
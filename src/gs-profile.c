@@ -21,56 +21,159 @@
 
 #include "config.h"
 
+#include <unistd.h>
 #include <glib/gi18n.h>
 
 #include "gs-cleanup.h"
 #include "gs-profile.h"
 
-struct GsProfilePrivate
-{
-	GPtrArray	*current;
-	GPtrArray	*archived;
-	GMutex		 mutex;
-	GThread		*unthreaded;
-};
+/* completed spans kept for each thread, older ones are overwritten */
+#define GS_PROFILE_RING_SIZE	2048
+
+/* completed spans kept from threads that have exited */
+#define GS_PROFILE_RETIRED_SIZE	8192
 
 typedef struct {
-	gchar		*id;
+	const gchar	*id;		/* interned */
+	const gchar	*parent;	/* interned, or NULL */
 	gint64		 time_start;
 	gint64		 time_stop;
-} GsProfileItem;
+} GsProfileSpan;
+
+typedef struct {
+	GMutex		 mutex;		/* only contended when dumping */
+	gboolean	 main;
+	guint		 tid;
+	GArray		*stack;		/* of GsProfileSpan, still running */
+	GsProfileSpan	 ring[GS_PROFILE_RING_SIZE];
+	guint		 ring_head;
+	guint		 ring_len;
+} GsProfileThread;
+
+typedef struct {
+	guint		 generation;
+	GsProfileThread	*thread;
+} GsProfileThreadRef;
+
+typedef struct {
+	GsProfileSpan	 span;
+	gboolean	 main;
+	guint		 tid;
+} GsProfileEvent;
+
+struct GsProfilePrivate
+{
+	GPtrArray	*threads;	/* of GsProfileThread, still running */
+	GsProfileEvent	*retired;	/* ring of GS_PROFILE_RETIRED_SIZE */
+	guint		 retired_head;
+	guint		 retired_len;
+	GMutex		 mutex;		/* protects @threads and @retired */
+	GThread		*unthreaded;
+	guint		 generation;
+	guint		 next_tid;
+};
 
 G_DEFINE_TYPE_WITH_PRIVATE (GsProfile, gs_profile, G_TYPE_OBJECT)
 
+static void gs_profile_thread_ref_free (GsProfileThreadRef *ref);
+
 static gpointer gs_profile_object = NULL;
+static GsProfile *gs_profile_current = NULL;
+static GMutex gs_profile_current_mutex;
+static gint gs_profile_generation = 0;
+static GPrivate gs_profile_thread_ref = G_PRIVATE_INIT ((GDestroyNotify) gs_profile_thread_ref_free);
 
 /**
- * gs_profile_item_free:
+ * gs_profile_thread_free:
  **/
 static void
-gs_profile_item_free (GsProfileItem *item)
+gs_profile_thread_free (GsProfileThread *thread)
 {
-	g_free (item->id);
-	g_free (item);
+	g_mutex_clear (&thread->mutex);
+	g_array_unref (thread->stack);
+	g_free (thread);
 }
 
 /**
- * gs_profile_item_find:
+ * gs_profile_thread_retire:
+ *
+ * Moves the completed spans of a thread that is exiting into the shared
+ * ring, so that pool threads coming and going do not use more memory.
  **/
-static GsProfileItem *
-gs_profile_item_find (GPtrArray *array, const gchar *id)
+static void
+gs_profile_thread_retire (GsProfile *profile, GsProfileThread *thread)
 {
-	GsProfileItem *tmp;
+	GsProfilePrivate *priv = profile->priv;
+	GsProfileEvent *event;
 	guint i;
+	guint start;
+
+	g_mutex_lock (&priv->mutex);
+	start = (thread->ring_head + GS_PROFILE_RING_SIZE - thread->ring_len) % GS_PROFILE_RING_SIZE;
+	for (i = 0; i < thread->ring_len; i++) {
+		event = &priv->retired[priv->retired_head];
+		event->span = thread->ring[(start + i) % GS_PROFILE_RING_SIZE];
+		event->main = thread->main;
+		event->tid = thread->tid;
+		priv->retired_head = (priv->retired_head + 1) % GS_PROFILE_RETIRED_SIZE;
+		if (priv->retired_len < GS_PROFILE_RETIRED_SIZE)
+			priv->retired_len++;
+	}
+	g_ptr_array_remove (priv->threads, thread);
+	g_mutex_unlock (&priv->mutex);
+}
 
-	g_return_val_if_fail (id != NULL, NULL);
+/**
+ * gs_profile_thread_ref_free:
+ *
+ * Called when a thread that recorded spans exits.
+ **/
+static void
+gs_profile_thread_ref_free (GsProfileThreadRef *ref)
+{
+	/* the buffer is only still around if its profile is */
+	g_mutex_lock (&gs_profile_current_mutex);
+	if (gs_profile_current != NULL &&
+	    gs_profile_current->priv->generation == ref->generation)
+		gs_profile_thread_retire (gs_profile_current, ref->thread);
+	g_mutex_unlock (&gs_profile_current_mutex);
+	g_free (ref);
+}
+
+/**
+ * gs_profile_get_thread:
+ *
+ * Returns the span buffer for the calling thread, creating it on first use.
+ **/
+static GsProfileThread *
+gs_profile_get_thread (GsProfile *profile)
+{
+	GsProfilePrivate *priv = profile->priv;
+	GsProfileThreadRef *ref;
+	GsProfileThread *thread;
 
-	for (i = 0; i < array->len; i++) {
-		tmp = g_ptr_array_index (array, i);
-		if (g_strcmp0 (tmp->id, id) == 0)
-			return tmp;
+	ref = g_private_get (&gs_profile_thread_ref);
+	if (ref == NULL) {
+		ref = g_new0 (GsProfileThreadRef, 1);
+		g_private_set (&gs_profile_thread_ref, ref);
 	}
-	return NULL;
+
+	/* the buffer belongs to the profile object that is alive now */
+	if (ref->generation == priv->generation)
+		return ref->thread;
+
+	thread = g_new0 (GsProfileThread, 1);
+	g_mutex_init (&thread->mutex);
+	thread->main = g_thread_self () == priv->unthreaded;
+	thread->stack = g_array_new (FALSE, FALSE, sizeof (GsProfileSpan));
+	g_mutex_lock (&priv->mutex);
+	thread->tid = priv->next_tid++;
+	g_ptr_array_add (priv->threads, thread);
+	g_mutex_unlock (&priv->mutex);
+
+	ref->generation = priv->generation;
+	ref->thread = thread;
+	return thread;
 }
 
 /**
@@ -79,41 +182,43 @@ gs_profile_item_find (GPtrArray *array, const gchar *id)
 void
 gs_profile_start (GsProfile *profile, const gchar *id)
 {
-	GThread *self;
-	GsProfileItem *item;
-	_cleanup_free_ gchar *id_thr = NULL;
+	GsProfileSpan span;
+	GsProfileSpan *tmp;
+	GsProfileThread *thread;
+	const gchar *id_intern;
+	guint i;
 
 	g_return_if_fail (GS_IS_PROFILE (profile));
 	g_return_if_fail (id != NULL);
 
-	/* only use the thread ID when not using the main thread */
-	self = g_thread_self ();
-	if (self != profile->priv->unthreaded) {
-		id_thr = g_strdup_printf ("%p~%s", self, id);
-	} else {
-		id_thr = g_strdup (id);
-	}
-
-	/* lock */
-	g_mutex_lock (&profile->priv->mutex);
+	id_intern = g_intern_string (id);
+	thread = gs_profile_get_thread (profile);
+	g_mutex_lock (&thread->mutex);
 
 	/* already started */
-	item = gs_profile_item_find (profile->priv->current, id_thr);
-	if (item != NULL) {
-		gs_profile_dump (profile);
-		g_warning ("Already a started task for %s", id_thr);
-		goto out;
+	for (i = 0; i < thread->stack->len; i++) {
+		tmp = &g_array_index (thread->stack, GsProfileSpan, i);
+		if (tmp->id == id_intern) {
+			g_mutex_unlock (&thread->mutex);
+			gs_profile_dump (profile);
+			g_warning ("Already a started task for %s", id);
+			return;
+		}
+	}
+
+	/* nest inside the innermost running span */
+	span.id = id_intern;
+	span.parent = NULL;
+	if (thread->stack->len > 0) {
+		tmp = &g_array_index (thread->stack, GsProfileSpan,
+				      thread->stack->len - 1);
+		span.parent = tmp->id;
 	}
+	span.time_start = g_get_monotonic_time ();
+	span.time_stop = 0;
+	g_array_append_val (thread->stack, span);
 
-	/* add new item */
-	item = g_new0 (GsProfileItem, 1);
-	item->id = g_strdup (id_thr);
-	item->time_start = g_get_real_time ();
-	g_ptr_array_add (profile->priv->current, item);
-	g_debug ("run %s", id_thr);
-out:
-	/* unlock */
-	g_mutex_unlock (&profile->priv->mutex);
+	g_mutex_unlock (&thread->mutex);
 }
 
 /**
@@ -122,46 +227,45 @@ out:
 void
 gs_profile_stop (GsProfile *profile, const gchar *id)
 {
-	GThread *self;
-	GsProfileItem *item;
-	gdouble elapsed_ms;
-	_cleanup_free_ gchar *id_thr = NULL;
+	GsProfileSpan span;
+	GsProfileThread *thread;
+	const gchar *id_intern;
+	gint64 elapsed_ms;
+	guint i;
 
 	g_return_if_fail (GS_IS_PROFILE (profile));
 	g_return_if_fail (id != NULL);
 
-	/* only use the thread ID when not using the main thread */
-	self = g_thread_self ();
-	if (self != profile->priv->unthreaded) {
-		id_thr = g_strdup_printf ("%p~%s", self, id);
-	} else {
-		id_thr = g_strdup (id);
+	id_intern = g_intern_string (id);
+	thread = gs_profile_get_thread (profile);
+	g_mutex_lock (&thread->mutex);
+
+	/* this is nearly always the innermost span */
+	for (i = thread->stack->len; i > 0; i--) {
+		span = g_array_index (thread->stack, GsProfileSpan, i - 1);
+		if (span.id == id_intern)
+			break;
 	}
+	if (i == 0) {
+		g_mutex_unlock (&thread->mutex);
+		g_warning ("Not already a started task for %s", id);
+		return;
+	}
+	g_array_remove_index (thread->stack, i - 1);
 
-	/* lock */
-	g_mutex_lock (&profile->priv->mutex);
+	/* add to the ring buffer */
+	span.time_stop = g_get_monotonic_time ();
+	thread->ring[thread->ring_head] = span;
+	thread->ring_head = (thread->ring_head + 1) % GS_PROFILE_RING_SIZE;
+	if (thread->ring_len < GS_PROFILE_RING_SIZE)
+		thread->ring_len++;
 
-	/* already started */
-	item = gs_profile_item_find (profile->priv->current, id_thr);
-	if (item == NULL) {
-		g_warning ("Not already a started task for %s", id_thr);
-		goto out;
-	}
+	g_mutex_unlock (&thread->mutex);
 
 	/* debug */
-	elapsed_ms = (item->time_stop - item->time_start) / 1000;
+	elapsed_ms = (span.time_stop - span.time_start) / 1000;
 	if (elapsed_ms > 5)
-		g_debug ("%s took %.0fms", id_thr, elapsed_ms);
-
-	/* update */
-	item->time_stop = g_get_real_time ();
-
-	/* move to archive */
-	g_ptr_array_remove (profile->priv->current, item);
-	g_ptr_array_add (profile->priv->archived, item);
-out:
-	/* unlock */
-	g_mutex_unlock (&profile->priv->mutex);
+		g_debug ("%s took %" G_GINT64_FORMAT "ms", id, elapsed_ms);
 }
 
 /**
@@ -170,22 +274,74 @@ out:
 static gint
 gs_profile_sort_cb (gconstpointer a, gconstpointer b)
 {
-	GsProfileItem *item_a = *((GsProfileItem **) a);
-	GsProfileItem *item_b = *((GsProfileItem **) b);
-	if (item_a->time_start < item_b->time_start)
+	const GsProfileEvent *event_a = a;
+	const GsProfileEvent *event_b = b;
+	if (event_a->span.time_start < event_b->span.time_start)
 		return -1;
-	if (item_a->time_start > item_b->time_start)
+	if (event_a->span.time_start > event_b->span.time_start)
 		return 1;
 	return 0;
 }
 
+/**
+ * gs_profile_get_events:
+ *
+ * Returns all the completed and running spans from every thread, sorted
+ * by start time. Running spans have a @time_stop of zero.
+ **/
+static GArray *
+gs_profile_get_events (GsProfile *profile)
+{
+	GsProfileEvent event;
+	GsProfilePrivate *priv = profile->priv;
+	GsProfileThread *thread;
+	GArray *events;
+	guint i;
+	guint j;
+
+	events = g_array_new (FALSE, FALSE, sizeof (GsProfileEvent));
+	g_mutex_lock (&priv->mutex);
+	g_array_append_vals (events, priv->retired, priv->retired_len);
+	for (i = 0; i < priv->threads->len; i++) {
+		thread = g_ptr_array_index (priv->threads, i);
+		event.main = thread->main;
+		event.tid = thread->tid;
+		g_mutex_lock (&thread->mutex);
+		for (j = 0; j < thread->ring_len; j++) {
+			event.span = thread->ring[j];
+			g_array_append_val (events, event);
+		}
+		for (j = 0; j < thread->stack->len; j++) {
+			event.span = g_array_index (thread->stack, GsProfileSpan, j);
+			g_array_append_val (events, event);
+		}
+		g_mutex_unlock (&thread->mutex);
+	}
+	g_mutex_unlock (&priv->mutex);
+	g_array_sort (events, gs_profile_sort_cb);
+	return events;
+}
+
+/**
+ * gs_profile_event_get_name:
+ **/
+static gchar *
+gs_profile_event_get_name (GsProfile *profile, GsProfileEvent *event)
+{
+	/* only use the thread ID when not using the main thread */
+	if (!event->main)
+		return g_strdup_printf ("%u~%s", event->tid, event->span.id);
+	return g_strdup (event->span.id);
+}
+
 /**
  * gs_profile_dump:
  **/
 void
 gs_profile_dump (GsProfile *profile)
 {
-	GsProfileItem *item;
+	GsProfileEvent *event;
+	gint64 now;
 	gint64 time_start = G_MAXINT64;
 	gint64 time_stop = 0;
 	gint64 time_ms;
@@ -195,35 +351,39 @@ gs_profile_dump (GsProfile *profile)
 	gdouble scale;
 	guint bar_offset;
 	guint bar_length;
+	_cleanup_array_unref_ GArray *events = NULL;
 
 	g_return_if_fail (GS_IS_PROFILE (profile));
 
-	/* nothing to show */
-	if (profile->priv->archived->len == 0)
-		return;
-
 	/* get the start and end times */
-	for (i = 0; i < profile->priv->archived->len; i++) {
-		item = g_ptr_array_index (profile->priv->archived, i);
-		if (item->time_start < time_start)
-			time_start = item->time_start;
-		if (item->time_stop > time_stop)
-			time_stop = item->time_stop;
+	events = gs_profile_get_events (profile);
+	for (i = 0; i < events->len; i++) {
+		event = &g_array_index (events, GsProfileEvent, i);
+		if (event->span.time_stop == 0)
+			continue;
+		if (event->span.time_start < time_start)
+			time_start = event->span.time_start;
+		if (event->span.time_stop > time_stop)
+			time_stop = event->span.time_stop;
 	}
-	scale = (gdouble) console_width / (gdouble) ((time_stop - time_start) / 1000);
 
-	/* sort the list */
-	g_ptr_array_sort (profile->priv->archived, gs_profile_sort_cb);
+	/* nothing to show */
+	if (time_stop == 0)
+		return;
+	scale = (gdouble) console_width / (gdouble) ((time_stop - time_start) / 1000);
 
 	/* dump a list of what happened when */
-	for (i = 0; i < profile->priv->archived->len; i++) {
-		item = g_ptr_array_index (profile->priv->archived, i);
-		time_ms = (item->time_stop - item->time_start) / 1000;
+	for (i = 0; i < events->len; i++) {
+		_cleanup_free_ gchar *name = NULL;
+		event = &g_array_index (events, GsProfileEvent, i);
+		if (event->span.time_stop == 0)
+			continue;
+		time_ms = (event->span.time_stop - event->span.time_start) / 1000;
 		if (time_ms < 5)
 			continue;
 
 		/* print a timechart of what we've done */
-		bar_offset = scale * (item->time_start - time_start) / 1000;
+		bar_offset = scale * (event->span.time_start - time_start) / 1000;
 		for (j = 0; j < bar_offset; j++)
 			g_print (" ");
 		bar_length = scale * time_ms;
@@ -234,22 +394,122 @@ gs_profile_dump (GsProfile *profile)
 		for (j = bar_offset + bar_length; j < console_width + 1; j++)
 			g_print (" ");
 		g_print ("@%04" G_GINT64_FORMAT "ms ",
-			 (item->time_stop - time_start) / 1000);
-		g_print ("%s %" G_GINT64_FORMAT "ms\n", item->id, time_ms);
+			 (event->span.time_stop - time_start) / 1000);
+		name = gs_profile_event_get_name (profile, event);
+		g_print ("%s %" G_GINT64_FORMAT "ms\n", name, time_ms);
 	}
 
 	/* not all complete */
-	if (profile->priv->current->len > 0) {
-		for (i = 0; i < profile->priv->current->len; i++) {
-			item = g_ptr_array_index (profile->priv->current, i);
-			item->time_stop = g_get_real_time ();
-			for (j = 0; j < console_width; j++)
-				g_print ("$");
-			time_ms = (item->time_stop - item->time_start) / 1000;
-			g_print (" @????ms %s %" G_GINT64_FORMAT "ms\n",
-				 item->id, time_ms);
+	now = g_get_monotonic_time ();
+	for (i = 0; i < events->len; i++) {
+		_cleanup_free_ gchar *name = NULL;
+		event = &g_array_index (events, GsProfileEvent, i);
+		if (event->span.time_stop != 0)
+			continue;
+		for (j = 0; j < console_width; j++)
+			g_print ("$");
+		time_ms = (now - event->span.time_start) / 1000;
+		name = gs_profile_event_get_name (profile, event);
+		g_print (" @????ms %s %" G_GINT64_FORMAT "ms\n", name, time_ms);
+	}
+}
+
+/**
+ * gs_profile_json_append_string:
+ **/
+static void
+gs_profile_json_append_string (GString *str, const gchar *value)
+{
+	const gchar *tmp;
+
+	g_string_append_c (str, '"');
+	for (tmp = value; *tmp != '\0'; tmp++) {
+		if (*tmp == '"' || *tmp == '\\')
+			g_string_append_printf (str, "\\%c", *tmp);
+		else if ((guchar) *tmp < 0x20)
+			g_string_append_printf (str, "\\u%04x", (guint) *tmp);
+		else
+			g_string_append_c (str, *tmp);
+	}
+	g_string_append_c (str, '"');
+}
+
+/**
+ * gs_profile_export_trace:
+ *
+ * Saves all the spans in the Chrome trace event JSON format, which can be
+ * loaded into chrome://tracing or https://ui.perfetto.dev/ to show what
+ * each thread was doing on a timeline.
+ **/
+gboolean
+gs_profile_export_trace (GsProfile *profile, const gchar *filename, GError **error)
+{
+	GsProfileEvent *event;
+	gint64 now;
+	gint64 time_start = G_MAXINT64;
+	gint64 time_stop;
+	gint pid;
+	guint i;
+	_cleanup_array_unref_ GArray *events = NULL;
+	_cleanup_hashtable_unref_ GHashTable *tids = NULL;
+	_cleanup_string_free_ GString *str = NULL;
+
+	g_return_val_if_fail (GS_IS_PROFILE (profile), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	events = gs_profile_get_events (profile);
+	if (events->len > 0) {
+		event = &g_array_index (events, GsProfileEvent, 0);
+		time_start = event->span.time_start;
+	}
+	now = g_get_monotonic_time ();
+	pid = getpid ();
+
+	str = g_string_new ("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	g_string_append_printf (str,
+				"\n{\"name\":\"process_name\",\"ph\":\"M\","
+				"\"pid\":%i,\"args\":{\"name\":\"gnome-software\"}}",
+				pid);
+
+	/* name the threads, including the ones that have exited */
+	tids = g_hash_table_new (g_direct_hash, g_direct_equal);
+	for (i = 0; i < events->len; i++) {
+		event = &g_array_index (events, GsProfileEvent, i);
+		if (g_hash_table_contains (tids, GUINT_TO_POINTER (event->tid)))
+			continue;
+		g_hash_table_add (tids, GUINT_TO_POINTER (event->tid));
+		g_string_append_printf (str,
+					",\n{\"name\":\"thread_name\",\"ph\":\"M\","
+					"\"pid\":%i,\"tid\":%u,\"args\":{\"name\":\"%s%u\"}}",
+					pid, event->tid,
+					event->main ? "main-" : "worker-",
+					event->tid);
+	}
+
+	/* each span is a complete event, which nest by time on each thread */
+	for (i = 0; i < events->len; i++) {
+		event = &g_array_index (events, GsProfileEvent, i);
+		time_stop = event->span.time_stop != 0 ? event->span.time_stop : now;
+		g_string_append (str, ",\n{\"name\":");
+		gs_profile_json_append_string (str, event->span.id);
+		g_string_append_printf (str,
+					",\"cat\":\"gnome-software\",\"ph\":\"X\","
+					"\"pid\":%i,\"tid\":%u,"
+					"\"ts\":%" G_GINT64_FORMAT ","
+					"\"dur\":%" G_GINT64_FORMAT,
+					pid, event->tid,
+					event->span.time_start - time_start,
+					time_stop - event->span.time_start);
+		if (event->span.parent != NULL) {
+			g_string_append (str, ",\"args\":{\"parent\":");
+			gs_profile_json_append_string (str, event->span.parent);
+			g_string_append_c (str, '}');
 		}
+		g_string_append_c (str, '}');
 	}
+	g_string_append (str, "\n]}\n");
+
+	return g_file_set_contents (filename, str->str, str->len, error);
 }
 
 /**
@@ -261,9 +521,15 @@ gs_profile_finalize (GObject *object)
 	GsProfile *profile = GS_PROFILE (object);
 	GsProfilePrivate *priv = profile->priv;
 
-	g_ptr_array_foreach (priv->current, (GFunc) gs_profile_item_free, NULL);
-	g_ptr_array_unref (priv->current);
-	g_ptr_array_unref (priv->archived);
+	/* threads exiting from now on have nothing to retire into */
+	g_mutex_lock (&gs_profile_current_mutex);
+	if (gs_profile_current == profile)
+		gs_profile_current = NULL;
+	g_mutex_unlock (&gs_profile_current_mutex);
+
+	g_ptr_array_unref (priv->threads);
+	g_free (priv->retired);
+	g_mutex_clear (&priv->mutex);
 
 	G_OBJECT_CLASS (gs_profile_parent_class)->finalize (object);
 }
@@ -285,10 +551,14 @@ static void
 gs_profile_init (GsProfile *profile)
 {
 	profile->priv = gs_profile_get_instance_private (profile);
-	profile->priv->current = g_ptr_array_new ();
+	profile->priv->threads = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_profile_thread_free);
 	profile->priv->unthreaded = g_thread_self ();
-	profile->priv->archived = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_profile_item_free);
+	profile->priv->retired = g_new0 (GsProfileEvent, GS_PROFILE_RETIRED_SIZE);
+	profile->priv->generation = g_atomic_int_add (&gs_profile_generation, 1) + 1;
 	g_mutex_init (&profile->priv->mutex);
+	g_mutex_lock (&gs_profile_current_mutex);
+	gs_profile_current = profile;
+	g_mutex_unlock (&gs_profile_current_mutex);
 }
 
 /**
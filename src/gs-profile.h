@@ -54,6 +54,9 @@ void		 gs_profile_start		(GsProfile	*profile,
 void		 gs_profile_stop		(GsProfile	*profile,
 						 const gchar	*id);
 void		 gs_profile_dump		(GsProfile	*profile);
+gboolean	 gs_profile_export_trace	(GsProfile	*profile,
+						 const gchar	*filename,
+						 GError		**error);
 
 G_END_DECLS
 
@@ -29,10 +29,13 @@
 #include <libgnome-desktop/gnome-bg.h>
 #include <libgnome-desktop/gnome-desktop-thumbnail.h>
 
+#include "gs-cache.h"
 #include "gs-cleanup.h"
 #include "gs-screenshot-image.h"
 #include "gs-utils.h"
 
+typedef struct _GsScreenshotImageStream GsScreenshotImageStream;
+
 struct _GsScreenshotImagePrivate
 {
 	AsScreenshot	*screenshot;
@@ -43,10 +46,15 @@ struct _GsScreenshotImagePrivate
 	GtkWidget	*label_error;
 	SoupSession	*session;
 	SoupMessage	*message;
+	GCancellable	*cancellable;
 	gchar		*cachedir;
 	gchar		*filename;
 	const gchar	*current_image;
 	gboolean	 use_desktop_background;
+	gboolean	 revalidating;
+	GsScreenshotImageStream	*stream;	/* the download being decoded */
+	guint		 generation;		/* of the last decode started */
+	guint		 generation_shown;	/* of the last decode shown */
 	guint		 width;
 	guint		 height;
 	gint		 scale;
@@ -86,101 +94,150 @@ gs_screenshot_image_set_error (GsScreenshotImage *ssimg, const gchar *message)
 		gtk_widget_show (priv->label_error);
 }
 
+/* shared by all the screenshot widgets; the settings and the monitor are
+ * only used from the main thread, the rest is rendered in a worker thread
+ * and is only used with bg_mutex held */
+static GSettings *bg_settings = NULL;
+static GnomeBG *bg_bg = NULL;
+static GnomeDesktopThumbnailFactory *bg_factory = NULL;
+static GFileMonitor *bg_monitor = NULL;
+static GHashTable *bg_cache = NULL;
+static GdkScreen *bg_screen = NULL;
+static GMutex bg_mutex;
+
 /**
- * gs_screenshot_image_get_desktop_pixbuf:
+ * gs_screenshot_image_bg_file_changed_cb:
+ *
+ * The wallpaper file may be replaced without the setting changing.
  **/
-static GdkPixbuf *
-gs_screenshot_image_get_desktop_pixbuf (GsScreenshotImage *ssimg)
+static void
+gs_screenshot_image_bg_file_changed_cb (GFileMonitor *monitor,
+					GFile *file,
+					GFile *other_file,
+					GFileMonitorEvent event_type,
+					gpointer user_data)
 {
-	GsScreenshotImagePrivate *priv;
-	_cleanup_object_unref_ GnomeBG *bg = NULL;
-	_cleanup_object_unref_ GnomeDesktopThumbnailFactory *factory = NULL;
-	_cleanup_object_unref_ GSettings *settings = NULL;
+	g_mutex_lock (&bg_mutex);
+	g_hash_table_remove_all (bg_cache);
+	g_mutex_unlock (&bg_mutex);
+}
 
-	priv = gs_screenshot_image_get_instance_private (ssimg);
+/**
+ * gs_screenshot_image_bg_load:
+ **/
+static void
+gs_screenshot_image_bg_load (GSettings *settings)
+{
+	_cleanup_free_ gchar *uri = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
+
+	g_mutex_lock (&bg_mutex);
+	g_hash_table_remove_all (bg_cache);
+	gnome_bg_load_from_preferences (bg_bg, settings);
+	g_mutex_unlock (&bg_mutex);
+
+	/* watch the file rather than checking it for every screenshot */
+	if (bg_monitor != NULL) {
+		g_file_monitor_cancel (bg_monitor);
+		g_clear_object (&bg_monitor);
+	}
+	uri = g_settings_get_string (settings, "picture-uri");
+	if (uri == NULL || uri[0] == '\0')
+		return;
+	file = g_file_new_for_uri (uri);
+	bg_monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE, NULL, NULL);
+	if (bg_monitor == NULL)
+		return;
+	g_signal_connect (bg_monitor, "changed",
+			  G_CALLBACK (gs_screenshot_image_bg_file_changed_cb), NULL);
+}
 
-	factory = gnome_desktop_thumbnail_factory_new (GNOME_DESKTOP_THUMBNAIL_SIZE_LARGE);
-	bg = gnome_bg_new ();
-	settings = g_settings_new ("org.gnome.desktop.background");
-	gnome_bg_load_from_preferences (bg, settings);
-	return gnome_bg_create_thumbnail (bg, factory,
-					  gdk_screen_get_default (),
-					  priv->width, priv->height);
+/**
+ * gs_screenshot_image_bg_changed_cb:
+ **/
+static void
+gs_screenshot_image_bg_changed_cb (GSettings *settings,
+				   const gchar *key,
+				   gpointer user_data)
+{
+	gs_screenshot_image_bg_load (settings);
 }
 
 /**
- * gs_screenshot_image_use_desktop_background:
+ * gs_screenshot_image_bg_setup:
+ *
+ * Sets up the shared state the first time, from the main thread.
  **/
-static gboolean
-gs_screenshot_image_use_desktop_background (GsScreenshotImage *ssimg, GdkPixbuf *pixbuf)
+static void
+gs_screenshot_image_bg_setup (void)
 {
-	GsScreenshotImagePrivate *priv = gs_screenshot_image_get_instance_private (ssimg);
-	_cleanup_object_unref_ AsImage *im = NULL;
+	if (bg_cache != NULL)
+		return;
+	bg_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+					  g_free, (GDestroyNotify) g_object_unref);
+	bg_factory = gnome_desktop_thumbnail_factory_new (GNOME_DESKTOP_THUMBNAIL_SIZE_LARGE);
+	bg_bg = gnome_bg_new ();
+	bg_screen = gdk_screen_get_default ();
+	bg_settings = g_settings_new ("org.gnome.desktop.background");
+	gs_screenshot_image_bg_load (bg_settings);
+	g_signal_connect (bg_settings, "changed",
+			  G_CALLBACK (gs_screenshot_image_bg_changed_cb), NULL);
+}
 
-	/* nothing to show, means no background mode */
-	if (pixbuf == NULL)
-		return FALSE;
-	/* background mode explicitly disabled */
-	if (!priv->use_desktop_background)
-		return FALSE;
+/**
+ * gs_screenshot_image_get_desktop_pixbuf:
+ *
+ * Returns the desktop background rendered at the widget size. The
+ * thumbnail is shared between widgets and must not be modified.
+ * This is safe to call from a thread once the shared state is set up.
+ **/
+static GdkPixbuf *
+gs_screenshot_image_get_desktop_pixbuf (guint width, guint height)
+{
+	GdkPixbuf *pixbuf;
+	_cleanup_free_ gchar *key = NULL;
+
+	/* the table is cleared when the setting or the file changes */
+	key = g_strdup_printf ("%ux%u", width, height);
+	g_mutex_lock (&bg_mutex);
+	pixbuf = g_hash_table_lookup (bg_cache, key);
+	if (pixbuf != NULL) {
+		g_object_ref (pixbuf);
+		g_mutex_unlock (&bg_mutex);
+		return pixbuf;
+	}
 
-	/* use a temp AsImage */
-	im = as_image_new ();
-	as_image_set_pixbuf (im, pixbuf);
-	return (as_image_get_alpha_flags (im) & AS_IMAGE_ALPHA_FLAG_INTERNAL) > 0;
+	/* render and save for next time; this only reads the screen size */
+	pixbuf = gnome_bg_create_thumbnail (bg_bg, bg_factory, bg_screen,
+					    width, height);
+	if (pixbuf != NULL)
+		g_hash_table_insert (bg_cache, g_strdup (key), g_object_ref (pixbuf));
+	g_mutex_unlock (&bg_mutex);
+	return pixbuf;
 }
 
 /**
  * as_screenshot_show_image:
  **/
 static void
-as_screenshot_show_image (GsScreenshotImage *ssimg)
+as_screenshot_show_image (GsScreenshotImage *ssimg, GdkPixbuf *pixbuf)
 {
 	GsScreenshotImagePrivate *priv;
-	_cleanup_object_unref_ GdkPixbuf *pixbuf_bg = NULL;
-	_cleanup_object_unref_ GdkPixbuf *pixbuf = NULL;
 
 	priv = gs_screenshot_image_get_instance_private (ssimg);
 
-	/* no need to composite */
-	if (priv->width == G_MAXUINT || priv->height == G_MAXUINT) {
-		pixbuf_bg = gdk_pixbuf_new_from_file (priv->filename, NULL);
-	} else {
-		/* this is always going to have alpha */
-		pixbuf = gdk_pixbuf_new_from_file_at_scale (priv->filename,
-							    priv->width * priv->scale,
-							    priv->height * priv->scale,
-							    FALSE, NULL);
-		if (pixbuf != NULL) {
-			if (gs_screenshot_image_use_desktop_background (ssimg, pixbuf)) {
-				pixbuf_bg = gs_screenshot_image_get_desktop_pixbuf (ssimg);
-				if (pixbuf_bg == NULL) {
-					pixbuf_bg = g_object_ref (pixbuf);
-				} else {
-					gdk_pixbuf_composite (pixbuf, pixbuf_bg,
-							      0, 0,
-							      priv->width, priv->height,
-							      0, 0, 1.0f, 1.0f,
-							      GDK_INTERP_NEAREST, 255);
-				}
-			} else {
-				pixbuf_bg = g_object_ref (pixbuf);
-			}
-		}
-	}
-
 	/* show icon */
 	if (g_strcmp0 (priv->current_image, "image1") == 0) {
-		if (pixbuf_bg != NULL) {
+		if (pixbuf != NULL) {
 			gs_image_set_from_pixbuf_with_scale (GTK_IMAGE (priv->image2),
-							     pixbuf_bg, priv->scale);
+							     pixbuf, priv->scale);
 		}
 		gtk_stack_set_visible_child_name (GTK_STACK (priv->stack), "image2");
 		priv->current_image = "image2";
 	} else {
-		if (pixbuf_bg != NULL) {
+		if (pixbuf != NULL) {
 			gs_image_set_from_pixbuf_with_scale (GTK_IMAGE (priv->image1),
-							     pixbuf_bg, priv->scale);
+							     pixbuf, priv->scale);
 		}
 		gtk_stack_set_visible_child_name (GTK_STACK (priv->stack), "image1");
 		priv->current_image = "image1";
@@ -222,78 +279,596 @@ gs_screenshot_image_show_blurred (GsScreenshotImage *ssimg,
 	}
 }
 
+typedef struct {
+	SoupMessage	*msg;			/* NULL when loading from cache */
+	gchar		*filename;
+	guint		 generation;
+	guint		 width;			/* in device pixels, or G_MAXUINT */
+	guint		 height;
+	gboolean	 check_alpha;
+	gboolean	 has_alpha;		/* out */
+	GdkPixbuf	*pixbuf_bg;		/* shared, do not modify */
+	GdkPixbuf	*pixbuf;		/* out */
+} GsScreenshotImageHelper;
+
 /**
- * gs_screenshot_image_complete_cb:
+ * gs_screenshot_image_helper_free:
  **/
 static void
-gs_screenshot_image_complete_cb (SoupSession *session,
-				 SoupMessage *msg,
-				 gpointer user_data)
+gs_screenshot_image_helper_free (GsScreenshotImageHelper *helper)
 {
-	_cleanup_object_unref_ GsScreenshotImage *ssimg = GS_SCREENSHOT_IMAGE (user_data);
-	GsScreenshotImagePrivate *priv = gs_screenshot_image_get_instance_private (ssimg);
-	gboolean ret;
-	_cleanup_error_free_ GError *error = NULL;
+	if (helper->msg != NULL)
+		g_object_unref (helper->msg);
+	if (helper->pixbuf_bg != NULL)
+		g_object_unref (helper->pixbuf_bg);
+	if (helper->pixbuf != NULL)
+		g_object_unref (helper->pixbuf);
+	g_free (helper->filename);
+	g_slice_free (GsScreenshotImageHelper, helper);
+}
+
+/**
+ * gs_screenshot_image_save_pixbuf:
+ *
+ * Scales and pads the decoded @pixbuf to the requested size and writes
+ * the cache file, or just writes @data if no padding is needed.
+ **/
+static GdkPixbuf *
+gs_screenshot_image_save_pixbuf (GdkPixbuf *pixbuf,
+				 const gchar *data,
+				 gsize len,
+				 const gchar *filename,
+				 guint width,
+				 guint height,
+				 GError **error)
+{
+	gsize buf_len;
+	_cleanup_free_ gchar *buf = NULL;
 	_cleanup_object_unref_ AsImage *im = NULL;
+	_cleanup_object_unref_ GdkPixbuf *pixbuf_new = NULL;
+
+	/* is image size destination size unknown or exactly the correct size */
+	if (width == G_MAXUINT || height == G_MAXUINT ||
+	    (width == (guint) gdk_pixbuf_get_width (pixbuf) &&
+	     height == (guint) gdk_pixbuf_get_height (pixbuf))) {
+		if (!g_file_set_contents (filename, data, len, error))
+			return NULL;
+		return g_object_ref (pixbuf);
+	}
+
+	/* pad using the same code as the AppStream builder so the preview
+	 * looks the same */
+	im = as_image_new ();
+	as_image_set_pixbuf (im, pixbuf);
+	pixbuf_new = as_image_save_pixbuf (im,
+					   width,
+					   height,
+					   AS_IMAGE_SAVE_FLAG_PAD_16_9);
+	if (pixbuf_new == NULL) {
+		g_set_error_literal (error,
+				     GDK_PIXBUF_ERROR,
+				     GDK_PIXBUF_ERROR_FAILED,
+				     "failed to pad image");
+		return NULL;
+	}
+	if (!gdk_pixbuf_save_to_buffer (pixbuf_new, &buf, &buf_len, "png", error, NULL))
+		return NULL;
+	if (!g_file_set_contents (filename, buf, buf_len, error))
+		return NULL;
+	return g_object_ref (pixbuf_new);
+}
+
+/**
+ * gs_screenshot_image_loader_get_pixbuf:
+ **/
+static GdkPixbuf *
+gs_screenshot_image_loader_get_pixbuf (GdkPixbufLoader *loader, GError **error)
+{
+	GdkPixbuf *pixbuf;
+
+	if (!gdk_pixbuf_loader_close (loader, error))
+		return NULL;
+	pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+	if (pixbuf == NULL) {
+		g_set_error_literal (error,
+				     GDK_PIXBUF_ERROR,
+				     GDK_PIXBUF_ERROR_CORRUPT_IMAGE,
+				     "no image data");
+		return NULL;
+	}
+	return g_object_ref (pixbuf);
+}
+
+/**
+ * gs_screenshot_image_save_data:
+ * @buffer: the downloaded data
+ * @filename: the cache filename
+ * @width: the width in device pixels, or %G_MAXUINT
+ * @height: the height in device pixels, or %G_MAXUINT
+ * @error: a #GError, or %NULL
+ *
+ * Decodes the downloaded data, scales and pads it to the requested size and
+ * writes the cache file, all in one pass. This is safe to call from a thread.
+ *
+ * Returns: (transfer full): the pixbuf that was saved, or %NULL
+ **/
+GdkPixbuf *
+gs_screenshot_image_save_data (SoupBuffer *buffer,
+			       const gchar *filename,
+			       guint width,
+			       guint height,
+			       GError **error)
+{
 	_cleanup_object_unref_ GdkPixbuf *pixbuf = NULL;
-	_cleanup_object_unref_ GInputStream *stream = NULL;
+	_cleanup_object_unref_ GdkPixbufLoader *loader = NULL;
 
-	/* return immediately if the message was cancelled or if we're in destruction */
-	if (msg->status_code == SOUP_STATUS_CANCELLED || priv->session == NULL)
+	/* load the image */
+	loader = gdk_pixbuf_loader_new ();
+	if (!gdk_pixbuf_loader_write (loader,
+				      (const guchar *) buffer->data,
+				      buffer->length,
+				      error)) {
+		gdk_pixbuf_loader_close (loader, NULL);
+		return NULL;
+	}
+	pixbuf = gs_screenshot_image_loader_get_pixbuf (loader, error);
+	if (pixbuf == NULL)
+		return NULL;
+	return gs_screenshot_image_save_pixbuf (pixbuf,
+						buffer->data,
+						buffer->length,
+						filename,
+						width,
+						height,
+						error);
+}
+
+/**
+ * gs_screenshot_image_helper_check_alpha:
+ **/
+static void
+gs_screenshot_image_helper_check_alpha (GsScreenshotImageHelper *helper)
+{
+	_cleanup_object_unref_ AsImage *im = NULL;
+
+	/* the background is only rendered if the image is transparent */
+	if (!helper->check_alpha)
 		return;
+	im = as_image_new ();
+	as_image_set_pixbuf (im, helper->pixbuf);
+	helper->has_alpha = (as_image_get_alpha_flags (im) & AS_IMAGE_ALPHA_FLAG_INTERNAL) > 0;
+}
 
-	if (msg->status_code != SOUP_STATUS_OK) {
-		/* TRANSLATORS: this is when we try to download a screenshot and
-		 * we get back 404 */
-		gs_screenshot_image_set_error (ssimg, _("Screenshot not found"));
-		gtk_widget_hide (GTK_WIDGET (ssimg));
+/**
+ * gs_screenshot_image_decode_thread_cb:
+ **/
+static void
+gs_screenshot_image_decode_thread_cb (GTask *task,
+				      gpointer object,
+				      gpointer task_data,
+				      GCancellable *cancellable)
+{
+	GError *error = NULL;
+	GsScreenshotImageHelper *helper = (GsScreenshotImageHelper *) task_data;
+
+	if (helper->width == G_MAXUINT || helper->height == G_MAXUINT) {
+		/* no need to composite */
+		helper->pixbuf = gdk_pixbuf_new_from_file (helper->filename, &error);
+	} else {
+		helper->pixbuf = gdk_pixbuf_new_from_file_at_scale (helper->filename,
+								    helper->width,
+								    helper->height,
+								    FALSE, &error);
+	}
+	if (helper->pixbuf == NULL) {
+		g_task_return_error (task, error);
 		return;
 	}
+	gs_screenshot_image_helper_check_alpha (helper);
+	g_task_return_boolean (task, TRUE);
+}
 
-	/* create a buffer with the data */
-	stream = g_memory_input_stream_new_from_data (msg->response_body->data,
-						      msg->response_body->length,
-						      NULL);
-	if (stream == NULL)
-		return;
+/* the chunks of a download, which are decoded in order as they arrive */
+struct _GsScreenshotImageStream {
+	GTask			*task;
+	GdkPixbufLoader		*loader;
+	GString			*data;		/* saved as-is if not padded */
+	GError			*error;		/* from writing a chunk */
+	gboolean		 abort;
+};
 
-	/* load the image */
-	pixbuf = gdk_pixbuf_new_from_stream (stream, NULL, NULL);
+typedef struct {
+	GsScreenshotImageStream	*stream;
+	SoupBuffer		*buffer;	/* NULL when finished */
+} GsScreenshotImageChunk;
+
+static GThreadPool *stream_pool = NULL;
+
+/**
+ * gs_screenshot_image_stream_free:
+ **/
+static void
+gs_screenshot_image_stream_free (GsScreenshotImageStream *stream)
+{
+	g_object_unref (stream->task);
+	g_object_unref (stream->loader);
+	g_string_free (stream->data, TRUE);
+	g_clear_error (&stream->error);
+	g_slice_free (GsScreenshotImageStream, stream);
+}
+
+/**
+ * gs_screenshot_image_stream_finish:
+ *
+ * Finishes decoding once the last chunk has been written.
+ **/
+static void
+gs_screenshot_image_stream_finish (GsScreenshotImageStream *stream)
+{
+	GError *error = NULL;
+	GsScreenshotImageHelper *helper = g_task_get_task_data (stream->task);
+	_cleanup_object_unref_ GdkPixbuf *pixbuf = NULL;
+
+	/* the download failed, which the caller shows */
+	if (stream->abort) {
+		gdk_pixbuf_loader_close (stream->loader, NULL);
+		g_task_return_new_error (stream->task,
+					 G_IO_ERROR,
+					 G_IO_ERROR_CANCELLED,
+					 "download did not complete");
+		return;
+	}
+	if (g_task_return_error_if_cancelled (stream->task)) {
+		gdk_pixbuf_loader_close (stream->loader, NULL);
+		return;
+	}
+	if (stream->error != NULL) {
+		gdk_pixbuf_loader_close (stream->loader, NULL);
+		g_task_return_error (stream->task, stream->error);
+		stream->error = NULL;
+		return;
+	}
+	pixbuf = gs_screenshot_image_loader_get_pixbuf (stream->loader, &error);
 	if (pixbuf == NULL) {
-		/* TRANSLATORS: possibly image file corrupt or not an image */
-		gs_screenshot_image_set_error (ssimg, _("Failed to load image"));
+		g_task_return_error (stream->task, error);
 		return;
 	}
+	helper->pixbuf = gs_screenshot_image_save_pixbuf (pixbuf,
+							  stream->data->str,
+							  stream->data->len,
+							  helper->filename,
+							  helper->width,
+							  helper->height,
+							  &error);
+	if (helper->pixbuf == NULL) {
+		g_task_return_error (stream->task, error);
+		return;
+	}
+	gs_screenshot_image_helper_check_alpha (helper);
+	g_task_return_boolean (stream->task, TRUE);
+}
 
-	/* is image size destination size unknown or exactly the correct size */
-	if (priv->width == G_MAXUINT || priv->height == G_MAXUINT ||
-	    (priv->width * priv->scale == (guint) gdk_pixbuf_get_width (pixbuf) &&
-	     priv->height * priv->scale == (guint) gdk_pixbuf_get_height (pixbuf))) {
-		ret = g_file_set_contents (priv->filename,
-					   msg->response_body->data,
-					   msg->response_body->length,
-					   &error);
-		if (!ret) {
-			gs_screenshot_image_set_error (ssimg, error->message);
-			return;
-		}
+/**
+ * gs_screenshot_image_stream_pool_cb:
+ *
+ * The pool only has one thread, so the chunks are written in order.
+ **/
+static void
+gs_screenshot_image_stream_pool_cb (gpointer data, gpointer user_data)
+{
+	GsScreenshotImageChunk *chunk = (GsScreenshotImageChunk *) data;
+	GsScreenshotImageStream *stream = chunk->stream;
+
+	if (chunk->buffer == NULL) {
+		gs_screenshot_image_stream_finish (stream);
+		gs_screenshot_image_stream_free (stream);
 	} else {
-		/* save to file, using the same code as the AppStream builder
-		 * so the preview looks the same */
-		im = as_image_new ();
-		as_image_set_pixbuf (im, pixbuf);
-		ret = as_image_save_filename (im, priv->filename,
-					      priv->width * priv->scale,
-					      priv->height * priv->scale,
-					      AS_IMAGE_SAVE_FLAG_PAD_16_9, &error);
-		if (!ret) {
-			gs_screenshot_image_set_error (ssimg, error->message);
+		if (stream->error == NULL &&
+		    !g_cancellable_is_cancelled (g_task_get_cancellable (stream->task))) {
+			gdk_pixbuf_loader_write (stream->loader,
+						 (const guchar *) chunk->buffer->data,
+						 chunk->buffer->length,
+						 &stream->error);
+			g_string_append_len (stream->data,
+					     chunk->buffer->data,
+					     chunk->buffer->length);
+		}
+		soup_buffer_free (chunk->buffer);
+	}
+	g_slice_free (GsScreenshotImageChunk, chunk);
+}
+
+/**
+ * gs_screenshot_image_stream_push:
+ **/
+static void
+gs_screenshot_image_stream_push (GsScreenshotImageStream *stream, SoupBuffer *buffer)
+{
+	GsScreenshotImageChunk *chunk;
+
+	if (stream_pool == NULL) {
+		stream_pool = g_thread_pool_new (gs_screenshot_image_stream_pool_cb,
+						 NULL, 1, FALSE, NULL);
+	}
+	chunk = g_slice_new (GsScreenshotImageChunk);
+	chunk->stream = stream;
+	chunk->buffer = buffer;
+	g_thread_pool_push (stream_pool, chunk, NULL);
+}
+
+/**
+ * gs_screenshot_image_composite_thread_cb:
+ **/
+static void
+gs_screenshot_image_composite_thread_cb (GTask *task,
+					 gpointer object,
+					 gpointer task_data,
+					 GCancellable *cancellable)
+{
+	GsScreenshotImageHelper *helper = (GsScreenshotImageHelper *) task_data;
+	GdkPixbuf *pixbuf;
+
+	/* show the image without the background if it cannot be rendered */
+	helper->pixbuf_bg = gs_screenshot_image_get_desktop_pixbuf (helper->width,
+								    helper->height);
+	if (helper->pixbuf_bg == NULL) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	/* the shared background is never modified */
+	pixbuf = gdk_pixbuf_copy (helper->pixbuf_bg);
+	gdk_pixbuf_composite (helper->pixbuf, pixbuf,
+			      0, 0,
+			      MIN (gdk_pixbuf_get_width (pixbuf),
+				   gdk_pixbuf_get_width (helper->pixbuf)),
+			      MIN (gdk_pixbuf_get_height (pixbuf),
+				   gdk_pixbuf_get_height (helper->pixbuf)),
+			      0, 0, 1.0f, 1.0f,
+			      GDK_INTERP_NEAREST, 255);
+	g_object_unref (helper->pixbuf);
+	helper->pixbuf = pixbuf;
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * gs_screenshot_image_show_decoded:
+ *
+ * The cached copy and the download can be decoded at the same time, so
+ * this never replaces a newer image with an older one.
+ **/
+static void
+gs_screenshot_image_show_decoded (GsScreenshotImage *ssimg,
+				  GsScreenshotImageHelper *helper)
+{
+	GsScreenshotImagePrivate *priv = gs_screenshot_image_get_instance_private (ssimg);
+
+	if (helper->generation < priv->generation_shown)
+		return;
+	priv->generation_shown = helper->generation;
+	as_screenshot_show_image (ssimg, helper->pixbuf);
+}
+
+/**
+ * gs_screenshot_image_composite_cb:
+ **/
+static void
+gs_screenshot_image_composite_cb (GObject *source_object,
+				  GAsyncResult *res,
+				  gpointer user_data)
+{
+	GsScreenshotImage *ssimg = GS_SCREENSHOT_IMAGE (source_object);
+	GsScreenshotImageHelper *helper;
+	GTask *task = G_TASK (res);
+
+	/* superseded by another screenshot, or we're in destruction */
+	if (!g_task_propagate_boolean (task, NULL))
+		return;
+	helper = g_task_get_task_data (task);
+	gs_screenshot_image_show_decoded (ssimg, helper);
+}
+
+/**
+ * gs_screenshot_image_decode_cb:
+ **/
+static void
+gs_screenshot_image_decode_cb (GObject *source_object,
+			       GAsyncResult *res,
+			       gpointer user_data)
+{
+	GsScreenshotImage *ssimg = GS_SCREENSHOT_IMAGE (source_object);
+	GsScreenshotImagePrivate *priv = gs_screenshot_image_get_instance_private (ssimg);
+	GsScreenshotImageHelper *helper;
+	GsScreenshotImageHelper *helper_bg;
+	GTask *task = G_TASK (res);
+	_cleanup_error_free_ GError *error = NULL;
+
+	/* superseded by another screenshot, or we're in destruction */
+	helper = g_task_get_task_data (task);
+	if (!g_task_propagate_boolean (task, &error)) {
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
 			return;
+
+		/* a newer image is already being shown */
+		if (helper->generation < priv->generation_shown)
+			return;
+
+		/* download it again next time */
+		if (helper->msg == NULL)
+			gs_cache_remove (helper->filename);
+		if (error->domain == GDK_PIXBUF_ERROR) {
+			/* TRANSLATORS: possibly image file corrupt or not an image */
+			gs_screenshot_image_set_error (ssimg, _("Failed to load image"));
+		} else {
+			gs_screenshot_image_set_error (ssimg, error->message);
 		}
+		return;
+	}
+
+	/* the cache file has been written by the thread */
+	if (helper->msg != NULL)
+		gs_cache_add (GS_CACHE_KIND_SCREENSHOT, helper->filename, helper->msg);
+
+	/* render the background and composite onto it in another thread */
+	if (helper->has_alpha) {
+		_cleanup_object_unref_ GTask *task_bg = NULL;
+		gs_screenshot_image_bg_setup ();
+		helper_bg = g_slice_new0 (GsScreenshotImageHelper);
+		helper_bg->generation = helper->generation;
+		helper_bg->pixbuf = g_object_ref (helper->pixbuf);
+		helper_bg->width = priv->width;
+		helper_bg->height = priv->height;
+		task_bg = g_task_new (ssimg, priv->cancellable,
+				      gs_screenshot_image_composite_cb, NULL);
+		g_task_set_task_data (task_bg, helper_bg,
+				      (GDestroyNotify) gs_screenshot_image_helper_free);
+		g_task_run_in_thread (task_bg, gs_screenshot_image_composite_thread_cb);
+		return;
 	}
 
 	/* got image, so show */
-	as_screenshot_show_image (ssimg);
+	gs_screenshot_image_show_decoded (ssimg, helper);
+}
+
+/**
+ * gs_screenshot_image_decode_task_new:
+ **/
+static GTask *
+gs_screenshot_image_decode_task_new (GsScreenshotImage *ssimg, SoupMessage *msg)
+{
+	GsScreenshotImageHelper *helper;
+	GsScreenshotImagePrivate *priv = gs_screenshot_image_get_instance_private (ssimg);
+	GTask *task;
+
+	helper = g_slice_new0 (GsScreenshotImageHelper);
+	if (msg != NULL)
+		helper->msg = g_object_ref (msg);
+	helper->filename = g_strdup (priv->filename);
+	helper->generation = ++priv->generation;
+	if (priv->width == G_MAXUINT || priv->height == G_MAXUINT) {
+		helper->width = G_MAXUINT;
+		helper->height = G_MAXUINT;
+	} else {
+		helper->width = priv->width * priv->scale;
+		helper->height = priv->height * priv->scale;
+		helper->check_alpha = priv->use_desktop_background;
+	}
+
+	task = g_task_new (ssimg, priv->cancellable, gs_screenshot_image_decode_cb, NULL);
+	g_task_set_task_data (task, helper, (GDestroyNotify) gs_screenshot_image_helper_free);
+	return task;
+}
+
+/**
+ * gs_screenshot_image_decode_async:
+ *
+ * Decodes the cached file in a worker thread; only the finished pixbuf is
+ * handed back to the main thread.
+ **/
+static void
+gs_screenshot_image_decode_async (GsScreenshotImage *ssimg)
+{
+	_cleanup_object_unref_ GTask *task = NULL;
+
+	task = gs_screenshot_image_decode_task_new (ssimg, NULL);
+	g_task_run_in_thread (task, gs_screenshot_image_decode_thread_cb);
+}
+
+/**
+ * gs_screenshot_image_stream_end:
+ * @abort: %TRUE if the download did not complete
+ *
+ * Queues the end of the current download after its last chunk.
+ **/
+static void
+gs_screenshot_image_stream_end (GsScreenshotImage *ssimg, gboolean abort)
+{
+	GsScreenshotImagePrivate *priv = gs_screenshot_image_get_instance_private (ssimg);
+
+	if (priv->stream == NULL)
+		return;
+	priv->stream->abort = abort;
+	gs_screenshot_image_stream_push (priv->stream, NULL);
+	priv->stream = NULL;
+}
+
+/**
+ * gs_screenshot_image_got_headers_cb:
+ *
+ * Starts decoding the image in a worker thread as soon as the download
+ * starts, rather than once all of it has been buffered.
+ **/
+static void
+gs_screenshot_image_got_headers_cb (SoupMessage *msg, gpointer user_data)
+{
+	GsScreenshotImage *ssimg = GS_SCREENSHOT_IMAGE (user_data);
+	GsScreenshotImagePrivate *priv = gs_screenshot_image_get_instance_private (ssimg);
+	GsScreenshotImageStream *stream;
+
+	/* this is also emitted for redirects and 304 */
+	gs_screenshot_image_stream_end (ssimg, TRUE);
+	if (msg->status_code != SOUP_STATUS_OK)
+		return;
+
+	stream = g_slice_new0 (GsScreenshotImageStream);
+	stream->task = gs_screenshot_image_decode_task_new (ssimg, msg);
+	stream->loader = gdk_pixbuf_loader_new ();
+	stream->data = g_string_new (NULL);
+	priv->stream = stream;
+}
+
+/**
+ * gs_screenshot_image_got_chunk_cb:
+ **/
+static void
+gs_screenshot_image_got_chunk_cb (SoupMessage *msg,
+				  SoupBuffer *chunk,
+				  gpointer user_data)
+{
+	GsScreenshotImage *ssimg = GS_SCREENSHOT_IMAGE (user_data);
+	GsScreenshotImagePrivate *priv = gs_screenshot_image_get_instance_private (ssimg);
+
+	if (priv->stream == NULL)
+		return;
+	gs_screenshot_image_stream_push (priv->stream, soup_buffer_copy (chunk));
+}
+
+/**
+ * gs_screenshot_image_complete_cb:
+ **/
+static void
+gs_screenshot_image_complete_cb (SoupSession *session,
+				 SoupMessage *msg,
+				 gpointer user_data)
+{
+	_cleanup_object_unref_ GsScreenshotImage *ssimg = GS_SCREENSHOT_IMAGE (user_data);
+	GsScreenshotImagePrivate *priv = gs_screenshot_image_get_instance_private (ssimg);
+
+	/* the chunks have all been queued for decoding */
+	if (msg == priv->message)
+		gs_screenshot_image_stream_end (ssimg, msg->status_code != SOUP_STATUS_OK);
+
+	/* return immediately if the message was cancelled or if we're in destruction */
+	if (msg->status_code == SOUP_STATUS_CANCELLED || priv->session == NULL)
+		return;
+
+	/* the cached copy being shown is still current */
+	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		gs_cache_touch (priv->filename);
+		return;
+	}
+
+	if (msg->status_code != SOUP_STATUS_OK) {
+		/* keep showing the cached copy */
+		if (priv->revalidating)
+			return;
+
+		/* TRANSLATORS: this is when we try to download a screenshot and
+		 * we get back 404 */
+		gs_screenshot_image_set_error (ssimg, _("Screenshot not found"));
+		gtk_widget_hide (GTK_WIDGET (ssimg));
+		return;
+	}
 }
 
 /**
@@ -360,6 +935,88 @@ gs_screenshot_image_set_use_desktop_background (GsScreenshotImage *ssimg,
 	priv->use_desktop_background = use_desktop_background;
 }
 
+/**
+ * gs_screenshot_image_find_image:
+ * @screenshot: a #AsScreenshot
+ * @width: the width in logical pixels
+ * @height: the height in logical pixels
+ * @scale: the scale factor, which is set to 1 if falling back to LoDPI
+ *
+ * Returns: (transfer none): the #AsImage to download, or %NULL
+ **/
+AsImage *
+gs_screenshot_image_find_image (AsScreenshot *screenshot,
+				guint width,
+				guint height,
+				gint *scale)
+{
+	AsImage *im;
+
+	/* load an image according to the scale factor */
+	im = as_screenshot_get_image (screenshot,
+				      width * *scale,
+				      height * *scale);
+
+	/* if we've failed to load a HiDPI image, fallback to LoDPI */
+	if (im == NULL && *scale > 1) {
+		*scale = 1;
+		im = as_screenshot_get_image (screenshot, width, height);
+	}
+	return im;
+}
+
+/**
+ * gs_screenshot_image_get_cache_filename:
+ * @cachedir: the base cache directory, e.g. ~/.cache
+ * @url: the screenshot URL
+ * @width: the width in logical pixels, or %G_MAXUINT
+ * @height: the height in logical pixels, or %G_MAXUINT
+ * @scale: the scale factor
+ *
+ * Returns: the filename used to cache a processed screenshot
+ **/
+gchar *
+gs_screenshot_image_get_cache_filename (const gchar *cachedir,
+					const gchar *url,
+					guint width,
+					guint height,
+					gint scale)
+{
+	_cleanup_free_ gchar *basename = NULL;
+	_cleanup_free_ gchar *sizedir = NULL;
+
+	basename = g_path_get_basename (url);
+	if (width == G_MAXUINT || height == G_MAXUINT) {
+		sizedir = g_strdup ("unknown");
+	} else {
+		sizedir = g_strdup_printf ("%ux%u", width * scale, height * scale);
+	}
+	return g_build_filename (cachedir,
+				 "gnome-software",
+				 "screenshots",
+				 sizedir,
+				 basename,
+				 NULL);
+}
+
+/**
+ * gs_screenshot_image_cancel_message:
+ **/
+static void
+gs_screenshot_image_cancel_message (GsScreenshotImage *ssimg)
+{
+	GsScreenshotImagePrivate *priv = gs_screenshot_image_get_instance_private (ssimg);
+
+	gs_screenshot_image_stream_end (ssimg, TRUE);
+	if (priv->message == NULL)
+		return;
+	g_signal_handlers_disconnect_by_data (priv->message, ssimg);
+	soup_session_cancel_message (priv->session,
+				     priv->message,
+				     SOUP_STATUS_CANCELLED);
+	g_clear_object (&priv->message);
+}
+
 /**
  * gs_screenshot_image_load_async:
  **/
@@ -368,14 +1025,13 @@ gs_screenshot_image_load_async (GsScreenshotImage *ssimg,
 				GCancellable *cancellable)
 {
 	AsImage *im = NULL;
+	GsCacheState state;
 	GsScreenshotImagePrivate *priv;
 	SoupURI *base_uri = NULL;
 	const gchar *url;
 	gint rc;
-	_cleanup_free_ gchar *basename = NULL;
 	_cleanup_free_ gchar *cachedir2 = NULL;
 	_cleanup_free_ gchar *cachedir = NULL;
-	_cleanup_free_ gchar *sizedir = NULL;
 
 	g_return_if_fail (GS_IS_SCREENSHOT_IMAGE (ssimg));
 
@@ -387,17 +1043,10 @@ gs_screenshot_image_load_async (GsScreenshotImage *ssimg,
 
 	/* load an image according to the scale factor */
 	priv->scale = gtk_widget_get_scale_factor (GTK_WIDGET (ssimg));
-	im = as_screenshot_get_image (priv->screenshot,
-				      priv->width * priv->scale,
-				      priv->height * priv->scale);
-
-	/* if we've failed to load a HiDPI image, fallback to LoDPI */
-	if (im == NULL && priv->scale > 1) {
-		priv->scale = 1;
-		im = as_screenshot_get_image (priv->screenshot,
-					      priv->width,
-					      priv->height);
-	}
+	im = gs_screenshot_image_find_image (priv->screenshot,
+					     priv->width,
+					     priv->height,
+					     &priv->scale);
 	if (im == NULL) {
 		/* TRANSLATORS: this is when we request a screenshot size that
 		 * the generator did not create or the parser did not add */
@@ -405,17 +1054,13 @@ gs_screenshot_image_load_async (GsScreenshotImage *ssimg,
 		return;
 	}
 	url = as_image_get_url (im);
-	basename = g_path_get_basename (url);
-	if (priv->width == G_MAXUINT || priv->height == G_MAXUINT) {
-		sizedir = g_strdup ("unknown");
-	} else {
-		sizedir = g_strdup_printf ("%ux%u", priv->width * priv->scale, priv->height * priv->scale);
-	}
-	cachedir = g_build_filename (priv->cachedir,
-				     "gnome-software",
-				     "screenshots",
-				     sizedir,
-				     NULL);
+	g_free (priv->filename);
+	priv->filename = gs_screenshot_image_get_cache_filename (priv->cachedir,
+								 url,
+								 priv->width,
+								 priv->height,
+								 priv->scale);
+	cachedir = g_path_get_dirname (priv->filename);
 	rc = g_mkdir_with_parents (cachedir, 0700);
 	if (rc != 0) {
 		/* TRANSLATORS: this is when we try create the cache directory
@@ -424,23 +1069,33 @@ gs_screenshot_image_load_async (GsScreenshotImage *ssimg,
 		return;
 	}
 
+	/* cancel any previous decode */
+	if (priv->cancellable != NULL) {
+		g_cancellable_cancel (priv->cancellable);
+		g_object_unref (priv->cancellable);
+	}
+	priv->cancellable = g_cancellable_new ();
+
 	/* does local file already exist */
-	priv->filename = g_build_filename (cachedir, basename, NULL);
-	if (g_file_test (priv->filename, G_FILE_TEST_EXISTS)) {
-		as_screenshot_show_image (ssimg);
+	state = gs_cache_lookup (GS_CACHE_KIND_SCREENSHOT, priv->filename);
+	if (state == GS_CACHE_STATE_VALID) {
+		gs_screenshot_image_decode_async (ssimg);
 		return;
 	}
 
-	/* can we load a blurred smaller version of this straight away */
-	if (priv->width > AS_IMAGE_THUMBNAIL_WIDTH &&
+	/* show the old copy while checking if it has changed */
+	priv->revalidating = (state == GS_CACHE_STATE_STALE);
+	if (priv->revalidating) {
+		gs_screenshot_image_decode_async (ssimg);
+	} else if (priv->width > AS_IMAGE_THUMBNAIL_WIDTH &&
 	    priv->height > AS_IMAGE_THUMBNAIL_HEIGHT) {
-		cachedir2 = g_build_filename (priv->cachedir,
-					      "gnome-software",
-					      "screenshots",
-					      "112x63",
-					      basename,
-					      NULL);
-		if (g_file_test (cachedir2, G_FILE_TEST_EXISTS))
+		cachedir2 = gs_screenshot_image_get_cache_filename (priv->cachedir,
+								    url,
+								    AS_IMAGE_THUMBNAIL_WIDTH,
+								    AS_IMAGE_THUMBNAIL_HEIGHT,
+								    1);
+		/* can we load a blurred smaller version of this straight away */
+		if (gs_cache_lookup (GS_CACHE_KIND_SCREENSHOT, cachedir2) != GS_CACHE_STATE_MISSING)
 			gs_screenshot_image_show_blurred (ssimg, cachedir2);
 	}
 
@@ -456,12 +1111,7 @@ gs_screenshot_image_load_async (GsScreenshotImage *ssimg,
 	}
 
 	/* cancel any previous messages */
-	if (priv->message != NULL) {
-		soup_session_cancel_message (priv->session,
-		                             priv->message,
-		                             SOUP_STATUS_CANCELLED);
-		g_clear_object (&priv->message);
-	}
+	gs_screenshot_image_cancel_message (ssimg);
 
 	priv->message = soup_message_new_from_uri (SOUP_METHOD_GET, base_uri);
 	if (priv->message == NULL) {
@@ -471,7 +1121,15 @@ gs_screenshot_image_load_async (GsScreenshotImage *ssimg,
 		return;
 	}
 
+	/* the chunks are decoded as they arrive, so do not keep them */
+	soup_message_body_set_accumulate (priv->message->response_body, FALSE);
+	g_signal_connect (priv->message, "got-headers",
+			  G_CALLBACK (gs_screenshot_image_got_headers_cb), ssimg);
+	g_signal_connect (priv->message, "got-chunk",
+			  G_CALLBACK (gs_screenshot_image_got_chunk_cb), ssimg);
+
 	/* send async */
+	gs_cache_prepare_message (priv->filename, priv->message);
 	soup_session_queue_message (priv->session,
 				    g_object_ref (priv->message) /* transfer full */,
 				    gs_screenshot_image_complete_cb,
@@ -490,11 +1148,10 @@ gs_screenshot_image_destroy (GtkWidget *widget)
 
 	priv = gs_screenshot_image_get_instance_private (ssimg);
 
-	if (priv->message != NULL) {
-		soup_session_cancel_message (priv->session,
-		                             priv->message,
-		                             SOUP_STATUS_CANCELLED);
-		g_clear_object (&priv->message);
+	gs_screenshot_image_cancel_message (ssimg);
+	if (priv->cancellable != NULL) {
+		g_cancellable_cancel (priv->cancellable);
+		g_clear_object (&priv->cancellable);
 	}
 	g_clear_object (&priv->screenshot);
 	g_clear_object (&priv->session);
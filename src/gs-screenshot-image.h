@@ -68,6 +68,21 @@ void		 gs_screenshot_image_set_use_desktop_background
 void		 gs_screenshot_image_load_async		(GsScreenshotImage	*ssimg,
 							 GCancellable		*cancellable);
 
+AsImage		*gs_screenshot_image_find_image		(AsScreenshot		*screenshot,
+							 guint			 width,
+							 guint			 height,
+							 gint			*scale);
+gchar		*gs_screenshot_image_get_cache_filename	(const gchar		*cachedir,
+							 const gchar		*url,
+							 guint			 width,
+							 guint			 height,
+							 gint			 scale);
+GdkPixbuf	*gs_screenshot_image_save_data		(SoupBuffer		*buffer,
+							 const gchar		*filename,
+							 guint			 width,
+							 guint			 height,
+							 GError			**error);
+
 G_END_DECLS
 
 #endif /* GS_SCREENSHOT_IMAGE_H */
@@ -25,6 +25,8 @@
 #include <glib-object.h>
 #include <gtk/gtk.h>
 #include <glib/gstdio.h>
+#include <libsoup/soup.h>
+#include <string.h>
 
 #include "gs-app.h"
 #include "gs-cleanup.h"
@@ -33,6 +35,122 @@
 #include "gs-plugin-loader.h"
 #include "gs-plugin-loader-sync.h"
 #include "gs-utils.h"
+#include "plugins/fwupd-download.h"
+#include "plugins/packagekit-common.h"
+
+/* a tiny web server running in its own thread, so that it can answer
+ * while the test is blocked in one of the sync loader calls */
+typedef struct {
+	GMainContext	*context;
+	GMainLoop	*loop;
+	GThread		*thread;
+	SoupServer	*server;
+	GHashTable	*files;		/* path : GBytes */
+	gint		 hits;
+	gint		 hits_range;
+} GsSelfTestServer;
+
+static void
+gs_self_test_server_cb (SoupServer *server,
+			SoupMessage *msg,
+			const char *path,
+			GHashTable *query,
+			SoupClientContext *client,
+			gpointer user_data)
+{
+	GsSelfTestServer *self = (GsSelfTestServer *) user_data;
+	GBytes *bytes;
+	SoupRange *ranges = NULL;
+	const gchar *data;
+	gint length;
+	gsize len;
+
+	bytes = g_hash_table_lookup (self->files, path);
+	if (bytes == NULL) {
+		soup_message_set_status (msg, SOUP_STATUS_NOT_FOUND);
+		return;
+	}
+	g_atomic_int_inc (&self->hits);
+	data = g_bytes_get_data (bytes, &len);
+
+	/* only the part that was asked for */
+	if (soup_message_headers_get_ranges (msg->request_headers, len,
+					     &ranges, &length)) {
+		g_atomic_int_inc (&self->hits_range);
+		soup_message_set_status (msg, SOUP_STATUS_PARTIAL_CONTENT);
+		soup_message_headers_set_content_range (msg->response_headers,
+							ranges[0].start,
+							ranges[0].end,
+							len);
+		soup_message_body_append (msg->response_body, SOUP_MEMORY_COPY,
+					  data + ranges[0].start,
+					  ranges[0].end - ranges[0].start + 1);
+		soup_message_headers_free_ranges (msg->request_headers, ranges);
+		return;
+	}
+	soup_message_set_status (msg, SOUP_STATUS_OK);
+	soup_message_body_append (msg->response_body, SOUP_MEMORY_COPY, data, len);
+}
+
+static gpointer
+gs_self_test_server_thread_cb (gpointer user_data)
+{
+	GsSelfTestServer *self = (GsSelfTestServer *) user_data;
+	g_main_context_push_thread_default (self->context);
+	g_main_loop_run (self->loop);
+	g_main_context_pop_thread_default (self->context);
+	return NULL;
+}
+
+static GsSelfTestServer *
+gs_self_test_server_new (void)
+{
+	GsSelfTestServer *self;
+
+	self = g_new0 (GsSelfTestServer, 1);
+	self->files = g_hash_table_new_full (g_str_hash, g_str_equal,
+					     g_free, (GDestroyNotify) g_bytes_unref);
+	self->context = g_main_context_new ();
+	self->loop = g_main_loop_new (self->context, FALSE);
+	self->server = soup_server_new (SOUP_SERVER_PORT, 0,
+					SOUP_SERVER_ASYNC_CONTEXT, self->context,
+					NULL);
+	g_assert (self->server != NULL);
+	soup_server_add_handler (self->server, NULL,
+				 gs_self_test_server_cb, self, NULL);
+	soup_server_run_async (self->server);
+	self->thread = g_thread_new ("self-test-server",
+				     gs_self_test_server_thread_cb, self);
+	return self;
+}
+
+static void
+gs_self_test_server_add_file (GsSelfTestServer *self,
+			      const gchar *path,
+			      GBytes *bytes)
+{
+	g_hash_table_insert (self->files, g_strdup (path), g_bytes_ref (bytes));
+}
+
+static gchar *
+gs_self_test_server_get_uri (GsSelfTestServer *self, const gchar *path)
+{
+	return g_strdup_printf ("http://127.0.0.1:%u%s",
+				soup_server_get_port (self->server), path);
+}
+
+static void
+gs_self_test_server_free (GsSelfTestServer *self)
+{
+	g_main_loop_quit (self->loop);
+	g_thread_join (self->thread);
+	soup_server_disconnect (self->server);
+	g_object_unref (self->server);
+	g_main_loop_unref (self->loop);
+	g_main_context_unref (self->context);
+	g_hash_table_unref (self->files);
+	g_free (self);
+}
 
 static void
 gs_markdown_func (void)
@@ -314,6 +432,33 @@ gs_app_func (void)
 	g_assert_cmpstr (gs_app_get_name (app), ==, "hugh");
 }
 
+static guint _app_notify_cnt = 0;
+
+static void
+gs_app_notify_cb (GsApp *app, GParamSpec *pspec, gpointer user_data)
+{
+	_app_notify_cnt++;
+}
+
+static void
+gs_app_notify_func (void)
+{
+	_cleanup_object_unref_ GsApp *app = NULL;
+
+	app = gs_app_new ("gnome-software");
+	g_signal_connect (app, "notify",
+			  G_CALLBACK (gs_app_notify_cb), NULL);
+
+	/* changes are only emitted from the main loop, once per property */
+	gs_app_set_progress (app, 10);
+	gs_app_set_progress (app, 20);
+	gs_app_set_state (app, AS_APP_STATE_AVAILABLE);
+	g_assert_cmpint (_app_notify_cnt, ==, 0);
+	while (g_main_context_iteration (NULL, FALSE));
+	g_assert_cmpint (_app_notify_cnt, ==, 2);
+	g_assert_cmpint (gs_app_get_progress (app), ==, 20);
+}
+
 static guint _status_changed_cnt = 0;
 
 static void
@@ -535,6 +680,130 @@ gs_plugin_loader_refine_func (void)
 	g_assert_cmpstr (url, ==, "http://www.gimp.org/");
 }
 
+static void
+gs_self_test_remove_dir (const gchar *path)
+{
+	const gchar *fn;
+	_cleanup_dir_close_ GDir *dir = NULL;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir == NULL)
+		return;
+	while ((fn = g_dir_read_name (dir)) != NULL) {
+		_cleanup_free_ gchar *tmp = NULL;
+		tmp = g_build_filename (path, fn, NULL);
+		if (g_file_test (tmp, G_FILE_TEST_IS_DIR))
+			gs_self_test_remove_dir (tmp);
+		else
+			g_unlink (tmp);
+	}
+	g_rmdir (path);
+}
+
+static void
+gs_plugin_loader_icons_func (void)
+{
+	AsIcon *icon;
+	GError *error = NULL;
+	GsSelfTestServer *server;
+	gboolean ret;
+	gchar *buf;
+	gsize buf_len;
+	_cleanup_bytes_unref_ GBytes *bytes = NULL;
+	_cleanup_free_ gchar *filename = NULL;
+	_cleanup_free_ gchar *tmpdir = NULL;
+	_cleanup_free_ gchar *uri = NULL;
+	_cleanup_object_unref_ GdkPixbuf *pixbuf = NULL;
+	_cleanup_object_unref_ GdkPixbuf *pixbuf_saved = NULL;
+	_cleanup_object_unref_ GsApp *app = NULL;
+	_cleanup_object_unref_ GsPluginLoader *loader = NULL;
+
+	/* not avaiable in make distcheck */
+	if (!g_file_test ("./plugins/.libs/libgs_plugin_icons.so", G_FILE_TEST_EXISTS))
+		return;
+
+	/* load the plugins */
+	loader = gs_plugin_loader_new ();
+	gs_plugin_loader_set_location (loader, "./plugins/.libs");
+	ret = gs_plugin_loader_setup (loader, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = gs_plugin_loader_set_enabled (loader, "icons", TRUE);
+	g_assert (ret);
+
+	/* serve an icon that is the wrong size */
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 32, 32);
+	gdk_pixbuf_fill (pixbuf, 0xff0000ff);
+	ret = gdk_pixbuf_save_to_buffer (pixbuf, &buf, &buf_len, "png", &error, NULL);
+	g_assert_no_error (error);
+	g_assert (ret);
+	bytes = g_bytes_new_take (buf, buf_len);
+	server = gs_self_test_server_new ();
+	gs_self_test_server_add_file (server, "/icon.png", bytes);
+
+	/* an app with a remote icon */
+	tmpdir = g_dir_make_tmp ("gs-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	filename = g_build_filename (tmpdir, "icons", "icon.png", NULL);
+	uri = gs_self_test_server_get_uri (server, "/icon.png");
+	icon = as_icon_new ();
+	as_icon_set_kind (icon, AS_ICON_KIND_REMOTE);
+#if AS_CHECK_VERSION(0,5,0)
+	as_icon_set_url (icon, uri);
+#else
+	as_icon_set_url (icon, uri, -1);
+#endif
+	as_icon_set_filename (icon, filename);
+	app = gs_app_new ("self-test-icons");
+	gs_app_set_icon (app, icon);
+	g_object_unref (icon);
+
+	/* download it to the local file, scaled for the UI */
+	ret = gs_plugin_loader_app_refine (loader, app,
+					   GS_PLUGIN_REFINE_FLAGS_DEFAULT,
+					   NULL,
+					   &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (server->hits, ==, 1);
+	g_assert_cmpint (as_icon_get_kind (gs_app_get_icon (app)), ==, AS_ICON_KIND_LOCAL);
+	pixbuf_saved = gdk_pixbuf_new_from_file (filename, &error);
+	g_assert_no_error (error);
+	g_assert (pixbuf_saved != NULL);
+	g_assert_cmpint (gdk_pixbuf_get_width (pixbuf_saved), ==, 64);
+	g_assert_cmpint (gdk_pixbuf_get_height (pixbuf_saved), ==, 64);
+
+	/* a missing icon is not fatal for the refine */
+	g_clear_object (&app);
+	g_free (uri);
+	uri = gs_self_test_server_get_uri (server, "/missing.png");
+	icon = as_icon_new ();
+	as_icon_set_kind (icon, AS_ICON_KIND_REMOTE);
+#if AS_CHECK_VERSION(0,5,0)
+	as_icon_set_url (icon, uri);
+#else
+	as_icon_set_url (icon, uri, -1);
+#endif
+	as_icon_set_filename (icon, filename);
+	app = gs_app_new ("self-test-icons-missing");
+	gs_app_set_icon (app, icon);
+	g_object_unref (icon);
+	ret = gs_plugin_loader_app_refine (loader, app,
+					   GS_PLUGIN_REFINE_FLAGS_DEFAULT,
+					   NULL,
+					   &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (as_icon_get_kind (gs_app_get_icon (app)), ==, AS_ICON_KIND_REMOTE);
+
+	/* the pixbufs are set from idles that hold the apps */
+	gs_app_load_icon_wait ();
+	while (g_main_context_iteration (NULL, FALSE));
+
+	gs_self_test_server_free (server);
+	gs_self_test_remove_dir (tmpdir);
+}
+
 static void
 gs_plugin_loader_empty_func (void)
 {
@@ -681,9 +950,204 @@ gs_plugin_loader_webapps_func (void)
 	g_unlink (path);
 }
 
+/**
+ * gs_self_test_pk_files_new:
+ *
+ * Makes one GetFiles reply, as the PackageKit backend would send it.
+ **/
+static PkFiles *
+gs_self_test_pk_files_new (const gchar *package_id, const gchar *filename, ...)
+{
+	PkFiles *files;
+	va_list args;
+	const gchar *tmp;
+	_cleanup_ptrarray_unref_ GPtrArray *filenames = NULL;
+
+	filenames = g_ptr_array_new ();
+	va_start (args, filename);
+	for (tmp = filename; tmp != NULL; tmp = va_arg (args, const gchar *))
+		g_ptr_array_add (filenames, (gpointer) tmp);
+	va_end (args);
+	g_ptr_array_add (filenames, NULL);
+
+	files = pk_files_new ();
+	g_object_set (files,
+		      "package-id", package_id,
+		      "files", filenames->pdata,
+		      NULL);
+	return files;
+}
+
+/**
+ * gs_self_test_desktop_app_new:
+ **/
+static GsApp *
+gs_self_test_desktop_app_new (GList **list, const gchar *id, const gchar *filename)
+{
+	_cleanup_object_unref_ GsApp *app = NULL;
+
+	app = gs_app_new (id);
+	gs_app_set_metadata (app, "DataDir::desktop-filename", filename);
+	gs_plugin_add_app (list, app);
+	return app;
+}
+
+static void
+gs_plugin_packagekit_desktop_func (void)
+{
+	GList *list = NULL;
+	GsApp *app_gimp;
+	GsApp *app_gedit;
+	GsApp *app_gedit_plugins;
+	GsApp *app_orphan;
+	GsApp *app_shared;
+	_cleanup_ptrarray_unref_ GPtrArray *files_array = NULL;
+
+	/* several desktop files, one of them in two apps */
+	app_gimp = gs_self_test_desktop_app_new (&list, "gimp.desktop",
+						 "/usr/share/applications/gimp.desktop");
+	app_gedit = gs_self_test_desktop_app_new (&list, "gedit.desktop",
+						  "/usr/share/applications/gedit.desktop");
+	app_gedit_plugins = gs_self_test_desktop_app_new (&list, "gedit-plugins.desktop",
+							  "/usr/share/applications/gedit.desktop");
+	app_orphan = gs_self_test_desktop_app_new (&list, "orphan.desktop",
+						   "/usr/share/applications/orphan.desktop");
+	app_shared = gs_self_test_desktop_app_new (&list, "shared.desktop",
+						   "/usr/share/applications/shared.desktop");
+
+	/* the file lists of the packages that SearchFiles found */
+	files_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_ptr_array_add (files_array,
+			 gs_self_test_pk_files_new ("gimp;2.8.14;x86_64;fedora",
+						    "/usr/bin/gimp",
+						    "/usr/share/applications/gimp.desktop",
+						    NULL));
+	g_ptr_array_add (files_array,
+			 gs_self_test_pk_files_new ("gedit;3.16.0;x86_64;fedora",
+						    "/usr/share/applications/gedit.desktop",
+						    "/usr/share/applications/shared.desktop",
+						    NULL));
+	g_ptr_array_add (files_array,
+			 gs_self_test_pk_files_new ("shared;1.0;noarch;fedora",
+						    "/usr/share/applications/shared.desktop",
+						    NULL));
+	gs_plugin_packagekit_add_desktop_sources (list, files_array);
+
+	/* each file owned by one package maps back to its apps */
+	g_assert_cmpstr (gs_app_get_source_id_default (app_gimp), ==, "gimp;2.8.14;x86_64;fedora");
+	g_assert_cmpint (gs_app_get_state (app_gimp), ==, AS_APP_STATE_INSTALLED);
+	g_assert_cmpstr (gs_app_get_management_plugin (app_gimp), ==, "PackageKit");
+	g_assert_cmpstr (gs_app_get_source_id_default (app_gedit), ==, "gedit;3.16.0;x86_64;fedora");
+	g_assert_cmpstr (gs_app_get_source_id_default (app_gedit_plugins), ==, "gedit;3.16.0;x86_64;fedora");
+	g_assert_cmpint (gs_app_get_state (app_gedit_plugins), ==, AS_APP_STATE_INSTALLED);
+
+	/* no owner, or more than one, leaves the app alone */
+	g_assert_cmpstr (gs_app_get_source_id_default (app_orphan), ==, NULL);
+	g_assert_cmpint (gs_app_get_state (app_orphan), ==, AS_APP_STATE_UNKNOWN);
+	g_assert_cmpstr (gs_app_get_source_id_default (app_shared), ==, NULL);
+	g_assert_cmpint (gs_app_get_state (app_shared), ==, AS_APP_STATE_UNKNOWN);
+
+	gs_plugin_list_free (list);
+}
+
+static void
+gs_plugin_fwupd_download_func (void)
+{
+	GError *error = NULL;
+	GsPluginFwupdDownload *dl;
+	GsSelfTestServer *server;
+	gboolean ret;
+	gchar *data;
+	gchar *data_saved;
+	gsize data_saved_len;
+	guint i;
+	_cleanup_bytes_unref_ GBytes *bytes = NULL;
+	_cleanup_free_ gchar *checksum = NULL;
+	_cleanup_free_ gchar *checksum_expected = NULL;
+	_cleanup_free_ gchar *filename = NULL;
+	_cleanup_free_ gchar *filename_part = NULL;
+	_cleanup_free_ gchar *tmpdir = NULL;
+	_cleanup_free_ gchar *uri = NULL;
+	_cleanup_object_unref_ GCancellable *cancellable = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *downloads = NULL;
+
+	/* serve a firmware file larger than one chunk */
+	data = g_malloc (100000);
+	for (i = 0; i < 100000; i++)
+		data[i] = i % 251;
+	bytes = g_bytes_new_take (data, 100000);
+	checksum_expected = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, bytes);
+	server = gs_self_test_server_new ();
+	gs_self_test_server_add_file (server, "/firmware.cab", bytes);
+	uri = gs_self_test_server_get_uri (server, "/firmware.cab");
+
+	/* an earlier download stopped part of the way through */
+	tmpdir = g_dir_make_tmp ("gs-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	filename = g_build_filename (tmpdir, "firmware.cab", NULL);
+	filename_part = g_strdup_printf ("%s.part", filename);
+	ret = g_file_set_contents (filename_part, data, 40000, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* only the rest of the file is fetched */
+	downloads = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_plugin_fwupd_download_free);
+	dl = gs_plugin_fwupd_download_new (uri, filename);
+	g_ptr_array_add (downloads, dl);
+	ret = gs_plugin_fwupd_download_all (downloads, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert (!dl->failed);
+	g_assert_cmpint (server->hits_range, ==, 1);
+	g_assert (!g_file_test (filename_part, G_FILE_TEST_EXISTS));
+	ret = g_file_get_contents (filename, &data_saved, &data_saved_len, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (data_saved_len, ==, 100000);
+	g_assert (memcmp (data_saved, data, 100000) == 0);
+	g_free (data_saved);
+
+	/* the checksum comes from what is on disk */
+	checksum = gs_plugin_fwupd_get_file_checksum (filename, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (checksum, ==, checksum_expected);
+	g_free (checksum);
+	ret = g_file_set_contents (filename, "corrupt", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	checksum = gs_plugin_fwupd_get_file_checksum (filename, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (checksum, !=, checksum_expected);
+
+	/* a cancelled download is an error */
+	g_unlink (filename);
+	g_ptr_array_set_size (downloads, 0);
+	g_ptr_array_add (downloads, gs_plugin_fwupd_download_new (uri, filename));
+	cancellable = g_cancellable_new ();
+	g_cancellable_cancel (cancellable);
+	ret = gs_plugin_fwupd_download_all (downloads, cancellable, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert (!ret);
+	g_clear_error (&error);
+	g_assert (!g_file_test (filename, G_FILE_TEST_EXISTS));
+
+	gs_self_test_server_free (server);
+	g_unlink (filename_part);
+	g_rmdir (tmpdir);
+}
+
 int
 main (int argc, char **argv)
 {
+	gint retval;
+	_cleanup_free_ gchar *cachedir = NULL;
+
+	/* never write to the cache of the user running the tests, which
+	 * must be set before anything asks for g_get_user_cache_dir() */
+	cachedir = g_dir_make_tmp ("gs-self-test-cache-XXXXXX", NULL);
+	g_assert (cachedir != NULL);
+	g_setenv ("XDG_CACHE_HOME", cachedir, TRUE);
+
 	gtk_init (&argc, &argv);
 	g_test_init (&argc, &argv, NULL);
 	g_setenv ("G_MESSAGES_DEBUG", "all", TRUE);
@@ -696,15 +1160,22 @@ main (int argc, char **argv)
 	g_test_add_func ("/gnome-software/markdown", gs_markdown_func);
 	g_test_add_func ("/gnome-software/plugin-loader{refine}", gs_plugin_loader_refine_func);
 	g_test_add_func ("/gnome-software/plugin", gs_plugin_func);
+	g_test_add_func ("/gnome-software/plugin{packagekit-desktop}", gs_plugin_packagekit_desktop_func);
+	g_test_add_func ("/gnome-software/plugin{fwupd-download}", gs_plugin_fwupd_download_func);
 	g_test_add_func ("/gnome-software/app", gs_app_func);
 	g_test_add_func ("/gnome-software/app{subsume}", gs_app_subsume_func);
+	g_test_add_func ("/gnome-software/app{notify}", gs_app_notify_func);
 	if (g_getenv ("HAS_APPSTREAM") != NULL)
 		g_test_add_func ("/gnome-software/plugin-loader{empty}", gs_plugin_loader_empty_func);
 	g_test_add_func ("/gnome-software/plugin-loader{dedupe}", gs_plugin_loader_dedupe_func);
+	g_test_add_func ("/gnome-software/plugin-loader{icons}", gs_plugin_loader_icons_func);
 	if(0)g_test_add_func ("/gnome-software/plugin-loader", gs_plugin_loader_func);
 	if(0)g_test_add_func ("/gnome-software/plugin-loader{webapps}", gs_plugin_loader_webapps_func);
 
-	return g_test_run ();
+	retval = g_test_run ();
+	gs_app_load_icon_wait ();
+	gs_self_test_remove_dir (cachedir);
+	return retval;
 }
 
 /* vim: set noexpandtab: */
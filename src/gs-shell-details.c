@@ -522,6 +522,52 @@ gs_shell_details_set_description (GsShellDetails *shell_details, const gchar *tm
 	}
 }
 
+/**
+ * gs_shell_details_refresh_icon:
+ **/
+static void
+gs_shell_details_refresh_icon (GsShellDetails *shell_details)
+{
+	GdkPixbuf *pixbuf;
+	GsShellDetailsPrivate *priv = shell_details->priv;
+	const gchar *tmp;
+	_cleanup_error_free_ GError *error = NULL;
+	_cleanup_object_unref_ GdkPixbuf *pixbuf_desktop = NULL;
+
+	tmp = gs_app_get_metadata_item (priv->app, "DataDir::desktop-icon");
+	if (tmp != NULL) {
+		pixbuf_desktop = gtk_icon_theme_load_icon (gtk_icon_theme_get_default (),
+							   tmp, 96,
+							   GTK_ICON_LOOKUP_USE_BUILTIN |
+							   GTK_ICON_LOOKUP_FORCE_SIZE,
+							   &error);
+		if (pixbuf_desktop == NULL) {
+			g_warning ("Failed to load desktop icon: %s",
+				   error->message);
+		}
+	}
+	pixbuf = pixbuf_desktop;
+	if (pixbuf == NULL)
+		pixbuf = gs_app_get_pixbuf (priv->app);
+	if (pixbuf != NULL) {
+		gs_image_set_from_pixbuf (GTK_IMAGE (priv->application_details_icon), pixbuf);
+		gtk_widget_set_visible (priv->application_details_icon, TRUE);
+	} else {
+		gtk_widget_set_visible (priv->application_details_icon, FALSE);
+	}
+}
+
+/**
+ * gs_shell_details_notify_pixbuf_cb:
+ **/
+static void
+gs_shell_details_notify_pixbuf_cb (GsApp *app,
+				   GParamSpec *pspec,
+				   GsShellDetails *shell_details)
+{
+	gs_shell_details_refresh_icon (shell_details);
+}
+
 /**
  * gs_shell_details_refresh_all:
  **/
@@ -529,13 +575,11 @@ static void
 gs_shell_details_refresh_all (GsShellDetails *shell_details)
 {
 	GPtrArray *history;
-	GdkPixbuf *pixbuf = NULL;
 	GList *addons;
 	GsShellDetailsPrivate *priv = shell_details->priv;
 	GtkWidget *widget;
 	const gchar *tmp;
 	guint64 updated;
-	_cleanup_error_free_ GError *error = NULL;
 
 	/* change widgets */
 	tmp = gs_app_get_name (priv->app);
@@ -561,27 +605,7 @@ gs_shell_details_refresh_all (GsShellDetails *shell_details)
 	gs_shell_details_set_description (shell_details, tmp);
 
 	/* set the icon */
-	tmp = gs_app_get_metadata_item (priv->app, "DataDir::desktop-icon");
-	if (tmp != NULL) {
-		pixbuf = gtk_icon_theme_load_icon (gtk_icon_theme_get_default (),
-						   tmp, 96,
-						   GTK_ICON_LOOKUP_USE_BUILTIN |
-						   GTK_ICON_LOOKUP_FORCE_SIZE,
-						   &error);
-		if (pixbuf == NULL) {
-			g_warning ("Failed to load desktop icon: %s",
-				   error->message);
-			g_clear_error (&error);
-		}
-	}
-	if (pixbuf == NULL)
-		pixbuf = gs_app_get_pixbuf (priv->app);
-	if (pixbuf != NULL) {
-		gs_image_set_from_pixbuf (GTK_IMAGE (priv->application_details_icon), pixbuf);
-		gtk_widget_set_visible (priv->application_details_icon, TRUE);
-	} else {
-		gtk_widget_set_visible (priv->application_details_icon, FALSE);
-	}
+	gs_shell_details_refresh_icon (shell_details);
 
 	tmp = gs_app_get_url (priv->app, AS_URL_KIND_HOMEPAGE);
 	if (tmp != NULL && tmp[0] != '\0') {
@@ -955,6 +979,9 @@ gs_shell_details_filename_to_app_cb (GObject *source,
 	g_signal_connect_object (priv->app, "notify::licence",
 				 G_CALLBACK (gs_shell_details_notify_state_changed_cb),
 				 shell_details, 0);
+	g_signal_connect_object (priv->app, "notify::pixbuf",
+				 G_CALLBACK (gs_shell_details_notify_pixbuf_cb),
+				 shell_details, 0);
 
 	/* print what we've got */
 	tmp = gs_app_to_string (priv->app);
@@ -1043,6 +1070,9 @@ gs_shell_details_set_app (GsShellDetails *shell_details, GsApp *app)
 	g_signal_connect_object (priv->app, "notify::licence",
 				 G_CALLBACK (gs_shell_details_notify_state_changed_cb),
 				 shell_details, 0);
+	g_signal_connect_object (priv->app, "notify::pixbuf",
+				 G_CALLBACK (gs_shell_details_notify_pixbuf_cb),
+				 shell_details, 0);
 	g_signal_connect_object (priv->app, "notify::progress",
 				 G_CALLBACK (gs_shell_details_progress_changed_cb),
 				 shell_details, 0);
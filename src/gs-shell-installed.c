@@ -210,6 +210,9 @@ gs_shell_installed_get_installed_cb (GObject *source_object,
 			g_warning ("failed to get installed apps: %s", error->message);
 		goto out;
 	}
+
+	/* replace any rows shown from the snapshot */
+	gs_container_remove_all (GTK_CONTAINER (priv->list_box_install));
 	for (l = list; l != NULL; l = l->next) {
 		app = GS_APP (l->data);
 		gs_shell_installed_add_app (shell_installed, app);
@@ -226,6 +229,8 @@ static void
 gs_shell_installed_load (GsShellInstalled *shell_installed)
 {
 	GsShellInstalledPrivate *priv = shell_installed->priv;
+	GList *l;
+	_cleanup_plugin_list_free_ GList *snapshot = NULL;
 
 	if (priv->waiting)
 		return;
@@ -234,6 +239,15 @@ gs_shell_installed_load (GsShellInstalled *shell_installed)
 	/* remove old entries */
 	gs_container_remove_all (GTK_CONTAINER (priv->list_box_install));
 
+	/* show what was installed last time while the plugins run */
+	snapshot = gs_plugin_loader_get_snapshot (priv->plugin_loader,
+						  AS_APP_STATE_INSTALLED);
+	snapshot = g_list_concat (snapshot,
+				  gs_plugin_loader_get_snapshot (priv->plugin_loader,
+								 AS_APP_STATE_UPDATABLE));
+	for (l = snapshot; l != NULL; l = l->next)
+		gs_shell_installed_add_app (shell_installed, GS_APP (l->data));
+
 	/* get popular apps */
 	gs_plugin_loader_get_installed_async (priv->plugin_loader,
 					      GS_PLUGIN_REFINE_FLAGS_DEFAULT |
@@ -245,6 +259,10 @@ gs_shell_installed_load (GsShellInstalled *shell_installed)
 					      priv->cancellable,
 					      gs_shell_installed_get_installed_cb,
 					      shell_installed);
+	if (snapshot != NULL) {
+		gtk_stack_set_visible_child_name (GTK_STACK (priv->stack_install), "view");
+		return;
+	}
 	gs_start_spinner (GTK_SPINNER (priv->spinner_install));
 	gtk_stack_set_visible_child_name (GTK_STACK (priv->stack_install), "spinner");
 }
@@ -49,6 +49,7 @@ struct GsShellOverviewPrivate
 	gboolean		 loading_categories;
 	gboolean		 empty;
 	gchar			*category_of_day;
+	GPtrArray		*prefetch_apps;		/* of GsApp */
 
 	GtkWidget		*bin_featured;
 	GtkWidget		*box_overview;
@@ -96,6 +97,21 @@ gs_shell_overview_invalidate (GsShellOverview *shell_overview)
 	shell_overview->priv->cache_valid = FALSE;
 }
 
+/**
+ * gs_shell_overview_prefetch_app:
+ *
+ * The apps are remembered, as the prefetch queue is dropped when another
+ * page is shown and the tiles are not reloaded when coming back.
+ **/
+static void
+gs_shell_overview_prefetch_app (GsShellOverview *shell_overview, GsApp *app)
+{
+	GsShellOverviewPrivate *priv = shell_overview->priv;
+	g_ptr_array_add (priv->prefetch_apps, g_object_ref (app));
+	gs_prefetch_add_app (gs_shell_get_prefetch (priv->shell), app,
+			     gtk_widget_get_scale_factor (GTK_WIDGET (shell_overview)));
+}
+
 static void
 popular_tile_clicked (GsPopularTile *tile, gpointer data)
 {
@@ -152,6 +168,7 @@ gs_shell_overview_get_popular_cb (GObject *source_object,
 		tile = gs_popular_tile_new (app);
 		g_signal_connect (tile, "clicked",
 			  G_CALLBACK (popular_tile_clicked), shell);
+		gs_shell_overview_prefetch_app (shell, app);
 		gtk_container_add (GTK_CONTAINER (priv->box_popular), tile);
 	}
 
@@ -209,6 +226,7 @@ gs_shell_overview_get_popular_rotating_cb (GObject *source_object,
 		tile = gs_popular_tile_new (app);
 		g_signal_connect (tile, "clicked",
 			  G_CALLBACK (popular_tile_clicked), shell);
+		gs_shell_overview_prefetch_app (shell, app);
 		gtk_container_add (GTK_CONTAINER (priv->box_popular_rotating), tile);
 	}
 
@@ -270,6 +288,7 @@ gs_shell_overview_get_featured_cb (GObject *source_object,
 	tile = gs_feature_tile_new (app);
 	g_signal_connect (tile, "clicked",
 			  G_CALLBACK (feature_tile_clicked), shell);
+	gs_shell_overview_prefetch_app (shell, app);
 
 	gtk_container_add (GTK_CONTAINER (priv->bin_featured), tile);
 
@@ -359,6 +378,7 @@ gs_shell_overview_load (GsShellOverview *shell_overview)
 	_cleanup_date_time_unref_ GDateTime *date = NULL;
 
 	priv->empty = TRUE;
+	g_ptr_array_set_size (priv->prefetch_apps, 0);
 
 	date = g_date_time_new_now_utc ();
 	switch (g_date_time_get_day_of_year (date) % 4) {
@@ -461,6 +481,7 @@ gs_shell_overview_switch_to (GsShellOverview *shell, gboolean scroll_up)
 	GsShellOverviewPrivate *priv = shell->priv;
 	GtkWidget *widget;
 	GtkAdjustment *adj;
+	guint i;
 
 	if (gs_shell_get_mode (priv->shell) != GS_SHELL_MODE_OVERVIEW) {
 		g_warning ("Called switch_to(overview) when in mode %s",
@@ -482,7 +503,16 @@ gs_shell_overview_switch_to (GsShellOverview *shell, gboolean scroll_up)
 
 	gs_grab_focus_when_mapped (priv->scrolledwindow_overview);
 
-	if (priv->cache_valid || priv->refresh_count > 0)
+	/* the tiles are still valid, but not what was being prefetched */
+	if (priv->cache_valid) {
+		for (i = 0; i < priv->prefetch_apps->len; i++) {
+			gs_prefetch_add_app (gs_shell_get_prefetch (priv->shell),
+					     g_ptr_array_index (priv->prefetch_apps, i),
+					     gtk_widget_get_scale_factor (GTK_WIDGET (shell)));
+		}
+		return;
+	}
+	if (priv->refresh_count > 0)
 		return;
 	gs_shell_overview_load (shell);
 }
@@ -535,6 +565,7 @@ gs_shell_overview_init (GsShellOverview *shell)
 	gtk_widget_init_template (GTK_WIDGET (shell));
 
 	shell->priv = gs_shell_overview_get_instance_private (shell);
+	shell->priv->prefetch_apps = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 }
 
 static void
@@ -547,6 +578,7 @@ gs_shell_overview_dispose (GObject *object)
 	g_clear_object (&priv->plugin_loader);
 	g_clear_object (&priv->cancellable);
 	g_clear_pointer (&priv->category_of_day, g_free);
+	g_clear_pointer (&priv->prefetch_apps, g_ptr_array_unref);
 
 	G_OBJECT_CLASS (gs_shell_overview_parent_class)->dispose (object);
 }
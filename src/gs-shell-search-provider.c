@@ -36,6 +36,7 @@
 typedef struct {
 	GsShellSearchProvider *provider;
 	GDBusMethodInvocation *invocation;
+	gboolean subsearch;
 } PendingSearch;
 
 struct _GsShellSearchProvider {
@@ -46,6 +47,7 @@ struct _GsShellSearchProvider {
 	GsShellSearchProvider2 *skeleton;
 	GsPluginLoader *plugin_loader;
 	GCancellable *cancellable;
+	gchar **last_terms;
 
 	GHashTable *metas_cache;
 };
@@ -85,7 +87,10 @@ search_done_cb (GObject *source,
 	GList *list, *l;
 	GVariantBuilder builder;
 
-	list = gs_plugin_loader_search_finish (self->plugin_loader, res, NULL);
+	if (search->subsearch)
+		list = gs_plugin_loader_subsearch_finish (self->plugin_loader, res, NULL);
+	else
+		list = gs_plugin_loader_search_finish (self->plugin_loader, res, NULL);
 	if (list == NULL) {
 		g_dbus_method_invocation_return_value (search->invocation, g_variant_new ("(as)", NULL));
 		pending_search_free (search);
@@ -108,16 +113,47 @@ search_done_cb (GObject *source,
 	pending_search_free (search);
 }
 
+/**
+ * search_terms_narrow:
+ *
+ * Returns %TRUE if each of the @old_terms is a prefix of the term in the
+ * same position of @terms, so the results can only be a subset.
+ **/
+static gboolean
+search_terms_narrow (gchar **old_terms, gchar **terms)
+{
+	guint i;
+
+	if (old_terms == NULL)
+		return FALSE;
+	for (i = 0; old_terms[i] != NULL; i++) {
+		if (terms[i] == NULL)
+			return FALSE;
+		if (!g_str_has_prefix (terms[i], old_terms[i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
 static void
 execute_search (GsShellSearchProvider  *self,
 		GDBusMethodInvocation  *invocation,
-		gchar		 **terms)
+		gchar		 **terms,
+		gchar		 **previous_results)
 {
 	PendingSearch *pending_search;
+	gboolean subsearch;
 	_cleanup_free_ gchar *string = NULL;
 
 	string = g_strjoinv (" ", terms);
 
+	/* only filter the previous results if the user typed more */
+	subsearch = previous_results != NULL &&
+		    previous_results[0] != NULL &&
+		    search_terms_narrow (self->last_terms, terms);
+	g_strfreev (self->last_terms);
+	self->last_terms = g_strdupv (terms);
+
 	if (self->cancellable != NULL) {
 		g_cancellable_cancel (self->cancellable);
 		g_clear_object (&self->cancellable);
@@ -133,8 +169,17 @@ execute_search (GsShellSearchProvider  *self,
 	pending_search = g_slice_new (PendingSearch);
 	pending_search->provider = self;
 	pending_search->invocation = g_object_ref (invocation);
+	pending_search->subsearch = subsearch;
 
 	self->cancellable = g_cancellable_new ();
+	if (subsearch) {
+		gs_plugin_loader_subsearch_async (self->plugin_loader,
+						  previous_results,
+						  string, 0, self->cancellable,
+						  search_done_cb,
+						  pending_search);
+		return;
+	}
 	gs_plugin_loader_search_async (self->plugin_loader,
 				       string, 0, self->cancellable,
 				       search_done_cb,
@@ -150,7 +195,7 @@ handle_get_initial_result_set (GsShellSearchProvider2	*skeleton,
 	GsShellSearchProvider *self = user_data;
 
 	g_debug ("****** GetInitialResultSet");
-	execute_search (self, invocation, terms);
+	execute_search (self, invocation, terms, NULL);
 	return TRUE;
 }
 
@@ -164,7 +209,7 @@ handle_get_subsearch_result_set (GsShellSearchProvider2	*skeleton,
 	GsShellSearchProvider *self = user_data;
 
 	g_debug ("****** GetSubSearchResultSet");
-	execute_search (self, invocation, terms);
+	execute_search (self, invocation, terms, previous_results);
 	return TRUE;
 }
 
@@ -207,7 +252,11 @@ handle_get_result_metas (GsShellSearchProvider2	*skeleton,
 		g_variant_builder_init (&meta, G_VARIANT_TYPE ("a{sv}"));
 		g_variant_builder_add (&meta, "{sv}", "id", g_variant_new_string (gs_app_get_id (app)));
 		g_variant_builder_add (&meta, "{sv}", "name", g_variant_new_string (gs_app_get_name (app)));
+		/* the shell needs the icon now, so don't wait for the pool */
 		pixbuf = gs_app_get_pixbuf (app);
+		if (pixbuf == NULL && gs_app_get_icon (app) != NULL &&
+		    gs_app_load_icon (app, 1, NULL))
+			pixbuf = gs_app_get_pixbuf (app);
 		if (pixbuf != NULL)
 			g_variant_builder_add (&meta, "{sv}", "icon", g_icon_serialize (G_ICON (pixbuf)));
 		g_variant_builder_add (&meta, "{sv}", "description", g_variant_new_string (gs_app_get_summary (app)));
@@ -329,6 +378,9 @@ search_provider_dispose (GObject *obj)
 		g_clear_object (&self->cancellable);
 	}
 
+	g_strfreev (self->last_terms);
+	self->last_terms = NULL;
+
 	if (self->metas_cache != NULL) {
 		g_hash_table_destroy (self->metas_cache);
 		self->metas_cache = NULL;
@@ -31,6 +31,9 @@
 #include "gs-utils.h"
 #include "gs-app-row.h"
 
+/* the number of results to prefetch screenshots for */
+#define GS_SHELL_SEARCH_PREFETCH_MAX	5
+
 struct GsShellSearchPrivate
 {
 	GsPluginLoader		*plugin_loader;
@@ -42,6 +45,10 @@ struct GsShellSearchPrivate
 	GsShell			*shell;
 	gchar			*appid_to_show;
 	gchar			*value;
+	guint			 n_prefetched;
+	guint			 search_offset;
+	guint			 search_offset_next;
+	guint			 search_n_shown;	/* rows of the current page */
 
 	GtkWidget		*list_box_search;
 	GtkWidget		*scrolledwindow_search;
@@ -83,6 +90,48 @@ gs_shell_search_app_row_clicked_cb (GsAppRow *app_row,
 	}
 }
 
+/**
+ * gs_shell_search_add_batch_cb:
+ *
+ * Adds a few refined results as soon as they are ready. Each plugin sends
+ * its best matches when it finishes, so the list box keeps the rows sorted.
+ **/
+static void
+gs_shell_search_add_batch_cb (GsPluginLoader *plugin_loader,
+			      GList *list,
+			      gpointer user_data)
+{
+	GList *l;
+	GsApp *app;
+	GsShellSearch *shell_search = GS_SHELL_SEARCH (user_data);
+	GsShellSearchPrivate *priv = shell_search->priv;
+	GtkWidget *app_row;
+
+	gs_stop_spinner (GTK_SPINNER (priv->spinner_search));
+	gtk_stack_set_visible_child_name (GTK_STACK (priv->stack_search), "results");
+	for (l = list; l != NULL; l = l->next) {
+		app = GS_APP (l->data);
+		app_row = gs_app_row_new ();
+		g_signal_connect (app_row, "button-clicked",
+				  G_CALLBACK (gs_shell_search_app_row_clicked_cb),
+				  shell_search);
+		gs_app_row_set_app (GS_APP_ROW (app_row), app);
+		gtk_container_add (GTK_CONTAINER (priv->list_box_search), app_row);
+		gs_app_row_set_size_groups (GS_APP_ROW (app_row),
+					    priv->sizegroup_image,
+					    priv->sizegroup_name);
+		gtk_widget_show (app_row);
+		priv->search_n_shown++;
+
+		/* only the results at the top are likely to be clicked */
+		if (priv->n_prefetched < GS_SHELL_SEARCH_PREFETCH_MAX) {
+			gs_prefetch_add_app (gs_shell_get_prefetch (priv->shell), app,
+					     gtk_widget_get_scale_factor (GTK_WIDGET (shell_search)));
+			priv->n_prefetched++;
+		}
+	}
+}
+
 /**
  * gs_shell_search_get_search_cb:
  **/
@@ -91,14 +140,11 @@ gs_shell_search_get_search_cb (GObject *source_object,
 				     GAsyncResult *res,
 				     gpointer user_data)
 {
-	GList *l;
-	GList *list;
-	GsApp *app;
 	GsShellSearch *shell_search = GS_SHELL_SEARCH (user_data);
 	GsShellSearchPrivate *priv = shell_search->priv;
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
-	GtkWidget *app_row;
 	_cleanup_error_free_ GError *error = NULL;
+	_cleanup_plugin_list_free_ GList *list = NULL;
 
 	list = gs_plugin_loader_search_finish (plugin_loader, res, &error);
 	if (list == NULL) {
@@ -113,69 +159,102 @@ gs_shell_search_get_search_cb (GObject *source_object,
 		} else {
 			g_warning ("failed to get search apps: %s", error->message);
 		}
+
+		/* keep the earlier pages and any rows already streamed */
+		if (priv->search_offset > 0 || priv->search_n_shown > 0)
+			return;
+
 		gs_stop_spinner (GTK_SPINNER (priv->spinner_search));
 		gtk_stack_set_visible_child_name (GTK_STACK (priv->stack_search), "no-results");
 		return;
 	}
 
-	gs_stop_spinner (GTK_SPINNER (priv->spinner_search));
-	gtk_stack_set_visible_child_name (GTK_STACK (priv->stack_search), "results");
-	for (l = list; l != NULL; l = l->next) {
-		app = GS_APP (l->data);
-		app_row = gs_app_row_new ();
-		g_signal_connect (app_row, "button-clicked",
-				  G_CALLBACK (gs_shell_search_app_row_clicked_cb),
-				  shell_search);
-		gs_app_row_set_app (GS_APP_ROW (app_row), app);
-		gtk_container_add (GTK_CONTAINER (priv->list_box_search), app_row);
-		gs_app_row_set_size_groups (GS_APP_ROW (app_row),
-					    priv->sizegroup_image,
-					    priv->sizegroup_name);
-		gtk_widget_show (app_row);
-	}
-
+	/* the rows were added as they were refined */
+	if (priv->search_offset + GS_PLUGIN_LOADER_SEARCH_PAGE_SIZE <
+	    gs_plugin_loader_search_get_n_matches (plugin_loader, res))
+		priv->search_offset_next = priv->search_offset + GS_PLUGIN_LOADER_SEARCH_PAGE_SIZE;
 	if (priv->appid_to_show != NULL) {
 		gs_shell_show_details (priv->shell, priv->appid_to_show);
 		g_clear_pointer (&priv->appid_to_show, g_free);
 	}
-	g_list_free_full (list, g_object_unref);
 }
 
 /**
- * gs_shell_search_load:
- */
+ * gs_shell_search_load_page:
+ **/
 static void
-gs_shell_search_load (GsShellSearch *shell_search)
+gs_shell_search_load_page (GsShellSearch *shell_search, guint offset)
 {
 	GsShellSearchPrivate *priv = shell_search->priv;
 
-	/* remove old entries */
-	gs_container_remove_all (GTK_CONTAINER (priv->list_box_search));
-
 	/* cancel any pending searches */
 	if (priv->search_cancellable != NULL) {
 		g_cancellable_cancel (priv->search_cancellable);
 		g_object_unref (priv->search_cancellable);
 	}
 	priv->search_cancellable = g_cancellable_new ();
+	priv->search_offset = offset;
+	priv->search_offset_next = 0;
+	priv->search_n_shown = 0;
+
+	/* search for apps */
+	gs_plugin_loader_search_stream_async (priv->plugin_loader,
+					      priv->value,
+					      GS_PLUGIN_REFINE_FLAGS_DEFAULT |
+					      GS_PLUGIN_REFINE_FLAGS_REQUIRE_VERSION |
+					      GS_PLUGIN_REFINE_FLAGS_REQUIRE_HISTORY |
+					      GS_PLUGIN_REFINE_FLAGS_REQUIRE_SETUP_ACTION |
+					      GS_PLUGIN_REFINE_FLAGS_REQUIRE_DESCRIPTION |
+					      GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING,
+					      offset,
+					      gs_shell_search_add_batch_cb,
+					      shell_search,
+					      priv->search_cancellable,
+					      gs_shell_search_get_search_cb,
+					      shell_search);
+}
+
+/**
+ * gs_shell_search_load:
+ */
+static void
+gs_shell_search_load (GsShellSearch *shell_search)
+{
+	GsShellSearchPrivate *priv = shell_search->priv;
+
+	/* remove old entries */
+	gs_container_remove_all (GTK_CONTAINER (priv->list_box_search));
+
+	/* the old results are no longer visible */
+	gs_prefetch_cancel (gs_shell_get_prefetch (priv->shell));
+	priv->n_prefetched = 0;
 
 	/* search for apps */
-	gs_plugin_loader_search_async (priv->plugin_loader,
-				       priv->value,
-				       GS_PLUGIN_REFINE_FLAGS_DEFAULT |
-				       GS_PLUGIN_REFINE_FLAGS_REQUIRE_VERSION |
-				       GS_PLUGIN_REFINE_FLAGS_REQUIRE_HISTORY |
-				       GS_PLUGIN_REFINE_FLAGS_REQUIRE_SETUP_ACTION |
-				       GS_PLUGIN_REFINE_FLAGS_REQUIRE_DESCRIPTION |
-				       GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING,
-				       priv->search_cancellable,
-				       gs_shell_search_get_search_cb,
-				       shell_search);
+	gs_shell_search_load_page (shell_search, 0);
 
 	gtk_stack_set_visible_child_name (GTK_STACK (priv->stack_search), "spinner");
 	gs_start_spinner (GTK_SPINNER (priv->spinner_search));
 }
 
+/**
+ * gs_shell_search_edge_reached_cb:
+ *
+ * Loads the next page of results once the last one has been scrolled to.
+ **/
+static void
+gs_shell_search_edge_reached_cb (GtkScrolledWindow *scrolled_window,
+				 GtkPositionType pos,
+				 GsShellSearch *shell_search)
+{
+	GsShellSearchPrivate *priv = shell_search->priv;
+
+	if (pos != GTK_POS_BOTTOM)
+		return;
+	if (priv->search_offset_next == 0)
+		return;
+	gs_shell_search_load_page (shell_search, priv->search_offset_next);
+}
+
 /**
  * gs_shell_search_reload:
  */
@@ -397,6 +476,8 @@ gs_shell_search_setup (GsShellSearch *shell_search,
 	gtk_list_box_set_sort_func (GTK_LIST_BOX (priv->list_box_search),
 				    gs_shell_search_sort_func,
 				    shell_search, NULL);
+	g_signal_connect (priv->scrolledwindow_search, "edge-reached",
+			  G_CALLBACK (gs_shell_search_edge_reached_cb), shell_search);
 
 	/* chain up */
 	gs_page_setup (GS_PAGE (shell_search),
@@ -420,6 +501,8 @@ gs_shell_search_dispose (GObject *object)
 	g_clear_object (&priv->builder);
 	g_clear_object (&priv->plugin_loader);
 	g_clear_object (&priv->cancellable);
+	if (priv->search_cancellable != NULL)
+		g_cancellable_cancel (priv->search_cancellable);
 	g_clear_object (&priv->search_cancellable);
 
 	g_free (priv->appid_to_show);
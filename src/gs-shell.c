@@ -61,6 +61,7 @@ struct GsShellPrivate
 	gboolean		 ignore_primary_buttons;
 	GCancellable		*cancellable;
 	GsPluginLoader		*plugin_loader;
+	GsPrefetch		*prefetch;
 	GsShellMode		 mode;
 	GsShellOverview		*shell_overview;
 	GsShellInstalled	*shell_installed;
@@ -94,6 +95,16 @@ gs_shell_is_active (GsShell *shell)
 	return gtk_window_is_active (priv->main_window);
 }
 
+/**
+ * gs_shell_get_prefetch:
+ **/
+GsPrefetch *
+gs_shell_get_prefetch (GsShell *shell)
+{
+	GsShellPrivate *priv = shell->priv;
+	return priv->prefetch;
+}
+
 /**
  * gs_shell_get_window:
  **/
@@ -129,6 +140,9 @@ gs_shell_change_mode (GsShell *shell,
 	if (priv->ignore_primary_buttons)
 		return;
 
+	/* the new page will prefetch what it shows */
+	gs_prefetch_cancel (priv->prefetch);
+
 	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "header"));
 	gtk_header_bar_set_show_close_button (GTK_HEADER_BAR (widget), TRUE);
 
@@ -814,6 +828,7 @@ gs_shell_dispose (GObject *object)
 	g_clear_object (&priv->builder);
 	g_clear_object (&priv->cancellable);
 	g_clear_object (&priv->plugin_loader);
+	g_clear_object (&priv->prefetch);
 
 	G_OBJECT_CLASS (gs_shell_parent_class)->dispose (object);
 }
@@ -843,6 +858,7 @@ gs_shell_init (GsShell *shell)
 {
 	shell->priv = gs_shell_get_instance_private (shell);
 	shell->priv->back_entry_stack = g_queue_new ();
+	shell->priv->prefetch = gs_prefetch_new ();
 	shell->priv->ignore_primary_buttons = FALSE;
 }
 
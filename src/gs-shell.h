@@ -28,6 +28,7 @@
 #include "gs-plugin-loader.h"
 #include "gs-category.h"
 #include "gs-app.h"
+#include "gs-prefetch.h"
 
 G_BEGIN_DECLS
 
@@ -102,6 +103,7 @@ void		 gs_shell_setup			(GsShell	*shell,
 						 GCancellable	*cancellable);
 void		 gs_shell_invalidate		(GsShell	*shell);
 gboolean	 gs_shell_is_active		(GsShell	*shell);
+GsPrefetch	*gs_shell_get_prefetch		(GsShell	*shell);
 GtkWindow	*gs_shell_get_window		(GsShell	*shell);
 
 G_END_DECLS
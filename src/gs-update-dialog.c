@@ -44,6 +44,7 @@ struct _GsUpdateDialogPrivate
 	GQueue		*back_entry_stack;
 	GCancellable	*cancellable;
 	GsPluginLoader	*plugin_loader;
+	GsApp		*app;
 	GtkWidget	*box_header;
 	GtkWidget	*button_back;
 	GtkWidget	*image_icon;
@@ -89,6 +90,40 @@ back_entry_free (BackEntry *entry)
 	g_slice_free (BackEntry, entry);
 }
 
+static void
+gs_update_dialog_notify_pixbuf_cb (GsApp *app,
+				   GParamSpec *pspec,
+				   GsUpdateDialog *dialog)
+{
+	GsUpdateDialogPrivate *priv = gs_update_dialog_get_instance_private (dialog);
+	const GdkPixbuf *pixbuf;
+
+	pixbuf = gs_app_get_pixbuf (app);
+	if (pixbuf != NULL)
+		gs_image_set_from_pixbuf (GTK_IMAGE (priv->image_icon), pixbuf);
+}
+
+static void
+gs_update_dialog_set_app (GsUpdateDialog *dialog, GsApp *app)
+{
+	GsUpdateDialogPrivate *priv = gs_update_dialog_get_instance_private (dialog);
+
+	if (priv->app != NULL) {
+		g_signal_handlers_disconnect_by_func (priv->app,
+						      gs_update_dialog_notify_pixbuf_cb,
+						      dialog);
+		g_clear_object (&priv->app);
+	}
+	if (app == NULL)
+		return;
+
+	/* the icon may still be loading */
+	priv->app = g_object_ref (app);
+	g_signal_connect_object (app, "notify::pixbuf",
+				 G_CALLBACK (gs_update_dialog_notify_pixbuf_cb),
+				 dialog, 0);
+}
+
 static void
 set_updates_description_ui (GsUpdateDialog *dialog, GsApp *app)
 {
@@ -133,6 +168,7 @@ set_updates_description_ui (GsUpdateDialog *dialog, GsApp *app)
 	gtk_label_set_label (GTK_LABEL (priv->label_name), gs_app_get_name (app));
 	gtk_label_set_label (GTK_LABEL (priv->label_summary), gs_app_get_summary (app));
 
+	gs_update_dialog_set_app (dialog, app);
 	pixbuf = gs_app_get_pixbuf (app);
 	if (pixbuf != NULL)
 		gs_image_set_from_pixbuf (GTK_IMAGE (priv->image_icon), pixbuf);
@@ -418,6 +454,7 @@ gs_update_dialog_dispose (GObject *object)
 		g_clear_object (&priv->cancellable);
 	}
 
+	gs_update_dialog_set_app (dialog, NULL);
 	g_clear_object (&priv->plugin_loader);
 
 	G_OBJECT_CLASS (gs_update_dialog_parent_class)->dispose (object);
@@ -0,0 +1,364 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2013 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+
+#include <glib/gstdio.h>
+
+#include <gs-cache.h>
+#include <gs-plugin.h>
+
+#include "gs-cleanup.h"
+#include "fwupd-download.h"
+
+/* can be overridden using GNOME_SOFTWARE_FIRMWARE_CONNECTIONS */
+#define GS_PLUGIN_FWUPD_MAX_CONNS	4
+
+/* the amount of a file that is read into memory at once */
+#define GS_PLUGIN_FWUPD_CHUNK_SIZE	(32 * 1024)
+
+/**
+ * gs_plugin_fwupd_download_new:
+ *
+ * Creates a download of @uri to @filename, which is written to
+ * @filename with a .part suffix until it is complete.
+ */
+GsPluginFwupdDownload *
+gs_plugin_fwupd_download_new (const gchar *uri, const gchar *filename)
+{
+	GsPluginFwupdDownload *dl;
+
+	dl = g_slice_new0 (GsPluginFwupdDownload);
+	dl->uri = g_strdup (uri);
+	dl->filename = g_strdup (filename);
+	dl->filename_part = g_strdup_printf ("%s.part", filename);
+	return dl;
+}
+
+/**
+ * gs_plugin_fwupd_download_free:
+ */
+void
+gs_plugin_fwupd_download_free (GsPluginFwupdDownload *dl)
+{
+	if (dl->stream != NULL)
+		g_object_unref (dl->stream);
+	if (dl->error != NULL)
+		g_error_free (dl->error);
+	g_free (dl->uri);
+	g_free (dl->filename);
+	g_free (dl->filename_part);
+	g_slice_free (GsPluginFwupdDownload, dl);
+}
+
+/**
+ * gs_plugin_fwupd_download_open:
+ *
+ * Opens the partial file for the response body, either appending to what
+ * is already there or starting again if the server sent the whole file.
+ */
+static gboolean
+gs_plugin_fwupd_download_open (GsPluginFwupdDownload *dl,
+			       SoupMessage *msg,
+			       GError **error)
+{
+	goffset start;
+	goffset end;
+	goffset total;
+	_cleanup_object_unref_ GFile *file = NULL;
+
+	file = g_file_new_for_path (dl->filename_part);
+	if (msg->status_code == SOUP_STATUS_PARTIAL_CONTENT) {
+		if (!soup_message_headers_get_content_range (msg->response_headers,
+							     &start, &end, &total) ||
+		    start != dl->offset) {
+			g_set_error (error,
+				     GS_PLUGIN_ERROR,
+				     GS_PLUGIN_ERROR_FAILED,
+				     "%s did not resume at %" G_GOFFSET_FORMAT,
+				     dl->uri, dl->offset);
+			return FALSE;
+		}
+		g_debug ("resuming %s at %" G_GOFFSET_FORMAT, dl->uri, dl->offset);
+		dl->stream = G_OUTPUT_STREAM (g_file_append_to (file,
+								G_FILE_CREATE_NONE,
+								NULL, error));
+	} else {
+		dl->stream = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE,
+							      G_FILE_CREATE_NONE,
+							      NULL, error));
+	}
+	return dl->stream != NULL;
+}
+
+/**
+ * gs_plugin_fwupd_download_got_headers_cb:
+ */
+static void
+gs_plugin_fwupd_download_got_headers_cb (SoupMessage *msg, gpointer user_data)
+{
+	GsPluginFwupdDownload *dl = (GsPluginFwupdDownload *) user_data;
+
+	if (msg->status_code != SOUP_STATUS_OK &&
+	    msg->status_code != SOUP_STATUS_PARTIAL_CONTENT)
+		return;
+	if (!gs_plugin_fwupd_download_open (dl, msg, &dl->error))
+		soup_session_cancel_message (dl->session, msg, SOUP_STATUS_IO_ERROR);
+}
+
+/**
+ * gs_plugin_fwupd_download_got_chunk_cb:
+ *
+ * Writes each part of the body to disk as it arrives.
+ */
+static void
+gs_plugin_fwupd_download_got_chunk_cb (SoupMessage *msg,
+				       SoupBuffer *chunk,
+				       gpointer user_data)
+{
+	GsPluginFwupdDownload *dl = (GsPluginFwupdDownload *) user_data;
+
+	if (dl->stream == NULL)
+		return;
+	if (!g_output_stream_write_all (dl->stream, chunk->data, chunk->length,
+					NULL, NULL, &dl->error))
+		soup_session_cancel_message (dl->session, msg, SOUP_STATUS_IO_ERROR);
+}
+
+/**
+ * gs_plugin_fwupd_download_finished_cb:
+ */
+static void
+gs_plugin_fwupd_download_finished_cb (SoupSession *session,
+				      SoupMessage *msg,
+				      gpointer user_data)
+{
+	GsPluginFwupdDownload *dl = (GsPluginFwupdDownload *) user_data;
+
+	(*dl->pending)--;
+
+	/* flush what was written, even if the download did not finish */
+	if (dl->stream != NULL && dl->error == NULL)
+		g_output_stream_close (dl->stream, NULL, &dl->error);
+	if (dl->error != NULL) {
+		g_warning ("Failed to save %s: %s", dl->uri, dl->error->message);
+		g_unlink (dl->filename_part);
+		return;
+	}
+	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		gs_cache_touch (dl->filename);
+		return;
+	}
+
+	/* keep what we have for next time if the connection went away */
+	if (SOUP_STATUS_IS_TRANSPORT_ERROR (msg->status_code)) {
+		g_warning ("Failed to download %s, will resume: %s",
+			   dl->uri, soup_status_get_phrase (msg->status_code));
+		return;
+	}
+
+	/* the partial file is no good, so start again next time */
+	if (msg->status_code == SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE) {
+		g_warning ("Failed to resume %s, restarting", dl->uri);
+		g_unlink (dl->filename_part);
+		return;
+	}
+	if (dl->stream == NULL) {
+		g_warning ("Failed to download %s, ignoring: %s",
+			   dl->uri, soup_status_get_phrase (msg->status_code));
+		g_unlink (dl->filename_part);
+		dl->failed = TRUE;
+		return;
+	}
+
+	/* the file is complete, and is checked against the metadata when
+	 * the update is added */
+	if (g_rename (dl->filename_part, dl->filename) != 0) {
+		g_warning ("Failed to save %s to %s", dl->uri, dl->filename);
+		return;
+	}
+	gs_cache_add (GS_CACHE_KIND_FIRMWARE, dl->filename, msg);
+}
+
+/**
+ * gs_plugin_fwupd_cancelled_cb:
+ */
+static gboolean
+gs_plugin_fwupd_cancelled_cb (GCancellable *cancellable, gpointer user_data)
+{
+	soup_session_abort (SOUP_SESSION (user_data));
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * gs_plugin_fwupd_get_max_conns:
+ */
+static guint
+gs_plugin_fwupd_get_max_conns (void)
+{
+	const gchar *tmp;
+	guint64 value;
+
+	tmp = g_getenv ("GNOME_SOFTWARE_FIRMWARE_CONNECTIONS");
+	if (tmp == NULL)
+		return GS_PLUGIN_FWUPD_MAX_CONNS;
+	value = g_ascii_strtoull (tmp, NULL, 10);
+	if (value == 0 || value > 64)
+		return GS_PLUGIN_FWUPD_MAX_CONNS;
+	return value;
+}
+
+/**
+ * gs_plugin_fwupd_download_all:
+ *
+ * Downloads the firmware files at the same time, streaming each one to a
+ * partial file in the cache and resuming any earlier partial download.
+ * A private main context is used so that this can be called from the
+ * refresh thread.
+ *
+ * Files that could not be fetched are left for the next refresh. If
+ * @cancellable is cancelled everything in progress is stopped, the partial
+ * files are kept, and %G_IO_ERROR_CANCELLED is returned.
+ */
+gboolean
+gs_plugin_fwupd_download_all (GPtrArray *downloads,
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	GStatBuf buf;
+	GsPluginFwupdDownload *dl;
+	GMainContext *context;
+	GSource *source = NULL;
+	SoupMessage *msg;
+	gboolean ret = TRUE;
+	guint i;
+	guint max_conns;
+	guint pending = 0;
+	_cleanup_object_unref_ SoupSession *session = NULL;
+
+	/* async operations will use the thread default context */
+	context = g_main_context_new ();
+	g_main_context_push_thread_default (context);
+	max_conns = gs_plugin_fwupd_get_max_conns ();
+	session = soup_session_new_with_options (SOUP_SESSION_USER_AGENT, "gnome-software",
+						 SOUP_SESSION_MAX_CONNS, max_conns,
+						 SOUP_SESSION_MAX_CONNS_PER_HOST, max_conns,
+						 SOUP_SESSION_USE_THREAD_CONTEXT, TRUE,
+						 NULL);
+	if (session == NULL) {
+		g_set_error_literal (error,
+				     GS_PLUGIN_ERROR,
+				     GS_PLUGIN_ERROR_FAILED,
+				     "failed to setup networking");
+		ret = FALSE;
+		goto out;
+	}
+
+	/* queue all the requests, the session limits the connections */
+	for (i = 0; i < downloads->len; i++) {
+		dl = g_ptr_array_index (downloads, i);
+		msg = soup_message_new (SOUP_METHOD_GET, dl->uri);
+		if (msg == NULL) {
+			g_warning ("%s is not a valid URL", dl->uri);
+			dl->failed = TRUE;
+			continue;
+		}
+		if (g_stat (dl->filename_part, &buf) == 0 && buf.st_size > 0) {
+			dl->offset = buf.st_size;
+			soup_message_headers_set_range (msg->request_headers,
+							dl->offset, -1);
+		} else {
+			gs_cache_prepare_message (dl->filename, msg);
+		}
+		soup_message_body_set_accumulate (msg->response_body, FALSE);
+		g_signal_connect (msg, "got-headers",
+				  G_CALLBACK (gs_plugin_fwupd_download_got_headers_cb), dl);
+		g_signal_connect (msg, "got-chunk",
+				  G_CALLBACK (gs_plugin_fwupd_download_got_chunk_cb), dl);
+		dl->pending = &pending;
+		dl->session = session;
+		pending++;
+		soup_session_queue_message (session, msg,
+					    gs_plugin_fwupd_download_finished_cb, dl);
+	}
+
+	/* abort everything that is still in progress when cancelled */
+	if (cancellable != NULL) {
+		source = g_cancellable_source_new (cancellable);
+		g_source_set_callback (source,
+				       (GSourceFunc) gs_plugin_fwupd_cancelled_cb,
+				       session, NULL);
+		g_source_attach (source, context);
+	}
+
+	/* wait for all the callbacks */
+	while (pending > 0)
+		g_main_context_iteration (context, TRUE);
+
+	/* the aborted downloads look like transport errors */
+	if (g_cancellable_set_error_if_cancelled (cancellable, error))
+		ret = FALSE;
+out:
+	if (source != NULL) {
+		g_source_destroy (source);
+		g_source_unref (source);
+	}
+	g_main_context_pop_thread_default (context);
+	g_main_context_unref (context);
+	return ret;
+}
+
+/**
+ * gs_plugin_fwupd_get_file_checksum:
+ *
+ * Works out the SHA1 of @filename as it is on disk, without loading the
+ * whole file into memory.
+ *
+ * Returns: the checksum as a hex string, or %NULL for error
+ */
+gchar *
+gs_plugin_fwupd_get_file_checksum (const gchar *filename,
+				   GCancellable *cancellable,
+				   GError **error)
+{
+	gssize len;
+	_cleanup_checksum_free_ GChecksum *checksum = NULL;
+	_cleanup_free_ guchar *buf = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
+	_cleanup_object_unref_ GFileInputStream *stream = NULL;
+
+	file = g_file_new_for_path (filename);
+	stream = g_file_read (file, cancellable, error);
+	if (stream == NULL)
+		return NULL;
+	checksum = g_checksum_new (G_CHECKSUM_SHA1);
+	buf = g_malloc (GS_PLUGIN_FWUPD_CHUNK_SIZE);
+	do {
+		len = g_input_stream_read (G_INPUT_STREAM (stream), buf,
+					   GS_PLUGIN_FWUPD_CHUNK_SIZE,
+					   cancellable, error);
+		if (len < 0)
+			return NULL;
+		g_checksum_update (checksum, buf, len);
+	} while (len > 0);
+	return g_strdup (g_checksum_get_string (checksum));
+}
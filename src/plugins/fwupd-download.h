@@ -0,0 +1,56 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2013 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __FWUPD_DOWNLOAD_H
+#define __FWUPD_DOWNLOAD_H
+
+#include <gio/gio.h>
+#include <libsoup/soup.h>
+
+G_BEGIN_DECLS
+
+/* one firmware file to fetch into the cache */
+typedef struct {
+	guint			*pending;	/* owned by the caller */
+	SoupSession		*session;
+	gchar			*uri;
+	gchar			*filename;
+	gchar			*filename_part;
+	goffset			 offset;	/* already in the partial file */
+	GOutputStream		*stream;
+	GError			*error;
+	gboolean		 failed;	/* don't try this again */
+} GsPluginFwupdDownload;
+
+GsPluginFwupdDownload	*gs_plugin_fwupd_download_new	(const gchar	*uri,
+							 const gchar	*filename);
+void		 gs_plugin_fwupd_download_free		(GsPluginFwupdDownload *dl);
+gboolean	 gs_plugin_fwupd_download_all		(GPtrArray	*downloads,
+							 GCancellable	*cancellable,
+							 GError		**error);
+gchar		*gs_plugin_fwupd_get_file_checksum	(const gchar	*filename,
+							 GCancellable	*cancellable,
+							 GError		**error);
+
+G_END_DECLS
+
+#endif /* __FWUPD_DOWNLOAD_H */
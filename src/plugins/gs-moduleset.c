@@ -46,6 +46,7 @@ typedef struct {
 	GPtrArray		*array;
 	GsModulesetEntry	*entry_tmp;
 	GsModulesetParserSection section;
+	GHashTable		*index[GS_MODULESET_MODULE_KIND_LAST];
 } GsModulesetPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (GsModuleset, gs_moduleset, G_TYPE_OBJECT)
@@ -83,6 +84,35 @@ gs_moduleset_get_modules (GsModuleset *moduleset,
 	return data;
 }
 
+/**
+ * gs_moduleset_has_module:
+ *
+ * Checks if @id is listed in the moduleset called @name. The lookup is
+ * done using an index built when the moduleset files are parsed.
+ *
+ * Returns: %TRUE if the module was found
+ **/
+gboolean
+gs_moduleset_has_module (GsModuleset *moduleset,
+			 GsModulesetModuleKind module_kind,
+			 const gchar *name,
+			 const gchar *id)
+{
+	GsModulesetPrivate *priv = gs_moduleset_get_instance_private (moduleset);
+	GHashTable *ids;
+
+	g_return_val_if_fail (GS_IS_MODULESET (moduleset), FALSE);
+	g_return_val_if_fail (module_kind < GS_MODULESET_MODULE_KIND_LAST, FALSE);
+	g_return_val_if_fail (name != NULL, FALSE);
+
+	if (id == NULL)
+		return FALSE;
+	ids = g_hash_table_lookup (priv->index[module_kind], name);
+	if (ids == NULL)
+		return FALSE;
+	return g_hash_table_contains (ids, id);
+}
+
 /**
  * gs_moduleset_get_core_packages:
  **/
@@ -274,6 +304,27 @@ gs_moduleset_parser_start_element (GMarkupParseContext *context,
 	}
 }
 
+/**
+ * gs_moduleset_index_entry:
+ **/
+static void
+gs_moduleset_index_entry (GsModuleset *moduleset, GsModulesetEntry *entry)
+{
+	GsModulesetPrivate *priv = gs_moduleset_get_instance_private (moduleset);
+	GHashTable *ids;
+
+	if (entry->name == NULL || entry->id == NULL)
+		return;
+
+	/* the strings are owned by the entry in priv->array */
+	ids = g_hash_table_lookup (priv->index[entry->module_kind], entry->name);
+	if (ids == NULL) {
+		ids = g_hash_table_new (g_str_hash, g_str_equal);
+		g_hash_table_insert (priv->index[entry->module_kind], entry->name, ids);
+	}
+	g_hash_table_add (ids, entry->id);
+}
+
 /**
  * gs_moduleset_parser_end_element:
  **/
@@ -294,6 +345,7 @@ gs_moduleset_parser_end_element (GMarkupParseContext *context,
 		break;
 	case GS_MODULESET_PARSER_SECTION_MODULE:
 		priv->section = GS_MODULESET_PARSER_SECTION_MODULESET;
+		gs_moduleset_index_entry (moduleset, priv->entry_tmp);
 		g_ptr_array_add (priv->array, priv->entry_tmp);
 		priv->entry_tmp = NULL;
 		break;
@@ -398,11 +450,14 @@ gs_moduleset_finalize (GObject *object)
 {
 	GsModuleset *moduleset;
 	GsModulesetPrivate *priv;
+	guint i;
 
 	g_return_if_fail (GS_IS_MODULESET (object));
 
 	moduleset = GS_MODULESET (object);
 	priv = gs_moduleset_get_instance_private (moduleset);
+	for (i = 0; i < GS_MODULESET_MODULE_KIND_LAST; i++)
+		g_hash_table_unref (priv->index[i]);
 	g_ptr_array_unref (priv->array);
 
 	G_OBJECT_CLASS (gs_moduleset_parent_class)->finalize (object);
@@ -419,7 +474,13 @@ static void
 gs_moduleset_init (GsModuleset *moduleset)
 {
 	GsModulesetPrivate *priv = gs_moduleset_get_instance_private (moduleset);
+	guint i;
+
 	priv->array = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_moduleset_entry_free);
+	for (i = 0; i < GS_MODULESET_MODULE_KIND_LAST; i++) {
+		priv->index[i] = g_hash_table_new_full (g_str_hash, g_str_equal,
+							NULL, (GDestroyNotify) g_hash_table_unref);
+	}
 }
 
 GsModuleset *
@@ -53,6 +53,10 @@ gchar		**gs_moduleset_get_modules		(GsModuleset		*moduleset,
 							 GsModulesetModuleKind	 module_kind,
 							 const gchar		*name,
 							 const gchar		*category);
+gboolean	 gs_moduleset_has_module		(GsModuleset		*moduleset,
+							 GsModulesetModuleKind	 module_kind,
+							 const gchar		*name,
+							 const gchar		*id);
 gchar		**gs_moduleset_get_core_packages	(GsModuleset		*moduleset);
 gchar		**gs_moduleset_get_system_apps		(GsModuleset		*moduleset);
 gchar		**gs_moduleset_get_popular_apps		(GsModuleset		*moduleset);
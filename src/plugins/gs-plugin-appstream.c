@@ -27,17 +27,40 @@
 #include "gs-cleanup.h"
 #include <gs-plugin.h>
 #include <gs-plugin-loader.h>
+#include <gs-cache.h>
+#include <gs-icon-cache.h>
 
 #define	GS_PLUGIN_APPSTREAM_MAX_SCREENSHOTS	5
+#define	GS_PLUGIN_APPSTREAM_COMPACT_MIN		64	/* removed slots */
 
 struct GsPluginPrivate {
 	AsStore			*store;
 	GMutex			 store_mutex;
 	gchar			*locale;
-	gsize			 done_init;
+	GMutex			 init_mutex;
+	gboolean		 done_init;
 	gboolean		 has_hi_dpi_support;
+	GPtrArray		*search_apps;		/* of AsApp, or NULL if removed */
+	GPtrArray		*search_app_tokens;	/* of GPtrArray of search_index keys */
+	GArray			*search_order;		/* of guint, store position */
+	guint			 search_n_removed;	/* slots that are NULL */
+	GHashTable		*search_slots;		/* id:search_apps index + 1 */
+	GHashTable		*search_index;		/* token:GArray of GsPluginAppstreamPosting */
+	GPtrArray		*search_tokens;		/* sorted keys of search_index */
+	GHashTable		*fingerprints;		/* id:SHA-256 of loaded apps */
+	GHashTable		*origins;		/* origin:percentage of the store */
+	GMutex			 changed_mutex;
+	GCond			 changed_cond;
+	gboolean		 loaded;
+	gboolean		 changed_pending;
+	guint			 changed_running;	/* store-changed threads */
 };
 
+typedef struct {
+	guint			 idx;			/* into search_apps */
+	guint			 match_value;		/* AsAppTokenType for an exact match */
+} GsPluginAppstreamPosting;
+
 static gboolean gs_plugin_refine_item (GsPlugin *plugin, GsApp *app, AsApp *item, GError **error);
 
 /**
@@ -68,18 +91,507 @@ as_app_has_compulsory_for_desktop (AsApp *app, const gchar *compulsory_for_deskt
 	return FALSE;
 }
 
+/**
+ * gs_plugin_appstream_fingerprint_add_array:
+ */
+static void
+gs_plugin_appstream_fingerprint_add_array (GString *str, GPtrArray *array)
+{
+	guint i;
+
+	if (array != NULL) {
+		for (i = 0; i < array->len; i++) {
+			g_string_append (str, g_ptr_array_index (array, i));
+			g_string_append_c (str, ';');
+		}
+	}
+	g_string_append_c (str, '\n');
+}
+
+/**
+ * gs_plugin_appstream_get_fingerprint:
+ *
+ * Returns: a checksum of the metadata that ends up being shown for @app, so
+ * that a reload can tell which applications actually changed. A 32 bit hash
+ * could collide and hide a change until the next restart.
+ */
+static gchar *
+gs_plugin_appstream_get_fingerprint (AsApp *app)
+{
+	AsIcon *icon;
+	AsImage *im;
+	AsRelease *release = NULL;
+	AsScreenshot *ss;
+	GPtrArray *images;
+	GPtrArray *releases;
+	GPtrArray *screenshots;
+	const gchar *keys[7];
+	guint i;
+	guint j;
+	_cleanup_string_free_ GString *str = NULL;
+
+	releases = as_app_get_releases (app);
+	if (releases->len > 0)
+		release = g_ptr_array_index (releases, 0);
+	icon = as_app_get_icon_default (app);
+	keys[0] = as_app_get_pkgname_default (app);
+	keys[1] = as_app_get_origin (app);
+	keys[2] = as_app_get_name (app, NULL);
+	keys[3] = as_app_get_comment (app, NULL);
+	keys[4] = as_app_get_description (app, NULL);
+	keys[5] = release != NULL ? as_release_get_version (release) : NULL;
+	keys[6] = icon != NULL ? as_icon_get_name (icon) : NULL;
+	str = g_string_new (NULL);
+	for (i = 0; i < G_N_ELEMENTS (keys); i++) {
+		if (keys[i] != NULL)
+			g_string_append (str, keys[i]);
+		g_string_append_c (str, '\n');
+	}
+
+	/* these are shown on the details page and used for searching */
+	gs_plugin_appstream_fingerprint_add_array (str, as_app_get_categories (app));
+	gs_plugin_appstream_fingerprint_add_array (str, as_app_get_keywords (app, NULL));
+	screenshots = as_app_get_screenshots (app);
+	for (i = 0; i < screenshots->len; i++) {
+		ss = g_ptr_array_index (screenshots, i);
+		images = as_screenshot_get_images (ss);
+		for (j = 0; j < images->len; j++) {
+			im = g_ptr_array_index (images, j);
+			if (as_image_get_url (im) != NULL)
+				g_string_append (str, as_image_get_url (im));
+			g_string_append_c (str, ';');
+		}
+		g_string_append_c (str, '\n');
+	}
+	return g_compute_checksum_for_string (G_CHECKSUM_SHA256, str->str, str->len);
+}
+
+/**
+ * gs_plugin_appstream_get_fingerprints:
+ */
+static GHashTable *
+gs_plugin_appstream_get_fingerprints (GPtrArray *items)
+{
+	AsApp *app;
+	GHashTable *hash;
+	guint i;
+
+	hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	for (i = 0; i < items->len; i++) {
+		app = g_ptr_array_index (items, i);
+		if (as_app_get_id (app) == NULL)
+			continue;
+		g_hash_table_insert (hash,
+				     g_strdup (as_app_get_id (app)),
+				     gs_plugin_appstream_get_fingerprint (app));
+	}
+	return hash;
+}
+
+/**
+ * gs_plugin_appstream_token_sort_cb:
+ */
+static gint
+gs_plugin_appstream_token_sort_cb (gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0 (*((const gchar **) a), *((const gchar **) b));
+}
+
+/**
+ * gs_plugin_appstream_search_token_find:
+ *
+ * Returns: the index of the first sorted token that is not less than @term
+ */
+static guint
+gs_plugin_appstream_search_token_find (GPtrArray *tokens, const gchar *term)
+{
+	guint hi = tokens->len;
+	guint lo = 0;
+	guint mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (g_strcmp0 (g_ptr_array_index (tokens, mid), term) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/**
+ * gs_plugin_appstream_search_index_clear:
+ */
+static void
+gs_plugin_appstream_search_index_clear (GsPlugin *plugin)
+{
+	GPtrArray *app_tokens;
+	AsApp *app;
+	guint i;
+
+	if (plugin->priv->search_apps != NULL) {
+		for (i = 0; i < plugin->priv->search_apps->len; i++) {
+			app = g_ptr_array_index (plugin->priv->search_apps, i);
+			if (app != NULL)
+				g_object_unref (app);
+			app_tokens = g_ptr_array_index (plugin->priv->search_app_tokens, i);
+			if (app_tokens != NULL)
+				g_ptr_array_unref (app_tokens);
+		}
+	}
+	g_clear_pointer (&plugin->priv->search_apps, g_ptr_array_unref);
+	g_clear_pointer (&plugin->priv->search_app_tokens, g_ptr_array_unref);
+	g_clear_pointer (&plugin->priv->search_order, g_array_unref);
+	plugin->priv->search_n_removed = 0;
+	g_clear_pointer (&plugin->priv->search_slots, g_hash_table_unref);
+	g_clear_pointer (&plugin->priv->search_tokens, g_ptr_array_unref);
+	g_clear_pointer (&plugin->priv->search_index, g_hash_table_unref);
+}
+
+/**
+ * gs_plugin_appstream_search_index_add:
+ *
+ * Adds a posting for each token of @app. If @keep_sorted is set then any
+ * new tokens are also inserted into the sorted list, otherwise the caller
+ * has to rebuild it. The new slot is last in store order until the caller
+ * sets its position.
+ */
+static void
+gs_plugin_appstream_search_index_add (GsPlugin *plugin,
+				      AsApp *app,
+				      gboolean keep_sorted)
+{
+	GArray *postings;
+	GPtrArray *app_tokens;
+	GPtrArray *tokens;
+	GsPluginAppstreamPosting posting;
+	const gchar *token;
+	gchar *key;
+	guint i;
+
+	posting.idx = plugin->priv->search_apps->len;
+	app_tokens = g_ptr_array_new ();
+	g_ptr_array_add (plugin->priv->search_apps, g_object_ref (app));
+	g_ptr_array_add (plugin->priv->search_app_tokens, app_tokens);
+	g_array_append_val (plugin->priv->search_order, posting.idx);
+	if (as_app_get_id (app) != NULL) {
+		g_hash_table_insert (plugin->priv->search_slots,
+				     g_strdup (as_app_get_id (app)),
+				     GUINT_TO_POINTER (posting.idx + 1));
+	}
+
+	tokens = as_app_get_search_tokens (app);
+	for (i = 0; i < tokens->len; i++) {
+		token = g_ptr_array_index (tokens, i);
+
+		/* an exact match is scored four times a partial one */
+		posting.match_value = as_app_search_matches (app, token) >> 2;
+		if (posting.match_value == 0)
+			continue;
+		if (!g_hash_table_lookup_extended (plugin->priv->search_index, token,
+						   (gpointer *) &key,
+						   (gpointer *) &postings)) {
+			key = g_strdup (token);
+			postings = g_array_new (FALSE, FALSE, sizeof (GsPluginAppstreamPosting));
+			g_hash_table_insert (plugin->priv->search_index, key, postings);
+			if (keep_sorted) {
+				g_ptr_array_insert (plugin->priv->search_tokens,
+						    gs_plugin_appstream_search_token_find (plugin->priv->search_tokens, key),
+						    key);
+			}
+		} else if (g_array_index (postings, GsPluginAppstreamPosting,
+					  postings->len - 1).idx == posting.idx) {
+			continue;
+		}
+		g_array_append_val (postings, posting);
+		g_ptr_array_add (app_tokens, key);
+	}
+}
+
+/**
+ * gs_plugin_appstream_search_index_remove:
+ *
+ * Removes the postings of the application with @id, and any token that no
+ * other application uses.
+ */
+static void
+gs_plugin_appstream_search_index_remove (GsPlugin *plugin, const gchar *id)
+{
+	AsApp *app;
+	GArray *postings;
+	GPtrArray *app_tokens;
+	gchar *key;
+	guint i;
+	guint idx;
+	guint j;
+
+	idx = GPOINTER_TO_UINT (g_hash_table_lookup (plugin->priv->search_slots, id));
+	if (idx == 0)
+		return;
+	idx--;
+	g_hash_table_remove (plugin->priv->search_slots, id);
+
+	app_tokens = g_ptr_array_index (plugin->priv->search_app_tokens, idx);
+	for (i = 0; i < app_tokens->len; i++) {
+		key = g_ptr_array_index (app_tokens, i);
+		postings = g_hash_table_lookup (plugin->priv->search_index, key);
+		for (j = 0; j < postings->len; j++) {
+			if (g_array_index (postings, GsPluginAppstreamPosting, j).idx == idx) {
+				g_array_remove_index (postings, j);
+				break;
+			}
+		}
+		if (postings->len > 0)
+			continue;
+		g_ptr_array_remove_index (plugin->priv->search_tokens,
+					  gs_plugin_appstream_search_token_find (plugin->priv->search_tokens, key));
+		g_hash_table_remove (plugin->priv->search_index, key);
+	}
+
+	/* keep the slot so the other postings stay valid, until compacted */
+	g_ptr_array_unref (app_tokens);
+	g_ptr_array_index (plugin->priv->search_app_tokens, idx) = NULL;
+	app = g_ptr_array_index (plugin->priv->search_apps, idx);
+	g_object_unref (app);
+	g_ptr_array_index (plugin->priv->search_apps, idx) = NULL;
+	plugin->priv->search_n_removed++;
+}
+
+/**
+ * gs_plugin_appstream_build_search_index:
+ *
+ * Builds an inverted index of every search token in the store so that a
+ * search only has to look at the applications that actually match.
+ */
+static void
+gs_plugin_appstream_build_search_index (GsPlugin *plugin, GPtrArray *items)
+{
+	GHashTableIter iter;
+	const gchar *token;
+	guint i;
+
+	gs_profile_start (plugin->profile, "appstream::build-search-index");
+
+	/* clear any previous index */
+	gs_plugin_appstream_search_index_clear (plugin);
+	plugin->priv->search_apps = g_ptr_array_new ();
+	plugin->priv->search_app_tokens = g_ptr_array_new ();
+	plugin->priv->search_order = g_array_new (FALSE, FALSE, sizeof (guint));
+	plugin->priv->search_slots = g_hash_table_new_full (g_str_hash, g_str_equal,
+							    g_free, NULL);
+	plugin->priv->search_index = g_hash_table_new_full (g_str_hash, g_str_equal,
+							    g_free, (GDestroyNotify) g_array_unref);
+
+	/* add a posting for each token of each application */
+	for (i = 0; i < items->len; i++)
+		gs_plugin_appstream_search_index_add (plugin, g_ptr_array_index (items, i), FALSE);
+
+	/* sort the tokens so prefixes can be found with a binary search */
+	plugin->priv->search_tokens = g_ptr_array_new ();
+	g_hash_table_iter_init (&iter, plugin->priv->search_index);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &token, NULL))
+		g_ptr_array_add (plugin->priv->search_tokens, (gpointer) token);
+	g_ptr_array_sort (plugin->priv->search_tokens,
+			  gs_plugin_appstream_token_sort_cb);
+	g_debug ("indexed %u search tokens for %u applications",
+		 plugin->priv->search_tokens->len,
+		 plugin->priv->search_apps->len);
+
+	gs_profile_stop (plugin->profile, "appstream::build-search-index");
+}
+
+/**
+ * gs_plugin_appstream_add_origin_keyword:
+ *
+ * Adds the origin as a search term for apps not in the main source.
+ */
+static void
+gs_plugin_appstream_add_origin_keyword (GsPlugin *plugin, AsApp *app)
+{
+	GPtrArray *keywords;
+	const gchar *origin;
+	guint *perc;
+	guint i;
+
+	origin = as_app_get_origin (app);
+	if (origin == NULL)
+		return;
+	perc = g_hash_table_lookup (plugin->priv->origins, origin);
+	if (perc == NULL || *perc >= 10)
+		return;
+
+	/* the store may hand back an app that was already done */
+	keywords = as_app_get_keywords (app, NULL);
+	if (keywords != NULL) {
+		for (i = 0; i < keywords->len; i++) {
+			if (g_strcmp0 (g_ptr_array_index (keywords, i), origin) == 0)
+				return;
+		}
+	}
+	g_debug ("Adding keyword '%s' to %s", origin, as_app_get_id (app));
+#if AS_CHECK_VERSION(0,5,0)
+	as_app_add_keyword (app, NULL, origin);
+#else
+	as_app_add_keyword (app, NULL, origin, -1);
+#endif
+}
+
+/**
+ * gs_plugin_appstream_store_changed:
+ *
+ * Refreshes the fingerprints and search index for just the applications
+ * that were added, removed or modified, and tells the loader about them.
+ */
+static void
+gs_plugin_appstream_store_changed (GsPlugin *plugin)
+{
+	AsApp *app;
+	GHashTableIter iter;
+	GPtrArray *items;
+	const gchar *fingerprint_old;
+	const gchar *id;
+	gchar *fingerprint;
+	guint i;
+	guint idx;
+	_cleanup_hashtable_unref_ GHashTable *seen = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *ids = NULL;
+
+	g_mutex_lock (&plugin->priv->store_mutex);
+
+	/* the last load failed, so start again from scratch */
+	if (plugin->priv->fingerprints == NULL) {
+		g_mutex_unlock (&plugin->priv->store_mutex);
+		g_debug ("AppStream metadata changed, reloading cache");
+		g_mutex_lock (&plugin->priv->init_mutex);
+		plugin->priv->done_init = FALSE;
+		g_mutex_unlock (&plugin->priv->init_mutex);
+		gs_plugin_updates_changed (plugin);
+		return;
+	}
+
+	/* the store has already merged the changed files */
+	gs_profile_start (plugin->profile, "appstream::store-changed");
+	ids = g_ptr_array_new_with_free_func (g_free);
+	seen = g_hash_table_new (g_str_hash, g_str_equal);
+	items = as_store_get_apps (plugin->priv->store);
+	for (i = 0; i < items->len; i++) {
+		app = g_ptr_array_index (items, i);
+		id = as_app_get_id (app);
+		if (id == NULL)
+			continue;
+		g_hash_table_add (seen, (gpointer) id);
+		gs_plugin_appstream_add_origin_keyword (plugin, app);
+		fingerprint = gs_plugin_appstream_get_fingerprint (app);
+		fingerprint_old = g_hash_table_lookup (plugin->priv->fingerprints, id);
+		if (g_strcmp0 (fingerprint_old, fingerprint) == 0) {
+			g_free (fingerprint);
+
+			/* the same metadata may have been loaded again */
+			idx = GPOINTER_TO_UINT (g_hash_table_lookup (plugin->priv->search_slots, id));
+			if (idx > 0 && g_ptr_array_index (plugin->priv->search_apps, idx - 1) != app) {
+				g_object_unref (g_ptr_array_index (plugin->priv->search_apps, idx - 1));
+				g_ptr_array_index (plugin->priv->search_apps, idx - 1) = g_object_ref (app);
+			}
+		} else {
+			g_hash_table_insert (plugin->priv->fingerprints,
+					     g_strdup (id),
+					     fingerprint);
+			gs_plugin_appstream_search_index_remove (plugin, id);
+			gs_plugin_appstream_search_index_add (plugin, app, TRUE);
+			g_ptr_array_add (ids, g_strdup (id));
+		}
+
+		/* results are returned in store order, not slot order */
+		idx = GPOINTER_TO_UINT (g_hash_table_lookup (plugin->priv->search_slots, id));
+		if (idx > 0)
+			g_array_index (plugin->priv->search_order, guint, idx - 1) = i;
+	}
+
+	/* anything not in the store now has been removed */
+	g_hash_table_iter_init (&iter, plugin->priv->fingerprints);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &id, NULL)) {
+		if (g_hash_table_contains (seen, id))
+			continue;
+		gs_plugin_appstream_search_index_remove (plugin, id);
+		g_ptr_array_add (ids, g_strdup (id));
+		g_hash_table_iter_remove (&iter);
+	}
+
+	/* removed slots are kept so the postings stay valid, so rebuild
+	 * once too many have piled up */
+	if (plugin->priv->search_n_removed > GS_PLUGIN_APPSTREAM_COMPACT_MIN &&
+	    plugin->priv->search_n_removed > plugin->priv->search_apps->len / 4) {
+		g_debug ("compacting search index with %u removed slots",
+			 plugin->priv->search_n_removed);
+		gs_plugin_appstream_build_search_index (plugin, items);
+	}
+	gs_profile_stop (plugin->profile, "appstream::store-changed");
+	g_mutex_unlock (&plugin->priv->store_mutex);
+
+	if (ids->len == 0)
+		return;
+	g_debug ("AppStream metadata changed for %u applications", ids->len);
+	for (i = 0; i < ids->len; i++)
+		gs_icon_cache_invalidate_app (g_ptr_array_index (ids, i));
+	g_ptr_array_add (ids, NULL);
+	gs_plugin_apps_changed (plugin, (gchar **) ids->pdata);
+}
+
+/**
+ * gs_plugin_appstream_store_changed_thread_cb:
+ */
+static void
+gs_plugin_appstream_store_changed_thread_cb (GTask *task,
+					     gpointer object,
+					     gpointer task_data,
+					     GCancellable *cancellable)
+{
+	GsPlugin *plugin = (GsPlugin *) task_data;
+
+	gs_plugin_appstream_store_changed (plugin);
+
+	/* the plugin can now be destroyed */
+	g_mutex_lock (&plugin->priv->changed_mutex);
+	plugin->priv->changed_running--;
+	g_cond_broadcast (&plugin->priv->changed_cond);
+	g_mutex_unlock (&plugin->priv->changed_mutex);
+}
+
+/**
+ * gs_plugin_appstream_store_changed_schedule:
+ *
+ * The plugin is not a GObject the task can hold a reference on, so
+ * gs_plugin_destroy() waits for the threads that are still running.
+ */
+static void
+gs_plugin_appstream_store_changed_schedule (GsPlugin *plugin)
+{
+	_cleanup_object_unref_ GTask *task = NULL;
+
+	g_mutex_lock (&plugin->priv->changed_mutex);
+	plugin->priv->changed_running++;
+	g_mutex_unlock (&plugin->priv->changed_mutex);
+
+	task = g_task_new (NULL, NULL, NULL, NULL);
+	g_task_set_task_data (task, plugin, NULL);
+	g_task_run_in_thread (task, gs_plugin_appstream_store_changed_thread_cb);
+}
+
 /**
  * gs_plugin_appstream_store_changed_cb:
  */
 static void
 gs_plugin_appstream_store_changed_cb (AsStore *store, GsPlugin *plugin)
 {
-	g_debug ("AppStream metadata changed, reloading cache");
-	plugin->priv->done_init = FALSE;
-
-	/* this is not strictly true, but it causes all the UI to be reloaded
-	 * which is what we really want */
-	gs_plugin_updates_changed (plugin);
+	/* still loading, so look again once the startup has finished */
+	g_mutex_lock (&plugin->priv->changed_mutex);
+	if (!plugin->priv->loaded) {
+		plugin->priv->changed_pending = TRUE;
+		g_mutex_unlock (&plugin->priv->changed_mutex);
+		return;
+	}
+	g_mutex_unlock (&plugin->priv->changed_mutex);
+	gs_plugin_appstream_store_changed_schedule (plugin);
 }
 
 /**
@@ -90,6 +602,9 @@ gs_plugin_initialize (GsPlugin *plugin)
 {
 	plugin->priv = GS_PLUGIN_GET_PRIVATE (GsPluginPrivate);
 	g_mutex_init (&plugin->priv->store_mutex);
+	g_mutex_init (&plugin->priv->init_mutex);
+	g_mutex_init (&plugin->priv->changed_mutex);
+	g_cond_init (&plugin->priv->changed_cond);
 	plugin->priv->store = as_store_new ();
 	as_store_set_watch_flags (plugin->priv->store,
 				  AS_STORE_WATCH_FLAG_ADDED |
@@ -123,9 +638,24 @@ gs_plugin_get_deps (GsPlugin *plugin)
 void
 gs_plugin_destroy (GsPlugin *plugin)
 {
+	/* no more changes, and wait for the ones being processed */
+	g_signal_handlers_disconnect_by_data (plugin->priv->store, plugin);
+	g_mutex_lock (&plugin->priv->changed_mutex);
+	while (plugin->priv->changed_running > 0)
+		g_cond_wait (&plugin->priv->changed_cond, &plugin->priv->changed_mutex);
+	g_mutex_unlock (&plugin->priv->changed_mutex);
+
 	g_free (plugin->priv->locale);
 	g_object_unref (plugin->priv->store);
+	gs_plugin_appstream_search_index_clear (plugin);
+	if (plugin->priv->fingerprints != NULL)
+		g_hash_table_unref (plugin->priv->fingerprints);
+	if (plugin->priv->origins != NULL)
+		g_hash_table_unref (plugin->priv->origins);
 	g_mutex_clear (&plugin->priv->store_mutex);
+	g_mutex_clear (&plugin->priv->init_mutex);
+	g_mutex_clear (&plugin->priv->changed_mutex);
+	g_cond_clear (&plugin->priv->changed_cond);
 }
 
 /**
@@ -175,6 +705,144 @@ gs_plugin_appstream_get_origins_hash (GPtrArray *array)
 	return origins;
 }
 
+/**
+ * gs_plugin_appstream_search_term:
+ *
+ * Returns: A hash table of search_apps index to match value for every
+ * application with a token starting with @term, following the scoring of
+ * as_app_search_matches().
+ */
+static GHashTable *
+gs_plugin_appstream_search_term (GsPlugin *plugin, const gchar *term)
+{
+	GArray *postings;
+	GHashTable *matches;
+	GPtrArray *tokens = plugin->priv->search_tokens;
+	GsPluginAppstreamPosting *posting;
+	const gchar *token;
+	gboolean exact;
+	gpointer key;
+	guint i;
+	guint lo;
+	guint match_value;
+
+	/* find the first token that is not less than the term */
+	lo = gs_plugin_appstream_search_token_find (tokens, term);
+
+	/* exact matches are stored in the upper half of the value so they
+	 * can replace, rather than add to, any partial match */
+	matches = g_hash_table_new (g_direct_hash, g_direct_equal);
+	for (; lo < tokens->len; lo++) {
+		token = g_ptr_array_index (tokens, lo);
+		if (!g_str_has_prefix (token, term))
+			break;
+		exact = g_strcmp0 (token, term) == 0;
+		postings = g_hash_table_lookup (plugin->priv->search_index, token);
+		for (i = 0; i < postings->len; i++) {
+			posting = &g_array_index (postings, GsPluginAppstreamPosting, i);
+			key = GUINT_TO_POINTER (posting->idx + 1);
+			match_value = GPOINTER_TO_UINT (g_hash_table_lookup (matches, key));
+			if (exact)
+				match_value |= posting->match_value << 16;
+			else
+				match_value |= posting->match_value;
+			g_hash_table_insert (matches, key, GUINT_TO_POINTER (match_value));
+		}
+	}
+	return matches;
+}
+
+/**
+ * gs_plugin_appstream_search_idx_sort_cb:
+ *
+ * Sorts search_apps indexes by their position in the store, as slots that
+ * were changed since the index was built are at the end.
+ */
+static gint
+gs_plugin_appstream_search_idx_sort_cb (gconstpointer a,
+					gconstpointer b,
+					gpointer user_data)
+{
+	GArray *order = (GArray *) user_data;
+	guint pos_a = g_array_index (order, guint, *((const guint *) a));
+	guint pos_b = g_array_index (order, guint, *((const guint *) b));
+	if (pos_a < pos_b)
+		return -1;
+	if (pos_a > pos_b)
+		return 1;
+	return 0;
+}
+
+/**
+ * gs_plugin_appstream_search_index:
+ *
+ * Returns: An array of search_apps indexes matching all of @values, in store
+ * order, with the match values in @match_values.
+ */
+static GArray *
+gs_plugin_appstream_search_index (GsPlugin *plugin,
+				  gchar **values,
+				  GHashTable **match_values)
+{
+	GArray *results;
+	GHashTable *matches = NULL;
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+	guint i;
+	guint idx;
+	guint match_value;
+	guint smallest = 0;
+	_cleanup_ptrarray_unref_ GPtrArray *terms = NULL;
+
+	/* get the candidates for each term */
+	terms = g_ptr_array_new_with_free_func ((GDestroyNotify) g_hash_table_unref);
+	for (i = 0; values[i] != NULL; i++) {
+		matches = gs_plugin_appstream_search_term (plugin, values[i]);
+		g_ptr_array_add (terms, matches);
+		if (g_hash_table_size (matches) <
+		    g_hash_table_size (g_ptr_array_index (terms, smallest)))
+			smallest = i;
+	}
+	results = g_array_new (FALSE, FALSE, sizeof (guint));
+	*match_values = g_hash_table_new (g_direct_hash, g_direct_equal);
+	if (terms->len == 0)
+		return results;
+
+	/* intersect starting with the shortest posting list */
+	matches = g_ptr_array_index (terms, smallest);
+	g_hash_table_iter_init (&iter, matches);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		guint match_all = 0;
+		for (i = 0; i < terms->len; i++) {
+			if (i == smallest) {
+				match_value = GPOINTER_TO_UINT (value);
+			} else {
+				match_value = GPOINTER_TO_UINT (g_hash_table_lookup (g_ptr_array_index (terms, i), key));
+				if (match_value == 0)
+					break;
+			}
+
+			/* an exact match wins over any partial matches */
+			if (match_value >> 16 != 0)
+				match_all |= (match_value >> 16) << 2;
+			else
+				match_all |= match_value;
+		}
+		if (i < terms->len)
+			continue;
+		idx = GPOINTER_TO_UINT (key) - 1;
+		g_array_append_val (results, idx);
+		g_hash_table_insert (*match_values, key, GUINT_TO_POINTER (match_all));
+	}
+
+	/* return the results in the same order as the store */
+	g_array_sort_with_data (results,
+				gs_plugin_appstream_search_idx_sort_cb,
+				plugin->priv->search_order);
+	return results;
+}
+
 /**
  * gs_plugin_startup:
  */
@@ -183,18 +851,20 @@ gs_plugin_startup (GsPlugin *plugin, GError **error)
 {
 	AsApp *app;
 	GPtrArray *items;
+	gboolean changed_pending;
 	gboolean ret;
-	const gchar *origin;
 	gchar *tmp;
-	guint *perc;
 	guint i;
-	_cleanup_hashtable_unref_ GHashTable *origins = NULL;
 
 	gs_profile_start (plugin->profile, "appstream::startup");
+	g_mutex_lock (&plugin->priv->changed_mutex);
+	plugin->priv->loaded = FALSE;
+	g_mutex_unlock (&plugin->priv->changed_mutex);
 	g_mutex_lock (&plugin->priv->store_mutex);
 
 	/* clear all existing applications if the store was invalidated */
 	as_store_remove_all (plugin->priv->store);
+	g_clear_pointer (&plugin->priv->fingerprints, g_hash_table_unref);
 
 	/* get the locale without the UTF-8 suffix */
 	plugin->priv->locale = g_strdup (setlocale (LC_MESSAGES, NULL));
@@ -229,23 +899,11 @@ gs_plugin_startup (GsPlugin *plugin, GError **error)
 	}
 
 	/* add search terms for apps not in the main source */
-	origins = gs_plugin_appstream_get_origins_hash (items);
-	for (i = 0; i < items->len; i++) {
-		app = g_ptr_array_index (items, i);
-		origin = as_app_get_origin (app);
-		if (origin == NULL)
-			continue;
-		perc = g_hash_table_lookup (origins, origin);
-		if (*perc < 10) {
-			g_debug ("Adding keyword '%s' to %s",
-				 origin, as_app_get_id (app));
-#if AS_CHECK_VERSION(0,5,0)
-			as_app_add_keyword (app, NULL, origin);
-#else
-			as_app_add_keyword (app, NULL, origin, -1);
-#endif
-		}
-	}
+	if (plugin->priv->origins != NULL)
+		g_hash_table_unref (plugin->priv->origins);
+	plugin->priv->origins = gs_plugin_appstream_get_origins_hash (items);
+	for (i = 0; i < items->len; i++)
+		gs_plugin_appstream_add_origin_keyword (plugin, g_ptr_array_index (items, i));
 
 	/* look for any application with a HiDPI icon kudo */
 	for (i = 0; i < items->len; i++) {
@@ -255,21 +913,40 @@ gs_plugin_startup (GsPlugin *plugin, GError **error)
 			break;
 		}
 	}
+
+	/* now the keywords are added we can index the search tokens */
+	gs_plugin_appstream_build_search_index (plugin, items);
+
+	/* so that a later metadata change only refreshes what differs */
+	if (plugin->priv->fingerprints != NULL)
+		g_hash_table_unref (plugin->priv->fingerprints);
+	plugin->priv->fingerprints = gs_plugin_appstream_get_fingerprints (items);
 out:
 	g_mutex_unlock (&plugin->priv->store_mutex);
+
+	/* pick up anything that changed while loading */
+	g_mutex_lock (&plugin->priv->changed_mutex);
+	plugin->priv->loaded = TRUE;
+	changed_pending = plugin->priv->changed_pending;
+	plugin->priv->changed_pending = FALSE;
+	g_mutex_unlock (&plugin->priv->changed_mutex);
+	if (changed_pending)
+		gs_plugin_appstream_store_changed_schedule (plugin);
+
 	gs_profile_stop (plugin->profile, "appstream::startup");
 	return ret;
 }
 
 /**
  * gs_plugin_refine_item_pixbuf:
+ *
+ * Sets up the icon for the application, which is then decoded by the
+ * GsApp icon worker threads rather than in the refine.
  */
 static void
 gs_plugin_refine_item_pixbuf (GsPlugin *plugin, GsApp *app, AsApp *item)
 {
 	AsIcon *icon;
-	gboolean ret;
-	_cleanup_error_free_ GError *error = NULL;
 	_cleanup_free_ gchar *fn = NULL;
 	_cleanup_free_ gchar *path = NULL;
 
@@ -286,15 +963,10 @@ gs_plugin_refine_item_pixbuf (GsPlugin *plugin, GsApp *app, AsApp *item)
 			as_icon_set_filename (icon, fn);
 			as_icon_set_prefix (icon, path);
 		}
-		if (g_file_test (fn, G_FILE_TEST_EXISTS)) {
+		if (gs_cache_lookup (GS_CACHE_KIND_ICON,
+				     as_icon_get_filename (icon)) != GS_CACHE_STATE_MISSING) {
 			as_icon_set_kind (icon, AS_ICON_KIND_LOCAL);
-			ret = gs_app_load_icon (app, plugin->scale, &error);
-			if (!ret) {
-				g_warning ("failed to load icon %s: %s",
-					   as_icon_get_name (icon),
-					   error->message);
-				return;
-			}
+			gs_app_load_icon_async (app, plugin->scale);
 		}
 		break;
 	case AS_ICON_KIND_STOCK:
@@ -307,14 +979,7 @@ gs_plugin_refine_item_pixbuf (GsPlugin *plugin, GsApp *app, AsApp *item)
 			as_icon_set_kind (icon, AS_ICON_KIND_STOCK);
 
 		/* load */
-		ret = gs_app_load_icon (app, plugin->scale, &error);
-		if (!ret) {
-			g_warning ("failed to load %s icon %s: %s",
-				   as_icon_kind_to_string (as_icon_get_kind (icon)),
-				   as_icon_get_name (icon),
-				   error->message);
-				return;
-		}
+		gs_app_load_icon_async (app, plugin->scale);
 		break;
 	case AS_ICON_KIND_CACHED:
 		if (plugin->scale == 2)
@@ -322,16 +987,12 @@ gs_plugin_refine_item_pixbuf (GsPlugin *plugin, GsApp *app, AsApp *item)
 		if (icon == NULL)
 			icon = as_app_get_icon_for_size (item, 64, 64);
 		if (icon == NULL) {
-			g_warning ("failed to find cached icon %s",
-				   as_icon_get_name (icon));
+			g_warning ("failed to find cached icon for %s",
+				   as_app_get_id (item));
 			return;
 		}
-		if (!as_icon_load (icon, AS_ICON_LOAD_FLAG_SEARCH_SIZE, &error)) {
-			g_warning ("failed to load cached icon %s: %s",
-				   as_icon_get_name (icon), error->message);
-				return;
-		}
-		gs_app_set_pixbuf (app, as_icon_get_pixbuf (icon));
+		gs_app_set_icon (app, icon);
+		gs_app_load_icon_async (app, plugin->scale);
 		break;
 	default:
 		g_warning ("icon kind unknown for %s", as_app_get_id (item));
@@ -578,7 +1239,7 @@ gs_plugin_refine_item (GsPlugin *plugin,
 	}
 
 	/* set icon */
-	if (as_app_get_icon_default (item) != NULL && gs_app_get_pixbuf (app) == NULL)
+	if (as_app_get_icon_default (item) != NULL && !gs_app_has_icon (app))
 		gs_plugin_refine_item_pixbuf (plugin, app, item);
 
 	/* set categories */
@@ -746,6 +1407,26 @@ out:
 	return ret;
 }
 
+/**
+ * gs_plugin_appstream_ensure_startup:
+ *
+ * Loads the XML files the first time, and again after the store changed
+ * in a way that could not be handled incrementally.
+ */
+static gboolean
+gs_plugin_appstream_ensure_startup (GsPlugin *plugin, GError **error)
+{
+	gboolean ret = TRUE;
+
+	g_mutex_lock (&plugin->priv->init_mutex);
+	if (!plugin->priv->done_init) {
+		ret = gs_plugin_startup (plugin, error);
+		plugin->priv->done_init = TRUE;
+	}
+	g_mutex_unlock (&plugin->priv->init_mutex);
+	return ret;
+}
+
 /**
  * gs_plugin_refine:
  */
@@ -762,12 +1443,8 @@ gs_plugin_refine (GsPlugin *plugin,
 	GsApp *app;
 
 	/* load XML files */
-	if (g_once_init_enter (&plugin->priv->done_init)) {
-		ret = gs_plugin_startup (plugin, error);
-		g_once_init_leave (&plugin->priv->done_init, TRUE);
-		if (!ret)
-			return FALSE;
-	}
+	if (!gs_plugin_appstream_ensure_startup (plugin, error))
+		return FALSE;
 
 	gs_profile_start (plugin->profile, "appstream::refine");
 	for (l = *list; l != NULL; l = l->next) {
@@ -808,12 +1485,8 @@ gs_plugin_add_category_apps (GsPlugin *plugin,
 	guint i;
 
 	/* load XML files */
-	if (g_once_init_enter (&plugin->priv->done_init)) {
-		ret = gs_plugin_startup (plugin, error);
-		g_once_init_leave (&plugin->priv->done_init, TRUE);
-		if (!ret)
-			return FALSE;
-	}
+	if (!gs_plugin_appstream_ensure_startup (plugin, error))
+		return FALSE;
 
 	/* get the two search terms */
 	gs_profile_start (plugin->profile, "appstream::add-category-apps");
@@ -880,7 +1553,7 @@ static gboolean
 gs_plugin_add_search_item (GsPlugin *plugin,
 			   GList **list,
 			   AsApp *app,
-			   gchar **values,
+			   guint match_value,
 			   GCancellable *cancellable,
 			   GError **error)
 {
@@ -889,12 +1562,6 @@ gs_plugin_add_search_item (GsPlugin *plugin,
 	const gchar *id;
 	gboolean ret = TRUE;
 	guint i;
-	guint match_value;
-
-	/* no match */
-	match_value = as_app_search_matches_all (app, values);
-	if (match_value == 0)
-		goto out;
 
 	/* if the app does not extend an application, then just add it */
 	extends = as_app_get_extends (app);
@@ -939,28 +1606,35 @@ gs_plugin_add_search (GsPlugin *plugin,
 		      GError **error)
 {
 	AsApp *item;
-	GPtrArray *array;
 	gboolean ret = TRUE;
 	guint i;
+	guint idx;
+	guint match_value;
+	_cleanup_array_unref_ GArray *results = NULL;
+	_cleanup_hashtable_unref_ GHashTable *match_values = NULL;
 
 	/* load XML files */
-	if (g_once_init_enter (&plugin->priv->done_init)) {
-		ret = gs_plugin_startup (plugin, error);
-		g_once_init_leave (&plugin->priv->done_init, TRUE);
-		if (!ret)
-			return FALSE;
-	}
+	if (!gs_plugin_appstream_ensure_startup (plugin, error))
+		return FALSE;
 
-	/* search categories for the search term */
+	/* look up the search terms in the index */
 	gs_profile_start (plugin->profile, "appstream::search");
 	g_mutex_lock (&plugin->priv->store_mutex);
-	array = as_store_get_apps (plugin->priv->store);
-	for (i = 0; i < array->len; i++) {
-		if (g_cancellable_set_error_if_cancelled (cancellable, error))
+	if (plugin->priv->search_tokens == NULL)
+		goto out;
+	results = gs_plugin_appstream_search_index (plugin, values, &match_values);
+	for (i = 0; i < results->len; i++) {
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			ret = FALSE;
 			goto out;
+		}
 
-		item = g_ptr_array_index (array, i);
-		ret = gs_plugin_add_search_item (plugin, list, item, values, cancellable, error);
+		idx = g_array_index (results, guint, i);
+		item = g_ptr_array_index (plugin->priv->search_apps, idx);
+		match_value = GPOINTER_TO_UINT (g_hash_table_lookup (match_values,
+								     GUINT_TO_POINTER (idx + 1)));
+		ret = gs_plugin_add_search_item (plugin, list, item, match_value,
+						 cancellable, error);
 		if (!ret)
 			goto out;
 	}
@@ -985,12 +1659,8 @@ gs_plugin_add_installed (GsPlugin *plugin,
 	guint i;
 
 	/* load XML files */
-	if (g_once_init_enter (&plugin->priv->done_init)) {
-		ret = gs_plugin_startup (plugin, error);
-		g_once_init_leave (&plugin->priv->done_init, TRUE);
-		if (!ret)
-			return FALSE;
-	}
+	if (!gs_plugin_appstream_ensure_startup (plugin, error))
+		return FALSE;
 
 	/* search categories for the search term */
 	gs_profile_start (plugin->profile, "appstream::add_installed");
@@ -1078,12 +1748,8 @@ gs_plugin_add_categories (GsPlugin *plugin,
 	guint i;
 
 	/* load XML files */
-	if (g_once_init_enter (&plugin->priv->done_init)) {
-		ret = gs_plugin_startup (plugin, error);
-		g_once_init_leave (&plugin->priv->done_init, TRUE);
-		if (!ret)
-			return FALSE;
-	}
+	if (!gs_plugin_appstream_ensure_startup (plugin, error))
+		return FALSE;
 
 	/* find out how many packages are in each category */
 	gs_profile_start (plugin->profile, "appstream::add-categories");
@@ -24,7 +24,6 @@
 #include <libsoup/soup.h>
 #include <string.h>
 #include <sqlite3.h>
-#include <stdlib.h>
 
 #include "gs-cleanup.h"
 #include <gs-plugin.h>
@@ -86,6 +85,36 @@ gs_plugin_get_deps (GsPlugin *plugin)
 	return deps;
 }
 
+/**
+ * gs_plugin_get_refine_provides:
+ */
+GsPluginRefineFlags
+gs_plugin_get_refine_provides (GsPlugin *plugin)
+{
+	return GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING;
+}
+
+/**
+ * gs_plugin_get_refine_reads:
+ */
+GsPluginRefineFields
+gs_plugin_get_refine_reads (GsPlugin *plugin)
+{
+	return GS_PLUGIN_REFINE_FIELD_ID |
+	       GS_PLUGIN_REFINE_FIELD_SOURCES |
+	       GS_PLUGIN_REFINE_FIELD_RATING;
+}
+
+/**
+ * gs_plugin_get_refine_writes:
+ */
+GsPluginRefineFields
+gs_plugin_get_refine_writes (GsPlugin *plugin)
+{
+	return GS_PLUGIN_REFINE_FIELD_RATING |
+	       GS_PLUGIN_REFINE_FIELD_KUDOS;
+}
+
 /**
  * gs_plugin_destroy:
  */
@@ -284,25 +313,24 @@ fedora_tagger_item_free (FedoraTaggerItem *item)
 }
 
 /**
- * gs_plugin_fedora_tagger_add:
+ * gs_plugin_fedora_tagger_add_items:
+ *
+ * Adds all the items in one transaction using a single prepared statement.
  */
 static gboolean
-gs_plugin_fedora_tagger_add (GsPlugin *plugin,
-			     FedoraTaggerItem *item,
-			     GError **error)
+gs_plugin_fedora_tagger_add_items (GsPlugin *plugin,
+				   GPtrArray *items,
+				   GError **error)
 {
+	FedoraTaggerItem *item;
+	gboolean ret = FALSE;
 	char *error_msg = NULL;
 	gint rc;
-	_cleanup_free_ gchar *statement = NULL;
+	guint i;
+	sqlite3_stmt *stmt = NULL;
 
-	/* insert the entry */
-	statement = g_strdup_printf ("INSERT OR REPLACE INTO ratings (pkgname, rating, "
-				     "vote_count, user_count, confidence) "
-				     "VALUES ('%s', '%.0f', '%.0f', '%.0f', '%.0f');",
-				     item->pkgname, item->rating,
-				     item->vote_count, item->user_count,
-				     item->confidence);
-	rc = sqlite3_exec (plugin->priv->db, statement, NULL, NULL, &error_msg);
+	rc = sqlite3_exec (plugin->priv->db, "BEGIN TRANSACTION;",
+			   NULL, NULL, &error_msg);
 	if (rc != SQLITE_OK) {
 		g_set_error (error,
 			     GS_PLUGIN_ERROR,
@@ -311,8 +339,50 @@ gs_plugin_fedora_tagger_add (GsPlugin *plugin,
 		sqlite3_free (error_msg);
 		return FALSE;
 	}
-	return TRUE;
+	rc = sqlite3_prepare_v2 (plugin->priv->db,
+				 "INSERT OR REPLACE INTO ratings (pkgname, rating, "
+				 "vote_count, user_count, confidence) "
+				 "VALUES (?1, ?2, ?3, ?4, ?5);",
+				 -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error,
+			     GS_PLUGIN_ERROR,
+			     GS_PLUGIN_ERROR_FAILED,
+			     "SQL error: %s", sqlite3_errmsg (plugin->priv->db));
+		goto out;
+	}
 
+	/* insert each entry */
+	for (i = 0; i < items->len; i++) {
+		item = g_ptr_array_index (items, i);
+		g_debug ("adding %s: %.1f%% [%.1f] {%.1f%%}",
+			 item->pkgname, item->rating,
+			 item->vote_count, item->confidence);
+		sqlite3_bind_text (stmt, 1, item->pkgname, -1, SQLITE_STATIC);
+		sqlite3_bind_int (stmt, 2, (gint) (item->rating + 0.5));
+		sqlite3_bind_int (stmt, 3, (gint) (item->vote_count + 0.5));
+		sqlite3_bind_int (stmt, 4, (gint) (item->user_count + 0.5));
+		sqlite3_bind_int (stmt, 5, (gint) (item->confidence + 0.5));
+		rc = sqlite3_step (stmt);
+		if (rc != SQLITE_DONE) {
+			g_set_error (error,
+				     GS_PLUGIN_ERROR,
+				     GS_PLUGIN_ERROR_FAILED,
+				     "SQL error: %s",
+				     sqlite3_errmsg (plugin->priv->db));
+			goto out;
+		}
+		sqlite3_reset (stmt);
+	}
+
+	/* success */
+	ret = TRUE;
+out:
+	sqlite3_finalize (stmt);
+	sqlite3_exec (plugin->priv->db,
+		      ret ? "COMMIT;" : "ROLLBACK;",
+		      NULL, NULL, NULL);
+	return ret;
 }
 
 /**
@@ -430,15 +500,9 @@ gs_plugin_fedora_tagger_download (GsPlugin *plugin, GError **error)
 		item->confidence = MAX (100.0f * item->vote_count / count_sum, 100);
 	}
 
-	/* add each completed item */
-	for (i = 0; i < items->len; i++) {
-		item = g_ptr_array_index (items, i);
-		g_debug ("adding %s: %.1f%% [%.1f] {%.1f%%}",
-			 item->pkgname, item->rating,
-			 item->vote_count, item->confidence);
-		if (!gs_plugin_fedora_tagger_add (plugin, item, error))
-			return FALSE;
-	}
+	/* add all the completed items */
+	if (!gs_plugin_fedora_tagger_add_items (plugin, items, error))
+		return FALSE;
 
 	/* reset the timestamp */
 	return gs_plugin_fedora_tagger_set_timestamp (plugin, "mtime", error);
@@ -542,62 +606,67 @@ typedef struct {
 	gint		 confidence;
 } FedoraTaggerHelper;
 
-/**
- * gs_plugin_fedora_tagger_ratings_sqlite_cb:
- **/
-static gint
-gs_plugin_fedora_tagger_ratings_sqlite_cb (void *data,
-					   gint argc,
-					   gchar **argv,
-					   gchar **col_name)
-{
-	FedoraTaggerHelper *helper = (FedoraTaggerHelper *) data;
-	helper->rating = atoi (argv[0]);
-	helper->confidence = atoi (argv[1]);
-	return 0;
-}
+/* keep well below SQLITE_MAX_VARIABLE_NUMBER */
+#define GS_PLUGIN_FEDORA_TAGGER_BATCH_MAX	500
 
 /**
- * gs_plugin_resolve_app:
+ * gs_plugin_fedora_tagger_resolve_batch:
+ *
+ * Looks up @len package names from @pkgnames using one query, adding
+ * a #FedoraTaggerHelper to @results for each package that was found.
  */
 static gboolean
-gs_plugin_resolve_app (GsPlugin *plugin,
-		       const gchar *pkgname,
-		       gint *rating,
-		       gint *confidence,
-		       GError **error)
+gs_plugin_fedora_tagger_resolve_batch (GsPlugin *plugin,
+				       GPtrArray *pkgnames,
+				       guint start,
+				       guint len,
+				       GHashTable *results,
+				       GError **error)
 {
-	FedoraTaggerHelper helper;
-	gchar *error_msg = NULL;
+	FedoraTaggerHelper *helper;
 	gint rc;
-	_cleanup_free_ gchar *statement = NULL;
-
-	/* default values */
-	helper.rating = -1;
-	helper.confidence = -1;
-
-	/* query, but don't return an error if the package isn't found */
-	statement = g_strdup_printf ("SELECT rating, confidence FROM ratings "
-				     "WHERE pkgname = '%s'", pkgname);
-	rc = sqlite3_exec (plugin->priv->db,
-			   statement,
-			   gs_plugin_fedora_tagger_ratings_sqlite_cb,
-			   &helper,
-			   &error_msg);
+	guint i;
+	sqlite3_stmt *stmt = NULL;
+	_cleanup_string_free_ GString *statement = NULL;
+
+	/* one placeholder per package */
+	statement = g_string_new ("SELECT pkgname, rating, confidence "
+				  "FROM ratings WHERE pkgname IN (");
+	for (i = 0; i < len; i++)
+		g_string_append (statement, i == 0 ? "?" : ",?");
+	g_string_append (statement, ");");
+	rc = sqlite3_prepare_v2 (plugin->priv->db, statement->str, -1, &stmt, NULL);
 	if (rc != SQLITE_OK) {
 		g_set_error (error,
 			     GS_PLUGIN_ERROR,
 			     GS_PLUGIN_ERROR_FAILED,
-			     "SQL error: %s", error_msg);
-		sqlite3_free (error_msg);
+			     "SQL error: %s", sqlite3_errmsg (plugin->priv->db));
 		return FALSE;
 	}
+	for (i = 0; i < len; i++) {
+		sqlite3_bind_text (stmt, i + 1,
+				   g_ptr_array_index (pkgnames, start + i),
+				   -1, SQLITE_STATIC);
+	}
 
-	/* success */
-	if (rating != NULL)
-		*rating = helper.rating;
-	if (confidence != NULL)
-		*confidence = helper.confidence;
+	/* packages that are not found are just not returned */
+	while ((rc = sqlite3_step (stmt)) == SQLITE_ROW) {
+		helper = g_new0 (FedoraTaggerHelper, 1);
+		helper->rating = sqlite3_column_int (stmt, 1);
+		helper->confidence = sqlite3_column_int (stmt, 2);
+		g_hash_table_insert (results,
+				     g_strdup ((const gchar *) sqlite3_column_text (stmt, 0)),
+				     helper);
+	}
+	if (rc != SQLITE_DONE) {
+		g_set_error (error,
+			     GS_PLUGIN_ERROR,
+			     GS_PLUGIN_ERROR_FAILED,
+			     "SQL error: %s", sqlite3_errmsg (plugin->priv->db));
+		sqlite3_finalize (stmt);
+		return FALSE;
+	}
+	sqlite3_finalize (stmt);
 	return TRUE;
 }
 
@@ -611,14 +680,15 @@ gs_plugin_refine (GsPlugin *plugin,
 		  GCancellable *cancellable,
 		  GError **error)
 {
+	FedoraTaggerHelper *helper;
 	GList *l;
 	GPtrArray *sources;
 	GsApp *app;
 	const gchar *pkgname;
 	gboolean ret;
-	gint rating;
-	gint confidence;
 	guint i;
+	_cleanup_hashtable_unref_ GHashTable *results = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *pkgnames = NULL;
 
 	/* nothing to do here */
 	if ((flags & GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING) == 0)
@@ -632,6 +702,33 @@ gs_plugin_refine (GsPlugin *plugin,
 			return FALSE;
 	}
 
+	/* get all the package names that need ratings data */
+	pkgnames = g_ptr_array_new ();
+	for (l = *list; l != NULL; l = l->next) {
+		app = GS_APP (l->data);
+		if (gs_app_get_rating (app) != -1)
+			continue;
+		sources = gs_app_get_sources (app);
+		for (i = 0; i < sources->len; i++)
+			g_ptr_array_add (pkgnames, g_ptr_array_index (sources, i));
+	}
+	if (pkgnames->len == 0)
+		return TRUE;
+
+	/* look them all up at once */
+	results = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	for (i = 0; i < pkgnames->len; i += GS_PLUGIN_FEDORA_TAGGER_BATCH_MAX) {
+		ret = gs_plugin_fedora_tagger_resolve_batch (plugin,
+							     pkgnames,
+							     i,
+							     MIN (pkgnames->len - i,
+								  GS_PLUGIN_FEDORA_TAGGER_BATCH_MAX),
+							     results,
+							     error);
+		if (!ret)
+			return FALSE;
+	}
+
 	/* add any missing ratings data */
 	for (l = *list; l != NULL; l = l->next) {
 		app = GS_APP (l->data);
@@ -640,25 +737,19 @@ gs_plugin_refine (GsPlugin *plugin,
 		sources = gs_app_get_sources (app);
 		for (i = 0; i < sources->len; i++) {
 			pkgname = g_ptr_array_index (sources, i);
-			ret = gs_plugin_resolve_app (plugin,
-						     pkgname,
-						     &rating,
-						     &confidence,
-						     error);
-			if (!ret)
-				return FALSE;
-			if (rating != -1) {
-				g_debug ("fedora-tagger setting rating on %s to %i%% [%i]",
-					 pkgname, rating, confidence);
-				gs_app_set_rating (app, rating);
-				gs_app_set_rating_confidence (app, confidence);
-				gs_app_set_rating_kind (app, GS_APP_RATING_KIND_SYSTEM);
-				if (confidence > 50 && rating > 80) {
-					g_debug ("%s is popular [confidence %i]",
-						 gs_app_get_source_default (app),
-						 confidence);
-					gs_app_add_kudo (app, GS_APP_KUDO_POPULAR);
-				}
+			helper = g_hash_table_lookup (results, pkgname);
+			if (helper == NULL || helper->rating == -1)
+				continue;
+			g_debug ("fedora-tagger setting rating on %s to %i%% [%i]",
+				 pkgname, helper->rating, helper->confidence);
+			gs_app_set_rating (app, helper->rating);
+			gs_app_set_rating_confidence (app, helper->confidence);
+			gs_app_set_rating_kind (app, GS_APP_RATING_KIND_SYSTEM);
+			if (helper->confidence > 50 && helper->rating > 80) {
+				g_debug ("%s is popular [confidence %i]",
+					 gs_app_get_source_default (app),
+					 helper->confidence);
+				gs_app_add_kudo (app, GS_APP_KUDO_POPULAR);
 			}
 		}
 	}
@@ -29,9 +29,11 @@
 #include <libsoup/soup.h>
 #include <glib/gstdio.h>
 
+#include <gs-cache.h>
 #include <gs-plugin.h>
 
 #include "gs-cleanup.h"
+#include "fwupd-download.h"
 
 struct GsPluginPrivate {
 	gsize			 done_init;
@@ -206,22 +208,6 @@ gs_plugin_fwupd_add_required_location (GsPlugin *plugin, const gchar *location)
 	g_ptr_array_add (plugin->priv->to_download, g_strdup (location));
 }
 
-/**
- * gs_plugin_fwupd_get_file_checksum:
- */
-static gchar *
-gs_plugin_fwupd_get_file_checksum (const gchar *filename,
-				   GChecksumType checksum_type,
-				   GError **error)
-{
-	gsize len;
-	_cleanup_free_ gchar *data = NULL;
-
-	if (!g_file_get_contents (filename, &data, &len, error))
-		return NULL;
-	return g_compute_checksum_for_data (checksum_type, (const guchar *)data, len);
-}
-
 /**
  * gs_plugin_add_update_app:
  */
@@ -318,10 +304,8 @@ gs_plugin_add_update_app (GsPlugin *plugin,
 		return FALSE;
 	}
 
-	/* does the checksum match */
-	checksum = gs_plugin_fwupd_get_file_checksum (filename_cache,
-						      G_CHECKSUM_SHA1,
-						      error);
+	/* does the checksum match what is on disk now */
+	checksum = gs_plugin_fwupd_get_file_checksum (filename_cache, NULL, error);
 	if (checksum == NULL)
 		return FALSE;
 	if (g_strcmp0 (update_hash, checksum) != 0) {
@@ -330,7 +314,7 @@ gs_plugin_add_update_app (GsPlugin *plugin,
 			     GS_PLUGIN_ERROR_FAILED,
 			     "%s does not match checksum, expected %s, got %s",
 			     filename_cache, update_hash, checksum);
-		g_unlink (filename_cache);
+		gs_cache_remove (filename_cache);
 		return FALSE;
 	}
 
@@ -703,9 +687,12 @@ gs_plugin_refresh (GsPlugin *plugin,
 		   GCancellable *cancellable,
 		   GError **error)
 {
+	GsPluginFwupdDownload *dl;
 	const gchar *tmp;
 	gboolean ret;
 	guint i;
+	guint j;
+	_cleanup_ptrarray_unref_ GPtrArray *downloads = NULL;
 
 	/* set up plugin */
 	if (g_once_init_enter (&plugin->priv->done_init)) {
@@ -724,41 +711,41 @@ gs_plugin_refresh (GsPlugin *plugin,
 		return FALSE;
 
 	/* download the files to the cachedir */
+	downloads = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_plugin_fwupd_download_free);
 	for (i = 0; i < plugin->priv->to_download->len; i++) {
-		guint status_code;
-		_cleanup_error_free_ GError *error_local = NULL;
 		_cleanup_free_ gchar *basename = NULL;
 		_cleanup_free_ gchar *filename_cache = NULL;
-		_cleanup_object_unref_ SoupMessage *msg = NULL;
 
 		tmp = g_ptr_array_index (plugin->priv->to_download, i);
 		basename = g_path_get_basename (tmp);
 		filename_cache = g_build_filename (plugin->priv->cachedir, basename, NULL);
-		g_debug ("downloading %s to %s", tmp, filename_cache);
-
-		/* set sync request */
-		msg = soup_message_new (SOUP_METHOD_GET, tmp);
-		status_code = soup_session_send_message (plugin->priv->session, msg);
-		if (status_code != SOUP_STATUS_OK) {
-			g_warning ("Failed to download %s, ignoring: %s",
-				   tmp, soup_status_get_phrase (status_code));
-			g_ptr_array_remove (plugin->priv->to_download, (gpointer) tmp);
-			g_ptr_array_add (plugin->priv->to_ignore, g_strdup (tmp));
+		if (gs_cache_lookup (GS_CACHE_KIND_FIRMWARE,
+				     filename_cache) == GS_CACHE_STATE_VALID) {
+			g_debug ("%s is already downloaded", tmp);
 			continue;
 		}
+		g_debug ("downloading %s to %s", tmp, filename_cache);
+		g_ptr_array_add (downloads,
+				 gs_plugin_fwupd_download_new (tmp, filename_cache));
+	}
+	if (downloads->len == 0)
+		return TRUE;
+	if (!gs_plugin_fwupd_download_all (downloads, cancellable, error))
+		return FALSE;
 
-		/* save binary file */
-		if (!g_file_set_contents (filename_cache,
-					  msg->response_body->data,
-					  msg->response_body->length,
-					  &error_local)) {
-			g_set_error (error,
-				     GS_PLUGIN_ERROR,
-				     GS_PLUGIN_ERROR_FAILED,
-				     "Failed to save firmware: %s",
-				     error_local->message);
-			return FALSE;
+	/* don't keep asking for files the server refused */
+	for (i = 0; i < downloads->len; i++) {
+		dl = g_ptr_array_index (downloads, i);
+		if (!dl->failed)
+			continue;
+		for (j = 0; j < plugin->priv->to_download->len; j++) {
+			tmp = g_ptr_array_index (plugin->priv->to_download, j);
+			if (g_strcmp0 (tmp, dl->uri) != 0)
+				continue;
+			g_ptr_array_remove_index (plugin->priv->to_download, j);
+			break;
 		}
+		g_ptr_array_add (plugin->priv->to_ignore, g_strdup (dl->uri));
 	}
 
 	return TRUE;
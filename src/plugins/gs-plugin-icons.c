@@ -28,12 +28,15 @@
 #include <libsoup/soup.h>
 
 #include "gs-cleanup.h"
+#include <gs-cache.h>
 #include <gs-plugin.h>
 #include <gs-utils.h>
 
+/* can be overridden using GNOME_SOFTWARE_ICON_CONNECTIONS */
+#define GS_PLUGIN_ICONS_MAX_CONNS	6
+
 struct GsPluginPrivate {
 	SoupSession		*session;
-	gsize			 loaded;
 };
 
 /**
@@ -45,13 +48,51 @@ gs_plugin_get_name (void)
 	return "icons";
 }
 
+/**
+ * gs_plugin_icons_get_max_conns:
+ */
+static guint
+gs_plugin_icons_get_max_conns (void)
+{
+	const gchar *tmp;
+	guint64 value;
+
+	tmp = g_getenv ("GNOME_SOFTWARE_ICON_CONNECTIONS");
+	if (tmp == NULL)
+		return GS_PLUGIN_ICONS_MAX_CONNS;
+	value = g_ascii_strtoull (tmp, NULL, 10);
+	if (value == 0 || value > 64)
+		return GS_PLUGIN_ICONS_MAX_CONNS;
+	return value;
+}
+
 /**
  * gs_plugin_initialize:
  */
 void
 gs_plugin_initialize (GsPlugin *plugin)
 {
+	guint max_conns;
+
+	/* one session for every refine, so connections are reused; each
+	 * message is dispatched in the context of the thread queueing it */
 	plugin->priv = GS_PLUGIN_GET_PRIVATE (GsPluginPrivate);
+	max_conns = gs_plugin_icons_get_max_conns ();
+	plugin->priv->session = soup_session_new_with_options (SOUP_SESSION_USER_AGENT, "gnome-software",
+							       SOUP_SESSION_MAX_CONNS, max_conns,
+							       SOUP_SESSION_MAX_CONNS_PER_HOST, max_conns,
+							       SOUP_SESSION_USE_THREAD_CONTEXT, TRUE,
+							       NULL);
+}
+
+/**
+ * gs_plugin_destroy:
+ */
+void
+gs_plugin_destroy (GsPlugin *plugin)
+{
+	if (plugin->priv->session != NULL)
+		g_object_unref (plugin->priv->session);
 }
 
 /**
@@ -67,82 +108,43 @@ gs_plugin_get_deps (GsPlugin *plugin)
 	return deps;
 }
 
-/**
- * gs_plugin_destroy:
- */
-void
-gs_plugin_destroy (GsPlugin *plugin)
-{
-	if (plugin->priv->session != NULL)
-		g_object_unref (plugin->priv->session);
-}
+typedef struct {
+	GsPlugin		*plugin;
+	GPtrArray		*msgs;		/* of SoupMessage */
+	guint			 pending;
+} GsPluginIconsHelper;
+
+typedef struct {
+	GsPluginIconsHelper	*helper;
+	gchar			*filename;
+	GPtrArray		*apps;		/* of GsApp */
+} GsPluginIconsDownload;
 
 /**
- * gs_plugin_setup_networking:
+ * gs_plugin_icons_download_free:
  */
-static gboolean
-gs_plugin_setup_networking (GsPlugin *plugin, GError **error)
+static void
+gs_plugin_icons_download_free (GsPluginIconsDownload *dl)
 {
-	/* already set up */
-	if (plugin->priv->session != NULL)
-		return TRUE;
-
-	/* set up a session */
-	plugin->priv->session = soup_session_new_with_options (SOUP_SESSION_USER_AGENT,
-	                                                       "gnome-software",
-	                                                       NULL);
-	if (plugin->priv->session == NULL) {
-		g_set_error (error,
-			     GS_PLUGIN_ERROR,
-			     GS_PLUGIN_ERROR_FAILED,
-			     "%s: failed to setup networking",
-			     plugin->name);
-		return FALSE;
-	}
-	return TRUE;
+	g_free (dl->filename);
+	g_ptr_array_unref (dl->apps);
+	g_slice_free (GsPluginIconsDownload, dl);
 }
 
 /**
- * gs_plugin_icons_download:
+ * gs_plugin_icons_save:
  */
 static gboolean
-gs_plugin_icons_download (GsPlugin *plugin, const gchar *uri, const gchar *filename, GError **error)
+gs_plugin_icons_save (const gchar *data, gsize len, const gchar *filename, GError **error)
 {
-	guint status_code;
+	gsize buf_len;
+	_cleanup_free_ gchar *buf = NULL;
 	_cleanup_object_unref_ GdkPixbuf *pixbuf_new = NULL;
 	_cleanup_object_unref_ GdkPixbuf *pixbuf = NULL;
 	_cleanup_object_unref_ GInputStream *stream = NULL;
-	_cleanup_object_unref_ SoupMessage *msg = NULL;
-
-	/* create the GET data */
-	msg = soup_message_new (SOUP_METHOD_GET, uri);
-	if (msg == NULL) {
-		g_set_error (error,
-			     GS_PLUGIN_ERROR,
-			     GS_PLUGIN_ERROR_FAILED,
-			     "%s is not a valid URL", uri);
-		return FALSE;
-	}
-
-	/* ensure networking is set up */
-	if (!gs_plugin_setup_networking (plugin, error))
-		return FALSE;
-
-	/* set sync request */
-	status_code = soup_session_send_message (plugin->priv->session, msg);
-	if (status_code != SOUP_STATUS_OK) {
-		g_set_error (error,
-			     GS_PLUGIN_ERROR,
-			     GS_PLUGIN_ERROR_FAILED,
-			     "Failed to download icon %s: %s",
-			     uri, soup_status_get_phrase (status_code));
-		return FALSE;
-	}
 
 	/* we're assuming this is a 64x64 png file, resize if not */
-	stream = g_memory_input_stream_new_from_data (msg->response_body->data,
-						      msg->response_body->length,
-						      NULL);
+	stream = g_memory_input_stream_new_from_data (data, len, NULL);
 	pixbuf = gdk_pixbuf_new_from_stream (stream, NULL, error);
 	if (pixbuf == NULL)
 		return FALSE;
@@ -154,35 +156,151 @@ gs_plugin_icons_download (GsPlugin *plugin, const gchar *uri, const gchar *filen
 						      GDK_INTERP_BILINEAR);
 	}
 
-	/* write file */
-	return gdk_pixbuf_save (pixbuf_new, filename, "png", error, NULL);
+	/* write file atomically, so a half-written icon is never loaded */
+	if (!gdk_pixbuf_save_to_buffer (pixbuf_new, &buf, &buf_len, "png", error, NULL))
+		return FALSE;
+	return g_file_set_contents (filename, buf, buf_len, error);
 }
 
 /**
- * gs_plugin_refine:
+ * gs_plugin_icons_download_cb:
  */
-static gboolean
-gs_plugin_refine_app (GsPlugin *plugin, GsApp *app, GError **error)
+static void
+gs_plugin_icons_download_cb (SoupSession *session, SoupMessage *msg, gpointer user_data)
 {
 	AsIcon *ic;
+	GsApp *app;
+	GsPluginIconsDownload *dl = (GsPluginIconsDownload *) user_data;
+	GsPlugin *plugin = dl->helper->plugin;
+	guint i;
+	_cleanup_error_free_ GError *error = NULL;
+	_cleanup_free_ gchar *uri = NULL;
 
-	/* not applicable */
-	ic = gs_app_get_icon (app);
-	if (as_icon_get_url (ic) == NULL)
-		return TRUE;
-	if (as_icon_get_filename (ic) == NULL)
-		return TRUE;
+	dl->helper->pending--;
+	g_ptr_array_remove (dl->helper->msgs, msg);
+
+	uri = soup_uri_to_string (soup_message_get_uri (msg), FALSE);
+	if (msg->status_code != SOUP_STATUS_OK) {
+		g_warning ("Failed to download icon %s: %s",
+			   uri, soup_status_get_phrase (msg->status_code));
+		return;
+	}
+	if (!gs_plugin_icons_save (msg->response_body->data,
+				   msg->response_body->length,
+				   dl->filename,
+				   &error)) {
+		g_warning ("Failed to save icon %s: %s", uri, error->message);
+		return;
+	}
+	gs_cache_add (GS_CACHE_KIND_ICON, dl->filename, msg);
+
+	/* every app using this URL can now load the local file */
+	for (i = 0; i < dl->apps->len; i++) {
+		app = g_ptr_array_index (dl->apps, i);
+		ic = gs_app_get_icon (app);
+		as_icon_set_kind (ic, AS_ICON_KIND_LOCAL);
+		gs_app_load_icon_async (app, plugin->scale);
+	}
+}
+
+/**
+ * gs_plugin_icons_cancelled_cb:
+ *
+ * Only cancels the messages of this refine, as the session is shared.
+ */
+static gboolean
+gs_plugin_icons_cancelled_cb (GCancellable *cancellable, gpointer user_data)
+{
+	GsPluginIconsHelper *helper = (GsPluginIconsHelper *) user_data;
+	SoupMessage *msg;
+	guint i;
+
+	/* backwards, as the callback may remove the message from the array */
+	for (i = helper->msgs->len; i > 0; i--) {
+		msg = g_ptr_array_index (helper->msgs, i - 1);
+		soup_session_cancel_message (helper->plugin->priv->session,
+					     msg, SOUP_STATUS_CANCELLED);
+	}
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * gs_plugin_icons_download_all:
+ *
+ * Downloads all the icons at the same time on the shared session, using a
+ * private main context so that this can be called from the refine thread.
+ */
+static gboolean
+gs_plugin_icons_download_all (GsPlugin *plugin,
+			      GHashTable *downloads,
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	GHashTableIter iter;
+	GsPluginIconsDownload *dl;
+	GsPluginIconsHelper helper;
+	GMainContext *context;
+	GSource *source = NULL;
+	SoupMessage *msg;
+	const gchar *uri;
+	_cleanup_ptrarray_unref_ GPtrArray *msgs = NULL;
 
-	/* create runtime dir and download */
-	if (!gs_mkdir_parent (as_icon_get_filename (ic), error))
+	if (plugin->priv->session == NULL) {
+		g_set_error (error,
+			     GS_PLUGIN_ERROR,
+			     GS_PLUGIN_ERROR_FAILED,
+			     "%s: failed to setup networking",
+			     plugin->name);
 		return FALSE;
-	if (!gs_plugin_icons_download (plugin,
-				       as_icon_get_url (ic),
-				       as_icon_get_filename (ic),
-				       error))
+	}
+
+	/* async operations will use the thread default context */
+	context = g_main_context_new ();
+	g_main_context_push_thread_default (context);
+
+	/* queue all the requests, the session limits the connections */
+	msgs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	helper.plugin = plugin;
+	helper.msgs = msgs;
+	helper.pending = 0;
+	g_hash_table_iter_init (&iter, downloads);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &uri, (gpointer *) &dl)) {
+		msg = soup_message_new (SOUP_METHOD_GET, uri);
+		if (msg == NULL) {
+			g_warning ("%s is not a valid URL", uri);
+			continue;
+		}
+		dl->helper = &helper;
+		helper.pending++;
+		g_ptr_array_add (msgs, g_object_ref (msg));
+		soup_session_queue_message (plugin->priv->session, msg,
+					    gs_plugin_icons_download_cb, dl);
+	}
+
+	/* abort everything that is still in progress when cancelled */
+	if (cancellable != NULL) {
+		source = g_cancellable_source_new (cancellable);
+		g_source_set_callback (source,
+				       (GSourceFunc) gs_plugin_icons_cancelled_cb,
+				       &helper, NULL);
+		g_source_attach (source, context);
+	}
+
+	/* wait for all the callbacks */
+	while (helper.pending > 0)
+		g_main_context_iteration (context, TRUE);
+
+	if (source != NULL) {
+		g_source_destroy (source);
+		g_source_unref (source);
+	}
+	g_main_context_pop_thread_default (context);
+	g_main_context_unref (context);
+
+	/* some of the icons will not have been downloaded */
+	if (g_cancellable_set_error_if_cancelled (cancellable, error))
 		return FALSE;
-	as_icon_set_kind (ic, AS_ICON_KIND_LOCAL);
-	return gs_app_load_icon (app, plugin->scale, error);
+	return TRUE;
 }
 
 /**
@@ -195,20 +313,48 @@ gs_plugin_refine (GsPlugin *plugin,
 		  GCancellable *cancellable,
 		  GError **error)
 {
+	AsIcon *ic;
 	GError *error_local = NULL;
 	GList *l;
 	GsApp *app;
+	GsPluginIconsDownload *dl;
+	_cleanup_hashtable_unref_ GHashTable *downloads = NULL;
 
+	/* each URL is only downloaded once, even if used by many apps */
+	downloads = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					   (GDestroyNotify) gs_plugin_icons_download_free);
 	for (l = *list; l != NULL; l = l->next) {
 		app = GS_APP (l->data);
-		if (gs_app_get_pixbuf (app) != NULL)
+		ic = gs_app_get_icon (app);
+		if (ic == NULL)
 			continue;
-		if (gs_app_get_icon (app) == NULL)
+		if (as_icon_get_kind (ic) != AS_ICON_KIND_REMOTE)
 			continue;
-		if (!gs_plugin_refine_app (plugin, app, &error_local)) {
-			g_warning ("ignoring: %s", error_local->message);
-			g_clear_error (&error_local);
+		if (as_icon_get_url (ic) == NULL)
+			continue;
+		if (as_icon_get_filename (ic) == NULL)
+			continue;
+
+		dl = g_hash_table_lookup (downloads, as_icon_get_url (ic));
+		if (dl == NULL) {
+			/* create runtime dir */
+			if (!gs_mkdir_parent (as_icon_get_filename (ic), &error_local)) {
+				g_warning ("ignoring: %s", error_local->message);
+				g_clear_error (&error_local);
+				continue;
+			}
+			dl = g_slice_new0 (GsPluginIconsDownload);
+			dl->filename = g_strdup (as_icon_get_filename (ic));
+			dl->apps = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+			g_hash_table_insert (downloads,
+					     g_strdup (as_icon_get_url (ic)),
+					     dl);
 		}
+		g_ptr_array_add (dl->apps, g_object_ref (app));
 	}
-	return TRUE;
+
+	/* nothing to do */
+	if (g_hash_table_size (downloads) == 0)
+		return TRUE;
+	return gs_plugin_icons_download_all (plugin, downloads, cancellable, error);
 }
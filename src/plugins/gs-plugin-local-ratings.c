@@ -71,6 +71,35 @@ gs_plugin_get_deps (GsPlugin *plugin)
 	return deps;
 }
 
+/**
+ * gs_plugin_get_refine_provides:
+ */
+GsPluginRefineFlags
+gs_plugin_get_refine_provides (GsPlugin *plugin)
+{
+	return GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING;
+}
+
+/**
+ * gs_plugin_get_refine_reads:
+ */
+GsPluginRefineFields
+gs_plugin_get_refine_reads (GsPlugin *plugin)
+{
+	return GS_PLUGIN_REFINE_FIELD_ID |
+	       GS_PLUGIN_REFINE_FIELD_RATING;
+}
+
+/**
+ * gs_plugin_get_refine_writes:
+ */
+GsPluginRefineFields
+gs_plugin_get_refine_writes (GsPlugin *plugin)
+{
+	return GS_PLUGIN_REFINE_FIELD_RATING |
+	       GS_PLUGIN_REFINE_FIELD_KUDOS;
+}
+
 /**
  * gs_plugin_destroy:
  */
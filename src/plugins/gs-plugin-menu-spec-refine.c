@@ -49,6 +49,34 @@ gs_plugin_get_deps (GsPlugin *plugin)
 	return deps;
 }
 
+/**
+ * gs_plugin_get_refine_provides:
+ */
+GsPluginRefineFlags
+gs_plugin_get_refine_provides (GsPlugin *plugin)
+{
+	return GS_PLUGIN_REFINE_FLAGS_REQUIRE_MENU_PATH;
+}
+
+/**
+ * gs_plugin_get_refine_reads:
+ */
+GsPluginRefineFields
+gs_plugin_get_refine_reads (GsPlugin *plugin)
+{
+	return GS_PLUGIN_REFINE_FIELD_CATEGORIES |
+	       GS_PLUGIN_REFINE_FIELD_MENU_PATH;
+}
+
+/**
+ * gs_plugin_get_refine_writes:
+ */
+GsPluginRefineFields
+gs_plugin_get_refine_writes (GsPlugin *plugin)
+{
+	return GS_PLUGIN_REFINE_FIELD_MENU_PATH;
+}
+
 /**
  * gs_plugin_refine_app_category:
  */
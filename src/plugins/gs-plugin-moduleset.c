@@ -243,12 +243,9 @@ gs_plugin_refine (GsPlugin *plugin,
 {
 	GList *l;
 	GsApp *app;
+	GsModuleset *moduleset = plugin->priv->moduleset;
+	const gchar *id;
 	gboolean ret = TRUE;
-	guint i;
-	_cleanup_strv_free_ gchar **featured_apps = NULL;
-	_cleanup_strv_free_ gchar **popular_apps = NULL;
-	_cleanup_strv_free_ gchar **system_apps = NULL;
-	_cleanup_strv_free_ gchar **core_pkgs = NULL;
 
 	/* load XML files */
 	if (g_once_init_enter (&plugin->priv->done_init)) {
@@ -258,54 +255,33 @@ gs_plugin_refine (GsPlugin *plugin,
 			return FALSE;
 	}
 
-	featured_apps = gs_moduleset_get_featured_apps (plugin->priv->moduleset, NULL);
-	popular_apps = gs_moduleset_get_popular_apps (plugin->priv->moduleset);
-	system_apps = gs_moduleset_get_system_apps (plugin->priv->moduleset);
-	core_pkgs = gs_moduleset_get_core_packages (plugin->priv->moduleset);
-	if (featured_apps == NULL ||
-	    popular_apps == NULL ||
-	    system_apps == NULL ||
-	    core_pkgs == NULL) {
-		g_set_error (error,
-			     GS_PLUGIN_ERROR,
-			     GS_PLUGIN_ERROR_FAILED,
-			     "No moduleset data found");
-		return FALSE;
-	}
-
 	for (l = *list; l != NULL; l = l->next) {
 		app = GS_APP (l->data);
-
-		/* add a kudo to featured apps */
-		for (i = 0; featured_apps[i] != NULL; i++) {
-			if (g_strcmp0 (featured_apps[i], gs_app_get_id (app)) == 0) {
-				gs_app_add_kudo (app, GS_APP_KUDO_FEATURED_RECOMMENDED);
-				break;
-			}
-		}
-
-		/* add a kudo to popular apps */
-		for (i = 0; popular_apps[i] != NULL; i++) {
-			if (g_strcmp0 (popular_apps[i], gs_app_get_id (app)) == 0) {
-				gs_app_add_kudo (app, GS_APP_KUDO_FEATURED_RECOMMENDED);
-				break;
-			}
+		id = gs_app_get_id (app);
+
+		/* add a kudo to featured and popular apps */
+		if (gs_moduleset_has_module (moduleset,
+					     GS_MODULESET_MODULE_KIND_APPLICATION,
+					     "featured", id) ||
+		    gs_moduleset_has_module (moduleset,
+					     GS_MODULESET_MODULE_KIND_APPLICATION,
+					     "popular", id)) {
+			gs_app_add_kudo (app, GS_APP_KUDO_FEATURED_RECOMMENDED);
 		}
 
 		/* mark each one as system */
-		for (i = 0; system_apps[i] != NULL; i++) {
-			if (g_strcmp0 (system_apps[i], gs_app_get_id (app)) == 0) {
-				gs_app_set_kind (app, GS_APP_KIND_SYSTEM);
-				break;
-			}
+		if (gs_moduleset_has_module (moduleset,
+					     GS_MODULESET_MODULE_KIND_APPLICATION,
+					     "system", id)) {
+			gs_app_set_kind (app, GS_APP_KIND_SYSTEM);
 		}
 
 		/* mark each one as core */
-		for (i = 0; core_pkgs[i] != NULL; i++) {
-			if (g_strcmp0 (core_pkgs[i], gs_app_get_source_default (app)) == 0) {
-				gs_app_set_kind (app, GS_APP_KIND_CORE);
-				break;
-			}
+		if (gs_moduleset_has_module (moduleset,
+					     GS_MODULESET_MODULE_KIND_PACKAGE,
+					     "core",
+					     gs_app_get_source_default (app))) {
+			gs_app_set_kind (app, GS_APP_KIND_CORE);
 		}
 	}
 
@@ -65,6 +65,39 @@ gs_plugin_get_deps (GsPlugin *plugin)
 	return deps;
 }
 
+/**
+ * gs_plugin_get_refine_provides:
+ */
+GsPluginRefineFlags
+gs_plugin_get_refine_provides (GsPlugin *plugin)
+{
+	return GS_PLUGIN_REFINE_FLAGS_REQUIRE_HISTORY;
+}
+
+/**
+ * gs_plugin_get_refine_reads:
+ */
+GsPluginRefineFields
+gs_plugin_get_refine_reads (GsPlugin *plugin)
+{
+	return GS_PLUGIN_REFINE_FIELD_ID |
+	       GS_PLUGIN_REFINE_FIELD_NAME |
+	       GS_PLUGIN_REFINE_FIELD_STATE |
+	       GS_PLUGIN_REFINE_FIELD_SOURCES |
+	       GS_PLUGIN_REFINE_FIELD_VERSION |
+	       GS_PLUGIN_REFINE_FIELD_INSTALL_DATE;
+}
+
+/**
+ * gs_plugin_get_refine_writes:
+ */
+GsPluginRefineFields
+gs_plugin_get_refine_writes (GsPlugin *plugin)
+{
+	return GS_PLUGIN_REFINE_FIELD_INSTALL_DATE |
+	       GS_PLUGIN_REFINE_FIELD_HISTORY;
+}
+
 /**
  * gs_plugin_destroy:
  */
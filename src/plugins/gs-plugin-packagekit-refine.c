@@ -154,9 +154,10 @@ gs_plugin_packagekit_set_origin (GsPlugin *plugin,
  **/
 static void
 gs_plugin_packagekit_resolve_packages_app (GsPlugin *plugin,
-					   GPtrArray *packages,
+					   GHashTable *packages_by_name,
 					   GsApp *app)
 {
+	GPtrArray *packages;
 	GPtrArray *sources;
 	PkPackage *package;
 	const gchar *data;
@@ -171,47 +172,48 @@ gs_plugin_packagekit_resolve_packages_app (GsPlugin *plugin,
 	sources = gs_app_get_sources (app);
 	for (j = 0; j < sources->len; j++) {
 		pkgname = g_ptr_array_index (sources, j);
+		packages = g_hash_table_lookup (packages_by_name, pkgname);
+		if (packages == NULL)
+			continue;
 		for (i = 0; i < packages->len; i++) {
 			package = g_ptr_array_index (packages, i);
-			if (g_strcmp0 (pk_package_get_name (package), pkgname) == 0) {
-				gs_app_set_management_plugin (app, "PackageKit");
-				gs_app_add_source_id (app, pk_package_get_id (package));
-				switch (pk_package_get_info (package)) {
-				case PK_INFO_ENUM_INSTALLED:
-					number_installed++;
-					data = pk_package_get_data (package);
-					if (g_str_has_prefix (data, "installed:")) {
-						gs_plugin_packagekit_set_origin (plugin,
-										 app,
-										 data + 10);
-					}
-					break;
-				case PK_INFO_ENUM_AVAILABLE:
-					number_available++;
-					break;
+			gs_app_set_management_plugin (app, "PackageKit");
+			gs_app_add_source_id (app, pk_package_get_id (package));
+			switch (pk_package_get_info (package)) {
+			case PK_INFO_ENUM_INSTALLED:
+				number_installed++;
+				data = pk_package_get_data (package);
+				if (g_str_has_prefix (data, "installed:")) {
+					gs_plugin_packagekit_set_origin (plugin,
+									 app,
+									 data + 10);
+				}
+				break;
+			case PK_INFO_ENUM_AVAILABLE:
+				number_available++;
+				break;
 #if PK_CHECK_VERSION(1,0,4)
-				case PK_INFO_ENUM_UNAVAILABLE:
-					data = pk_package_get_data (package);
-					gs_plugin_packagekit_set_origin (plugin, app, data);
-					gs_app_set_state (app, AS_APP_STATE_UNAVAILABLE);
-					gs_app_set_size (app, GS_APP_SIZE_MISSING);
-					number_available++;
-					break;
+			case PK_INFO_ENUM_UNAVAILABLE:
+				data = pk_package_get_data (package);
+				gs_plugin_packagekit_set_origin (plugin, app, data);
+				gs_app_set_state (app, AS_APP_STATE_UNAVAILABLE);
+				gs_app_set_size (app, GS_APP_SIZE_MISSING);
+				number_available++;
+				break;
 #endif
-				default:
-					/* should we expect anything else? */
-					break;
-				}
-				if (gs_app_get_version (app) == NULL)
-					gs_app_set_version (app,
-						pk_package_get_version (package));
-				gs_app_set_name (app,
-						 GS_APP_QUALITY_LOWEST,
-						 pk_package_get_name (package));
-				gs_app_set_summary (app,
-						    GS_APP_QUALITY_LOWEST,
-						    pk_package_get_summary (package));
+			default:
+				/* should we expect anything else? */
+				break;
 			}
+			if (gs_app_get_version (app) == NULL)
+				gs_app_set_version (app,
+					pk_package_get_version (package));
+			gs_app_set_name (app,
+					 GS_APP_QUALITY_LOWEST,
+					 pk_package_get_name (package));
+			gs_app_set_summary (app,
+					    GS_APP_QUALITY_LOWEST,
+					    pk_package_get_summary (package));
 		}
 	}
 
@@ -251,8 +253,10 @@ gs_plugin_packagekit_resolve_packages (GsPlugin *plugin,
 	GList *l;
 	GPtrArray *sources;
 	GsApp *app;
+	PkPackage *package;
 	const gchar *pkgname;
 	guint i;
+	_cleanup_hashtable_unref_ GHashTable *packages_by_name = NULL;
 	_cleanup_object_unref_ PkError *error_code = NULL;
 	_cleanup_object_unref_ PkResults *results = NULL;
 	_cleanup_ptrarray_unref_ GPtrArray *package_ids = NULL;
@@ -291,28 +295,63 @@ gs_plugin_packagekit_resolve_packages (GsPlugin *plugin,
 		return FALSE;
 	}
 
-	/* get results */
+	/* index the results by package name so each app is a lookup */
 	packages = pk_results_get_package_array (results);
+	packages_by_name = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  NULL, (GDestroyNotify) g_ptr_array_unref);
+	for (i = 0; i < packages->len; i++) {
+		GPtrArray *tmp;
+		package = g_ptr_array_index (packages, i);
+		tmp = g_hash_table_lookup (packages_by_name,
+					   pk_package_get_name (package));
+		if (tmp == NULL) {
+			tmp = g_ptr_array_new ();
+			g_hash_table_insert (packages_by_name,
+					     (gpointer) pk_package_get_name (package),
+					     tmp);
+		}
+		g_ptr_array_add (tmp, package);
+	}
 	for (l = list; l != NULL; l = l->next) {
 		app = GS_APP (l->data);
-		gs_plugin_packagekit_resolve_packages_app (plugin, packages, app);
+		gs_plugin_packagekit_resolve_packages_app (plugin, packages_by_name, app);
 	}
 	return TRUE;
 }
 
+/**
+ * gs_plugin_packagekit_refine_from_desktop:
+ *
+ * Finds the installed packages that own the desktop files of @list in one
+ * transaction, then gets the file lists of those packages in a second one
+ * to work out which package each desktop file came from.
+ */
 static gboolean
 gs_plugin_packagekit_refine_from_desktop (GsPlugin *plugin,
-					  GsApp	 *app,
-					  const gchar *filename,
+					  GList *list,
 					  GCancellable *cancellable,
 					  GError **error)
 {
-	const gchar *to_array[] = { NULL, NULL };
+	GList *l;
+	PkPackage *package;
+	guint i;
+	_cleanup_free_ const gchar **to_array = NULL;
+	_cleanup_hashtable_unref_ GHashTable *filenames = NULL;
 	_cleanup_object_unref_ PkError *error_code = NULL;
 	_cleanup_object_unref_ PkResults *results = NULL;
+	_cleanup_object_unref_ PkResults *results_files = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *files_array = NULL;
 	_cleanup_ptrarray_unref_ GPtrArray *packages = NULL;
+	_cleanup_strv_free_ gchar **package_ids = NULL;
 
-	to_array[0] = filename;
+	/* the same desktop file can be shared by more than one #GsApp */
+	filenames = g_hash_table_new (g_str_hash, g_str_equal);
+	for (l = list; l != NULL; l = l->next) {
+		g_hash_table_add (filenames,
+				  (gpointer) gs_app_get_metadata_item (GS_APP (l->data),
+								       "DataDir::desktop-filename"));
+	}
+	to_array = (const gchar **) g_hash_table_get_keys_as_array (filenames, NULL);
 	results = pk_client_search_files (plugin->priv->client,
 					  pk_bitfield_from_enums (PK_FILTER_ENUM_INSTALLED, -1),
 					  (gchar **) to_array,
@@ -334,18 +373,37 @@ gs_plugin_packagekit_refine_from_desktop (GsPlugin *plugin,
 		return FALSE;
 	}
 
-	/* get results */
+	/* find out which of the desktop files each package owns */
 	packages = pk_results_get_package_array (results);
-	if (packages->len == 1) {
-		PkPackage *package;
-		package = g_ptr_array_index (packages, 0);
-		gs_app_add_source_id (app, pk_package_get_id (package));
-		gs_app_set_state (app, AS_APP_STATE_INSTALLED);
-		gs_app_set_management_plugin (app, "PackageKit");
+	if (packages->len == 0) {
+		files_array = g_ptr_array_new ();
 	} else {
-		g_warning ("Failed to find one package for %s, %s, [%d]",
-			   gs_app_get_id (app), filename, packages->len);
+		package_ids = g_new0 (gchar *, packages->len + 1);
+		for (i = 0; i < packages->len; i++) {
+			package = g_ptr_array_index (packages, i);
+			package_ids[i] = g_strdup (pk_package_get_id (package));
+		}
+		results_files = pk_client_get_files (plugin->priv->client,
+						     package_ids,
+						     cancellable,
+						     gs_plugin_packagekit_progress_cb, plugin,
+						     error);
+		if (results_files == NULL)
+			return FALSE;
+		g_clear_object (&error_code);
+		error_code = pk_results_get_error_code (results_files);
+		if (error_code != NULL) {
+			g_set_error (error,
+				     GS_PLUGIN_ERROR,
+				     GS_PLUGIN_ERROR_FAILED,
+				     "failed to get files: %s, %s",
+				     pk_error_enum_to_string (pk_error_get_code (error_code)),
+				     pk_error_get_details (error_code));
+			return FALSE;
+		}
+		files_array = pk_results_get_files_array (results_files);
 	}
+	gs_plugin_packagekit_add_desktop_sources (list, files_array);
 	return TRUE;
 }
 
@@ -416,26 +474,53 @@ gs_pk_format_desc (const gchar *text)
 }
 
 /**
- * gs_pk_compare_ids:
+ * gs_pk_package_id_hash:
+ *
+ * Only hash the name, version and arch. Some backends do not append the
+ * origin, so the data section of the package-id is ignored.
+ */
+static guint
+gs_pk_package_id_hash (gconstpointer key)
+{
+	const gchar *p;
+	guint hash = 5381;
+	guint sections = 0;
+
+	for (p = key; *p != '\0'; p++) {
+		if (*p == ';' && ++sections == 3)
+			break;
+		hash = (hash << 5) + hash + (guint) *p;
+	}
+	return hash;
+}
+
+/**
+ * gs_pk_package_id_equal:
  *
  * Do not compare the repo. Some backends do not append the origin.
  */
 static gboolean
-gs_pk_compare_ids (const gchar *package_id1, const gchar *package_id2)
+gs_pk_package_id_equal (gconstpointer a, gconstpointer b)
 {
-	gboolean ret;
-	_cleanup_strv_free_ gchar **split1 = NULL;
-	_cleanup_strv_free_ gchar **split2 = NULL;
-
-	split1 = pk_package_id_split (package_id1);
-	split2 = pk_package_id_split (package_id2);
-	ret = (g_strcmp0 (split1[PK_PACKAGE_ID_NAME],
-			  split2[PK_PACKAGE_ID_NAME]) == 0 &&
-	       g_strcmp0 (split1[PK_PACKAGE_ID_VERSION],
-			  split2[PK_PACKAGE_ID_VERSION]) == 0 &&
-	       g_strcmp0 (split1[PK_PACKAGE_ID_ARCH],
-			  split2[PK_PACKAGE_ID_ARCH]) == 0);
-	return ret;
+	const gchar *p1 = a;
+	const gchar *p2 = b;
+	guint sections = 0;
+
+	for (; *p1 == *p2; p1++, p2++) {
+		if (*p1 == '\0')
+			return TRUE;
+		if (*p1 == ';' && ++sections == 3)
+			return TRUE;
+	}
+
+	/* one package-id may have no trailing data section at all */
+	if (sections == 2) {
+		if (*p1 == '\0' && *p2 == ';')
+			return TRUE;
+		if (*p1 == ';' && *p2 == '\0')
+			return TRUE;
+	}
+	return FALSE;
 }
 
 /**
@@ -443,44 +528,39 @@ gs_pk_compare_ids (const gchar *package_id1, const gchar *package_id2)
  */
 static void
 gs_plugin_packagekit_refine_details_app (GsPlugin *plugin,
-					 GPtrArray *array,
+					 GHashTable *details_by_id,
 					 GsApp *app)
 {
 	GPtrArray *source_ids;
 	PkDetails *details;
 	const gchar *package_id;
-	guint i;
 	guint j;
 	guint64 size = 0;
 
 	source_ids = gs_app_get_source_ids (app);
 	for (j = 0; j < source_ids->len; j++) {
+		_cleanup_free_ gchar *desc = NULL;
+
+		/* right package? */
 		package_id = g_ptr_array_index (source_ids, j);
-		for (i = 0; i < array->len; i++) {
-			_cleanup_free_ gchar *desc = NULL;
-			/* right package? */
-			details = g_ptr_array_index (array, i);
-			if (!gs_pk_compare_ids (package_id,
-						pk_details_get_package_id (details))) {
-				continue;
-			}
-			if (gs_app_get_licence (app) == NULL)
-				gs_app_set_licence (app, pk_details_get_license (details));
-			if (gs_app_get_url (app, AS_URL_KIND_HOMEPAGE) == NULL) {
-				gs_app_set_url (app,
-						AS_URL_KIND_HOMEPAGE,
-						pk_details_get_url (details));
-			}
-			size += pk_details_get_size (details);
-			desc = gs_pk_format_desc (pk_details_get_description (details));
-			gs_app_set_description (app,
-						GS_APP_QUALITY_LOWEST,
-						desc);
-			gs_app_set_summary (app,
-					    GS_APP_QUALITY_LOWEST,
-					    pk_details_get_summary (details));
-			break;
+		details = g_hash_table_lookup (details_by_id, package_id);
+		if (details == NULL)
+			continue;
+		if (gs_app_get_licence (app) == NULL)
+			gs_app_set_licence (app, pk_details_get_license (details));
+		if (gs_app_get_url (app, AS_URL_KIND_HOMEPAGE) == NULL) {
+			gs_app_set_url (app,
+					AS_URL_KIND_HOMEPAGE,
+					pk_details_get_url (details));
 		}
+		size += pk_details_get_size (details);
+		desc = gs_pk_format_desc (pk_details_get_description (details));
+		gs_app_set_description (app,
+					GS_APP_QUALITY_LOWEST,
+					desc);
+		gs_app_set_summary (app,
+				    GS_APP_QUALITY_LOWEST,
+				    pk_details_get_summary (details));
 	}
 
 	/* the size is the size of all sources */
@@ -500,8 +580,10 @@ gs_plugin_packagekit_refine_details (GsPlugin *plugin,
 	GList *l;
 	GPtrArray *source_ids;
 	GsApp *app;
+	PkDetails *details;
 	const gchar *package_id;
 	guint i;
+	_cleanup_hashtable_unref_ GHashTable *details_by_id = NULL;
 	_cleanup_ptrarray_unref_ GPtrArray *array = NULL;
 	_cleanup_ptrarray_unref_ GPtrArray *package_ids = NULL;
 	_cleanup_object_unref_ PkResults *results = NULL;
@@ -526,11 +608,22 @@ gs_plugin_packagekit_refine_details (GsPlugin *plugin,
 	if (results == NULL)
 		return FALSE;
 
-	/* set the update details for the update */
+	/* index by name;version;arch, keeping the first match */
 	array = pk_results_get_details_array (results);
+	details_by_id = g_hash_table_new (gs_pk_package_id_hash,
+					  gs_pk_package_id_equal);
+	for (i = 0; i < array->len; i++) {
+		details = g_ptr_array_index (array, i);
+		package_id = pk_details_get_package_id (details);
+		if (g_hash_table_contains (details_by_id, package_id))
+			continue;
+		g_hash_table_insert (details_by_id, (gpointer) package_id, details);
+	}
+
+	/* set the update details for the update */
 	for (l = list; l != NULL; l = l->next) {
 		app = GS_APP (l->data);
-		gs_plugin_packagekit_refine_details_app (plugin, array, app);
+		gs_plugin_packagekit_refine_details_app (plugin, details_by_id, app);
 	}
 	return TRUE;
 }
@@ -705,6 +798,7 @@ gs_plugin_refine (GsPlugin *plugin,
 	const gchar *profile_id = NULL;
 	const gchar *tmp;
 	gboolean ret = TRUE;
+	_cleanup_list_free_ GList *desktop_all = NULL;
 	_cleanup_list_free_ GList *resolve_all = NULL;
 	_cleanup_list_free_ GList *updatedetails_all = NULL;
 
@@ -758,9 +852,11 @@ gs_plugin_refine (GsPlugin *plugin,
 		tmp = gs_app_get_metadata_item (app, "DataDir::desktop-filename");
 		if (tmp == NULL)
 			continue;
+		desktop_all = g_list_prepend (desktop_all, app);
+	}
+	if (desktop_all != NULL) {
 		ret = gs_plugin_packagekit_refine_from_desktop (plugin,
-								app,
-								tmp,
+								desktop_all,
 								cancellable,
 								error);
 		if (!ret)
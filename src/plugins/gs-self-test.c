@@ -63,6 +63,24 @@ moduleset_func (void)
 	g_assert_cmpint (g_strv_length (data), ==, 1);
 	g_assert_cmpstr (data[0], ==, "gnome-shell.desktop");
 	g_assert_cmpstr (data[1], ==, NULL);
+
+	/* check the index */
+	g_assert (gs_moduleset_has_module (ms,
+					   GS_MODULESET_MODULE_KIND_APPLICATION,
+					   "gnome3",
+					   "gnome-shell.desktop"));
+	g_assert (gs_moduleset_has_module (ms,
+					   GS_MODULESET_MODULE_KIND_PACKAGE,
+					   "gnome3",
+					   "kernel"));
+	g_assert (!gs_moduleset_has_module (ms,
+					    GS_MODULESET_MODULE_KIND_PACKAGE,
+					    "gnome3",
+					    "gnome-shell.desktop"));
+	g_assert (!gs_moduleset_has_module (ms,
+					    GS_MODULESET_MODULE_KIND_APPLICATION,
+					    "featured",
+					    "gnome-shell.desktop"));
 }
 
 int
@@ -172,3 +172,85 @@ gs_plugin_packagekit_add_results (GsPlugin *plugin,
 	}
 	return TRUE;
 }
+
+/**
+ * gs_plugin_packagekit_add_desktop_sources:
+ *
+ * Gives each application in @list the package that owns the file in its
+ * DataDir::desktop-filename metadata, using the file lists of the
+ * packages in @files_array. A desktop file that is not owned by exactly
+ * one of those packages is ignored.
+ */
+void
+gs_plugin_packagekit_add_desktop_sources (GList *list, GPtrArray *files_array)
+{
+	GHashTableIter iter;
+	GList *l;
+	GPtrArray *apps;
+	GPtrArray *owners;
+	GsApp *app;
+	PkFiles *files;
+	const gchar *filename;
+	gchar **filenames;
+	guint i;
+	guint j;
+	_cleanup_hashtable_unref_ GHashTable *apps_by_filename = NULL;
+	_cleanup_hashtable_unref_ GHashTable *owners_by_filename = NULL;
+
+	/* the same desktop file can be shared by more than one #GsApp */
+	apps_by_filename = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  NULL, (GDestroyNotify) g_ptr_array_unref);
+	for (l = list; l != NULL; l = l->next) {
+		app = GS_APP (l->data);
+		filename = gs_app_get_metadata_item (app, "DataDir::desktop-filename");
+		if (filename == NULL)
+			continue;
+		apps = g_hash_table_lookup (apps_by_filename, filename);
+		if (apps == NULL) {
+			apps = g_ptr_array_new ();
+			g_hash_table_insert (apps_by_filename, (gpointer) filename, apps);
+		}
+		g_ptr_array_add (apps, app);
+	}
+
+	/* find out which of the desktop files each package owns */
+	owners_by_filename = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    NULL, (GDestroyNotify) g_ptr_array_unref);
+	for (i = 0; i < files_array->len; i++) {
+		files = g_ptr_array_index (files_array, i);
+		filenames = pk_files_get_files (files);
+		for (j = 0; filenames != NULL && filenames[j] != NULL; j++) {
+			if (!g_hash_table_lookup_extended (apps_by_filename,
+							   filenames[j],
+							   (gpointer *) &filename,
+							   NULL))
+				continue;
+			owners = g_hash_table_lookup (owners_by_filename, filename);
+			if (owners == NULL) {
+				owners = g_ptr_array_new ();
+				g_hash_table_insert (owners_by_filename,
+						     (gpointer) filename,
+						     owners);
+			}
+			g_ptr_array_add (owners, (gpointer) pk_files_get_package_id (files));
+		}
+	}
+
+	/* only trust a desktop file owned by exactly one package */
+	g_hash_table_iter_init (&iter, apps_by_filename);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &filename, (gpointer *) &apps)) {
+		owners = g_hash_table_lookup (owners_by_filename, filename);
+		for (i = 0; i < apps->len; i++) {
+			app = g_ptr_array_index (apps, i);
+			if (owners == NULL || owners->len != 1) {
+				g_warning ("Failed to find one package for %s, %s, [%d]",
+					   gs_app_get_id (app), filename,
+					   owners != NULL ? owners->len : 0);
+				continue;
+			}
+			gs_app_add_source_id (app, g_ptr_array_index (owners, 0));
+			gs_app_set_state (app, AS_APP_STATE_INSTALLED);
+			gs_app_set_management_plugin (app, "PackageKit");
+		}
+	}
+}
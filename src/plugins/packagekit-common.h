@@ -36,6 +36,8 @@ gboolean	gs_plugin_packagekit_add_results	(GsPlugin	*plugin,
 							 GList		**list,
 							 PkResults	*results,
 							 GError		**error);
+void		gs_plugin_packagekit_add_desktop_sources (GList		*list,
+							 GPtrArray	*files_array);
 
 G_END_DECLS
 